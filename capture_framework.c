@@ -399,6 +399,14 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
     ch->channel_hop_failure_list = NULL;
     ch->channel_hop_failure_list_sz = 0;
 
+    /* Batching is off until the server asks for it */
+    pthread_mutex_init(&(ch->batch_lock), NULL);
+    ch->batch_max_packets = 0;
+    ch->batch_max_latency_ms = 0;
+    ch->batch_buf = NULL;
+    ch->batch_len = 0;
+    ch->batch_count = 0;
+
     return ch;
 }
 
@@ -466,8 +474,12 @@ void cf_handler_free(kis_capture_handler_t *caph) {
         caph->hopping_running = 0;
     }
 
+    if (caph->batch_buf != NULL)
+        free(caph->batch_buf);
+
     pthread_mutex_destroy(&(caph->out_ringbuf_lock));
     pthread_mutex_destroy(&(caph->handler_lock));
+    pthread_mutex_destroy(&(caph->batch_lock));
 }
 
 cf_params_interface_t *cf_params_interface_new() {
@@ -1426,6 +1438,14 @@ int cf_handle_rx_data(kis_capture_handler_t *caph) {
                 cbret = -1;
                 goto finish;
             }
+
+            /* Pick up the batching parameters if the server supports them */
+            pthread_mutex_lock(&(caph->batch_lock));
+            if (open_cmd->has_batch_max_packets)
+                caph->batch_max_packets = open_cmd->batch_max_packets;
+            if (open_cmd->has_batch_max_latency_ms)
+                caph->batch_max_latency_ms = open_cmd->batch_max_latency_ms;
+            pthread_mutex_unlock(&(caph->batch_lock));
             
             msgstr[0] = 0;
             cbret = (*(caph->open_cb))(caph,
@@ -1965,6 +1985,8 @@ int cf_handler_remote_connect(kis_capture_handler_t *caph) {
     return 1;
 }
 
+static long cf_handler_service_batch(kis_capture_handler_t *caph, int force);
+
 int cf_handler_loop(kis_capture_handler_t *caph) {
     fd_set rset, wset;
     int max_fd;
@@ -1973,6 +1995,7 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
     int spindown;
     int ret;
     int rv = 0;
+    long batch_wait;
 
     if (caph->tcp_fd >= 0) {
         read_fd = caph->tcp_fd;
@@ -2017,6 +2040,15 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
 
         pthread_mutex_unlock(&(caph->handler_lock));
 
+        /* Push out any batched reports which have waited long enough, or everything 
+         * if we're spinning down */
+        batch_wait = cf_handler_service_batch(caph, spindown);
+
+        if (batch_wait == -2) {
+            rv = -1;
+            break;
+        }
+
         max_fd = 0;
 
         /* Only set read sets if we're not spinning down */
@@ -2044,6 +2076,10 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
         tm.tv_sec = 0;
         tm.tv_usec = 500000;
 
+        /* Wake up in time to flush the pending batch */
+        if (batch_wait >= 0 && batch_wait < tm.tv_usec)
+            tm.tv_usec = batch_wait;
+
         if ((ret = select(max_fd + 1, &rset, &wset, NULL, &tm)) < 0) {
             if (errno != EINTR && errno != EAGAIN) {
                 fprintf(stderr, "FATAL:  Error during select(): %s\n", strerror(errno));
@@ -2213,7 +2249,8 @@ int cf_send_raw_bytes(kis_capture_handler_t *caph, uint8_t *data, size_t len) {
     return 1;
 }
 
-int cf_send_packet(kis_capture_handler_t *caph, const char *packtype,
+/* Frame and send a command, leaving the content buffer owned by the caller */
+static int cf_send_frame(kis_capture_handler_t *caph, const char *packtype,
         uint8_t *data, size_t len) {
     uint32_t seqno;
     KismetExternal__Command cmd;
@@ -2249,7 +2286,6 @@ int cf_send_packet(kis_capture_handler_t *caph, const char *packtype,
     if (send_buffer == NULL) {
         fprintf(stderr, "FATAL:  Unable to allocate the buffer for writing a packet");
         free(cmd.command);
-        free(data);
         return -1;
     }
 
@@ -2272,12 +2308,160 @@ int cf_send_packet(kis_capture_handler_t *caph, const char *packtype,
     r = cf_send_raw_bytes(caph, send_buffer, data_sz + sizeof(kismet_external_frame_t));
 
     free(send_buffer);
-    free(data);
     free(cmd.command);
 
     return r;
 }
 
+int cf_send_packet(kis_capture_handler_t *caph, const char *packtype,
+        uint8_t *data, size_t len) {
+    int r;
+
+    r = cf_send_frame(caph, packtype, data, len);
+
+    free(data);
+
+    return r;
+}
+
+/* Flush the pending batch; batch_lock must be held */
+static int cf_flush_datareport_batch_locked(kis_capture_handler_t *caph) {
+    int r;
+
+    if (caph->batch_count == 0)
+        return 1;
+
+    r = cf_send_frame(caph, "KDSDATAREPORTBATCH", caph->batch_buf, caph->batch_len);
+
+    /* Keep the batch (and the buffer) around to try again if the ringbuf is full */
+    if (r > 0) {
+        caph->batch_len = 0;
+        caph->batch_count = 0;
+    }
+
+    return r;
+}
+
+int cf_flush_datareport_batch(kis_capture_handler_t *caph) {
+    int r;
+
+    pthread_mutex_lock(&(caph->batch_lock));
+    r = cf_flush_datareport_batch_locked(caph);
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return r;
+}
+
+int cf_send_datareport(kis_capture_handler_t *caph, uint8_t *data, size_t len) {
+    /* Length-delimited field 1 header; tag plus up to a 5 byte varint */
+    uint8_t hdr[6];
+    size_t hdr_len = 0;
+    size_t vlen = len;
+    int r;
+
+    pthread_mutex_lock(&(caph->batch_lock));
+
+    if (caph->batch_max_packets <= 1) {
+        pthread_mutex_unlock(&(caph->batch_lock));
+        return cf_send_packet(caph, "KDSDATAREPORT", data, len);
+    }
+
+    hdr[hdr_len++] = (1 << 3) | 2;
+    do {
+        hdr[hdr_len] = vlen & 0x7F;
+        vlen >>= 7;
+        if (vlen != 0)
+            hdr[hdr_len] |= 0x80;
+        hdr_len++;
+    } while (vlen != 0);
+
+    /* Anything already batched has to go out first to keep the reports in order 
+     * if this one won't fit, or if the batch is already full from a previous failed 
+     * flush */
+    if (caph->batch_count >= caph->batch_max_packets || 
+            caph->batch_len + hdr_len + len > CF_BATCH_MAX_BYTES) {
+        if ((r = cf_flush_datareport_batch_locked(caph)) <= 0) {
+            pthread_mutex_unlock(&(caph->batch_lock));
+            free(data);
+            return r;
+        }
+    }
+
+    /* Too large to batch at all */
+    if (hdr_len + len > CF_BATCH_MAX_BYTES) {
+        pthread_mutex_unlock(&(caph->batch_lock));
+        return cf_send_packet(caph, "KDSDATAREPORT", data, len);
+    }
+
+    if (caph->batch_buf == NULL) {
+        caph->batch_buf = (uint8_t *) malloc(CF_BATCH_MAX_BYTES);
+
+        if (caph->batch_buf == NULL) {
+            pthread_mutex_unlock(&(caph->batch_lock));
+            fprintf(stderr, "FATAL:  Unable to allocate the data report batch buffer\n");
+            free(data);
+            return -1;
+        }
+    }
+
+    if (caph->batch_count == 0)
+        gettimeofday(&(caph->batch_first_ts), NULL);
+
+    memcpy(caph->batch_buf + caph->batch_len, hdr, hdr_len);
+    memcpy(caph->batch_buf + caph->batch_len + hdr_len, data, len);
+    caph->batch_len += hdr_len + len;
+    caph->batch_count++;
+
+    free(data);
+
+    /* The report is queued regardless; if the ringbuf is full the batch is retried on 
+     * the next report or by the main loop */
+    r = 1;
+    if (caph->batch_count >= caph->batch_max_packets)
+        r = cf_flush_datareport_batch_locked(caph) < 0 ? -1 : 1;
+
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return r;
+}
+
+/* Flush the pending batch if it has hit the latency limit (or unconditionally if
+ * forced); returns the number of microseconds until the batch needs to be flushed, -1
+ * if there is no pending batch, or -2 on error */
+static long cf_handler_service_batch(kis_capture_handler_t *caph, int force) {
+    struct timeval now;
+    long waited_usec, max_usec;
+    long rv = -1;
+
+    pthread_mutex_lock(&(caph->batch_lock));
+
+    if (caph->batch_count == 0) {
+        pthread_mutex_unlock(&(caph->batch_lock));
+        return -1;
+    }
+
+    gettimeofday(&now, NULL);
+
+    waited_usec = (now.tv_sec - caph->batch_first_ts.tv_sec) * 1000000L +
+        (now.tv_usec - caph->batch_first_ts.tv_usec);
+    max_usec = (long) caph->batch_max_latency_ms * 1000L;
+
+    if (force || waited_usec >= max_usec) {
+        int r = cf_flush_datareport_batch_locked(caph);
+
+        if (r < 0)
+            rv = -2;
+        else if (r == 0)
+            rv = 1000;  /* ringbuf is full; retry shortly */
+    } else {
+        rv = max_usec - waited_usec;
+    }
+
+    pthread_mutex_unlock(&(caph->batch_lock));
+
+    return rv;
+}
+
 int cf_send_message(kis_capture_handler_t *caph, const char *msg, unsigned int flags) {
     KismetExternal__MsgbusMessage kemsg;
     uint8_t *buf;
@@ -2747,7 +2931,7 @@ int cf_send_data(kis_capture_handler_t *caph,
     if (kegps.type != NULL)
         free(kegps.type);
 
-    return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
+    return cf_send_datareport(caph, buf, buf_len);
 }
 
 int cf_send_json(kis_capture_handler_t *caph,
@@ -2817,7 +3001,7 @@ int cf_send_json(kis_capture_handler_t *caph,
     if (kegps.type != NULL)
         free(kegps.type);
 
-    return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
+    return cf_send_datareport(caph, buf, buf_len);
 }
 
 
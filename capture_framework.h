@@ -346,8 +346,23 @@ struct kis_capture_handler {
 
     /* Fixed GPS name */
     char *gps_name;
+
+    /* Batched data reports, if negotiated by the server in the OPENSOURCE command;
+     * packed reports are accumulated in the batch buffer as an encoded 
+     * DataReportBatch and flushed when the count, size, or latency limit is hit */
+    pthread_mutex_t batch_lock;
+    unsigned int batch_max_packets;
+    unsigned int batch_max_latency_ms;
+    uint8_t *batch_buf;
+    size_t batch_len;
+    unsigned int batch_count;
+    struct timeval batch_first_ts;
 };
 
+/* Maximum encoded size of a data report batch; this must fit comfortably in the
+ * outbound ring buffer */
+#define CF_BATCH_MAX_BYTES      (1024 * 64)
+
 
 struct cf_params_interface {
     char *capif;
@@ -671,6 +686,30 @@ int cf_send_raw_bytes(kis_capture_handler_t *caph, uint8_t *data, size_t len);
 int cf_send_packet(kis_capture_handler_t *caph, const char *packtype,
         uint8_t *data, size_t len);
 
+/* Send a packed DataReport, either directly as a KDSDATAREPORT or by appending it
+ * to the pending KDSDATAREPORTBATCH if the server negotiated batching.
+ * May be called from any thread.
+ *
+ * The supplied data WILL BE FREED regardless of the success of transmitting
+ * the report.
+ *
+ * Returns:
+ * -1   An error occurred
+ *  0   Insufficient space in buffer
+ *  1   Success
+ */
+int cf_send_datareport(kis_capture_handler_t *caph, uint8_t *data, size_t len);
+
+/* Flush any pending batched data reports.
+ * May be called from any thread.
+ *
+ * Returns:
+ * -1   An error occurred
+ *  0   Insufficient space in buffer
+ *  1   Success, or nothing to flush
+ */
+int cf_flush_datareport_batch(kis_capture_handler_t *caph);
+
 /* Send a MESSAGE
  * Can be called from any thread.
  *
@@ -487,6 +487,9 @@ void datasource_tracker::trigger_deferred_startup() {
 
     config_defaults->set_remote_cap_timestamp(Globalreg::globalreg->kismet_config->fetch_opt_bool("override_remote_timestamp", true));
 
+    config_defaults->set_batch_packets(Globalreg::globalreg->kismet_config->fetch_opt_uint("source_batch_packets", 32));
+    config_defaults->set_batch_latency(Globalreg::globalreg->kismet_config->fetch_opt_uint("source_batch_latency", 10));
+
     httpd_pcap = std::make_shared<datasource_tracker_httpd_pcap>();
 
     // Register js module for UI
@@ -246,6 +246,9 @@ public:
 
     __Proxy(remote_cap_timestamp, uint8_t, bool, bool, remote_cap_timestamp);
 
+    __Proxy(batch_packets, uint32_t, uint32_t, uint32_t, batch_packets);
+    __Proxy(batch_latency, uint32_t, uint32_t, uint32_t, batch_latency);
+
 protected:
     virtual void register_fields() override {
         tracker_component::register_fields();
@@ -273,6 +276,13 @@ protected:
         register_field("kismet.datasourcetracker.default.remote_cap_timestamp",
                 "overwrite remote capture timestamp with server timestamp",
                 &remote_cap_timestamp);
+
+        register_field("kismet.datasourcetracker.default.batch_packets",
+                "maximum packets per batched data report",
+                &batch_packets);
+        register_field("kismet.datasourcetracker.default.batch_latency",
+                "maximum latency of batched data reports, in milliseconds",
+                &batch_latency);
     }
 
     // Double hoprate per second
@@ -295,6 +305,10 @@ protected:
     std::shared_ptr<tracker_element_uint32> remote_cap_port;
     std::shared_ptr<tracker_element_uint8> remote_cap_timestamp;
 
+    // Data report batching negotiated with capture sources
+    std::shared_ptr<tracker_element_uint32> batch_packets;
+    std::shared_ptr<tracker_element_uint32> batch_latency;
+
 };
 
 // Intermediary buffer handler which is responsible for parsing the incoming
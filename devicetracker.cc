@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 #include <time.h>
+#include <unistd.h>
 #include <list>
 #include <map>
 #include <vector>
@@ -42,6 +43,7 @@
 #include "globalregistry.h"
 #include "gpstracker.h"
 #include "json_adapter.h"
+#include "msgpack_adapter.h"
 #include "kis_datasource.h"
 #include "kis_databaselogfile.h"
 #include "kismet_json.h"
@@ -58,6 +60,28 @@ int Devicetracker_packethook_commontracker(CHAINCALL_PARMS) {
 	return ((device_tracker *) auxdata)->common_tracker(in_pack);
 }
 
+// Resident set size of the process in bytes, or 0 if it can't be read on this platform
+static size_t devicetracker_process_rss() {
+#ifdef SYS_LINUX
+    FILE *statm = fopen("/proc/self/statm", "r");
+
+    if (statm == NULL)
+        return 0;
+
+    unsigned long total, resident;
+    int r = fscanf(statm, "%lu %lu", &total, &resident);
+
+    fclose(statm);
+
+    if (r != 2)
+        return 0;
+
+    return (size_t) resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
 device_tracker::device_tracker(global_registry *in_globalreg) :
     kis_net_httpd_chain_stream_handler(),
     kis_database(in_globalreg, "devicetracker") {
@@ -160,8 +184,25 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
     // the device has as complete a view as possible; if we trigger it at the
     // BEGINNING of the chain, we get only the generic device with none of the
     // phy-specific attachments.
+    //
+    // Devices touched by the packet are stamped with a new modification sequence here
+    // too, once every phy is done updating them.  The sequence is taken while holding
+    // the device lock, so a reader which locks the device can never miss a stamp older
+    // than the sequence it saw before looking at the device.  Stamping only compares
+    // the content generation, which the device bumps as its content is set, so the
+    // lock is held for a few stores.
     packetchain_tracking_done_id =
         packetchain->register_handler([this](kis_packet *in_packet) -> int {
+            auto devinfo = 
+                (kis_tracked_device_info *) in_packet->fetch(pack_comp_device);
+
+            if (devinfo != nullptr) {
+                for (const auto& d : devinfo->devrefs) {
+                    local_locker devlocker(&(d.second->device_mutex));
+                    d.second->stamp_mod_seq(next_mod_seq());
+                }
+            }
+
             for (auto e : in_packet->process_complete_events)
                 eventbus->publish(e);
             return 1;
@@ -175,6 +216,7 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
     persistent_storage = false;
     persistent_mode = MODE_ONSTART;
     persistent_compression = false;
+    persistent_msgpack = false;
     statestore = NULL;
     persistent_storage_timeout = 0;
 
@@ -268,6 +310,18 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
             persistent_compression = 
                 globalreg->kismet_config->fetch_opt_bool("persistent_compression", true);
 
+            std::string performat =
+                str_lower(globalreg->kismet_config->fetch_opt_dfl("persistent_storage_format",
+                            "json"));
+
+            if (performat != "json" && performat != "msgpack") {
+                _MSG("Unknown persistent_storage_format '" + performat + "', expected json "
+                        "or msgpack; using json.", MSGFLAG_ERROR);
+                performat = "json";
+            }
+
+            persistent_msgpack = performat == "msgpack";
+
             persistent_storage_timeout =
                 globalreg->kismet_config->fetch_opt_ulong("persistent_timeout", 86400);
         }
@@ -382,7 +436,40 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
 	if (max_num_devices > 0) {
         _MSG_INFO("Limiting maximum number of devices to {}, older devices will be "
                 "removed from tracking when this limit is reached.", max_num_devices);
+    }
+
+    max_device_memory =
+        globalreg->kismet_config->fetch_opt_ulong("tracker_max_memory", 0) * 1024 * 1024;
+    device_memory_estimate =
+        globalreg->kismet_config->fetch_opt_ulong("tracker_device_memory_estimate", 0);
+    device_memory_baseline = devicetracker_process_rss();
+    device_memory_learned = false;
 
+    if (max_device_memory > 0) {
+        if (device_memory_estimate == 0 && device_memory_baseline == 0) {
+            _MSG_ERROR("Kismet can not read the process memory use on this platform, so "
+                    "tracker_max_memory needs tracker_device_memory_estimate to be set; "
+                    "devices will not be limited by memory.");
+            max_device_memory = 0;
+        } else {
+            _MSG_INFO("Limiting device memory to approximately {} MB, older devices will be "
+                    "removed from tracking when this limit is reached.", 
+                    max_device_memory / 1024 / 1024);
+        }
+    }
+
+    spill_evicted_devices =
+        globalreg->kismet_config->fetch_opt_bool("tracker_spill_evicted", false);
+
+    device_changes.set_max_tombstones(
+            globalreg->kismet_config->fetch_opt_uint("tracker_removed_history", 10000));
+
+    if (spill_evicted_devices && (max_num_devices > 0 || max_device_memory > 0)) {
+        _MSG_INFO("Devices removed to stay under the device limits will be saved to the "
+                "kismetdb log and restored if they are seen again.");
+    }
+
+	if (max_num_devices > 0 || max_device_memory > 0) {
 		// Schedule max device reaping every 5 seconds
 		max_devices_timer =
 			timetracker->register_timer(SERVER_TIMESLICES_SEC * 5, NULL, 1, this);
@@ -390,6 +477,23 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
 		max_devices_timer = -1;
 	}
 
+    // Optional pool for sharding read-only device work, such as filtering views for
+    // the web UI, across multiple cores
+    unsigned int device_worker_threads =
+        globalreg->kismet_config->fetch_opt_uint("device_worker_threads", 0);
+    device_work_min_shard =
+        globalreg->kismet_config->fetch_opt_uint("device_worker_min_shard", 1024);
+
+    if (device_work_min_shard == 0)
+        device_work_min_shard = 1;
+
+    if (device_worker_threads > 0) {
+        _MSG_INFO("Splitting read-only device work over {} worker threads", 
+                device_worker_threads);
+        device_work_pool = 
+            std::make_shared<kis_work_pool>("devworker", device_worker_threads);
+    }
+
     full_refresh_time = globalreg->timestamp.tv_sec;
 
     track_history_cloud =
@@ -423,6 +527,51 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
                 return multimac_endp_handler(stream, uri, structured, variable_cache);
                 });
 
+    changes_seq_id =
+        entrytracker->register_field("kismet.devicelist.changes.sequence",
+                tracker_element_factory<tracker_element_uint64>(),
+                "current device modification sequence");
+    changes_epoch_id =
+        entrytracker->register_field("kismet.devicelist.changes.epoch",
+                tracker_element_factory<tracker_element_uuid>(),
+                "per-run epoch of the modification sequence");
+    changes_resync_id =
+        entrytracker->register_field("kismet.devicelist.changes.resync",
+                tracker_element_factory<tracker_element_uint8>(),
+                "removed devices since the requested sequence are no longer known, or the "
+                "sequence is from another run; reload all devices");
+    changes_devices_id =
+        entrytracker->register_field("kismet.devicelist.changes.devices",
+                tracker_element_factory<tracker_element_vector>(),
+                "devices changed since the requested sequence");
+    changes_updated_id =
+        entrytracker->register_field("kismet.devicelist.changes.updated",
+                tracker_element_factory<tracker_element_vector>(),
+                "devices with only counters changed since the requested sequence");
+    changes_update_id =
+        entrytracker->register_field("kismet.devicelist.changes.update",
+                tracker_element_factory<tracker_element_map>(),
+                "device counters update");
+    changes_removed_id =
+        entrytracker->register_field("kismet.devicelist.changes.removed",
+                tracker_element_factory<tracker_element_vector>(),
+                "devices removed since the requested sequence");
+    changes_removed_key_id =
+        entrytracker->register_field("kismet.devicelist.changes.removed.key",
+                tracker_element_factory<tracker_element_device_key>(),
+                "removed device key");
+    changes_last_signal_id =
+        entrytracker->register_field("kismet.common.signal.last_signal",
+                tracker_element_factory<tracker_element_int32>(),
+                "most recent signal");
+
+    changes_endp =
+        std::make_shared<kis_net_httpd_simple_post_endpoint>("/devices/changes/devices", 
+                [this](std::ostream& stream, const std::string& uri, shared_structured structured,
+                    kis_net_httpd_connection::variable_cache_map& variable_cache) -> unsigned int {
+                return changes_endp_handler(stream, uri, structured, variable_cache);
+                });
+
     phy_phyentry_id =
         entrytracker->register_field("kismet.phy.phy",
                 tracker_element_factory<tracker_element_map>(),
@@ -584,6 +733,12 @@ device_tracker::~device_tracker() {
     tracked_vec.clear();
     immutable_tracked_vec->clear();
     tracked_mac_multimap.clear();
+
+    {
+        local_locker l(&last_seen_mutex);
+        last_seen_buckets.clear();
+        last_seen_map.clear();
+    }
 }
 
 void device_tracker::macdevice_timer_event() {
@@ -786,6 +941,14 @@ std::shared_ptr<kis_tracked_device_base>
             mac_addr in_mac, kis_phy_handler *in_phy, kis_packet *in_pack, 
             unsigned int in_flags, std::string in_basic_type) {
 
+    // Restore the device if it was spilled when it was evicted; the log is read before
+    // the device list is locked so that packets for other devices aren't held up
+    std::shared_ptr<kis_tracked_device_base> spilled_device;
+
+    if (spill_evicted_devices && !(in_flags & UCD_UPDATE_EXISTING_ONLY))
+        spilled_device = 
+            load_spilled_device(device_key(in_phy->fetch_phyname_hash(), in_mac), in_mac);
+
     // The device list has to be locked for the duration of the device assignment and
     // update since devices only get added at the end
     local_locker list_locker(&devicelist_mutex);
@@ -810,31 +973,39 @@ std::shared_ptr<kis_tracked_device_base>
         if (in_flags & UCD_UPDATE_EXISTING_ONLY)
             return NULL;
 
-        device =
-            std::make_shared<kis_tracked_device_base>(device_base_id);
-        // Device ID is the size of the vector so a new device always gets put
-        // in it's numbered slot
-        device->set_kis_internal_id(immutable_tracked_vec->size());
+        device = spilled_device;
 
-        device->set_key(key);
+        if (device != NULL) {
+            device->set_kis_internal_id(immutable_tracked_vec->size());
+            device->device_mutex.set_name(fmt::format("kis_tracked_device({})", key));
+            device->set_phyid(in_phy->fetch_phy_id());
+        } else {
+            device =
+                std::make_shared<kis_tracked_device_base>(device_base_id);
+            // Device ID is the size of the vector so a new device always gets put
+            // in it's numbered slot
+            device->set_kis_internal_id(immutable_tracked_vec->size());
 
-        device->device_mutex.set_name(fmt::format("kis_tracked_device({})", key));
-        device->set_macaddr(in_mac);
-        device->set_phyname(in_phy->fetch_phy_name());
-		device->set_phyid(in_phy->fetch_phy_id());
+            device->set_key(key);
 
-        device->set_server_uuid(globalreg->server_uuid);
+            device->device_mutex.set_name(fmt::format("kis_tracked_device({})", key));
+            device->set_macaddr(in_mac);
+            device->set_phyname(in_phy->fetch_phy_name());
+            device->set_phyid(in_phy->fetch_phy_id());
 
-        device->set_first_time(in_pack->ts.tv_sec);
+            device->set_server_uuid(globalreg->server_uuid);
 
-        device->set_type_string(in_basic_type);
+            device->set_first_time(in_pack->ts.tv_sec);
 
-        if (globalreg->manufdb != NULL) {
-            device->set_manuf(globalreg->manufdb->lookup_oui(in_mac));
-        }
+            device->set_type_string(in_basic_type);
+
+            if (globalreg->manufdb != NULL) {
+                device->set_manuf(globalreg->manufdb->lookup_oui(in_mac));
+            }
 
-        load_stored_username(device);
-        load_stored_tags(device);
+            load_stored_username(device);
+            load_stored_tags(device);
+        }
 
         new_device = true;
 
@@ -952,9 +1123,10 @@ std::shared_ptr<kis_tracked_device_base>
     if (((in_flags & UCD_UPDATE_LOCATION) ||
                 ((in_flags & UCD_UPDATE_EMPTY_LOCATION) && !device->has_location_cloud())) &&
             pack_gpsinfo != NULL) {
-        device->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
+        if (device->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
                 pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
-                pack_gpsinfo->heading);
+                pack_gpsinfo->heading))
+            device->mark_content_changed();
 
         // Throttle history cloud to one update per second to prevent floods of
         // data from swamping the cloud
@@ -1008,6 +1180,13 @@ std::shared_ptr<kis_tracked_device_base>
     if (pack_common != NULL)
         device->add_basic_crypt(pack_common->basic_crypt_set);
 
+    update_last_seen(device);
+
+    // Keep any active view sort indexes current; new devices are indexed when they're
+    // added to the views
+    if (!new_device)
+        update_view_device_sort(device);
+
     // Add the new device at the end once we've populated it
     if (new_device) {
         tracked_map[key] = device;
@@ -1068,6 +1247,77 @@ void device_tracker::do_readonly_device_work(std::shared_ptr<device_tracker_filt
 
 }
 
+bool device_tracker::can_shard_device_work(size_t n_devices) {
+    return device_work_pool != nullptr && n_devices >= device_work_min_shard * 2;
+}
+
+std::vector<std::shared_ptr<kis_tracked_device_base>> 
+    device_tracker::parallel_match_devices(size_t n_devices,
+            const std::function<std::shared_ptr<kis_tracked_device_base> (size_t)>& get_cb,
+            const std::function<bool (std::shared_ptr<kis_tracked_device_base>)>& match_cb) {
+
+    std::vector<std::shared_ptr<kis_tracked_device_base>> ret;
+
+    if (n_devices == 0)
+        return ret;
+
+    // A few shards per thread so one slow shard doesn't hold up the rest, but never
+    // smaller than the minimum shard size
+    size_t n_shards = n_devices / device_work_min_shard;
+
+    if (device_work_pool != nullptr)
+        n_shards = std::min<size_t>(n_shards, (device_work_pool->get_threads() + 1) * 4);
+    else
+        n_shards = 1;
+
+    if (n_shards < 1)
+        n_shards = 1;
+
+    size_t per_shard = (n_devices + n_shards - 1) / n_shards;
+
+    // Each shard fills its own result vector so no locking is needed on the results
+    std::vector<std::vector<std::shared_ptr<kis_tracked_device_base>>> shard_results(n_shards);
+
+    auto shard_cb = [&](size_t shard) {
+        size_t start = shard * per_shard;
+        size_t end = std::min(n_devices, start + per_shard);
+        auto& results = shard_results[shard];
+
+        for (size_t i = start; i < end; i++) {
+            auto dev = get_cb(i);
+
+            if (dev == nullptr)
+                continue;
+
+            bool m;
+
+            {
+                local_shared_locker devlocker(&dev->device_mutex);
+                m = match_cb(dev);
+            }
+
+            if (m)
+                results.push_back(dev);
+        }
+    };
+
+    if (n_shards == 1)
+        shard_cb(0);
+    else
+        device_work_pool->run_shards(n_shards, shard_cb);
+
+    size_t total = 0;
+    for (const auto& r : shard_results)
+        total += r.size();
+
+    ret.reserve(total);
+
+    for (auto& r : shard_results)
+        ret.insert(ret.end(), r.begin(), r.end());
+
+    return ret;
+}
+
 void device_tracker::do_device_work_raw(std::shared_ptr<device_tracker_filter_worker> worker, 
         std::shared_ptr<tracker_element_vector> vec, bool batch) {
 
@@ -1099,6 +1349,23 @@ void device_tracker::do_readonly_device_work_raw(std::shared_ptr<device_tracker_
     if (vec == nullptr)
         return;
 
+    if (worker->parallel_safe() && can_shard_device_work(vec->size())) {
+        auto matched = parallel_match_devices(vec->size(),
+                [&](size_t i) { 
+                    return std::static_pointer_cast<kis_tracked_device_base>((*vec)[i]); 
+                },
+                [&](std::shared_ptr<kis_tracked_device_base> v) { 
+                    return worker->match_device(this, v); 
+                });
+
+        for (const auto& v : matched)
+            worker->matched_device(v);
+
+        worker->finalize(this);
+
+        return;
+    }
+
     std::for_each(vec->begin(), vec->end(), [&](shared_tracker_element val) {
             if (val == nullptr)
                 return;
@@ -1175,6 +1442,21 @@ void device_tracker::do_readonly_device_work_raw(std::shared_ptr<device_tracker_
 
     local_shared_locker locker(&devicelist_mutex);
 
+    if (worker->parallel_safe() && can_shard_device_work(vec.size())) {
+        auto matched = parallel_match_devices(vec.size(),
+                [&](size_t i) { return vec[i]; },
+                [&](std::shared_ptr<kis_tracked_device_base> v) { 
+                    return worker->match_device(this, v); 
+                });
+
+        for (const auto& v : matched)
+            worker->matched_device(v);
+
+        worker->finalize(this);
+
+        return;
+    }
+
     std::for_each(vec.begin(), vec.end(), [&](shared_tracker_element val) {
             if (val == nullptr)
                 return;
@@ -1203,14 +1485,6 @@ void device_tracker::do_readonly_device_work(std::shared_ptr<device_tracker_filt
     do_readonly_device_work(worker, immutable_tracked_vec, batch);
 }
 
-// Simple std::sort comparison function to order by the least frequently
-// seen devices
-bool devicetracker_sort_lastseen(std::shared_ptr<kis_tracked_device_base> a,
-	std::shared_ptr<kis_tracked_device_base> b) {
-
-	return a->get_last_time() < b->get_last_time();
-}
-
 int device_tracker::timetracker_event(int eventid) {
     if (eventid == device_idle_timer) {
         local_locker lock(&devicelist_mutex);
@@ -1245,6 +1519,10 @@ int device_tracker::timetracker_event(int eventid) {
                         // Forget it from any views
                         remove_view_device(d);
 
+                        remove_last_seen(d);
+
+                        device_changes.add_tombstone(d->get_key());
+
                         // Forget it from the immutable vec, but keep its 
                         // position; we need to have vecpos = devid
                         auto iti = immutable_tracked_vec->begin() + d->get_kis_internal_id();
@@ -1265,51 +1543,20 @@ int device_tracker::timetracker_event(int eventid) {
     } else if (eventid == max_devices_timer) {
 		local_locker lock(&devicelist_mutex);
 
-		// Do nothing if we don't care
-		if (max_num_devices <= 0)
-			return 1;
+        size_t limit = max_num_devices;
+        size_t memory_limit = memory_device_limit();
+
+        if (memory_limit > 0 && (limit == 0 || memory_limit < limit))
+            limit = memory_limit;
 
 		// Do nothing if the number of devices is less than the max
-		if (tracked_vec.size() <= max_num_devices)
+		if (limit == 0 || tracked_vec.size() <= limit)
 			return 1;
 
         // Do an update since we're trimming something
         update_full_refresh();
 
-		// Now things start getting expensive.  Start by sorting the
-		// vector of devices - anything else that has to sort the entire list
-        // has to sort it themselves
-        std::stable_sort(tracked_vec.begin(), tracked_vec.end(), 
-                devicetracker_sort_lastseen);
-
-        tracked_vec.erase(std::remove_if(tracked_vec.begin() + max_num_devices, tracked_vec.end(),
-                [&](std::shared_ptr<kis_tracked_device_base> d) {
-                    // Lock the device itself
-                    local_locker devlocker(&(d->device_mutex));
-
-                    device_itr mi = tracked_map.find(d->get_key());
-
-                    if (mi != tracked_map.end())
-                        tracked_map.erase(mi);
-
-                    // Erase it from the multimap
-                    auto mmp = tracked_mac_multimap.equal_range(d->get_macaddr());
-
-                    for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi) {
-                        if (mmpi->second->get_key() == d->get_key()) {
-                            tracked_mac_multimap.erase(mmpi);
-                            break;
-                        }
-                    }
-
-                    // Forget it from the immutable vec, but keep its 
-                    // position; we need to have vecpos = devid
-                    auto iti = immutable_tracked_vec->begin() + d->get_kis_internal_id();
-                    (*iti).reset();
-
-                    return true;
-         
-                    }), tracked_vec.end());
+        evict_oldest_devices(tracked_vec.size() - limit);
 	}
 
     // Loop
@@ -1435,6 +1682,240 @@ void device_tracker::add_device(std::shared_ptr<kis_tracked_device_base> device)
 
     auto mm_pair = std::make_pair(device->get_macaddr(), device);
     tracked_mac_multimap.emplace(mm_pair);
+
+    update_last_seen(device);
+}
+
+size_t device_tracker::memory_device_limit() {
+    if (max_device_memory == 0)
+        return 0;
+
+    // Learn the per-device cost from the RSS the first time the budget is reached, then
+    // hold it; freed memory is rarely returned to the OS, so the RSS can't be trusted to
+    // shrink as devices are removed
+    if (device_memory_estimate == 0) {
+        auto rss = devicetracker_process_rss();
+
+        if (rss <= max_device_memory || tracked_vec.size() == 0)
+            return 0;
+
+        device_memory_estimate = 1;
+
+        if (rss > device_memory_baseline)
+            device_memory_estimate = 
+                std::max<size_t>(1, (rss - device_memory_baseline) / tracked_vec.size());
+
+        device_memory_learned = true;
+
+        _MSG_INFO("Device memory limit reached with {} devices, estimating {} bytes per device",
+                tracked_vec.size(), device_memory_estimate);
+    }
+
+    // A learned estimate is relative to the memory in use before any devices were 
+    // tracked; a configured estimate is the whole budget
+    if (device_memory_learned) {
+        if (max_device_memory <= device_memory_baseline)
+            return 1;
+
+        return std::max<size_t>(1, 
+                (max_device_memory - device_memory_baseline) / device_memory_estimate);
+    }
+
+    return std::max<size_t>(1, max_device_memory / device_memory_estimate);
+}
+
+size_t device_tracker::evict_oldest_devices(size_t n) {
+    std::vector<std::shared_ptr<kis_tracked_device_base>> evicted;
+
+    if (n == 0)
+        return 0;
+
+    evicted.reserve(n);
+
+    // The last-seen index is already ordered, so only the devices being removed are visited
+    {
+        local_shared_locker l(&last_seen_mutex);
+
+        for (auto bi = last_seen_buckets.begin(); 
+                bi != last_seen_buckets.end() && evicted.size() < n; ++bi) {
+            for (const auto& di : bi->second) {
+                if (evicted.size() >= n)
+                    break;
+
+                evicted.push_back(di.second);
+            }
+        }
+    }
+
+    if (spill_evicted_devices && evicted.size() > 0) {
+        auto dblog = 
+            Globalreg::FetchGlobalAs<kis_database_logfile>("DATABASELOG");
+
+        // The log only queues the devices here; they're serialized and written by its
+        // writer thread
+        if (dblog != nullptr && dblog->spill_devices(evicted)) {
+            local_locker l(&spilled_mutex);
+
+            for (auto d : evicted)
+                spilled_device_keys.insert(d->get_key());
+        }
+    }
+
+    remove_devices(evicted);
+
+    return evicted.size();
+}
+
+void device_tracker::remove_devices(const std::vector<std::shared_ptr<kis_tracked_device_base>>& devices) {
+    if (devices.size() == 0)
+        return;
+
+    std::unordered_set<device_key> removed_keys;
+
+    for (auto d : devices) {
+        // Lock the device itself
+        local_locker devlocker(&(d->device_mutex));
+
+        removed_keys.insert(d->get_key());
+
+        tracked_map.erase(d->get_key());
+
+        // Erase it from the multimap
+        auto mmp = tracked_mac_multimap.equal_range(d->get_macaddr());
+
+        for (auto mmpi = mmp.first; mmpi != mmp.second; ++mmpi) {
+            if (mmpi->second->get_key() == d->get_key()) {
+                tracked_mac_multimap.erase(mmpi);
+                break;
+            }
+        }
+
+        // Forget it from any views
+        remove_view_device(d);
+
+        remove_last_seen(d);
+
+        device_changes.add_tombstone(d->get_key());
+
+        // Forget it from the immutable vec, but keep its 
+        // position; we need to have vecpos = devid
+        auto iti = immutable_tracked_vec->begin() + d->get_kis_internal_id();
+        (*iti).reset();
+    }
+
+    // One pass to compact the tracked vector, instead of one per device
+    tracked_vec.erase(std::remove_if(tracked_vec.begin(), tracked_vec.end(),
+                [&](std::shared_ptr<kis_tracked_device_base> d) {
+                    return removed_keys.find(d->get_key()) != removed_keys.end();
+                }), tracked_vec.end());
+}
+
+std::shared_ptr<kis_tracked_device_base> device_tracker::load_spilled_device(const device_key& key,
+        mac_addr mac) {
+    {
+        local_locker l(&spilled_mutex);
+
+        auto ki = spilled_device_keys.find(key);
+
+        if (ki == spilled_device_keys.end())
+            return nullptr;
+
+        spilled_device_keys.erase(ki);
+    }
+
+    auto dblog = 
+        Globalreg::FetchGlobalAs<kis_database_logfile>("DATABASELOG");
+
+    if (dblog == nullptr)
+        return nullptr;
+
+    std::string stored;
+    auto pending = dblog->unspill_device(key, stored);
+
+    // Still waiting to be written, so it's the same record that was evicted
+    if (pending != nullptr)
+        return pending;
+
+    if (stored.length() == 0)
+        return nullptr;
+
+    auto device = convert_stored_device(mac, (const unsigned char *) stored.data(), 
+            stored.length());
+
+    if (device == nullptr || !(device->get_key() == key))
+        return nullptr;
+
+    return device;
+}
+
+void device_tracker::forget_spilled_devices(const std::vector<device_key>& keys) {
+    local_locker l(&spilled_mutex);
+
+    for (const auto& k : keys)
+        spilled_device_keys.erase(k);
+}
+
+void device_tracker::update_last_seen(std::shared_ptr<kis_tracked_device_base> in_device) {
+    local_locker l(&last_seen_mutex);
+
+    auto key = in_device->get_key();
+    time_t last_time = in_device->get_last_time();
+
+    auto lsi = last_seen_map.find(key);
+
+    if (lsi != last_seen_map.end()) {
+        if (lsi->second == last_time)
+            return;
+
+        auto bi = last_seen_buckets.find(lsi->second);
+
+        if (bi != last_seen_buckets.end()) {
+            bi->second.erase(key);
+
+            if (bi->second.size() == 0)
+                last_seen_buckets.erase(bi);
+        }
+
+        lsi->second = last_time;
+    } else {
+        last_seen_map[key] = last_time;
+    }
+
+    last_seen_buckets[last_time][key] = in_device;
+}
+
+void device_tracker::remove_last_seen(std::shared_ptr<kis_tracked_device_base> in_device) {
+    local_locker l(&last_seen_mutex);
+
+    auto key = in_device->get_key();
+    auto lsi = last_seen_map.find(key);
+
+    if (lsi == last_seen_map.end())
+        return;
+
+    auto bi = last_seen_buckets.find(lsi->second);
+
+    if (bi != last_seen_buckets.end()) {
+        bi->second.erase(key);
+
+        if (bi->second.size() == 0)
+            last_seen_buckets.erase(bi);
+    }
+
+    last_seen_map.erase(lsi);
+}
+
+std::shared_ptr<tracker_element_vector> device_tracker::fetch_devices_since(time_t in_ts) {
+    auto ret = std::make_shared<tracker_element_vector>();
+
+    local_shared_locker l(&last_seen_mutex);
+
+    for (auto bi = last_seen_buckets.lower_bound(in_ts); bi != last_seen_buckets.end(); ++bi) {
+        for (const auto& di : bi->second)
+            ret->push_back(di.second);
+    }
+
+    return ret;
 }
 
 bool device_tracker::add_view(std::shared_ptr<device_tracker_view> in_view) {
@@ -1486,6 +1967,15 @@ void device_tracker::update_view_device(std::shared_ptr<kis_tracked_device_base>
     }
 }
 
+void device_tracker::update_view_device_sort(std::shared_ptr<kis_tracked_device_base> in_device) {
+    local_shared_locker l(&view_mutex);
+
+    for (auto i : *view_vec) {
+        auto vi = std::static_pointer_cast<device_tracker_view>(i);
+        vi->update_device_sort(in_device);
+    }
+}
+
 void device_tracker::remove_view_device(std::shared_ptr<kis_tracked_device_base> in_device) {
     local_shared_locker l(&view_mutex);
 
@@ -1632,12 +2122,19 @@ device_tracker::convert_stored_device(mac_addr macaddr,
         // Get the decompressed record
         std::string uzbuf(std::istreambuf_iterator<char>(istream), {});
 
-        // Read out the structured json
-        shared_structured sjson(new structured_json(uzbuf));
+        // Process the stored object into a shared element; storagejson records are always
+        // a json object, anything else is storagemsgpack
+        shared_tracker_element e;
 
-        // Process structured object into a shared element
-        shared_tracker_element e = 
-            storage_loader::storage_to_tracker(sjson);
+        if (uzbuf.length() != 0 && uzbuf[0] == '{') {
+            shared_structured sjson(new structured_json(uzbuf));
+            e = storage_loader::storage_to_tracker(sjson);
+        } else {
+            e = storage_loader::storage_msgpack_to_tracker(uzbuf);
+        }
+
+        if (e == nullptr)
+            throw std::runtime_error("stored device record is empty");
 
         if (e->get_type() != tracker_type::tracker_map) 
             throw structured_data_exception(fmt::format("Expected a tracker_map from loading the storage "
@@ -1798,6 +2295,8 @@ void device_tracker::set_device_user_name(std::shared_ptr<kis_tracked_device_bas
     local_locker devlocker(&(in_dev->device_mutex));
 
     in_dev->set_username(in_username);
+    in_dev->mark_content_changed();
+    in_dev->stamp_mod_seq(next_mod_seq());
 
     if (!database_valid()) {
         _MSG("Unable to store device name to permanent storage, the database connection "
@@ -1860,6 +2359,9 @@ void device_tracker::set_device_tag(std::shared_ptr<kis_tracked_device_base> in_
         sm->insert(in_tag, e);
     }
 
+    in_dev->mark_content_changed();
+    in_dev->stamp_mod_seq(next_mod_seq());
+
     if (!database_valid()) {
         _MSG("Unable to store device name to permanent storage, the database connection "
                 "is not available", MSGFLAG_ERROR);
@@ -2274,7 +2776,10 @@ int device_tracker_state_store::store_devices(std::shared_ptr<tracker_element_ve
                 // pack a storage formatted blob
                 {
                     local_locker lock(&(devicetracker->devicelist_mutex));
-                    storage_json_adapter::pack(*serialstream, d, NULL);
+                    if (devicetracker->persistent_msgpack)
+                        storage_msgpack_adapter::pack(*serialstream, d);
+                    else
+                        storage_json_adapter::pack(*serialstream, d, NULL);
                 }
 
                 // Sync the buffers
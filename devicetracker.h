@@ -24,9 +24,11 @@
 #include <atomic>
 #include <stdio.h>
 #include <time.h>
+#include <deque>
 #include <list>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -48,6 +50,7 @@
 #include "kis_datasource.h"
 #include "packinfo_signal.h"
 #include "devicetracker_component.h"
+#include "devicetracker_changes.h"
 #include "trackercomponent_legacy.h"
 #include "timetracker.h"
 #include "kis_net_microhttpd.h"
@@ -56,6 +59,7 @@
 #include "devicetracker_workers.h"
 #include "kis_database.h"
 #include "eventbus.h"
+#include "kis_work_pool.h"
 
 #define KIS_PHY_ANY	-1
 #define KIS_PHY_UNKNOWN -2
@@ -162,9 +166,35 @@ public:
     // components due to timeouts / max device cleanup
     void update_full_refresh();
 
+    // Next value of the global device modification sequence; devices are stamped with it
+    // whenever they change
+    uint64_t next_mod_seq() {
+        return device_changes.next_seq();
+    }
+
 	// Look for an existing device record
     std::shared_ptr<kis_tracked_device_base> fetch_device(device_key in_key);
 
+    // Fetch all devices last seen at or after a given time, from the last-seen index; 
+    // this only visits recently seen devices instead of the entire device list.  Devices
+    // are returned oldest first.
+    std::shared_ptr<tracker_element_vector> fetch_devices_since(time_t in_ts);
+
+    // Can read-only device work over this many devices be sharded across the device 
+    // worker pool?
+    bool can_shard_device_work(size_t n_devices);
+
+    // Match devices in parallel across the device worker pool.  The source is accessed 
+    // by index so that any vector type can be sharded; each device is matched under its
+    // shared lock, and matched devices are returned in source order.
+    //
+    // The match function is called concurrently from multiple threads and MUST NOT 
+    // modify the device or any shared state, and the caller MUST NOT hold a write lock 
+    // on any of the devices.
+    std::vector<std::shared_ptr<kis_tracked_device_base>> parallel_match_devices(size_t n_devices,
+            const std::function<std::shared_ptr<kis_tracked_device_base> (size_t)>& get_cb,
+            const std::function<bool (std::shared_ptr<kis_tracked_device_base>)>& match_cb);
+
     // Perform a device filter.  Pass a subclassed filter instance.
     //
     // If "batch" is true, Kismet will sort the devices based on the internal ID 
@@ -285,6 +315,9 @@ public:
             size_t *upload_data_size);
 
     virtual int httpd_post_complete(kis_net_httpd_connection *concls);
+
+    virtual std::string httpd_stream_encoding(kis_net_httpd_connection *connection,
+            const char *url) override;
     
     // time_tracker event handler
     virtual int timetracker_event(int eventid);
@@ -315,12 +348,16 @@ public:
     // Iterate over all phys and load from the database
     virtual int load_devices();
 
+    // Forget spilled devices which have expired from the kismetdb log
+    void forget_spilled_devices(const std::vector<device_key>& keys);
+
     // View API
     virtual bool add_view(std::shared_ptr<device_tracker_view> in_view);
     virtual void remove_view(const std::string& in_view_id);
 
     virtual void new_view_device(std::shared_ptr<kis_tracked_device_base> in_device);
     virtual void update_view_device(std::shared_ptr<kis_tracked_device_base> in_device);
+    virtual void update_view_device_sort(std::shared_ptr<kis_tracked_device_base> in_device);
     virtual void remove_view_device(std::shared_ptr<kis_tracked_device_base> in_device);
 
     // Get phy views
@@ -379,6 +416,40 @@ protected:
     unsigned int max_num_devices;
     int max_devices_timer;
 
+    // Memory budget for devices, in bytes (0 for no budget).  The budget is turned into
+    // a device limit using the configured per-device estimate, or, when none is set, an
+    // estimate learned from the process RSS the first time the budget is reached.
+    size_t max_device_memory;
+    size_t device_memory_estimate;
+    size_t device_memory_baseline;
+    bool device_memory_learned;
+
+    // Number of devices allowed by the memory budget, or 0 if the budget is not in force
+    size_t memory_device_limit();
+
+    // Evict up to n of the least recently seen devices, oldest first; devicelist_mutex
+    // must be held.  Returns the number of devices removed.
+    size_t evict_oldest_devices(size_t n);
+
+    // Remove a set of devices from every index; devicelist_mutex must be held
+    void remove_devices(const std::vector<std::shared_ptr<kis_tracked_device_base>>& devices);
+
+    // Global device modification sequence, run epoch, and the keys of removed devices
+    // for clients syncing via the changes endpoint.  Tombstones are guarded by 
+    // devicelist_mutex.
+    device_change_log device_changes;
+
+    // Spill evicted devices to the kismetdb log so they can be restored if they are 
+    // seen again; keys of spilled devices are kept to avoid querying the log for every
+    // new device.  Spilled devices are restored before the device list is locked, so 
+    // the keys have their own lock.
+    bool spill_evicted_devices;
+    kis_recursive_timed_mutex spilled_mutex;
+    std::unordered_set<device_key> spilled_device_keys;
+
+    std::shared_ptr<kis_tracked_device_base> load_spilled_device(const device_key& key,
+            mac_addr mac);
+
     // Timer event for storing devices
     int device_storage_timer;
 
@@ -430,6 +501,22 @@ protected:
     // device ID.
     std::shared_ptr<tracker_element_vector> immutable_tracked_vec;
 
+    // Last-seen index; devices bucketed by the second they were last seen, and the
+    // bucket each device is currently in.  Devices move buckets at most once a second,
+    // and only when they're seen.
+    kis_recursive_timed_mutex last_seen_mutex;
+    std::map<time_t, std::unordered_map<device_key, std::shared_ptr<kis_tracked_device_base>>> 
+        last_seen_buckets;
+    std::unordered_map<device_key, time_t> last_seen_map;
+
+    void update_last_seen(std::shared_ptr<kis_tracked_device_base> in_device);
+    void remove_last_seen(std::shared_ptr<kis_tracked_device_base> in_device);
+
+    // Optional pool for sharding read-only device work, and the minimum number of 
+    // devices handled by each shard
+    std::shared_ptr<kis_work_pool> device_work_pool;
+    size_t device_work_min_shard;
+
     // List of views using new API as we transition the rest to the new API
     kis_recursive_timed_mutex view_mutex;
     std::shared_ptr<tracker_element_vector> view_vec;
@@ -446,6 +533,14 @@ protected:
     int phy_phyentry_id, phy_phyname_id, phy_devices_count_id, 
         phy_packets_count_id, phy_phyid_id;
 
+    // Devices changed and removed since a modification sequence
+    std::shared_ptr<kis_net_httpd_simple_post_endpoint> changes_endp;
+    unsigned int changes_endp_handler(std::ostream& stream, const std::string& uri,
+            shared_structured structured, kis_net_httpd_connection::variable_cache_map& variable_cache);
+    int changes_seq_id, changes_epoch_id, changes_resync_id, changes_devices_id, 
+        changes_updated_id, changes_update_id, changes_removed_id, changes_removed_key_id,
+        changes_last_signal_id;
+
 	// Registered PHY types
 	int next_phy_id;
     std::map<int, kis_phy_handler *> phy_handler_map;
@@ -477,6 +572,9 @@ protected:
     // Do we use persistent compression when storing
     bool persistent_compression;
 
+    // Do we store records as storagemsgpack instead of storagejson
+    bool persistent_msgpack;
+
     // If we log devices to the kismet database...
     int databaselog_timer;
     time_t last_database_logged;
@@ -486,6 +584,11 @@ protected:
     // Do we constrain memory by not tracking RRD data?
     bool ram_no_rrd;
 
+    // Stream every device as ekjson in bounded chunks, waiting for the client to drain
+    // the connection between chunks instead of holding the device list for the whole
+    // transfer
+    void stream_all_devices_ekjson(kis_net_httpd_connection *connection, std::ostream& stream);
+
 protected:
     // Handle new datasources and create endpoints for them
     void handle_new_datasource_event(std::shared_ptr<eventbus_event> evt);
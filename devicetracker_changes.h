@@ -0,0 +1,174 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DEVICETRACKER_CHANGES_H__
+#define __DEVICETRACKER_CHANGES_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <deque>
+#include <string>
+
+#include "trackedelement.h"
+#include "uuid.h"
+
+/* Device modification sequencing for the changes endpoint
+ *
+ * Every change to a device is stamped with the next value of a global sequence.
+ * Removed devices are remembered as tombstones at the sequence they were removed at,
+ * up to a limit; the floor is the sequence of the newest tombstone which has been
+ * dropped.  A client passes the sequence and epoch of its last response, and has to
+ * reload every device if it is older than the floor, or from another run of the
+ * server; the sequence restarts each run, so the epoch is a random per-run uuid.
+ *
+ */
+
+// Content sequence of a device: the modification sequence at which its content
+// generation last moved.  Only compares the generation, so it is cheap enough to
+// update for every packet.
+class device_content_stamp {
+public:
+    device_content_stamp() :
+        seq {0},
+        generation {0} { }
+
+    void update(uint64_t in_seq, uint64_t in_generation) {
+        if (in_generation != generation || seq == 0) {
+            generation = in_generation;
+            seq = in_seq;
+        }
+    }
+
+    uint64_t get_seq() const {
+        return seq;
+    }
+
+protected:
+    uint64_t seq;
+    uint64_t generation;
+};
+
+// Not locked; the device tracker guards the tombstones with the device list lock.  The
+// sequence itself is atomic.
+class device_change_log {
+public:
+    enum class change {
+        none,
+        counters,
+        full,
+    };
+
+    device_change_log() :
+        mod_seq {0},
+        max_tombstones {10000},
+        tombstone_floor {0} {
+        epoch.generate_random_time_uuid();
+    }
+
+    void set_max_tombstones(size_t in_max) {
+        max_tombstones = in_max;
+        trim();
+    }
+
+    uint64_t next_seq() {
+        return ++mod_seq;
+    }
+
+    uint64_t current_seq() const {
+        return mod_seq;
+    }
+
+    const uuid& get_epoch() const {
+        return epoch;
+    }
+
+    uint64_t get_tombstone_floor() const {
+        return tombstone_floor;
+    }
+
+    void add_tombstone(const device_key& in_key) {
+        tombstones.push_back(tombstone{next_seq(), in_key});
+        trim();
+    }
+
+    // A client has to reload every device when its sequence is older than the dropped
+    // tombstones, or from another run; the current sequence is the one taken for the
+    // response.  A client which didn't send an epoch is only caught by a sequence
+    // newer than ours.
+    bool needs_resync(uint64_t in_since, uint64_t in_seq, const std::string& in_epoch) const {
+        if (in_since < tombstone_floor || in_since > in_seq)
+            return true;
+
+        if (in_epoch.length() != 0 && in_since != 0) {
+            uuid client_epoch(in_epoch);
+
+            if (client_epoch.error || client_epoch != epoch)
+                return true;
+        }
+
+        return false;
+    }
+
+    // Call fn with the key of every device removed after in_since, newest first
+    template<typename F>
+    void removed_since(uint64_t in_since, F fn) const {
+        for (auto ti = tombstones.rbegin(); ti != tombstones.rend() && ti->seq > in_since; ++ti)
+            fn(ti->key);
+    }
+
+    // What to send for a device with the given sequences: nothing, the counters, or the
+    // full record
+    static change classify(uint64_t in_since, bool in_resync, bool in_delta,
+            uint64_t in_mod_seq, uint64_t in_content_seq) {
+        if (in_resync)
+            return change::full;
+
+        if (in_mod_seq <= in_since)
+            return change::none;
+
+        if (!in_delta || in_content_seq > in_since)
+            return change::full;
+
+        return change::counters;
+    }
+
+protected:
+    struct tombstone {
+        uint64_t seq;
+        device_key key;
+    };
+
+    void trim() {
+        while (tombstones.size() > max_tombstones) {
+            tombstone_floor = tombstones.front().seq;
+            tombstones.pop_front();
+        }
+    }
+
+    std::atomic<uint64_t> mod_seq;
+
+    uuid epoch;
+
+    std::deque<tombstone> tombstones;
+    size_t max_tombstones;
+    uint64_t tombstone_floor;
+};
+
+#endif
+
@@ -0,0 +1,327 @@
+/* test harness for the device changes sequencing
+ *
+ * Simulates a device list changing under a mirror which polls for changes the way
+ * the /devices/changes/devices endpoint serves them: devices are added, updated,
+ * changed, and removed (and some re-added under the same key) at random, and the
+ * mirror applies the removed keys, then the full records, then the counter updates
+ * of each response.  After every poll the mirror has to hold exactly the devices of
+ * the list, with the same content and counters.
+ *
+ * The tombstone history is kept small so mirrors regularly fall behind it and have
+ * to resync, and the server is restarted to check that a mirror from a previous run
+ * is told to resync by the epoch, even once the new sequence has passed its own.
+ *
+ * # configure and build kismet
+ * ./configure
+ * make
+ *
+ * # build test harness
+ * g++ -o devicetracker_changes_test devicetracker_changes_test.cc trackedelement.cc.o \
+ *     util.cc.o macaddr.cc.o uuid.cc.o
+ *
+ * ./devicetracker_changes_test
+ *
+ */
+
+#include "config.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "devicetracker_changes.h"
+
+// No fields are built here
+#define TEST_HARNESS_TRACKER_STUBS
+#include "test_harness.h"
+
+// The parts of a device the changes endpoint cares about
+struct sim_device {
+    sim_device() :
+        mod_seq {0},
+        generation {0},
+        content {0},
+        packets {0} { }
+
+    void stamp(device_change_log& log) {
+        mod_seq = log.next_seq();
+        stamp_content.update(mod_seq, generation);
+    }
+
+    uint64_t mod_seq;
+    device_content_stamp stamp_content;
+    uint64_t generation;
+
+    // Stands in for the device record and for its counters
+    uint64_t content;
+    uint64_t packets;
+};
+
+struct mirror_device {
+    uint64_t content;
+    uint64_t packets;
+};
+
+// One server run: the change log and the device list
+struct sim_server {
+    sim_server(size_t max_tombstones) {
+        log.set_max_tombstones(max_tombstones);
+    }
+
+    device_change_log log;
+    std::map<device_key, sim_device> devices;
+};
+
+struct sim_mirror {
+    sim_mirror() :
+        since {0},
+        resyncs {0},
+        full {0},
+        counters {0} { }
+
+    uint64_t since;
+    std::string epoch;
+    std::map<device_key, mirror_device> devices;
+
+    unsigned int resyncs, full, counters;
+};
+
+// Serve a changes request and apply it to the mirror, as a client would
+static void poll(sim_server& server, sim_mirror& mirror, bool delta, bool send_epoch) {
+    auto seq = server.log.current_seq();
+    auto resync = server.log.needs_resync(mirror.since, seq, send_epoch ? mirror.epoch : "");
+
+    if (resync)
+        mirror.resyncs++;
+
+    std::vector<device_key> removed;
+    server.log.removed_since(mirror.since, [&](const device_key& k) { removed.push_back(k); });
+
+    std::map<device_key, mirror_device> full, updated;
+
+    for (const auto& d : server.devices) {
+        auto change = device_change_log::classify(mirror.since, resync, delta,
+                d.second.mod_seq, d.second.stamp_content.get_seq());
+
+        if (change == device_change_log::change::full) {
+            full[d.first] = mirror_device{d.second.content, d.second.packets};
+            mirror.full++;
+        } else if (change == device_change_log::change::counters) {
+            updated[d.first] = mirror_device{0, d.second.packets};
+            mirror.counters++;
+        }
+    }
+
+    if (resync) {
+        mirror.devices = full;
+    } else {
+        for (const auto& k : removed)
+            mirror.devices.erase(k);
+
+        for (const auto& d : full)
+            mirror.devices[d.first] = d.second;
+    }
+
+    for (const auto& u : updated) {
+        auto mi = mirror.devices.find(u.first);
+
+        if (mi == mirror.devices.end()) {
+            expect("counter update for a device the mirror doesn't have", false);
+            continue;
+        }
+
+        mi->second.packets = u.second.packets;
+    }
+
+    mirror.since = seq;
+    mirror.epoch = server.log.get_epoch().uuid_to_string();
+}
+
+static bool in_sync(const sim_server& server, const sim_mirror& mirror) {
+    if (server.devices.size() != mirror.devices.size())
+        return false;
+
+    for (const auto& d : server.devices) {
+        auto mi = mirror.devices.find(d.first);
+
+        if (mi == mirror.devices.end() || mi->second.content != d.second.content ||
+                mi->second.packets != d.second.packets)
+            return false;
+    }
+
+    return true;
+}
+
+static void check_random(size_t max_tombstones, bool delta) {
+    std::mt19937_64 rng(max_tombstones * 2 + delta);
+    sim_server server(max_tombstones);
+    std::vector<sim_mirror> mirrors(4);
+
+    for (unsigned int step = 0; step < 200000; step++) {
+        auto op = rng() % 100;
+        device_key key(1, test_mac(rng() % 64));
+        auto di = server.devices.find(key);
+
+        if (op < 5) {
+            // Poll from a random mirror
+            auto& m = mirrors[rng() % mirrors.size()];
+
+            poll(server, m, delta, true);
+
+            if (!in_sync(server, m)) {
+                char what[128];
+                snprintf(what, sizeof(what), "mirror out of sync at step %u (history %lu, %s)",
+                        step, max_tombstones, delta ? "delta" : "full");
+                expect(what, false);
+            }
+        } else if (di == server.devices.end()) {
+            // New device, or a removed one seen again
+            auto& d = server.devices[key];
+            d.generation++;
+            d.content = rng();
+            d.packets = 1;
+            d.stamp(server.log);
+        } else if (op < 10) {
+            // Removed by timeout or eviction
+            server.devices.erase(di);
+            server.log.add_tombstone(key);
+        } else if (op < 13) {
+            // Content change
+            di->second.generation++;
+            di->second.content = rng();
+            di->second.packets++;
+            di->second.stamp(server.log);
+        } else {
+            // Another packet
+            di->second.packets++;
+            di->second.stamp(server.log);
+        }
+    }
+
+    for (auto& m : mirrors) {
+        poll(server, m, delta, true);
+        expect("final sync", in_sync(server, m));
+    }
+
+    printf("history %6lu %-5s: %u resyncs, %u full records, %u counter updates\n",
+            max_tombstones, delta ? "delta" : "full", mirrors[0].resyncs, mirrors[0].full,
+            mirrors[0].counters);
+
+    if (delta)
+        expect("delta sent counter updates", mirrors[0].counters > 0);
+    else
+        expect("full sent no counter updates", mirrors[0].counters == 0);
+
+    if (max_tombstones < 16)
+        expect("short history forced a resync", mirrors[0].resyncs > 0);
+}
+
+static void check_restart() {
+    auto old_run = std::unique_ptr<sim_server>(new sim_server(1000));
+    sim_mirror mirror;
+
+    for (unsigned int i = 0; i < 100; i++) {
+        auto& d = old_run->devices[device_key(1, test_mac(i))];
+        d.generation++;
+        d.content = i;
+        d.stamp(old_run->log);
+    }
+
+    poll(*old_run, mirror, true, true);
+    expect("synced before restart", in_sync(*old_run, mirror) && mirror.since == 100);
+
+    // The new run starts over with other devices and passes the old sequence
+    sim_server new_run(1000);
+
+    for (unsigned int i = 0; i < 300; i++) {
+        auto& d = new_run.devices[device_key(1, test_mac(1000 + (i % 10)))];
+        d.generation++;
+        d.content = 1000 + i;
+        d.stamp(new_run.log);
+    }
+
+    expect("epochs differ", old_run->log.get_epoch() != new_run.log.get_epoch());
+    expect("new sequence passed the old", new_run.log.current_seq() > mirror.since);
+
+    // Without the epoch, a mirror from the old run looks current and keeps old devices
+    auto stale = mirror;
+    poll(new_run, stale, true, false);
+    expect("no epoch can't detect the restart", !in_sync(new_run, stale));
+
+    // With it, the mirror is told to resync
+    auto resyncs = mirror.resyncs;
+    poll(new_run, mirror, true, true);
+    expect("epoch forced a resync", mirror.resyncs == resyncs + 1);
+    expect("synced after restart", in_sync(new_run, mirror));
+
+    // A sequence newer than the server's is caught without the epoch
+    sim_mirror ahead;
+    ahead.since = new_run.log.current_seq() + 1;
+    poll(new_run, ahead, true, false);
+    expect("sequence from the future forced a resync", ahead.resyncs == 1);
+
+    // A malformed epoch resyncs
+    sim_mirror bad;
+    bad.since = 1;
+    bad.epoch = "not a uuid";
+    poll(new_run, bad, true, true);
+    expect("bad epoch forced a resync", bad.resyncs == 1 && in_sync(new_run, bad));
+}
+
+static void check_tombstones() {
+    device_change_log log;
+    log.set_max_tombstones(3);
+
+    for (unsigned int i = 1; i <= 5; i++)
+        log.add_tombstone(device_key(1, test_mac(i)));
+
+    // Sequences 1..5; 1 and 2 have been dropped
+    expect("floor", log.get_tombstone_floor() == 2);
+    expect("behind the floor", log.needs_resync(1, log.current_seq(), ""));
+    expect("at the floor", !log.needs_resync(2, log.current_seq(), ""));
+
+    std::vector<device_key> removed;
+    log.removed_since(3, [&](const device_key& k) { removed.push_back(k); });
+    expect("removed since", removed.size() == 2 &&
+            removed[0] == device_key(1, test_mac(5)) && removed[1] == device_key(1, test_mac(4)));
+
+    // No history at all; every removal moves the floor
+    log.set_max_tombstones(0);
+    expect("history dropped", log.get_tombstone_floor() == 5);
+    log.add_tombstone(device_key(1, test_mac(6)));
+    expect("floor without history", log.get_tombstone_floor() == 6);
+    expect("resync without history", log.needs_resync(5, log.current_seq(), ""));
+
+    using change = device_change_log::change;
+    expect("unchanged", device_change_log::classify(10, false, true, 10, 5) == change::none);
+    expect("counters", device_change_log::classify(10, false, true, 11, 5) == change::counters);
+    expect("content", device_change_log::classify(10, false, true, 11, 11) == change::full);
+    expect("no delta", device_change_log::classify(10, false, false, 11, 5) == change::full);
+    expect("resync", device_change_log::classify(10, true, true, 1, 1) == change::full);
+
+    // The content sequence only moves with the generation
+    device_content_stamp stamp;
+    stamp.update(4, 0);
+    expect("first stamp", stamp.get_seq() == 4);
+    stamp.update(5, 0);
+    expect("same generation", stamp.get_seq() == 4);
+    stamp.update(6, 1);
+    expect("new generation", stamp.get_seq() == 6);
+}
+
+int main(int argc, char *argv[]) {
+    check_tombstones();
+    check_restart();
+
+    for (auto history : {0, 4, 10000}) {
+        check_random(history, true);
+        check_random(history, false);
+    }
+
+    printf("%u failures\n", test_failures());
+
+    return test_failures() == 0 ? 0 : 1;
+}
@@ -370,6 +370,8 @@ void kis_tracked_device_base::inc_seenby_count(kis_datasource *source,
 
         seenby_map->insert(source->get_source_key(), seenby);
 
+        mark_content_changed();
+
     } else {
         seenby = std::static_pointer_cast<kis_tracked_seenby_data>(seenby_iter->second);
 
@@ -405,6 +407,8 @@ void kis_tracked_device_base::register_fields() {
     register_field("kismet.device.base.last_time", "last time seen time_t", &last_time);
     register_field("kismet.device.base.mod_time", 
             "timestamp of last seen time (local clock)", &mod_time);
+    register_field("kismet.device.base.mod_seq", 
+            "global modification sequence of the last change", &mod_seq);
     register_field("kismet.device.base.packets.total", "total packets seen of all types", &packets);
     register_field("kismet.device.base.packets.rx", "observed packets sent to device", &rx_packets);
     register_field("kismet.device.base.packets.tx", "observed packets from device", &tx_packets);
@@ -505,9 +509,14 @@ void kis_tracked_device_base::add_related_device(const std::string& in_relations
         related_group->set_as_key_vector(true);
         related_group->insert(in_key, nullptr);
         related_devices_map->insert(in_relationship, related_group);
+        mark_content_changed();
     } else {
         auto related_group = std::static_pointer_cast<tracker_element_device_key_map>(related_group_i->second);
-        related_group->insert(in_key, nullptr);
+
+        if (related_group->find(in_key) == related_group->end()) {
+            related_group->insert(in_key, nullptr);
+            mark_content_changed();
+        }
     }
 }
 
@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <algorithm>
+#include <atomic>
 #include <list>
 #include <map>
 #include <string>
@@ -38,6 +39,7 @@
 #include "globalregistry.h"
 #include "trackedelement.h"
 #include "entrytracker.h"
+#include "devicetracker_changes.h"
 #include "packet.h"
 #include "uuid.h"
 #include "trackedlocation.h"
@@ -239,19 +241,22 @@ protected:
 class kis_tracked_device_base : public tracker_component {
 public:
     kis_tracked_device_base() :
-        tracker_component() {
+        tracker_component(),
+        content_generation {0} {
         register_fields();
         reserve_fields(NULL);
     }
 
     kis_tracked_device_base(int in_id) :
-        tracker_component(in_id) {
+        tracker_component(in_id),
+        content_generation {0} {
         register_fields();
         reserve_fields(NULL);
     }
 
     kis_tracked_device_base(int in_id, std::shared_ptr<tracker_element_map> e) : 
-        tracker_component(in_id) {
+        tracker_component(in_id),
+        content_generation {0} {
         register_fields();
         reserve_fields(e);
     }
@@ -290,19 +295,33 @@ public:
     __Proxy(phyname, std::string, std::string, std::string, phyname);
 	__Proxy(phyid, int32_t, int32_t, int32_t, phyid);
 
-    __ProxyL(devicename, std::string, std::string, std::string, devicename, 
-            [this](std::string i) -> bool {
-
-            // Override the common name if there's no username
-            if (has_username()) {
-                if (get_username() == "")
-                    set_commonname(i);
-            } else {
-                set_commonname(i);
-            }
-
-            return true;
-            });
+    // Fields which describe the device, instead of counting its traffic, mark the content
+    // as changed when they're set to a new value
+    virtual shared_tracker_element get_tracker_devicename() {
+        return (std::shared_ptr<tracker_element>) devicename;
+    }
+    virtual std::string get_devicename() const {
+        return get_tracker_value<std::string>(devicename);
+    }
+    virtual bool set_devicename(const std::string& in) {
+        set_only_devicename(in);
+
+        // Override the common name if there's no username
+        if (has_username()) {
+            if (get_username() == "")
+                set_commonname(in);
+        } else {
+            set_commonname(in);
+        }
+
+        return true;
+    }
+    virtual void set_only_devicename(const std::string& in) {
+        if (devicename->get() != in) {
+            devicename->set(in);
+            mark_content_changed();
+        }
+    }
 
     __ProxyDynamicL(username, std::string, std::string, std::string, username, username_id,
             [this](std::string i) -> bool {
@@ -314,10 +333,12 @@ public:
 
     __Proxy(commonname, std::string, std::string, std::string, commonname);
 
-    __Proxy(type_string, std::string, std::string, std::string, type_string);
+    __ProxyOnChange(type_string, std::string, std::string, std::string, type_string,
+            mark_content_changed);
 
-    __Proxy(basic_type_set, uint64_t, uint64_t, uint64_t, basic_type_set);
-    __ProxyBitset(basic_type_set, uint64_t, basic_type_set);
+    __ProxyOnChange(basic_type_set, uint64_t, uint64_t, uint64_t, basic_type_set,
+            mark_content_changed);
+    __ProxyBitsetOnChange(basic_type_set, uint64_t, basic_type_set, mark_content_changed);
 
     // Set the type string if any of the matching set are found
     void set_type_string_if(std::string in_type, uint64_t if_set) {
@@ -338,10 +359,17 @@ public:
     }
 
 
-    __Proxy(crypt_string, std::string, std::string, std::string, crypt_string);
+    __ProxyOnChange(crypt_string, std::string, std::string, std::string, crypt_string,
+            mark_content_changed);
 
-    __Proxy(basic_crypt_set, uint64_t, uint64_t, uint64_t, basic_crypt_set);
-    void add_basic_crypt(uint64_t in) { (*basic_crypt_set) |= in; }
+    __ProxyOnChange(basic_crypt_set, uint64_t, uint64_t, uint64_t, basic_crypt_set,
+            mark_content_changed);
+    void add_basic_crypt(uint64_t in) { 
+        if ((get_basic_crypt_set() & in) != in) {
+            (*basic_crypt_set) |= in; 
+            mark_content_changed();
+        }
+    }
 
     __Proxy(first_time, uint64_t, time_t, time_t, first_time);
     __Proxy(last_time, uint64_t, time_t, time_t, last_time);
@@ -352,6 +380,22 @@ public:
         set_mod_time(time(0));
     }
 
+    // Global modification sequence of the most recent change to the device
+    __Proxy(mod_seq, uint64_t, uint64_t, uint64_t, mod_seq);
+
+    // Stamp the device with a new modification sequence; the content sequence is
+    // only moved when the content generation has changed since the last stamp
+    void stamp_mod_seq(uint64_t in_seq) {
+        content_stamp.update(in_seq, get_content_generation());
+        set_mod_seq(in_seq);
+    }
+
+    // Modification sequence of the last change to anything but the counters,
+    // timestamps, and signal levels
+    uint64_t get_content_seq() const {
+        return content_stamp.get_seq();
+    }
+
     __Proxy(packets, uint64_t, uint64_t, uint64_t, packets);
     __ProxyIncDec(packets, uint64_t, uint64_t, packets);
 
@@ -398,11 +442,12 @@ public:
     __ProxyDynamicTrackable(packet_rrd_bin_jumbo, mrrdt, packet_rrd_bin_jumbo,
             packet_rrd_bin_jumbo_id);
 
-    __Proxy(channel, std::string, std::string, std::string, channel);
+    __ProxyOnChange(channel, std::string, std::string, std::string, channel,
+            mark_content_changed);
     __Proxy(frequency, double, double, double, frequency);
 
-    __ProxyTrackable(manuf, tracker_element_string, manuf);
-    __Proxy(manuf, std::string, std::string, std::string, manuf);
+    __ProxyTrackableOnChange(manuf, tracker_element_string, manuf, mark_content_changed);
+    __ProxyOnChange(manuf, std::string, std::string, std::string, manuf, mark_content_changed);
 
     __Proxy(num_alerts, uint32_t, unsigned int, unsigned int, alert);
 
@@ -434,6 +479,18 @@ public:
         kis_internal_id = in_id;
     }
 
+    // Non-exported generation counter, bumped whenever the content of the device
+    // changes (names, types, crypt, channel, new phy records, related devices, location
+    // bounds, etc) instead of just the counters, timestamps, signal levels, and last
+    // location; used by loggers and the changes endpoint to skip unchanged devices
+    uint64_t get_content_generation() const {
+        return content_generation;
+    }
+
+    void mark_content_changed() {
+        content_generation++;
+    }
+
     // Lock our device around serialization
     virtual void pre_serialize() override {
         local_eol_shared_locker lock(&device_mutex);
@@ -458,6 +515,12 @@ protected:
     // up long-running queries.
     uint64_t kis_internal_id;
 
+    // Structural change generation
+    std::atomic<uint64_t> content_generation;
+
+    // Sequence of the last content change
+    device_content_stamp content_stamp;
+
     // Unique key
     std::shared_ptr<tracker_element_device_key> key;
 
@@ -498,6 +561,7 @@ protected:
     std::shared_ptr<tracker_element_uint64> first_time;
     std::shared_ptr<tracker_element_uint64> last_time;
     std::shared_ptr<tracker_element_uint64> mod_time;
+    std::shared_ptr<tracker_element_uint64> mod_seq;
 
     // Packet counts
     std::shared_ptr<tracker_element_uint64> packets;
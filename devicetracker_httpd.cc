@@ -48,6 +48,12 @@
 #include "structured.h"
 #include "kismet_json.h"
 #include "base64.h"
+#include "zstr.hpp"
+
+// Devices serialized between checks of the connection, and the amount of output
+// allowed to wait for the client before the stream pauses
+static constexpr size_t stream_chunk_devices = 64;
+static constexpr size_t stream_max_pending = 512 * 1024;
 
 // HTTP interfaces
 bool device_tracker::httpd_verify_path(const char *path, const char *method) {
@@ -222,6 +228,83 @@ bool device_tracker::httpd_verify_path(const char *path, const char *method) {
     return false;
 }
 
+std::string device_tracker::httpd_stream_encoding(kis_net_httpd_connection *connection,
+        const char *url) {
+    if (strcmp(url, "/devices/all_devices.ekjson") == 0 &&
+            kishttpd::accepts_encoding(connection->connection, "gzip"))
+        return "gzip";
+
+    return "";
+}
+
+void device_tracker::stream_all_devices_ekjson(kis_net_httpd_connection *connection,
+        std::ostream& stream) {
+    auto saux = (kis_net_httpd_buffer_stream_aux *) connection->custom_extension;
+    auto rbh = saux->get_rbhandler();
+
+    // Snapshot the keys; devices removed while we stream are skipped
+    std::vector<device_key> keys;
+    {
+        local_shared_locker lock(&devicelist_mutex);
+
+        keys.reserve(tracked_map.size());
+        for (const auto& i : tracked_map)
+            keys.push_back(i.first);
+    }
+
+    // Compress into the connection stream; the gzip stream is only finished once, at 
+    // the end, so the client sees a single gzip member.  zstr finishes the member on
+    // every sync, so the compressed stream must never be flushed before then
+    std::unique_ptr<zstr::ostreambuf> zbuf;
+    std::unique_ptr<std::ostream> zstream;
+    std::ostream *out = &stream;
+
+    if (connection->content_encoding == "gzip") {
+        zbuf.reset(new zstr::ostreambuf(stream.rdbuf(), 1 << 16));
+        zstream.reset(new std::ostream(zbuf.get()));
+        out = zstream.get();
+    }
+
+    conditional_locker<size_t> drain_cl;
+    rbh->set_write_buffer_drain_cb([&drain_cl](size_t amt) {
+            drain_cl.unlock(amt);
+            });
+
+    try {
+        for (size_t i = 0; i < keys.size() && !saux->get_in_error(); i++) {
+            auto d = fetch_device(keys[i]);
+
+            if (d != nullptr) {
+                local_shared_locker devlocker(&d->device_mutex);
+                entrytracker->serialize("json", *out, d, nullptr);
+                *out << "\n";
+            }
+
+            if ((i + 1) % stream_chunk_devices != 0)
+                continue;
+
+            // Wait for the client to catch up before serializing the next chunk
+            while (rbh->get_write_buffer_used() > stream_max_pending && !saux->get_in_error()) {
+                drain_cl.lock();
+
+                if (rbh->get_write_buffer_used() <= stream_max_pending)
+                    break;
+
+                drain_cl.block_for_ms(std::chrono::milliseconds(500));
+            }
+        }
+    } catch (...) {
+        rbh->remove_write_buffer_drain_cb();
+        throw;
+    }
+
+    rbh->remove_write_buffer_drain_cb();
+
+    // Finish the gzip stream; the connection stream is synced when the generator returns
+    zstream.reset();
+    zbuf.reset();
+}
+
 int device_tracker::httpd_create_stream_response(
         kis_net_httpd *httpd __attribute__((unused)),
         kis_net_httpd_connection *connection,
@@ -259,20 +342,7 @@ int device_tracker::httpd_create_stream_response(
 
 
     if (strcmp(path, "/devices/all_devices.ekjson") == 0) {
-        // Instantiate a manual serializer
-        json_adapter::serializer serial; 
-
-        auto fw = std::make_shared<devicetracker_function_worker>(
-                [&stream, &serial](device_tracker *, std::shared_ptr<kis_tracked_device_base> d) -> bool {
-                    serial.serialize(d, stream);
-                    stream << "\n";
-
-                    // Return false because we're not building a list, we're serializing
-                    // per element
-                    return false;
-                }, nullptr);
-
-        do_readonly_device_work(fw);
+        stream_all_devices_ekjson(connection, stream);
         return MHD_YES;
     }
 
@@ -395,18 +465,8 @@ int device_tracker::httpd_create_stream_response(
             if (!httpd_can_serialize(tokenurl[4]))
                 return MHD_YES;
 
-            std::shared_ptr<tracker_element_vector> devvec;
-
-            auto fw = std::make_shared<devicetracker_function_worker>(
-                    [devvec, lastts](device_tracker *, 
-                        std::shared_ptr<kis_tracked_device_base> d) -> bool {
-                        if (d->get_last_time() <= lastts)
-                            return false;
-
-                        return true;
-                    }, nullptr);
-            do_readonly_device_work(fw);
-            devvec = fw->GetMatchedDevices();
+            // Only devices seen after the timestamp, from the last-seen index
+            auto devvec = fetch_devices_since(lastts + 1);
 
             Globalreg::globalreg->entrytracker->serialize(httpd->get_suffix(tokenurl[4]), stream, devvec, NULL);
 
@@ -692,16 +752,8 @@ int device_tracker::httpd_post_complete(kis_net_httpd_connection *concls) {
                 //  List of devices that pass the regex filter
                 auto regexdevs = std::make_shared<tracker_element_vector>();
 
-                auto tw = std::make_shared<devicetracker_function_worker>(
-                        [lastts](device_tracker *, std::shared_ptr<kis_tracked_device_base> d) -> bool {
-
-                        if (d->get_last_time() <= lastts)
-                            return false;
-
-                        return true;
-                        }, nullptr);
-                do_readonly_device_work(tw);
-                timedevs = tw->GetMatchedDevices();
+                // Only devices seen after the timestamp, from the last-seen index
+                timedevs = fetch_devices_since(lastts + 1);
 
                 if (regexdata != NULL) {
                     auto worker = std::make_shared<devicetracker_pcre_worker>(regexdata);
@@ -794,6 +846,127 @@ unsigned int device_tracker::multimac_endp_handler(std::ostream& stream, const s
     return 500;
 }
 
+unsigned int device_tracker::changes_endp_handler(std::ostream& stream, const std::string& uri,
+        shared_structured structured, kis_net_httpd_connection::variable_cache_map& variable_cache) {
+
+    try {
+        uint64_t since = structured->key_as_number("since", 0);
+        bool delta = structured->key_as_bool("delta", false);
+        auto epoch = structured->key_as_string("epoch", "");
+
+        auto devices = std::make_shared<tracker_element_vector>(changes_devices_id);
+        auto updated = std::make_shared<tracker_element_vector>(changes_updated_id);
+        auto removed = std::make_shared<tracker_element_vector>(changes_removed_id);
+
+        // Take the sequence before looking at any device; anything stamped after this
+        // point is returned again by the next request
+        uint64_t seq = device_changes.current_seq();
+
+        std::shared_ptr<tracker_element_vector> immutable_copy;
+        bool resync;
+
+        {
+            local_shared_locker l(&devicelist_mutex);
+
+            immutable_copy = std::make_shared<tracker_element_vector>(immutable_tracked_vec);
+
+            resync = device_changes.needs_resync(since, seq, epoch);
+
+            device_changes.removed_since(since, [&](const device_key& key) {
+                    auto k = std::make_shared<tracker_element_device_key>(changes_removed_key_id);
+                    k->set(key);
+                    removed->push_back(k);
+                    });
+        }
+
+        for (auto i : *immutable_copy) {
+            if (i == nullptr)
+                continue;
+
+            auto d = std::static_pointer_cast<kis_tracked_device_base>(i);
+
+            local_shared_locker devlocker(&(d->device_mutex));
+
+            auto change = device_change_log::classify(since, resync, delta, 
+                    d->get_mod_seq(), d->get_content_seq());
+
+            if (change == device_change_log::change::none)
+                continue;
+
+            if (change == device_change_log::change::full) {
+                devices->push_back(d);
+                continue;
+            }
+
+            // Only the counters, signal, and last location have changed, send a copy of
+            // them instead of the device
+            auto u = std::make_shared<tracker_element_map>(changes_update_id);
+
+            auto k = std::make_shared<tracker_element_device_key>(d->get_tracker_key()->get_id());
+            k->set(d->get_key());
+            u->insert(k);
+
+            u->insert(std::make_shared<tracker_element_uint64>(d->get_tracker_mod_seq()->get_id(), 
+                        d->get_mod_seq()));
+            u->insert(std::make_shared<tracker_element_uint64>(d->get_tracker_last_time()->get_id(),
+                        d->get_last_time()));
+            u->insert(std::make_shared<tracker_element_uint64>(d->get_tracker_mod_time()->get_id(),
+                        d->get_mod_time()));
+            u->insert(std::make_shared<tracker_element_uint64>(d->get_tracker_packets()->get_id(),
+                        d->get_packets()));
+            u->insert(std::make_shared<tracker_element_uint64>(d->get_tracker_datasize()->get_id(),
+                        d->get_datasize()));
+
+            if (d->has_signal_data())
+                u->insert(std::make_shared<tracker_element_int32>(changes_last_signal_id,
+                            d->get_signal_data()->get_last_signal()));
+
+            if (d->has_location() && d->get_location()->get_last_loc() != nullptr) {
+                auto last = d->get_location()->get_last_loc();
+                auto l = std::make_shared<kis_tracked_location_triplet>(last->get_id());
+
+                l->set(last->get_lat(), last->get_lon(), last->get_alt(), last->get_fix());
+                l->set_speed(last->get_speed());
+                l->set_heading(last->get_heading());
+                l->set_time_sec(last->get_time_sec());
+                l->set_time_usec(last->get_time_usec());
+
+                u->insert(l);
+            }
+
+            updated->push_back(u);
+        }
+
+        // Full device records are summarized with the usual 'fields' option
+        auto rename_map = std::make_shared<tracker_element_serializer::rename_map>();
+
+        auto summarized = 
+            kishttpd::summarize_with_structured(devices, structured, rename_map);
+        summarized->set_id(changes_devices_id);
+
+        auto ret = std::make_shared<tracker_element_map>();
+
+        ret->insert(std::make_shared<tracker_element_uint64>(changes_seq_id, seq));
+        ret->insert(std::make_shared<tracker_element_uuid>(changes_epoch_id, 
+                    device_changes.get_epoch()));
+        ret->insert(std::make_shared<tracker_element_uint8>(changes_resync_id, resync));
+        ret->insert(summarized);
+        ret->insert(updated);
+        ret->insert(removed);
+
+        Globalreg::globalreg->entrytracker->serialize(kishttpd::get_suffix(uri), stream, ret, rename_map);
+
+        return 200;
+
+    } catch (const std::exception& e) {
+        stream << "Invalid request: " << e.what() << "\n";
+        return 500;
+    }
+
+    stream << "Unhandled request\n";
+    return 500;
+}
+
 std::shared_ptr<tracker_element> device_tracker::all_phys_endp_handler() {
     auto ret_vec = 
         std::make_shared<tracker_element_vector>();
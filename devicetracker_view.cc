@@ -18,18 +18,118 @@
 
 #include "config.h"
 
+#include "devicetracker.h"
 #include "devicetracker_view.h"
 #include "devicetracker_component.h"
 #include "util.h"
 
 #include "kis_mutex.h"
 #include "kismet_algorithm.h"
+#include "alphanum.hpp"
+
+device_tracker_view_index::device_tracker_view_index(const std::string& in_field,
+        bool in_string_key, key_extractor_cb in_extractor) :
+    field {in_field},
+    string_key {in_string_key},
+    active {false},
+    extractor {in_extractor},
+    sorted {entry_compare{in_string_key}} { }
+
+const std::vector<int>& device_tracker_view_index::get_path() {
+    if (path.size() == 0)
+        path = tracker_element_summary{field}.resolved_path;
+
+    return path;
+}
+
+bool device_tracker_view_index::entry_compare::operator()(const entry& a, const entry& b) const {
+    // Order by the key, then by the device key so that equal values have a stable order
+    if (string_key) {
+        auto c = doj::alphanum_comp(a.key.str, b.key.str);
+
+        if (c != 0)
+            return c < 0;
+    } else if (a.key.num != b.key.num) {
+        return a.key.num < b.key.num;
+    }
+
+    return a.dkey < b.dkey;
+}
+
+bool device_tracker_view_index::update(std::shared_ptr<kis_tracked_device_base> device,
+        const sort_key& key) {
+    auto dkey = device->get_key();
+    auto pi = positions.find(dkey);
+
+    if (pi == positions.end()) {
+        positions[dkey] = sorted.insert(entry{key, dkey, device}).first;
+        return true;
+    }
+
+    if (string_key ? pi->second->key.str == key.str : pi->second->key.num == key.num)
+        return false;
+
+    // Most key changes, like a last-seen time moving forward among devices seen in
+    // other seconds, leave the device between the same neighbours
+    auto neighbours = [this](entry_set::iterator i) {
+        auto n = std::next(i);
+        return std::make_pair(i == sorted.begin() ? nullptr : std::prev(i)->device.get(),
+                n == sorted.end() ? nullptr : n->device.get());
+    };
+
+    auto before = neighbours(pi->second);
+
+    sorted.erase(pi->second);
+    pi->second = sorted.insert(entry{key, dkey, device}).first;
+
+    return neighbours(pi->second) != before;
+}
+
+void device_tracker_view_index::insert(std::shared_ptr<kis_tracked_device_base> device,
+        const sort_key& key) {
+    auto dkey = device->get_key();
+
+    if (positions.find(dkey) != positions.end())
+        return;
+
+    positions[dkey] = sorted.insert(entry{key, dkey, device}).first;
+}
+
+void device_tracker_view_index::remove(const device_key& key) {
+    auto pi = positions.find(key);
+
+    if (pi == positions.end())
+        return;
+
+    sorted.erase(pi->second);
+    positions.erase(pi);
+}
+
+void device_tracker_view_index::clear() {
+    sorted.clear();
+    positions.clear();
+}
+
+void device_tracker_view_index::walk(bool ascending,
+        const std::function<bool (const std::shared_ptr<kis_tracked_device_base>&)>& cb) const {
+    if (ascending) {
+        for (auto i = sorted.begin(); i != sorted.end(); ++i)
+            if (!cb(i->device))
+                return;
+    } else {
+        for (auto i = sorted.rbegin(); i != sorted.rend(); ++i)
+            if (!cb(i->device))
+                return;
+    }
+}
 
 device_tracker_view::device_tracker_view(const std::string& in_id, const std::string& in_description, 
         new_device_cb in_new_cb, updated_device_cb in_update_cb) :
     tracker_component{},
     new_cb {in_new_cb},
-    update_cb {in_update_cb} {
+    update_cb {in_update_cb},
+    sort_indexes_active {false},
+    list_generation {0} {
 
     mutex.set_name(fmt::format("devicetracker_view({})", in_id));
 
@@ -43,6 +143,8 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
 
     device_list = std::make_shared<tracker_element_vector>();
 
+    register_sort_indexes();
+
     auto uri = fmt::format("/devices/views/{}/devices", in_id);
     device_endp =
         std::make_shared<kis_net_httpd_simple_post_endpoint>(uri, 
@@ -67,6 +169,8 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
     tracker_component{},
     new_cb {in_new_cb},
     update_cb {in_update_cb},
+    sort_indexes_active {false},
+    list_generation {0},
     uri_extras {in_aux_path} {
 
     using namespace std::placeholders;
@@ -79,6 +183,8 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
 
     device_list = std::make_shared<tracker_element_vector>();
 
+    register_sort_indexes();
+
     // Because we can't lock the device view and acquire locks on devices while the caller
     // might also hold locks on devices, we need to specially handle the mutex ourselves;
     // all our endpoints are registered w/ no mutex, accordingly.
@@ -126,6 +232,146 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
     
 }
 
+void device_tracker_view::register_sort_indexes() {
+    using sort_key = device_tracker_view_index::sort_key;
+
+    sort_indexes.push_back(std::unique_ptr<device_tracker_view_index>(
+                new device_tracker_view_index("kismet.device.base.last_time", false,
+                    [](std::shared_ptr<kis_tracked_device_base> dev) -> sort_key {
+                        sort_key k;
+                        k.num = dev->get_last_time();
+                        return k;
+                    })));
+
+    sort_indexes.push_back(std::unique_ptr<device_tracker_view_index>(
+                new device_tracker_view_index("kismet.device.base.packets.total", false,
+                    [](std::shared_ptr<kis_tracked_device_base> dev) -> sort_key {
+                        sort_key k;
+                        k.num = dev->get_packets();
+                        return k;
+                    })));
+
+    sort_indexes.push_back(std::unique_ptr<device_tracker_view_index>(
+                new device_tracker_view_index("kismet.device.base.signal/kismet.common.signal.last_signal", 
+                    false,
+                    [](std::shared_ptr<kis_tracked_device_base> dev) -> sort_key {
+                        sort_key k;
+                        auto sd = dev->get_tracker_signal_data();
+                        if (sd != nullptr)
+                            k.num = sd->get_last_signal();
+                        return k;
+                    })));
+
+    sort_indexes.push_back(std::unique_ptr<device_tracker_view_index>(
+                new device_tracker_view_index("kismet.device.base.commonname", true,
+                    [](std::shared_ptr<kis_tracked_device_base> dev) -> sort_key {
+                        sort_key k;
+                        k.str = dev->get_commonname();
+                        return k;
+                    })));
+}
+
+device_tracker_view_index *device_tracker_view::fetch_sort_index(const std::vector<int>& path) {
+    device_tracker_view_index *index = nullptr;
+    std::shared_ptr<tracker_element_vector> devices;
+
+    {
+        local_locker l(&mutex);
+
+        for (const auto& i : sort_indexes) {
+            if (i->get_path() == path) {
+                index = i.get();
+                break;
+            }
+        }
+
+        if (index == nullptr || index->get_active())
+            return index;
+
+        // Activate the index before populating it, so that any updates which happen 
+        // while we're building it are applied
+        index->set_active(true);
+        sort_indexes_active = true;
+
+        devices = std::make_shared<tracker_element_vector>(device_list);
+    }
+
+    // Snapshot the keys without holding the view lock, we can't acquire device locks
+    // under it
+    std::vector<device_tracker_view_index::sort_key> keys;
+    keys.reserve(devices->size());
+
+    for (const auto& i : *devices) {
+        auto dev = std::static_pointer_cast<kis_tracked_device_base>(i);
+        local_shared_locker dl(&dev->device_mutex);
+        keys.push_back(index->extract_key(dev));
+    }
+
+    local_locker l(&mutex);
+
+    // Devices which have been updated since the snapshot are already indexed with a 
+    // newer key, and devices removed since the snapshot are skipped
+    for (size_t i = 0; i < devices->size(); i++) {
+        auto dev = std::static_pointer_cast<kis_tracked_device_base>((*devices)[i]);
+
+        if (device_presence_map.find(dev->get_key()) == device_presence_map.end())
+            continue;
+
+        index->insert(dev, keys[i]);
+    }
+
+    return index;
+}
+
+std::vector<std::pair<device_tracker_view_index *, device_tracker_view_index::sort_key>> 
+    device_tracker_view::extract_sort_keys(std::shared_ptr<kis_tracked_device_base> device) {
+    std::vector<std::pair<device_tracker_view_index *, device_tracker_view_index::sort_key>> ret;
+
+    if (!sort_indexes_active)
+        return ret;
+
+    for (const auto& i : sort_indexes) {
+        if (i->get_active())
+            ret.push_back(std::make_pair(i.get(), i->extract_key(device)));
+    }
+
+    return ret;
+}
+
+bool device_tracker_view::update_sort_indexes(std::shared_ptr<kis_tracked_device_base> device,
+        const std::vector<std::pair<device_tracker_view_index *, 
+        device_tracker_view_index::sort_key>>& keys) {
+    bool moved = false;
+
+    for (const auto& k : keys) 
+        moved |= k.first->update(device, k.second);
+
+    return moved;
+}
+
+void device_tracker_view::remove_sort_indexes(std::shared_ptr<kis_tracked_device_base> device) {
+    if (!sort_indexes_active)
+        return;
+
+    for (const auto& i : sort_indexes)
+        i->remove(device->get_key());
+}
+
+void device_tracker_view::update_device_sort(std::shared_ptr<kis_tracked_device_base> device) {
+    if (!sort_indexes_active)
+        return;
+
+    auto keys = extract_sort_keys(device);
+
+    local_locker l(&mutex);
+
+    if (device_presence_map.find(device->get_key()) == device_presence_map.end())
+        return;
+
+    if (update_sort_indexes(device, keys))
+        list_generation++;
+}
+
 std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(device_tracker_view_worker& worker) {
     // Make a copy of the vector
     std::shared_ptr<tracker_element_vector> immutable_copy;
@@ -183,6 +429,29 @@ std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(devi
 std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_work(device_tracker_view_worker& worker,
         std::shared_ptr<tracker_element_vector> devices) {
     auto ret = std::make_shared<tracker_element_vector>();
+
+    if (worker.parallel_safe()) {
+        auto devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
+
+        if (devicetracker->can_shard_device_work(devices->size())) {
+            auto matched = devicetracker->parallel_match_devices(devices->size(),
+                    [&](size_t i) {
+                        return std::static_pointer_cast<kis_tracked_device_base>((*devices)[i]);
+                    },
+                    [&](std::shared_ptr<kis_tracked_device_base> dev) {
+                        return worker.match_device(dev);
+                    });
+
+            ret->reserve(matched.size());
+            for (const auto& d : matched)
+                ret->push_back(d);
+
+            worker.set_matched_devices(ret);
+
+            return ret;
+        }
+    }
+
     ret->reserve(devices->size());
     kis_recursive_timed_mutex ret_mutex;
 
@@ -214,6 +483,8 @@ std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_
 
 void device_tracker_view::new_device(std::shared_ptr<kis_tracked_device_base> device) {
     if (new_cb != nullptr) {
+        auto keys = extract_sort_keys(device);
+
         local_locker l(&mutex);
 
         if (new_cb(device)) {
@@ -222,9 +493,11 @@ void device_tracker_view::new_device(std::shared_ptr<kis_tracked_device_base> de
             if (dpmi == device_presence_map.end()) {
                 device_presence_map[device->get_key()] = true;
                 device_list->push_back(device);
+                update_sort_indexes(device, keys);
             }
 
             list_sz->set(device_list->size());
+            list_generation++;
         }
     }
 }
@@ -234,6 +507,8 @@ void device_tracker_view::update_device(std::shared_ptr<kis_tracked_device_base>
     if (update_cb == nullptr)
         return;
 
+    auto keys = extract_sort_keys(device);
+
     {
         local_locker l(&mutex);
         bool retain = update_cb(device);
@@ -245,7 +520,15 @@ void device_tracker_view::update_device(std::shared_ptr<kis_tracked_device_base>
         if (retain && dpmi == device_presence_map.end()) {
             device_list->push_back(device);
             device_presence_map[device->get_key()] = true;
+            update_sort_indexes(device, keys);
             list_sz->set(device_list->size());
+            list_generation++;
+            return;
+        }
+
+        if (retain) {
+            if (update_sort_indexes(device, keys))
+                list_generation++;
             return;
         }
 
@@ -259,7 +542,9 @@ void device_tracker_view::update_device(std::shared_ptr<kis_tracked_device_base>
                 }
             }
             device_presence_map.erase(dpmi);
+            remove_sort_indexes(device);
             list_sz->set(device_list->size());
+            list_generation++;
             return;
         }
     }
@@ -279,12 +564,17 @@ void device_tracker_view::remove_device(std::shared_ptr<kis_tracked_device_base>
                 break;
             }
         }
+
+        remove_sort_indexes(device);
         
         list_sz->set(device_list->size());
+        list_generation++;
     }
 }
 
 void device_tracker_view::add_device_direct(std::shared_ptr<kis_tracked_device_base> device) {
+    auto keys = extract_sort_keys(device);
+
     local_locker l(&mutex);
 
     auto di = device_presence_map.find(device->get_key());
@@ -294,8 +584,10 @@ void device_tracker_view::add_device_direct(std::shared_ptr<kis_tracked_device_b
 
     device_presence_map[device->get_key()] = true;
     device_list->push_back(device);
+    update_sort_indexes(device, keys);
 
     list_sz->set(device_list->size());
+    list_generation++;
 }
 
 void device_tracker_view::remove_device_direct(std::shared_ptr<kis_tracked_device_base> device) {
@@ -312,11 +604,37 @@ void device_tracker_view::remove_device_direct(std::shared_ptr<kis_tracked_devic
                 break;
             }
         }
+
+        remove_sort_indexes(device);
         
         list_sz->set(device_list->size());
+        list_generation++;
     }
 }
 
+std::shared_ptr<tracker_element_vector> device_tracker_view::fetch_devices_since(time_t in_ts) {
+    auto devicetracker = 
+        Globalreg::fetch_mandatory_global_as<device_tracker>();
+
+    // Recently seen devices come from the device tracker's last-seen index, we only need 
+    // to check them for membership in this view
+    auto recent = devicetracker->fetch_devices_since(in_ts);
+
+    auto ret = std::make_shared<tracker_element_vector>();
+    ret->reserve(recent->size());
+
+    local_shared_locker l(&mutex);
+
+    for (const auto& i : *recent) {
+        auto dev = std::static_pointer_cast<kis_tracked_device_base>(i);
+
+        if (device_presence_map.find(dev->get_key()) != device_presence_map.end())
+            ret->push_back(dev);
+    }
+
+    return ret;
+}
+
 bool device_tracker_view::device_time_endpoint_path(const std::vector<std::string>& path) {
     // /devices/views/[id]/last-time/[time]/devices
 
@@ -339,9 +657,6 @@ bool device_tracker_view::device_time_endpoint_path(const std::vector<std::strin
 }
 
 std::shared_ptr<tracker_element> device_tracker_view::device_time_endpoint(const std::vector<std::string>& path) {
-    // The device worker creates an immutable copy of the device list under its own RO mutex,
-    // so we don't have to lock here.
-    
     auto ret = std::make_shared<tracker_element_vector>();
 
     if (path.size() < 6)
@@ -355,19 +670,11 @@ std::shared_ptr<tracker_element> device_tracker_view::device_time_endpoint(const
         return ret;
 
     if (tv < 0)
-        ts = time(0) - tv;
+        ts = time(0) + tv;
     else
         ts = tv;
 
-    auto worker = 
-        device_tracker_view_function_worker([&](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
-                if (dev->get_last_time() < ts)
-                    return false;
-
-                return true;
-                });
-
-    return do_readonly_device_work(worker);
+    return fetch_devices_since(ts);
 }
 
 bool device_tracker_view::device_time_uri_endpoint_path(const std::vector<std::string>& path) {
@@ -401,8 +708,6 @@ bool device_tracker_view::device_time_uri_endpoint_path(const std::vector<std::s
 }
 
 std::shared_ptr<tracker_element> device_tracker_view::device_time_uri_endpoint(const std::vector<std::string>& path) {
-    // The device worker creates an immutable copy of the device list under its own RO mutex,
-    // so we don't have to lock here.
     auto ret = std::make_shared<tracker_element_vector>();
 
     auto extras_sz = uri_extras.size();
@@ -425,15 +730,7 @@ std::shared_ptr<tracker_element> device_tracker_view::device_time_uri_endpoint(c
     else
         ts = tv;
 
-    auto worker = 
-        device_tracker_view_function_worker([&](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
-                if (dev->get_last_time() < ts)
-                    return false;
-
-                return true;
-                });
-
-    return do_readonly_device_work(worker);
+    return fetch_devices_since(ts);
 }
 
 unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream, 
@@ -445,8 +742,9 @@ unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream,
     // Rename cache generated by summarization
     auto rename_map = std::make_shared<tracker_element_serializer::rename_map>();
 
-    // Timestamp limitation
+    // Timestamp limitation, and the raw requested time for caching
     time_t timestamp_min = 0;
+    int64_t raw_ts = 0;
 
     // String search term, if any
     auto search_term = std::string{};
@@ -508,7 +806,7 @@ unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream,
         }
 
         // Capture timestamp and negative-offset timestamp
-        int64_t raw_ts = structured->key_as_number("last_time", 0);
+        raw_ts = structured->key_as_number("last_time", 0);
         if (raw_ts < 0)
             timestamp_min = time(0) + raw_ts;
         else
@@ -624,33 +922,175 @@ unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream,
         return 400;
     }
 
+    // Summarize and serialize a window of the results
+    auto emit_window = 
+        [&](std::shared_ptr<tracker_element_vector> window_vec, uint64_t total_sz,
+                uint64_t filtered_sz, unsigned int window_start) -> unsigned int {
+        total_sz_elem->set(total_sz);
+        filtered_sz_elem->set(filtered_sz);
+        start_elem->set(window_start);
+        length_elem->set(window_vec->size());
+
+        for (const auto& i : *window_vec)
+            output_devices_elem->push_back(summarize_single_tracker_element(i, summary_vec, rename_map));
+
+        // If the transmit wasn't assigned to a wrapper...
+        if (transmit == nullptr)
+            transmit = output_devices_elem;
+
+        // serialize
+        Globalreg::globalreg->entrytracker->serialize(kishttpd::get_suffix(uri), stream, transmit, rename_map);
+
+        // And done
+        return 200;
+    };
+
+    // Identical requests, such as multiple UI clients polling the same table, are answered
+    // from the previous result when the view membership and indexed order haven't changed
+    // and the result is less than a second old
+    std::string cache_key;
+    try {
+        std::stringstream ks;
+
+        ks << raw_ts << '\x1f' << search_term << '\x1f' << in_window_start << '\x1f' << 
+            in_window_len << '\x1f' << in_order_column_num << '\x1f' << in_order_direction << '\x1f';
+
+        for (auto o : order_field)
+            ks << o << '/';
+        ks << '\x1f';
+
+        for (const auto& sp : search_paths) {
+            for (auto o : sp)
+                ks << o << '/';
+            ks << ',';
+        }
+        ks << '\x1f';
+
+        if (regex != nullptr) {
+            for (const auto& r : regex->as_vector())
+                for (const auto& rs : r->as_vector())
+                    ks << rs->as_string() << '\x1e';
+        }
+
+        cache_key = ks.str();
+    } catch (const std::exception& e) {
+        // Malformed regex filters are rejected by the filter itself below
+        cache_key = "";
+    }
+
+    if (cache_key.length() != 0) {
+        local_locker l(&window_cache_mutex);
+
+        auto ci = window_cache.find(cache_key);
+
+        if (ci != window_cache.end() && ci->second.generation == list_generation &&
+                std::chrono::steady_clock::now() - ci->second.ts < std::chrono::seconds(1)) {
+            auto& c = ci->second;
+            return emit_window(c.devices, c.total_sz, c.filtered_sz, c.window_start);
+        }
+    }
+
+    // Remember the result of this request for any identical ones which follow
+    auto cache_window = 
+        [&](std::shared_ptr<tracker_element_vector> window_vec, uint64_t generation,
+                uint64_t total_sz, uint64_t filtered_sz, unsigned int window_start) {
+        if (cache_key.length() == 0)
+            return;
+
+        local_locker l(&window_cache_mutex);
+
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto ci = window_cache.begin(); ci != window_cache.end(); ) {
+            if (now - ci->second.ts >= std::chrono::seconds(1))
+                ci = window_cache.erase(ci);
+            else
+                ++ci;
+        }
+
+        if (window_cache.size() >= 32)
+            return;
+
+        auto& c = window_cache[cache_key];
+        c.generation = generation;
+        c.ts = now;
+        c.total_sz = total_sz;
+        c.filtered_sz = filtered_sz;
+        c.window_start = window_start;
+        c.devices = window_vec;
+    };
+
+    // Sorting by an indexed field, with no filters, is answered by walking the sort index 
+    // instead of copying and sorting the whole view
+    device_tracker_view_index *sort_index = nullptr;
+
+    if (in_order_column_num >= 0 && order_field.size() > 0 && timestamp_min == 0 &&
+            search_term.length() == 0 && regex == nullptr) 
+        sort_index = fetch_sort_index(order_field);
+
+    if (sort_index != nullptr) {
+        auto window_vec = std::make_shared<tracker_element_vector>();
+        uint64_t total_sz = 0;
+        uint64_t filtered_sz = 0;
+        uint64_t generation;
+
+        {
+            local_shared_locker l(&mutex);
+
+            generation = list_generation;
+            total_sz = device_list->size();
+
+            // With no filters we know the filtered size up front and only need to walk
+            // to the end of the window
+            filtered_sz = sort_index->size();
+
+            if (in_window_start >= filtered_sz)
+                in_window_start = 0;
+
+            size_t pos = 0;
+
+            sort_index->walk(in_order_direction == 0,
+                    [&](const std::shared_ptr<kis_tracked_device_base>& dev) -> bool {
+                    if (in_window_len != 0 && window_vec->size() >= in_window_len)
+                        return false;
+
+                    if (pos++ >= in_window_start)
+                        window_vec->push_back(dev);
+
+                    return true;
+                    });
+        }
+
+        cache_window(window_vec, generation, total_sz, filtered_sz, in_window_start);
+
+        return emit_window(window_vec, total_sz, filtered_sz, in_window_start);
+    }
+
     // Next vector we do work on
     auto next_work_vec = std::make_shared<tracker_element_vector>();
+    uint64_t generation;
+
+    uint64_t total_sz;
 
     // Copy the entire vector list, under lock, to the next work vector; this makes it an independent copy
     // which is protected from the main vector being grown/shrank.  While we're in there, log the total
     // size of the original vector for windowed ops.
+    //
+    // If we have a time filter, start from the recently seen devices instead of the whole list, it's 
+    // the fastest.
     {
         local_shared_locker l(&mutex);
 
-        next_work_vec->set(device_list->begin(), device_list->end());
-        total_sz_elem->set(next_work_vec->size());
-    }
-
-    // If we have a time filter, apply that first, it's the fastest.
-    if (timestamp_min > 0) {
-        auto worker = 
-            device_tracker_view_function_worker([timestamp_min] (std::shared_ptr<kis_tracked_device_base> dev) -> bool {
-                    if (dev->get_last_time() < timestamp_min)
-                        return false;
-                    return true;
-                    });
+        generation = list_generation;
+        total_sz = device_list->size();
 
-        // Do the work and copy the vector
-        auto ts_vec = do_readonly_device_work(worker, next_work_vec);
-        next_work_vec->set(ts_vec->begin(), ts_vec->end());
+        if (timestamp_min == 0)
+            next_work_vec->set(device_list->begin(), device_list->end());
     }
 
+    if (timestamp_min > 0)
+        next_work_vec = fetch_devices_since(timestamp_min);
+
     // Apply a string filter
     if (search_term.length() > 0 && search_paths.size() > 0) {
         auto worker =
@@ -674,36 +1114,31 @@ unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream,
     }
 
     // Apply the filtered length
-    filtered_sz_elem->set(next_work_vec->size());
+    uint64_t filtered_sz = next_work_vec->size();
 
     // Slice from the beginning of the list
     if (in_window_start >= next_work_vec->size()) 
         in_window_start = 0;
 
-    // Update the start
-    start_elem->set(in_window_start);
-
-    tracker_element_vector::iterator si = std::next(next_work_vec->begin(), in_window_start);
-    tracker_element_vector::iterator ei;
+    size_t window_end;
 
     if (in_window_len + in_window_start >= next_work_vec->size() || in_window_len == 0)
-        ei = next_work_vec->end();
+        window_end = next_work_vec->size();
     else
-        ei = std::next(next_work_vec->begin(), in_window_start + in_window_len);
-
-    // Update the end
-    length_elem->set(ei - si);
+        window_end = in_window_start + in_window_len;
 
-    // Unfortunately we need to do a stable sort to get a consistent display
     if (in_order_column_num >= 0 && order_field.size() > 0) {
-        std::stable_sort(next_work_vec->begin(), next_work_vec->end(),
-                [&](shared_tracker_element a, shared_tracker_element b) -> bool {
+        auto compare = 
+            [&](shared_tracker_element a, shared_tracker_element b) -> bool {
                 shared_tracker_element fa;
                 shared_tracker_element fb;
 
                 fa = get_tracker_element_path(order_field, a);
                 fb = get_tracker_element_path(order_field, b);
 
+                if (fa == nullptr && fb == nullptr)
+                    return false;
+
                 if (fa == nullptr) 
                     return in_order_direction == 0;
 
@@ -714,23 +1149,33 @@ unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream,
                     return fast_sort_tracker_element_less(fa, fb);
 
                 return fast_sort_tracker_element_less(fb, fa);
-            });
-    }
-
-    // Summarize into the output element
-    for (auto i = si; i != ei; ++i) {
-        output_devices_elem->push_back(summarize_single_tracker_element(*i, summary_vec, rename_map));
+            };
+
+        // When only a window is requested, only sort as far as the end of the window; 
+        // partial_sort isn't stable, so break ties by device key to keep a consistent display
+        // between requests.  Otherwise we need a stable sort of everything.
+        if (window_end < next_work_vec->size()) {
+            std::partial_sort(next_work_vec->begin(), 
+                    std::next(next_work_vec->begin(), window_end), next_work_vec->end(),
+                    [&](shared_tracker_element a, shared_tracker_element b) -> bool {
+                        if (compare(a, b))
+                            return true;
+                        if (compare(b, a))
+                            return false;
+
+                        return std::static_pointer_cast<kis_tracked_device_base>(a)->get_key() <
+                            std::static_pointer_cast<kis_tracked_device_base>(b)->get_key();
+                    });
+        } else {
+            std::stable_sort(next_work_vec->begin(), next_work_vec->end(), compare);
+        }
     }
 
-    // If the transmit wasn't assigned to a wrapper...
-    if (transmit == nullptr)
-        transmit = output_devices_elem;
+    auto window_vec = 
+        std::make_shared<tracker_element_vector>(std::next(next_work_vec->begin(), in_window_start),
+                std::next(next_work_vec->begin(), window_end));
 
-    // serialize
-    Globalreg::globalreg->entrytracker->serialize(kishttpd::get_suffix(uri), stream, transmit, rename_map);
+    cache_window(window_vec, generation, total_sz, filtered_sz, in_window_start);
 
-    // And done
-    return 200;
+    return emit_window(window_vec, total_sz, filtered_sz, in_window_start);
 }
-
-
@@ -21,7 +21,10 @@
 
 #include "config.h"
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <set>
 #include <unordered_map>
 
 #include "kis_mutex.h"
@@ -52,6 +55,85 @@
 class kis_tracked_device;
 class device_tracker_view;
 
+// Incrementally maintained sort order of the devices in a view for a single, commonly 
+// sorted field.  Each device is stored with a snapshot of its sort key so that it can be
+// re-positioned when the key changes, instead of copying and sorting the entire view for
+// every request.
+//
+// Indexes are not thread safe; they are protected by the view mutex.
+class device_tracker_view_index {
+public:
+    // Snapshot of a sort key; numeric fields use num, string fields use str
+    struct sort_key {
+        sort_key() : num {0} { }
+
+        int64_t num;
+        std::string str;
+    };
+
+    using key_extractor_cb = std::function<sort_key (std::shared_ptr<kis_tracked_device_base>)>;
+
+    device_tracker_view_index(const std::string& in_field, bool in_string_key, 
+            key_extractor_cb in_extractor);
+
+    const std::string& get_field() const { return field; }
+
+    // Resolved path of the field, as sent in a sort request; resolved on demand because
+    // the device fields may not be registered when the view is created
+    const std::vector<int>& get_path();
+
+    bool get_active() const { return active; }
+    void set_active(bool in_active) { active = in_active; }
+
+    sort_key extract_key(std::shared_ptr<kis_tracked_device_base> device) const {
+        return extractor(device);
+    }
+
+    // Insert a device or re-position it if the key has changed; returns true if the
+    // device is new to the index or its place in the order changed
+    bool update(std::shared_ptr<kis_tracked_device_base> device, const sort_key& key);
+
+    // Insert a device only if it isn't already indexed
+    void insert(std::shared_ptr<kis_tracked_device_base> device, const sort_key& key);
+
+    void remove(const device_key& key);
+
+    void clear();
+
+    size_t size() const {
+        return sorted.size();
+    }
+
+    // Walk the devices in ascending or descending order until the callback returns false
+    void walk(bool ascending, 
+            const std::function<bool (const std::shared_ptr<kis_tracked_device_base>&)>& cb) const;
+
+protected:
+    struct entry {
+        sort_key key;
+        device_key dkey;
+        std::shared_ptr<kis_tracked_device_base> device;
+    };
+
+    struct entry_compare {
+        bool string_key;
+
+        bool operator()(const entry& a, const entry& b) const;
+    };
+
+    using entry_set = std::set<entry, entry_compare>;
+
+    std::string field;
+    std::vector<int> path;
+    bool string_key;
+    bool active;
+
+    key_extractor_cb extractor;
+
+    entry_set sorted;
+    std::unordered_map<device_key, entry_set::iterator> positions;
+};
+
 class device_tracker_view : public tracker_component {
 public:
     // The new device callback is called whenever a new device is created by the devicetracker;
@@ -108,6 +190,10 @@ public:
     virtual std::shared_ptr<tracker_element_vector> do_readonly_device_work(device_tracker_view_worker& worker,
             std::shared_ptr<tracker_element_vector> vec);
 
+    // Devices in this view which have been seen at or after a given time; this uses the
+    // device tracker last-seen index and does not visit the entire view.
+    virtual std::shared_ptr<tracker_element_vector> fetch_devices_since(time_t in_ts);
+
     // Called when a device undergoes a change that might make it eligible for inclusion
     // into a view; Integration with view filtering needs to be added to other locations
     // to activate this.
@@ -146,6 +232,46 @@ protected:
     // Map of device presence in our list for fast reference during updates
     std::unordered_map<device_key, bool> device_presence_map;
 
+    // Sort indexes for commonly ordered fields; an index is only built and maintained once
+    // a request has sorted by it
+    std::vector<std::unique_ptr<device_tracker_view_index>> sort_indexes;
+    std::atomic<bool> sort_indexes_active;
+
+    // Generation of the view, incremented whenever devices are added or removed, or an
+    // update moves a device in a sort index; cached windows are only valid for the
+    // generation they were built from.  Windows sorted or filtered on other fields are
+    // bounded by the cache lifetime instead.
+    std::atomic<uint64_t> list_generation;
+
+    // Recent endpoint results, keyed on the filter, order, and window of the request
+    struct window_cache_entry {
+        uint64_t generation;
+        std::chrono::steady_clock::time_point ts;
+        uint64_t total_sz;
+        uint64_t filtered_sz;
+        unsigned int window_start;
+        std::shared_ptr<tracker_element_vector> devices;
+    };
+
+    kis_recursive_timed_mutex window_cache_mutex;
+    std::unordered_map<std::string, window_cache_entry> window_cache;
+
+    void register_sort_indexes();
+
+    // Find the index for a sort path, building it if it is not yet active
+    device_tracker_view_index *fetch_sort_index(const std::vector<int>& path);
+
+    // Snapshot the keys of the active indexes, outside of the view lock
+    std::vector<std::pair<device_tracker_view_index *, device_tracker_view_index::sort_key>>
+        extract_sort_keys(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Apply snapshotted keys and remove devices from the indexes; must hold the view lock.
+    // Returns true if the device moved in any index.
+    bool update_sort_indexes(std::shared_ptr<kis_tracked_device_base> device, 
+            const std::vector<std::pair<device_tracker_view_index *, 
+            device_tracker_view_index::sort_key>>& keys);
+    void remove_sort_indexes(std::shared_ptr<kis_tracked_device_base> device);
+
     // Complex endpoint and optional extended URI endpoint
     std::shared_ptr<kis_net_httpd_simple_post_endpoint> device_endp;
     std::shared_ptr<kis_net_httpd_simple_post_endpoint> device_uri_endp;
@@ -178,6 +304,10 @@ protected:
     // device record.
     virtual void remove_device(std::shared_ptr<kis_tracked_device_base> device);
 
+    // Called when a device has been updated by a packet, to keep the sort indexes current; 
+    // the caller must hold the device lock.
+    virtual void update_device_sort(std::shared_ptr<kis_tracked_device_base> device);
+
 };
 
 #endif
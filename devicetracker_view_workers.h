@@ -41,6 +41,11 @@ public:
     virtual ~device_tracker_view_worker() { }
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) = 0;
+
+    // Workers which only read the device and their own immutable filter state may be
+    // sharded across the device worker pool; see device_tracker_filter_worker
+    virtual bool parallel_safe() const { return false; }
+
     virtual std::shared_ptr<tracker_element_vector> getMatchedDevices() {
         return matched;
     }
@@ -106,6 +111,7 @@ public:
     virtual ~device_tracker_view_regex_worker() { }
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
+    virtual bool parallel_safe() const override { return true; }
 
 protected:
     std::vector<std::shared_ptr<device_tracker_view_regex_worker::pcre_filter>> filter_vec;
@@ -130,6 +136,7 @@ public:
     virtual ~device_tracker_view_stringmatch_worker() { }
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
+    virtual bool parallel_safe() const override { return true; }
 
 protected:
     std::string query;
@@ -157,6 +164,7 @@ public:
     virtual ~device_tracker_view_icasestringmatch_worker() { }
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
+    virtual bool parallel_safe() const override { return true; }
 
 protected:
     std::string query;
@@ -49,6 +49,12 @@ public:
     // finalize operations
     virtual void finalize(device_tracker *devicetracker __attribute__((unused))) { }
 
+    // Workers which only read the device and their own immutable filter state may
+    // have match_device called concurrently from multiple threads, allowing the device
+    // list to be sharded across the device worker pool.  Matched devices are still
+    // delivered in order, on the calling thread, and finalize is called once.
+    virtual bool parallel_safe() const { return false; }
+
     virtual std::shared_ptr<tracker_element_vector> GetMatchedDevices() {
         return matched_devices;
     }
@@ -103,6 +109,8 @@ public:
     virtual bool match_device(device_tracker *devicetracker,
             std::shared_ptr<kis_tracked_device_base> device);
 
+    virtual bool parallel_safe() const { return true; }
+
     virtual void finalize(device_tracker *devicetracker);
 
 protected:
@@ -171,6 +179,9 @@ public:
     virtual bool match_device(device_tracker *devicetracker,
             std::shared_ptr<kis_tracked_device_base> device);
 
+    // pcre_exec is safe to call concurrently with a shared compiled expression
+    virtual bool parallel_safe() const { return true; }
+
     virtual void finalize(device_tracker *devicetracker);
 
 protected:
@@ -208,6 +219,8 @@ public:
     virtual bool match_device(device_tracker *devicetracker,
             std::shared_ptr<kis_tracked_device_base> device) { return false; };
 
+    virtual bool parallel_safe() const { return true; }
+
     virtual void finalize(device_tracker *devicetracker) { };
 };
 
@@ -0,0 +1,514 @@
+/* benchmark harness for the 802.11 IE walker
+ *
+ * Walks the tagged parameters of a corpus of beacons and parses the tags the beacon
+ * dissector looks at (country, QBSS, HT and VHT capabilities and operation, RSN,
+ * extended capabilities, and the WMM, WPS, and WPA vendor tags), and compares:
+ *
+ *   previous   the walker before the in-place span: the frame wrapped in a membuf and
+ *              istream for a kaitai stream, a shared record, a copy of the data, and a
+ *              kaitai stream for every tag, and each parser fed from a kaitai stream
+ *   span       dot11_ie walking the block in place, and each parser reading the tag
+ *              data directly with dot11_span_stream
+ *
+ * The parsed fields of every tag are folded into a digest per beacon, and the digests
+ * from the two paths are compared for every beacon.
+ *
+ * Beacons are read from a pcap file with 802.11 (DLT 105) or radiotap (DLT 127)
+ * framing; without one, a set of generated beacons is used.
+ *
+ * # configure and build kismet
+ * ./configure
+ * make
+ *
+ * # build benchmark, linking the object of every dot11_parsers/<parser>.cc
+ * g++ -O2 -o dot11_ie_bench dot11_ie_bench.cc $(ls dot11_parsers/dot11_*.cc.o) \
+ *     kaitaistream.cc.o
+ *
+ * ./dot11_ie_bench [pcap] [passes]
+ *
+ */
+
+#include "config.h"
+
+#include <chrono>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kaitai/kaitaistream.h"
+#include "dot11_parsers/dot11_ie.h"
+#include "dot11_parsers/dot11_ie_7_country.h"
+#include "dot11_parsers/dot11_ie_11_qbss.h"
+#include "dot11_parsers/dot11_ie_45_ht_cap.h"
+#include "dot11_parsers/dot11_ie_48_rsn.h"
+#include "dot11_parsers/dot11_ie_61_ht_op.h"
+#include "dot11_parsers/dot11_ie_127_extended_capabilities.h"
+#include "dot11_parsers/dot11_ie_191_vht_cap.h"
+#include "dot11_parsers/dot11_ie_192_vht_op.h"
+#include "dot11_parsers/dot11_ie_221_vendor.h"
+#include "dot11_parsers/dot11_ie_221_ms_wmm.h"
+#include "dot11_parsers/dot11_ie_221_ms_wps.h"
+#include "dot11_parsers/dot11_ie_221_wfa_wpa.h"
+
+// Same as the streambuf in util.h, without pulling in the rest of the server
+struct bench_membuf : std::streambuf {
+    bench_membuf(const char *begin, const char *end) {
+        this->setg((char *) begin, (char *) begin, (char *) end);
+    }
+};
+
+// The previous IE walker: a shared record, a copy, and a kaitai stream for every tag
+class legacy_ie {
+public:
+    class legacy_ie_tag {
+    public:
+        void parse(std::shared_ptr<kaitai::kstream> p_io) {
+            m_tag_num = p_io->read_u1();
+            m_tag_len = p_io->read_u1();
+            m_tag_data = p_io->read_bytes(m_tag_len);
+            m_tag_data_stream.reset(new kaitai::kstream(m_tag_data));
+        }
+
+        uint8_t tag_num() const {
+            return m_tag_num;
+        }
+
+        std::shared_ptr<kaitai::kstream> tag_data_stream() const {
+            return m_tag_data_stream;
+        }
+
+    protected:
+        uint8_t m_tag_num;
+        uint8_t m_tag_len;
+        std::string m_tag_data;
+        std::shared_ptr<kaitai::kstream> m_tag_data_stream;
+    };
+
+    void parse(std::shared_ptr<kaitai::kstream> p_io) {
+        while (!p_io->is_eof()) {
+            std::shared_ptr<legacy_ie_tag> t(new legacy_ie_tag());
+            t->parse(p_io);
+            m_tags.push_back(t);
+        }
+    }
+
+    const std::vector<std::shared_ptr<legacy_ie_tag>>& tags() const {
+        return m_tags;
+    }
+
+protected:
+    std::vector<std::shared_ptr<legacy_ie_tag>> m_tags;
+};
+
+static void mix(uint64_t& digest, uint64_t v) {
+    digest = (digest ^ v) * 0x100000001b3ULL;
+}
+
+static void mix(uint64_t& digest, const std::string& s) {
+    for (auto c : s)
+        mix(digest, (uint8_t) c);
+    mix(digest, s.length());
+}
+
+// Parse one tag and fold the fields the dissector uses into the digest; the source
+// decides how each parser is fed
+template<typename S>
+void digest_tag(uint8_t num, S& src, uint64_t& digest) {
+    mix(digest, num);
+
+    if (num == 7) {
+        dot11_ie_7_country country;
+        src.parse(country);
+        mix(digest, country.country_code());
+        for (auto t : *country.country_list()) {
+            mix(digest, t->first_channel());
+            mix(digest, t->num_channels());
+            mix(digest, t->max_power());
+        }
+    } else if (num == 11) {
+        dot11_ie_11_qbss qbss;
+        src.parse(qbss);
+        mix(digest, qbss.station_count());
+        mix(digest, qbss.channel_utilization());
+    } else if (num == 45) {
+        dot11_ie_45_ht_cap htcap;
+        src.parse(htcap);
+        mix(digest, htcap.ht_capabilities());
+        mix(digest, htcap.mcs()->rx_mcs());
+        mix(digest, htcap.mcs()->supported_data_rate());
+    } else if (num == 48) {
+        dot11_ie_48_rsn rsn;
+        src.parse(rsn);
+        mix(digest, rsn.rsn_version());
+        mix(digest, rsn.group_cipher()->cipher_type());
+        for (auto c : *rsn.pairwise_ciphers())
+            mix(digest, c->cipher_type());
+        for (auto a : *rsn.akm_ciphers())
+            mix(digest, a->management_type());
+        mix(digest, rsn.rsn_capabilities());
+    } else if (num == 61) {
+        dot11_ie_61_ht_op htop;
+        src.parse(htop);
+        mix(digest, htop.primary_channel());
+        mix(digest, htop.info_subset_1());
+    } else if (num == 127) {
+        dot11_ie_127_extended extcap;
+        src.parse(extcap);
+        mix(digest, extcap.octet1());
+        mix(digest, extcap.octet8());
+    } else if (num == 191) {
+        dot11_ie_191_vht_cap vhtcap;
+        src.parse(vhtcap);
+        mix(digest, vhtcap.vht_capabilities());
+        mix(digest, vhtcap.rx_mcs_map());
+    } else if (num == 192) {
+        dot11_ie_192_vht_op vhtop;
+        src.parse(vhtop);
+        mix(digest, vhtop.channel_width());
+        mix(digest, vhtop.center1());
+        mix(digest, vhtop.center2());
+    } else if (num == 221) {
+        dot11_ie_221_vendor vendor;
+        src.parse(vendor);
+        mix(digest, vendor.vendor_oui_int());
+
+        if (vendor.vendor_oui_int() != dot11_ie_221_ms_wps::ms_wps_oui())
+            return;
+
+        if (vendor.vendor_oui_type() == 0x02) {
+            dot11_ie_221_ms_wmm wmm;
+            src.parse_vendor(vendor, wmm);
+            mix(digest, wmm.wme_subtype());
+        } else if (vendor.vendor_oui_type() == dot11_ie_221_wfa_wpa::wfa_wpa_subtype()) {
+            dot11_ie_221_wfa_wpa wpa;
+            src.parse_vendor(vendor, wpa);
+            mix(digest, wpa.wpa_version());
+            for (auto c : *wpa.unicast_ciphers())
+                mix(digest, c->cipher_type());
+        } else if (vendor.vendor_oui_type() == dot11_ie_221_ms_wps::ms_wps_subtype()) {
+            dot11_ie_221_ms_wps wps;
+            src.parse_vendor(vendor, wps);
+            for (auto e : *wps.wps_elements()) {
+                mix(digest, e->wps_de_type());
+                if (e->sub_element_name() != nullptr)
+                    mix(digest, e->sub_element_name()->str());
+                if (e->sub_element_manuf() != nullptr)
+                    mix(digest, e->sub_element_manuf()->str());
+                if (e->sub_element_state() != nullptr)
+                    mix(digest, e->sub_element_state()->wps_state_configured());
+            }
+        }
+    }
+}
+
+struct legacy_source {
+    std::shared_ptr<kaitai::kstream> stream;
+
+    template<typename P>
+    void parse(P& parser) {
+        parser.parse(stream);
+    }
+
+    template<typename P>
+    void parse_vendor(const dot11_ie_221_vendor& vendor, P& parser) {
+        auto s = vendor.vendor_tag_stream();
+        s->seek(0);
+        parser.parse(s);
+    }
+};
+
+struct span_source {
+    const char *data;
+    size_t len;
+
+    template<typename P>
+    void parse(P& parser) {
+        parser.parse(data, len);
+    }
+
+    template<typename P>
+    void parse_vendor(const dot11_ie_221_vendor& vendor, P& parser) {
+        parser.parse(vendor.vendor_tag().data(), vendor.vendor_tag().length());
+    }
+};
+
+static uint64_t parse_legacy(const std::string& ies) {
+    uint64_t digest = 0xcbf29ce484222325ULL;
+
+    try {
+        bench_membuf tags_membuf(ies.data(), ies.data() + ies.length());
+        std::istream istream_tags(&tags_membuf);
+        std::shared_ptr<kaitai::kstream> stream_tags(new kaitai::kstream(&istream_tags));
+
+        legacy_ie ie;
+        ie.parse(stream_tags);
+
+        for (auto& t : ie.tags()) {
+            legacy_source src;
+            src.stream = t->tag_data_stream();
+
+            try {
+                digest_tag(t->tag_num(), src, digest);
+            } catch (const std::exception& e) {
+                mix(digest, 0xFFFF);
+            }
+        }
+    } catch (const std::exception& e) {
+        mix(digest, 0xFFFE);
+    }
+
+    return digest;
+}
+
+static uint64_t parse_span(const std::string& ies) {
+    uint64_t digest = 0xcbf29ce484222325ULL;
+
+    try {
+        dot11_ie ie;
+        ie.parse(ies.data(), ies.length());
+
+        for (auto& t : ie.tag_list()) {
+            span_source src;
+            src.data = t.tag_data_ptr();
+            src.len = t.tag_len();
+
+            try {
+                digest_tag(t.tag_num(), src, digest);
+            } catch (const std::exception& e) {
+                mix(digest, 0xFFFF);
+            }
+        }
+    } catch (const std::exception& e) {
+        mix(digest, 0xFFFE);
+    }
+
+    return digest;
+}
+
+// Tagged parameters of beacons in a pcap file
+static bool load_pcap(const char *fname, std::vector<std::string>& beacons) {
+    FILE *f = fopen(fname, "rb");
+
+    if (f == NULL) {
+        fprintf(stderr, "could not open %s: %s\n", fname, strerror(errno));
+        return false;
+    }
+
+    uint8_t hdr[24];
+
+    if (fread(hdr, 24, 1, f) != 1) {
+        fprintf(stderr, "%s: short pcap header\n", fname);
+        fclose(f);
+        return false;
+    }
+
+    uint32_t magic = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | ((uint32_t) hdr[3] << 24);
+    bool swapped;
+
+    if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+        swapped = false;
+    } else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
+        swapped = true;
+    } else {
+        fprintf(stderr, "%s: not a pcap file\n", fname);
+        fclose(f);
+        return false;
+    }
+
+    auto u32 = [swapped](const uint8_t *d) -> uint32_t {
+        if (swapped)
+            return ((uint32_t) d[0] << 24) | (d[1] << 16) | (d[2] << 8) | d[3];
+        return ((uint32_t) d[3] << 24) | (d[2] << 16) | (d[1] << 8) | d[0];
+    };
+
+    uint32_t dlt = u32(hdr + 20);
+
+    if (dlt != 105 && dlt != 127) {
+        fprintf(stderr, "%s: unsupported link type %u\n", fname, dlt);
+        fclose(f);
+        return false;
+    }
+
+    uint8_t rec[16];
+    std::vector<uint8_t> pkt;
+
+    while (fread(rec, 16, 1, f) == 1) {
+        uint32_t caplen = u32(rec + 8);
+
+        if (caplen > 65535)
+            break;
+
+        pkt.resize(caplen);
+
+        if (caplen > 0 && fread(pkt.data(), caplen, 1, f) != 1)
+            break;
+
+        size_t offt = 0;
+        size_t len = caplen;
+
+        if (dlt == 127) {
+            if (len < 8)
+                continue;
+
+            // Radiotap header, little endian; find the flags field for the FCS
+            size_t rt_len = pkt[2] | (pkt[3] << 8);
+
+            if (rt_len > len)
+                continue;
+
+            size_t p = 4;
+            uint32_t present = pkt[4] | (pkt[5] << 8) | (pkt[6] << 16) | ((uint32_t) pkt[7] << 24);
+            uint32_t word = present;
+
+            while ((word & 0x80000000) && p + 8 <= rt_len) {
+                p += 4;
+                word = pkt[p] | (pkt[p + 1] << 8) | (pkt[p + 2] << 16) |
+                    ((uint32_t) pkt[p + 3] << 24);
+            }
+
+            p += 4;
+
+            if (present & 0x01)
+                p = ((p + 7) & ~7) + 8;
+
+            if ((present & 0x02) && p < rt_len && (pkt[p] & 0x10))
+                len -= 4;
+
+            offt = rt_len;
+        }
+
+        // Management beacon, 24 byte header and 12 bytes of fixed parameters
+        if (len < offt + 36 || pkt[offt] != 0x80)
+            continue;
+
+        beacons.push_back(std::string((const char *) pkt.data() + offt + 36, len - offt - 36));
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+static void add_tag(std::string& ies, uint8_t num, const std::string& data) {
+    ies.push_back(num);
+    ies.push_back(data.length());
+    ies.append(data);
+}
+
+static std::string bytes(std::initializer_list<uint8_t> b) {
+    return std::string(b.begin(), b.end());
+}
+
+// Beacons shaped like a typical 802.11ac access point
+static void generate_beacons(std::vector<std::string>& beacons, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        std::string ies;
+        uint8_t chan = 36 + ((i % 8) * 4);
+
+        add_tag(ies, 0, "bench-network-" + std::to_string(i));
+        add_tag(ies, 1, bytes({0x8c, 0x12, 0x98, 0x24, 0xb0, 0x48, 0x60, 0x6c}));
+        add_tag(ies, 3, bytes({chan}));
+        add_tag(ies, 5, bytes({0x00, 0x01, 0x00, 0x00}));
+        add_tag(ies, 7, bytes({'U', 'S', 0x20, 36, 4, 23, 52, 4, 24, 100, 12, 24, 149, 5, 30}));
+        add_tag(ies, 11, bytes({(uint8_t) (i % 20), 0x00, (uint8_t) (i % 255), 0x00, 0x00}));
+        add_tag(ies, 45, bytes({0xef, 0x09, 0x17, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00}));
+        add_tag(ies, 48, bytes({0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f,
+                    0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, (uint8_t) ((i % 2) ? 0x02 : 0x08),
+                    0x0c, 0x00}));
+        add_tag(ies, 61, bytes({chan, 0x05, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+        add_tag(ies, 127, bytes({0x04, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x40}));
+        add_tag(ies, 191, bytes({0xb2, 0x01, 0x80, 0x33, 0xfa, 0xff, 0x0c, 0x03, 0xfa, 0xff,
+                    0x0c, 0x03}));
+        add_tag(ies, 192, bytes({0x01, (uint8_t) (chan + 6), 0x00, 0xfc, 0xff}));
+        add_tag(ies, 221, bytes({0x00, 0x50, 0xf2, 0x02, 0x01, 0x01, 0x80, 0x00, 0x03, 0xa4,
+                    0x00, 0x00, 0x27, 0xa4, 0x00, 0x00, 0x42, 0x43, 0x5e, 0x00, 0x62, 0x32,
+                    0x2f, 0x00}));
+
+        std::string wps = bytes({0x00, 0x50, 0xf2, 0x04});
+        wps += bytes({0x10, 0x4a, 0x00, 0x01, 0x10});
+        wps += bytes({0x10, 0x44, 0x00, 0x01, 0x02});
+        std::string name = "bench-ap-" + std::to_string(i % 100);
+        wps += bytes({0x10, 0x11, 0x00, (uint8_t) name.length()}) + name;
+        wps += bytes({0x10, 0x21, 0x00, 0x05}) + "Bench";
+        wps += bytes({0x10, 0x3c, 0x00, 0x01, 0x03});
+        add_tag(ies, 221, wps);
+
+        if (i % 4 == 0)
+            add_tag(ies, 221, bytes({0x00, 0x50, 0xf2, 0x01, 0x01, 0x00, 0x00, 0x50, 0xf2,
+                        0x02, 0x01, 0x00, 0x00, 0x50, 0xf2, 0x02, 0x01, 0x00, 0x00, 0x50,
+                        0xf2, 0x02}));
+
+        // Vendor tag the beacon parser ignores
+        add_tag(ies, 221, bytes({0x00, 0x10, 0x18, 0x02, 0x00, 0x00, 0x1c, 0x00, 0x00}));
+
+        beacons.push_back(ies);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> beacons;
+    unsigned int passes = 20;
+
+    if (argc > 1) {
+        if (!load_pcap(argv[1], beacons))
+            exit(1);
+    } else {
+        generate_beacons(beacons, 10000);
+    }
+
+    if (argc > 2)
+        passes = strtoul(argv[2], NULL, 10);
+
+    if (beacons.size() == 0 || passes == 0) {
+        fprintf(stderr, "usage: %s [pcap] [passes]\n", argv[0]);
+        exit(1);
+    }
+
+    size_t ie_bytes = 0;
+    for (auto& b : beacons)
+        ie_bytes += b.length();
+
+    printf("%lu beacons, %.1f bytes of tags per beacon, %u passes\n", beacons.size(),
+            (double) ie_bytes / beacons.size(), passes);
+
+    // Both paths have to agree on every beacon
+    size_t mismatches = 0;
+    for (auto& b : beacons)
+        if (parse_legacy(b) != parse_span(b))
+            mismatches++;
+
+    auto bench = [&](const char *name, uint64_t (*fn)(const std::string&)) {
+        uint64_t total = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (unsigned int p = 0; p < passes; p++)
+            for (auto& b : beacons)
+                total += fn(b);
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+        size_t n = beacons.size() * passes;
+
+        printf("%-12s %10lu beacons %10ld us %10.1f ns/beacon (%016lx)\n", name, n, (long) us,
+                (us * 1000.0f) / n, (unsigned long) total);
+    };
+
+    bench("previous", parse_legacy);
+    bench("span", parse_span);
+
+    printf("%lu mismatches between the previous and span parsers\n", mismatches);
+
+    return mismatches == 0 ? 0 : 1;
+}
+
@@ -16,22 +16,49 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <stdexcept>
+
 #include "dot11_ie.h"
 
 void dot11_ie::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_tags.reset(new shared_ie_tag_vector());
+    auto data = p_io->read_bytes_full();
+    parse(data.data(), data.length());
+}
+
+void dot11_ie::parse(const char *data, size_t len) {
+    m_data.assign(data, len);
+    m_tag_list.clear();
+    m_tags.reset();
+
+    size_t pos = 0;
+
+    while (pos < m_data.length()) {
+        if (m_data.length() - pos < 2)
+            throw std::runtime_error("truncated IE tag header");
+
+        uint8_t tag_num = m_data[pos];
+        uint8_t tag_len = m_data[pos + 1];
+        pos += 2;
 
-    while (!p_io->is_eof()) {
-        std::shared_ptr<dot11_ie_tag> t(new dot11_ie_tag());
-        t->parse(p_io);
-        m_tags->push_back(t);
+        if (m_data.length() - pos < tag_len)
+            throw std::runtime_error("truncated IE tag");
+
+        m_tag_list.push_back(dot11_ie_tag(tag_num, tag_len, m_data.data() + pos));
+        pos += tag_len;
     }
 }
 
-void dot11_ie::dot11_ie_tag::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_tag_num = p_io->read_u1();
-    m_tag_len = p_io->read_u1();
-    m_tag_data = p_io->read_bytes(tag_len());
-    m_tag_data_stream.reset(new kaitai::kstream(m_tag_data));
-}
+std::shared_ptr<dot11_ie::shared_ie_tag_vector> dot11_ie::tags() {
+    if (m_tags == nullptr) {
+        m_tags = std::make_shared<shared_ie_tag_vector>();
+        m_tags->reserve(m_tag_list.size());
+
+        // Alias the tags to the parser so they don't need their own copies
+        auto self = shared_from_this();
 
+        for (auto& t : m_tag_list)
+            m_tags->push_back(std::shared_ptr<dot11_ie_tag>(self, &t));
+    }
+
+    return m_tags;
+}
@@ -21,10 +21,10 @@
 
 /* Parse a dot11 ie stream into individual objects.
  *
- * This uses the kaitai stream buffer from the kaitai runtime as it is a 
- * solid implementation of buffer-bounded operations and data extraction.
- *
- * Much of this is modeled on how kaitai generates parsers.
+ * The IE block is copied once into the parser and walked in place; each tag
+ * refers to its data inside the block, so parsing a frame costs no per-tag
+ * allocations.  Tags which need a full parser can still provide a kaitai
+ * stream of their data, which is only built on demand.
  *
  */
 
@@ -34,7 +34,7 @@
 #include <kaitai/kaitaistream.h>
 #include "multi_constexpr.h"
 
-class dot11_ie {
+class dot11_ie : public std::enable_shared_from_this<dot11_ie> {
 public:
     class dot11_ie_tag;
     typedef std::vector<std::shared_ptr<dot11_ie_tag> > shared_ie_tag_vector;
@@ -47,22 +47,38 @@ public:
 
     }
 
+    dot11_ie(const dot11_ie&) = delete;
+    dot11_ie& operator=(const dot11_ie&) = delete;
+
+    // Parse the remainder of a kaitai stream
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
-    std::shared_ptr<shared_ie_tag_vector> tags() const {
-        return m_tags;
+    // Parse a block of IE tags
+    void parse(const char *data, size_t len);
+
+    // Tags in the order they were seen
+    const std::vector<dot11_ie_tag>& tag_list() const {
+        return m_tag_list;
     }
 
-protected:
-    std::shared_ptr<shared_ie_tag_vector> m_tags;
+    // Tags as shared records, sharing the lifetime of this parser; only built when
+    // requested.  The parser must be held by a shared_ptr.
+    std::shared_ptr<shared_ie_tag_vector> tags();
 
 public:
     class dot11_ie_tag {
     public:
-        dot11_ie_tag() { } 
-        ~dot11_ie_tag() { }
+        dot11_ie_tag() :
+            m_tag_num {0},
+            m_tag_len {0},
+            m_tag_data {nullptr} { } 
 
-        void parse(std::shared_ptr<kaitai::kstream> p_io);
+        dot11_ie_tag(uint8_t num, uint8_t len, const char *data) :
+            m_tag_num {num},
+            m_tag_len {len},
+            m_tag_data {data} { }
+
+        ~dot11_ie_tag() { }
 
         constexpr17 uint8_t tag_num() const {
             return m_tag_num;
@@ -72,21 +88,37 @@ public:
             return m_tag_len;
         }
 
-        std::string tag_data() const {
+        // Tag data, in place in the parsed block
+        const char *tag_data_ptr() const {
             return m_tag_data;
         }
 
+        std::string tag_data() const {
+            return std::string(m_tag_data, m_tag_len);
+        }
+
         std::shared_ptr<kaitai::kstream> tag_data_stream() const {
+            if (m_tag_data_stream == nullptr) {
+                // kstream copies the data into its own buffer
+                auto data = tag_data();
+                m_tag_data_stream.reset(new kaitai::kstream(data));
+            }
+
             return m_tag_data_stream;
         }
 
     protected:
         uint8_t m_tag_num;
         uint8_t m_tag_len;
-        std::string m_tag_data;
-        std::shared_ptr<kaitai::kstream> m_tag_data_stream;
+        const char *m_tag_data;
+        mutable std::shared_ptr<kaitai::kstream> m_tag_data_stream;
     };
 
+protected:
+    std::string m_data;
+    std::vector<dot11_ie_tag> m_tag_list;
+    std::shared_ptr<shared_ie_tag_vector> m_tags;
+
 };
 
 
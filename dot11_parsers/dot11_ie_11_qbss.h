@@ -39,6 +39,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint16_t station_count() const {
         return m_station_count;
     }
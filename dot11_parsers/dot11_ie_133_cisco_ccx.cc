@@ -17,11 +17,22 @@
 */
 
 #include "dot11_ie_133_cisco_ccx.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_133_cisco_ccx::parse_stream(IO& p_io) {
+    m_ccx_unk1 = p_io.read_bytes(10);
+    m_ap_name = p_io.read_bytes(16);
+    m_station_count = p_io.read_u1();
+    m_ccx_unk2 = p_io.read_bytes(3);
+
+}
 
 void dot11_ie_133_cisco_ccx::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_ccx_unk1 = p_io->read_bytes(10);
-    m_ap_name = p_io->read_bytes(16);
-    m_station_count = p_io->read_u1();
-    m_ccx_unk2 = p_io->read_bytes(3);
+    parse_stream(*p_io);
+}
 
+void dot11_ie_133_cisco_ccx::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
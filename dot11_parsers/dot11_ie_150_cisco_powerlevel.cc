@@ -17,11 +17,22 @@
 */
 
 #include "dot11_ie_150_cisco_powerlevel.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_150_cisco_powerlevel::parse(std::shared_ptr<kaitai::kstream> p_io) {
+template<typename IO>
+void dot11_ie_150_cisco_powerlevel::parse_stream(IO& p_io) {
     // Throw away IE type field
-    p_io->read_u1();
+    p_io.read_u1();
+
+    m_txpower = p_io.read_u1();
+}
+
+void dot11_ie_150_cisco_powerlevel::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
 
-    m_txpower = p_io->read_u1();
+void dot11_ie_150_cisco_powerlevel::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
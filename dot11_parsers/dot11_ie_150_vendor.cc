@@ -16,12 +16,26 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <stdexcept>
+
 #include "dot11_ie_150_vendor.h"
 
 void dot11_ie_150_vendor::parse(std::shared_ptr<kaitai::kstream> p_io) {
     m_vendor_oui = p_io->read_bytes(3);
     m_vendor_tag = p_io->read_bytes_full();
-    m_vendor_tag_stream.reset(new kaitai::kstream(m_vendor_tag));
+    m_vendor_tag_stream.reset();
+
+    if (m_vendor_tag.length() >= 1)
+        m_vendor_oui_type = m_vendor_tag[0];
+}
+
+void dot11_ie_150_vendor::parse(const char *data, size_t len) {
+    if (len < 3)
+        throw std::runtime_error("vendor tag too short for OUI");
+
+    m_vendor_oui.assign(data, 3);
+    m_vendor_tag.assign(data + 3, len - 3);
+    m_vendor_tag_stream.reset();
 
     if (m_vendor_tag.length() >= 1)
         m_vendor_oui_type = m_vendor_tag[0];
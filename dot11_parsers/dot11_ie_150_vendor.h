@@ -33,20 +33,30 @@
 
 class dot11_ie_150_vendor {
 public:
-    dot11_ie_150_vendor() { } 
+    dot11_ie_150_vendor() :
+        m_vendor_oui_type {0} { } 
     ~dot11_ie_150_vendor() { }
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
     std::string vendor_oui() const {
         return m_vendor_oui;
     }
 
-    std::string vendor_tag() const {
+    const std::string& vendor_tag() const {
         return m_vendor_tag;
     }
 
     std::shared_ptr<kaitai::kstream> vendor_tag_stream() const {
+        if (m_vendor_tag_stream == nullptr) {
+            // kstream copies the data into its own buffer
+            std::string tag {m_vendor_tag};
+            m_vendor_tag_stream.reset(new kaitai::kstream(tag));
+        }
+
         return m_vendor_tag_stream;
     }
 
@@ -65,7 +75,7 @@ public:
 protected:
     std::string m_vendor_oui;
     std::string m_vendor_tag;
-    std::shared_ptr<kaitai::kstream> m_vendor_tag_stream;
+    mutable std::shared_ptr<kaitai::kstream> m_vendor_tag_stream;
     uint8_t m_vendor_oui_type;
 };
 
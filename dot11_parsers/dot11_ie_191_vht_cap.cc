@@ -17,12 +17,23 @@
 */
 
 #include "dot11_ie_191_vht_cap.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_191_vht_cap::parse_stream(IO& p_io) {
+    m_vht_capabilities = p_io.read_u4le();
+    m_rx_mcs_map = p_io.read_u2le();
+    m_rx_mcs_set = p_io.read_u2le();
+    m_tx_mcs_map = p_io.read_u2le();
+    m_tx_mcs_set = p_io.read_u2le();
+}
 
 void dot11_ie_191_vht_cap::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_vht_capabilities = p_io->read_u4le();
-    m_rx_mcs_map = p_io->read_u2le();
-    m_rx_mcs_set = p_io->read_u2le();
-    m_tx_mcs_map = p_io->read_u2le();
-    m_tx_mcs_set = p_io->read_u2le();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_191_vht_cap::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
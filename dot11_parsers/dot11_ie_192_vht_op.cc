@@ -17,11 +17,22 @@
 */
 
 #include "dot11_ie_192_vht_op.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_192_vht_op::parse_stream(IO& p_io) {
+    m_channel_width = p_io.read_u1();
+    m_center1 = p_io.read_u1();
+    m_center2 = p_io.read_u1();
+    m_basic_mcs_map = p_io.read_u2be();
+}
 
 void dot11_ie_192_vht_op::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_channel_width = p_io->read_u1();
-    m_center1 = p_io->read_u1();
-    m_center2 = p_io->read_u1();
-    m_basic_mcs_map = p_io->read_u2be();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_192_vht_op::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
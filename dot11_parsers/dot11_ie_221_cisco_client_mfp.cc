@@ -17,12 +17,23 @@
 */
 
 #include "dot11_ie_221_cisco_client_mfp.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_221_cisco_client_mfp::parse(std::shared_ptr<kaitai::kstream> p_io) {
+template<typename IO>
+void dot11_ie_221_cisco_client_mfp::parse_stream(IO& p_io) {
     // Throw out sub-type
-    p_io->read_u1();
+    p_io.read_u1();
 
-    uint8_t l_mfp = p_io->read_u1();
+    uint8_t l_mfp = p_io.read_u1();
     m_client_mfp = (l_mfp & 0x01);
 }
 
+void dot11_ie_221_cisco_client_mfp::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_221_cisco_client_mfp::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
@@ -68,6 +68,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint8_t vendor_type() const {
         return m_vendor_type;
     }
@@ -110,7 +117,6 @@ protected:
     uint8_t m_unk2;
     uint8_t m_subcommand;
     std::string m_raw_record_data;
-    std::shared_ptr<kaitai::kstream> m_raw_record_data_stream;
     std::shared_ptr<dji_subcommand_common> m_record;
 
 public:
@@ -129,6 +135,9 @@ public:
 
         virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         uint8_t version() {
             return m_version;
         }
@@ -310,6 +319,9 @@ public:
 
         virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         std::string serialnumber() {
             return m_serialnumber;
         }
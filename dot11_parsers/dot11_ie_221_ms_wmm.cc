@@ -17,8 +17,19 @@
 */
 
 #include "dot11_ie_221_ms_wmm.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_221_ms_wmm::parse_stream(IO& p_io) {
+    m_wme_subtype = p_io.read_u1();
+}
 
 void dot11_ie_221_ms_wmm::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_wme_subtype = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_221_ms_wmm::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
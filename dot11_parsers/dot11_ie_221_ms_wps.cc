@@ -17,101 +17,163 @@
 */
 
 #include "dot11_ie_221_ms_wps.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_221_ms_wps::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_vendor_subtype = p_io->read_u1();
+template<typename IO>
+void dot11_ie_221_ms_wps::parse_stream(IO& p_io) {
+    m_vendor_subtype = p_io.read_u1();
     m_wps_elements.reset(new shared_wps_de_sub_element_vector());
-    while (!p_io->is_eof()) {
+    while (!p_io.is_eof()) {
         std::shared_ptr<wps_de_sub_element> e(new wps_de_sub_element());
-        e->parse(p_io);
+        e->parse_stream(p_io);
         m_wps_elements->push_back(e);
     }
 }
 
-void dot11_ie_221_ms_wps::wps_de_sub_element::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_wps_de_type = p_io->read_u2be();
-    m_wps_de_len = p_io->read_u2be();
-    m_wps_de_content = p_io->read_bytes(wps_de_len());
-    m_wps_de_content_data_stream.reset(new kaitai::kstream(m_wps_de_content));
+void dot11_ie_221_ms_wps::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_221_ms_wps::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::parse_stream(IO& p_io) {
+    m_wps_de_type = p_io.read_u2be();
+    m_wps_de_len = p_io.read_u2be();
+    m_wps_de_content = p_io.read_bytes(wps_de_len());
+    m_wps_de_content_data_stream.reset();
+    dot11_span_stream content_io(m_wps_de_content);
 
     if (wps_de_type() == wps_de_device_name) {
         std::shared_ptr<wps_de_sub_string> s(new wps_de_sub_string());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else if (wps_de_type() == wps_de_manuf) {
         std::shared_ptr<wps_de_sub_string> s(new wps_de_sub_string());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else if (wps_de_type() == wps_de_model) {
         std::shared_ptr<wps_de_sub_string> s(new wps_de_sub_string());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else if (wps_de_type() == wps_de_model_num) {
         std::shared_ptr<wps_de_sub_string> s(new wps_de_sub_string());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else if (wps_de_type() == wps_de_rfbands) {
         std::shared_ptr<wps_de_sub_rfband> s(new wps_de_sub_rfband());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else if (wps_de_type() == wps_de_serial) {
         std::shared_ptr<wps_de_sub_string> s(new wps_de_sub_string());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else if (wps_de_type() == wps_de_state) {
         std::shared_ptr<wps_de_sub_state> s(new wps_de_sub_state());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else if (wps_de_type() == wps_de_uuid_e) {
         std::shared_ptr<wps_de_sub_uuid_e> s(new wps_de_sub_uuid_e());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     } else {
         std::shared_ptr<wps_de_sub_generic> s(new wps_de_sub_generic());
-        s->parse(m_wps_de_content_data_stream);
+        s->parse_stream(content_io);
         m_sub_element = s;
     }
 }
 
+void dot11_ie_221_ms_wps::wps_de_sub_element::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_string::parse_stream(IO& p_io) {
+    m_str = p_io.read_bytes_full();
+}
+
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_string::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_str = p_io->read_bytes_full();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_rfband::parse_stream(IO& p_io) {
+    m_rfband = p_io.read_u1();
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_rfband::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_rfband = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_state::parse_stream(IO& p_io) {
+    m_state = p_io.read_u1();
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_state::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_state = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_uuid_e::parse_stream(IO& p_io) {
+    m_uuid = p_io.read_bytes_full();
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_uuid_e::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_uuid = p_io->read_bytes_full();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_primary_type::parse_stream(IO& p_io) {
+    m_category = p_io.read_u2be();
+    m_typedata = p_io.read_u4be();
+    m_subcategory = p_io.read_u2be();
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_primary_type::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_category = p_io->read_u2be();
-    m_typedata = p_io->read_u4be();
-    m_subcategory = p_io->read_u2be();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_vendor_extension::parse_stream(IO& p_io) {
+    m_vendor_id = p_io.read_bytes(3);
+    m_wfa_sub_id = p_io.read_u1();
+    m_wfa_sub_len = p_io.read_u1();
+    m_wfa_sub_data = p_io.read_bytes(wfa_sub_len());
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_vendor_extension::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_vendor_id = p_io->read_bytes(3);
-    m_wfa_sub_id = p_io->read_u1();
-    m_wfa_sub_len = p_io->read_u1();
-    m_wfa_sub_data = p_io->read_bytes(wfa_sub_len());
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_version::parse_stream(IO& p_io) {
+    m_version = p_io.read_u1();
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_version::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_version = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_ap_setup::parse_stream(IO& p_io) {
+    m_ap_setup_locked = p_io.read_u1();
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_ap_setup::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_ap_setup_locked = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_generic::parse_stream(IO& p_io) {
+    m_wps_de_data = p_io.read_bytes_full();
 }
 
 void dot11_ie_221_ms_wps::wps_de_sub_element::wps_de_sub_generic::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_wps_de_data = p_io->read_bytes_full();
+    parse_stream(*p_io);
 }
 
 
@@ -42,6 +42,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint8_t vendor_subtype() const {
         return m_vendor_subtype;
     }
@@ -97,6 +104,9 @@ public:
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         constexpr17 wps_de_type_e wps_de_type() const {
             return (wps_de_type_e) m_wps_de_type;
         }
@@ -110,6 +120,12 @@ public:
         }
 
         std::shared_ptr<kaitai::kstream> wps_de_content_data_stream() const {
+            if (m_wps_de_content_data_stream == nullptr) {
+                // kstream copies the data into its own buffer
+                std::string content {m_wps_de_content};
+                m_wps_de_content_data_stream.reset(new kaitai::kstream(content));
+            }
+
             return m_wps_de_content_data_stream;
         }
 
@@ -173,7 +189,7 @@ public:
         uint16_t m_wps_de_type;
         uint16_t m_wps_de_len;
         std::string m_wps_de_content;
-        std::shared_ptr<kaitai::kstream> m_wps_de_content_data_stream;
+        mutable std::shared_ptr<kaitai::kstream> m_wps_de_content_data_stream;
         std::shared_ptr<wps_de_sub_common> m_sub_element;
 
     public:
@@ -192,6 +208,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             std::string str() const {
                 return m_str;
             }
@@ -207,6 +226,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             constexpr17 uint8_t rfband() const {
                 return m_rfband;
             }
@@ -230,6 +252,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             constexpr17 uint8_t state() const {
                 return m_state;
             }
@@ -249,6 +274,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             std::string str() const {
                 return m_uuid;
             }
@@ -264,6 +292,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             constexpr17 uint16_t category() const {
                 return m_category;
             }
@@ -289,6 +320,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             std::string vendor_id() const {
                 return m_vendor_id;
             }
@@ -319,6 +353,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             constexpr17 uint8_t version() const {
                 return m_version;
             }
@@ -334,6 +371,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             constexpr17 uint8_t ap_setup_locked() const {
                 return m_ap_setup_locked;
             }
@@ -349,6 +389,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             std::string wps_de_data() const {
                 return m_wps_de_data;
             }
@@ -17,8 +17,19 @@
 */
 
 #include "dot11_ie_221_rsn_pmkid.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_221_rsn_pmkid::parse_stream(IO& p_io) {
+    m_vendor_type = p_io.read_u1();
+    m_pmkid = p_io.read_bytes_full();
+}
 
 void dot11_ie_221_rsn_pmkid::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_vendor_type = p_io->read_u1();
-    m_pmkid = p_io->read_bytes_full();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_221_rsn_pmkid::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
@@ -17,11 +17,22 @@
 */
 
 #include "dot11_ie_221_wfa.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_221_wfa::parse_stream(IO& p_io) {
+    m_wfa_subtype = p_io.read_u1();
+
+    m_wfa_content = p_io.read_bytes_full();
+    m_wfa_content_stream.reset();
+}
 
 void dot11_ie_221_wfa::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_wfa_subtype = p_io->read_u1();
+    parse_stream(*p_io);
+}
 
-    m_wfa_content = p_io->read_bytes_full();
-    m_wfa_content_stream.reset(new kaitai::kstream(m_wfa_content));
+void dot11_ie_221_wfa::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
@@ -78,19 +78,32 @@ public:
     }
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
+
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
     
     constexpr17 uint8_t wfa_subtype() const {
         return m_wfa_subtype;
     }
 
     std::shared_ptr<kaitai::kstream> wfa_content_stream() const {
+        if (m_wfa_content_stream == nullptr) {
+            // kstream copies the data into its own buffer
+            std::string content {m_wfa_content};
+            m_wfa_content_stream.reset(new kaitai::kstream(content));
+        }
+
         return m_wfa_content_stream;
     }
 
 protected:
     uint8_t m_wfa_subtype;
     std::string m_wfa_content;
-    std::shared_ptr<kaitai::kstream> m_wfa_content_stream;
+    mutable std::shared_ptr<kaitai::kstream> m_wfa_content_stream;
 };
 
 
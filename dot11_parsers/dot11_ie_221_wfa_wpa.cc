@@ -17,29 +17,45 @@
 */
 
 #include "dot11_ie_221_wfa_wpa.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_221_wfa_wpa::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_vendor_subtype = p_io->read_u1();
-    m_wpa_version = p_io->read_u2le();
+template<typename IO>
+void dot11_ie_221_wfa_wpa::parse_stream(IO& p_io) {
+    m_vendor_subtype = p_io.read_u1();
+    m_wpa_version = p_io.read_u2le();
     m_multicast_cipher.reset(new wpa_v1_cipher());
-    m_multicast_cipher->parse(p_io);
-    m_unicast_count = p_io->read_u2le();
+    m_multicast_cipher->parse_stream(p_io);
+    m_unicast_count = p_io.read_u2le();
     m_unicast_ciphers.reset(new shared_wpa_v1_cipher_vector());
     for (uint16_t i = 0; i < unicast_count(); i++) {
         std::shared_ptr<wpa_v1_cipher> c(new wpa_v1_cipher());
-        c->parse(p_io);
+        c->parse_stream(p_io);
         m_unicast_ciphers->push_back(c);
     }
-    m_akm_count = p_io->read_u2le();
+    m_akm_count = p_io.read_u2le();
     m_akm_ciphers.reset(new shared_wpa_v1_cipher_vector());
     for (uint16_t i = 0; i < akm_count(); i++) {
         std::shared_ptr<wpa_v1_cipher> c(new wpa_v1_cipher());
-        c->parse(p_io);
+        c->parse_stream(p_io);
         m_akm_ciphers->push_back(c);
     }
 }
 
+void dot11_ie_221_wfa_wpa::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_221_wfa_wpa::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
+template<typename IO>
+void dot11_ie_221_wfa_wpa::wpa_v1_cipher::parse_stream(IO& p_io) {
+    m_oui = p_io.read_bytes(3);
+    m_cipher_type = p_io.read_u1();
+}
+
 void dot11_ie_221_wfa_wpa::wpa_v1_cipher::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_oui = p_io->read_bytes(3);
-    m_cipher_type = p_io->read_u1();
+    parse_stream(*p_io);
 }
@@ -49,6 +49,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint8_t vendor_subtype() const {
         return m_vendor_subtype;
     }
@@ -116,6 +123,9 @@ public:
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         std::string oui() const {
             return m_oui;
         }
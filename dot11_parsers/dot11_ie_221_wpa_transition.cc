@@ -17,14 +17,25 @@
 */
 
 #include "dot11_ie_221_wpa_transition.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_221_owe_transition::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_vendor_type = p_io->read_u1();
+template<typename IO>
+void dot11_ie_221_owe_transition::parse_stream(IO& p_io) {
+    m_vendor_type = p_io.read_u1();
+
+    m_bssid = mac_addr(p_io.read_bytes(6).data(), 6);
+
+    auto ssid_len = p_io.read_u1();
+    m_ssid = p_io.read_bytes(ssid_len);
 
-    m_bssid = mac_addr(p_io->read_bytes(6).data(), 6);
+}
 
-    auto ssid_len = p_io->read_u1();
-    m_ssid = p_io->read_bytes(ssid_len);
+void dot11_ie_221_owe_transition::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
 
+void dot11_ie_221_owe_transition::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
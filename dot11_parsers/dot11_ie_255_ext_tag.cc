@@ -17,9 +17,20 @@
 */
 
 #include "dot11_ie_255_ext_tag.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_255_ext::parse_stream(IO& p_io) {
+    m_subtag_num = p_io.read_u1();
+    m_subtag_data = p_io.read_bytes_full();
+    m_subtag_data_stream.reset();
+}
 
 void dot11_ie_255_ext::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_subtag_num = p_io->read_u1();
-    m_subtag_data = p_io->read_bytes_full();
-    m_subtag_data_stream.reset(new kaitai::kstream(m_subtag_data));
+    parse_stream(*p_io);
+}
+
+void dot11_ie_255_ext::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
@@ -32,6 +32,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint8_t subtag_num() const {
         return m_subtag_num;
     }
@@ -41,13 +48,19 @@ public:
     }
 
     std::shared_ptr<kaitai::kstream> tag_data_stream() const {
+        if (m_subtag_data_stream == nullptr) {
+            // kstream copies the data into its own buffer
+            std::string data {m_subtag_data};
+            m_subtag_data_stream.reset(new kaitai::kstream(data));
+        }
+
         return m_subtag_data_stream;
     }
 
 protected:
     uint8_t m_subtag_num;
     std::string m_subtag_data;
-    std::shared_ptr<kaitai::kstream> m_subtag_data_stream;
+    mutable std::shared_ptr<kaitai::kstream> m_subtag_data_stream;
 };
 
 #endif /* ifndef DOT11_IE_255_EXT_TAG */
@@ -17,9 +17,20 @@
 */
 
 #include "dot11_ie_33_power.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_33_power::parse_stream(IO& p_io) {
+    m_min_power = p_io.read_u1();
+    m_max_power = p_io.read_u1();
+}
 
 void dot11_ie_33_power::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_min_power = p_io->read_u1();
-    m_max_power = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_33_power::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
@@ -17,14 +17,16 @@
 */
 
 #include "dot11_ie_36_supported_channels.h"
+#include "dot11_span_stream.h"
 #include "fmt.h"
 
-void dot11_ie_36_supported_channels::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    while (!p_io->is_eof()) {
+template<typename IO>
+void dot11_ie_36_supported_channels::parse_stream(IO& p_io) {
+    while (!p_io.is_eof()) {
         unsigned int start, count;
 
-        start = p_io->read_u1();
-        count = p_io->read_u1();
+        start = p_io.read_u1();
+        count = p_io.read_u1();
 
         if (start + count > 0xFF) 
             throw std::runtime_error(fmt::format("Invalid IEEE 802.11 IE 36; Start channel {} + "
@@ -36,3 +38,12 @@ void dot11_ie_36_supported_channels::parse(std::shared_ptr<kaitai::kstream> p_io
     }
 }
 
+void dot11_ie_36_supported_channels::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_36_supported_channels::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
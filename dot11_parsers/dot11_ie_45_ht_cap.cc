@@ -17,20 +17,36 @@
 */
 
 #include "dot11_ie_45_ht_cap.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_45_ht_cap::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_ht_capabilities = p_io->read_u2le();
-    m_ampdu = p_io->read_u1();
+template<typename IO>
+void dot11_ie_45_ht_cap::parse_stream(IO& p_io) {
+    m_ht_capabilities = p_io.read_u2le();
+    m_ampdu = p_io.read_u1();
     m_mcs.reset(new dot11_ie_45_rx_mcs());
-    m_mcs->parse(p_io);
-    m_ht_extended_caps = p_io->read_u2be();
-    m_txbf_caps = p_io->read_u4be();
-    m_asel_caps = p_io->read_u1();
+    m_mcs->parse_stream(p_io);
+    m_ht_extended_caps = p_io.read_u2be();
+    m_txbf_caps = p_io.read_u4be();
+    m_asel_caps = p_io.read_u1();
+}
+
+void dot11_ie_45_ht_cap::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_45_ht_cap::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
+template<typename IO>
+void dot11_ie_45_ht_cap::dot11_ie_45_rx_mcs::parse_stream(IO& p_io) {
+    m_rx_mcs = p_io.read_bytes(10);
+    m_supported_data_rate = p_io.read_u2le();
+    m_txflags = p_io.read_u4be();
 }
 
 void dot11_ie_45_ht_cap::dot11_ie_45_rx_mcs::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_rx_mcs = p_io->read_bytes(10);
-    m_supported_data_rate = p_io->read_u2le();
-    m_txflags = p_io->read_u4be();
+    parse_stream(*p_io);
 }
 
@@ -40,6 +40,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint16_t ht_capabilities() const {
         return m_ht_capabilities;
     }
@@ -141,6 +148,9 @@ public:
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         std::string rx_mcs() const {
             return m_rx_mcs;
         }
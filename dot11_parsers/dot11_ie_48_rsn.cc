@@ -17,41 +17,72 @@
 */
 
 #include "dot11_ie_48_rsn.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_48_rsn::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_rsn_version = p_io->read_u2le();
+template<typename IO>
+void dot11_ie_48_rsn::parse_stream(IO& p_io) {
+    m_rsn_version = p_io.read_u2le();
     m_group_cipher.reset(new dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_cipher());
-    m_group_cipher->parse(p_io);
-    m_pairwise_count = p_io->read_u2le();
+    m_group_cipher->parse_stream(p_io);
+    m_pairwise_count = p_io.read_u2le();
     m_pairwise_ciphers.reset(new shared_rsn_cipher_vector());
     for (unsigned int i = 0; i < pairwise_count(); i++) {
         std::shared_ptr<dot11_ie_48_rsn_rsn_cipher> c(new dot11_ie_48_rsn_rsn_cipher());
-        c->parse(p_io);
+        c->parse_stream(p_io);
         m_pairwise_ciphers->push_back(c);
     }
-    m_akm_count = p_io->read_u2le();
+    m_akm_count = p_io.read_u2le();
     m_akm_ciphers.reset(new shared_rsn_management_vector());
     for (unsigned int i = 0; i < akm_count(); i++) {
         std::shared_ptr<dot11_ie_48_rsn_rsn_management> a(new dot11_ie_48_rsn_rsn_management());
-        a->parse(p_io);
+        a->parse_stream(p_io);
         m_akm_ciphers->push_back(a);
     }
-    m_rsn_capabilities = p_io->read_u2le();
+    m_rsn_capabilities = p_io.read_u2le();
+}
+
+void dot11_ie_48_rsn::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_48_rsn::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
+template<typename IO>
+void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_cipher::parse_stream(IO& p_io) {
+    m_cipher_suite_oui = p_io.read_bytes(3);
+    m_cipher_type = p_io.read_u1();
 }
 
 void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_cipher::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_cipher_suite_oui = p_io->read_bytes(3);
-    m_cipher_type = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_management::parse_stream(IO& p_io) {
+    m_management_suite_oui = p_io.read_bytes(3);
+    m_management_type = p_io.read_u1();
 }
 
 void dot11_ie_48_rsn::dot11_ie_48_rsn_rsn_management::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_management_suite_oui = p_io->read_bytes(3);
-    m_management_type = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_48_rsn_partial::parse_stream(IO& p_io) {
+    m_rsn_version = p_io.read_u2le();
+    m_group_cipher = p_io.read_bytes(4);
+    m_pairwise_count = p_io.read_u2le();
 }
 
 void dot11_ie_48_rsn_partial::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_rsn_version = p_io->read_u2le();
-    m_group_cipher = p_io->read_bytes(4);
-    m_pairwise_count = p_io->read_u2le();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_48_rsn_partial::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
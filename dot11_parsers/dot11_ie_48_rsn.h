@@ -47,6 +47,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint16_t rsn_version() const {
         return m_rsn_version;
     }
@@ -129,6 +136,9 @@ public:
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         std::string cipher_suite_oui() const {
             return m_cipher_suite_oui;
         }
@@ -162,6 +172,9 @@ public:
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         std::string management_suite_oui() const {
             return m_management_suite_oui;
         }
@@ -184,6 +197,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     constexpr17 uint16_t rsn_version() const {
         return m_rsn_version;
     }
@@ -17,12 +17,23 @@
 */
 
 #include "dot11_ie_52_rmm_neighbor.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_52_rmm::parse_stream(IO& p_io) {
+    m_bssid = p_io.read_bytes(6);
+    m_bssid_info = p_io.read_u4le();
+    m_operating_class = p_io.read_u1();
+    m_channel_number = p_io.read_u1();
+    m_phy_type = p_io.read_u1();
+}
 
 void dot11_ie_52_rmm::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_bssid = p_io->read_bytes(6);
-    m_bssid_info = p_io->read_u4le();
-    m_operating_class = p_io->read_u1();
-    m_channel_number = p_io->read_u1();
-    m_phy_type = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_52_rmm::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
@@ -17,73 +17,119 @@
 */
 
 #include "dot11_ie_55_fastbss.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_55_fastbss::parse(std::shared_ptr<kaitai::kstream> p_io) {
+template<typename IO>
+void dot11_ie_55_fastbss::parse_stream(IO& p_io) {
     m_mic_control.reset(new sub_mic_control());
-    m_mic_control->parse(p_io);
-    m_mic = p_io->read_bytes(16);
-    m_anonce = p_io->read_bytes(32);
-    m_snonce = p_io->read_bytes(32);
+    m_mic_control->parse_stream(p_io);
+    m_mic = p_io.read_bytes(16);
+    m_anonce = p_io.read_bytes(32);
+    m_snonce = p_io.read_bytes(32);
     m_subelements.reset(new shared_sub_element_vector());
-    while (!p_io->is_eof()) {
+    while (!p_io.is_eof()) {
         std::shared_ptr<sub_element> e(new sub_element());
-        e->parse(p_io);
+        e->parse_stream(p_io);
         m_subelements->push_back(e);
     }
 }
 
+void dot11_ie_55_fastbss::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_55_fastbss::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
+template<typename IO>
+void dot11_ie_55_fastbss::sub_mic_control::parse_stream(IO& p_io) {
+    m_reserved = p_io.read_u1();
+    m_element_count = p_io.read_u1();
+}
+
 void dot11_ie_55_fastbss::sub_mic_control::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_reserved = p_io->read_u1();
-    m_element_count = p_io->read_u1();
+    parse_stream(*p_io);
 }
 
-void dot11_ie_55_fastbss::sub_element::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_sub_id = p_io->read_u1();
-    m_sub_len = p_io->read_u1();
-    m_raw_sub_data = p_io->read_bytes(sub_len());
-    m_raw_sub_data_stream.reset(new kaitai::kstream(m_raw_sub_data));
+template<typename IO>
+void dot11_ie_55_fastbss::sub_element::parse_stream(IO& p_io) {
+    m_sub_id = p_io.read_u1();
+    m_sub_len = p_io.read_u1();
+    m_raw_sub_data = p_io.read_bytes(sub_len());
+    dot11_span_stream sub_io(m_raw_sub_data);
 
     if (sub_id() == sub_pmk_r1_keyholder) {
         std::shared_ptr<sub_element_data_pmk_r1_keyholder> r1kh(new sub_element_data_pmk_r1_keyholder());
-        r1kh->parse(m_raw_sub_data_stream);
+        r1kh->parse_stream(sub_io);
         m_sub_data = r1kh;
     } else if (sub_id() == sub_pmk_gtk) {
         std::shared_ptr<sub_element_data_gtk> gtk(new sub_element_data_gtk());
-        gtk->parse(m_raw_sub_data_stream);
+        gtk->parse_stream(sub_io);
         m_sub_data = gtk;
     } else if (sub_id() == sub_pmk_r0_kh_id) {
         std::shared_ptr<sub_element_data_pmk_r0_kh_id> r0khid(new sub_element_data_pmk_r0_kh_id());
-        r0khid->parse(m_raw_sub_data_stream);
+        r0khid->parse_stream(sub_io);
         m_sub_data = r0khid;
     } else {
         std::shared_ptr<sub_element_data_generic> g(new sub_element_data_generic());
-        g->parse(m_raw_sub_data_stream);
+        g->parse_stream(sub_io);
         m_sub_data = g;
     }
 }
 
+void dot11_ie_55_fastbss::sub_element::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_55_fastbss::sub_element::sub_element_data_pmk_r1_keyholder::parse_stream(IO& p_io) {
+    m_keyholder_id = p_io.read_bytes_full();
+}
+
 void dot11_ie_55_fastbss::sub_element::sub_element_data_pmk_r1_keyholder::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_keyholder_id = p_io->read_bytes_full();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_55_fastbss::sub_element::sub_element_data_pmk_r0_kh_id::parse_stream(IO& p_io) {
+    m_keyholder_id = p_io.read_bytes_full();
 }
 
 void dot11_ie_55_fastbss::sub_element::sub_element_data_pmk_r0_kh_id::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_keyholder_id = p_io->read_bytes_full();
+    parse_stream(*p_io);
 }
 
-void dot11_ie_55_fastbss::sub_element::sub_element_data_gtk::parse(std::shared_ptr<kaitai::kstream> p_io) {
+template<typename IO>
+void dot11_ie_55_fastbss::sub_element::sub_element_data_gtk::parse_stream(IO& p_io) {
     m_gtk_keyinfo.reset(new sub_element_data_gtk_sub_keyinfo());
-    m_gtk_keyinfo->parse(p_io);
-    m_keylen = p_io->read_u1();
-    m_gtk_rsc = p_io->read_bytes(8);
+    m_gtk_keyinfo->parse_stream(p_io);
+    m_keylen = p_io.read_u1();
+    m_gtk_rsc = p_io.read_bytes(8);
     // Use the remaining length instead of the keylen
-    m_gtk_gtk = p_io->read_bytes_full();
+    m_gtk_gtk = p_io.read_bytes_full();
+}
+
+void dot11_ie_55_fastbss::sub_element::sub_element_data_gtk::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_55_fastbss::sub_element::sub_element_data_gtk::sub_element_data_gtk_sub_keyinfo::parse_stream(IO& p_io) {
+    m_keyinfo = p_io.read_u2le();
 }
 
 void dot11_ie_55_fastbss::sub_element::sub_element_data_gtk::sub_element_data_gtk_sub_keyinfo::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_keyinfo = p_io->read_u2le();
+    parse_stream(*p_io);
+}
+
+template<typename IO>
+void dot11_ie_55_fastbss::sub_element::sub_element_data_generic::parse_stream(IO& p_io) {
+    m_data = p_io.read_bytes_full();
 }
 
 void dot11_ie_55_fastbss::sub_element::sub_element_data_generic::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_data = p_io->read_bytes_full();
+    parse_stream(*p_io);
 }
 
@@ -42,6 +42,13 @@ public:
 
     void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+    // Parse directly from the tag data
+    void parse(const char *data, size_t len);
+
+    // Parser body, shared by the kaitai stream and the in-place span
+    template<typename IO>
+    void parse_stream(IO& p_io);
+
     std::shared_ptr<sub_mic_control> mic_control() const {
         return m_mic_control;
     }
@@ -77,6 +84,9 @@ public:
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         constexpr17 uint8_t element_count() const {
             return m_element_count;
         }
@@ -106,6 +116,9 @@ public:
 
         void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+        template<typename IO>
+        void parse_stream(IO& p_io);
+
         constexpr17 sub_type sub_id() const {
             return (sub_type) m_sub_id;
         }
@@ -144,7 +157,6 @@ public:
         uint8_t m_sub_id;
         uint8_t m_sub_len;
         std::string m_raw_sub_data;
-        std::shared_ptr<kaitai::kstream> m_raw_sub_data_stream;
         std::shared_ptr<sub_element_data> m_sub_data;
 
     public:
@@ -163,6 +175,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             std::string keyholder_id() const {
                 return m_keyholder_id;
             }
@@ -178,6 +193,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             std::string keyholder_id() const {
                 return m_keyholder_id;
             }
@@ -195,6 +213,9 @@ public:
 
             void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
         protected:
             std::shared_ptr<sub_element_data_gtk_sub_keyinfo> m_gtk_keyinfo;
             uint8_t m_keylen;
@@ -209,6 +230,9 @@ public:
 
                 void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+                template<typename IO>
+                void parse_stream(IO& p_io);
+
                 constexpr17 uint16_t keyinfo() const {
                     return m_keyinfo;
                 }
@@ -228,6 +252,9 @@ public:
 
             virtual void parse(std::shared_ptr<kaitai::kstream> p_io);
 
+            template<typename IO>
+            void parse_stream(IO& p_io);
+
             std::string data() const {
                 return m_data;
             }
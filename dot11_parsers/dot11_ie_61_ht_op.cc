@@ -17,12 +17,23 @@
 */
 
 #include "dot11_ie_61_ht_op.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_61_ht_op::parse_stream(IO& p_io) {
+    m_primary_channel = p_io.read_u1();
+    m_info_subset_1 = p_io.read_u1();
+    m_info_subset_2 = p_io.read_u2be();
+    m_info_subset_3 = p_io.read_u2be();
+    m_rx_coding_scheme = p_io.read_u2le();
+}
 
 void dot11_ie_61_ht_op::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_primary_channel = p_io->read_u1();
-    m_info_subset_1 = p_io->read_u1();
-    m_info_subset_2 = p_io->read_u2be();
-    m_info_subset_3 = p_io->read_u2be();
-    m_rx_coding_scheme = p_io->read_u2le();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_61_ht_op::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
@@ -17,12 +17,23 @@
 */
 
 #include "dot11_ie_70_rm_capabilities.h"
+#include "dot11_span_stream.h"
+
+template<typename IO>
+void dot11_ie_70_rm_cap::parse_stream(IO& p_io) {
+    m_octet1 = p_io.read_u1();
+    m_octet2 = p_io.read_u1();
+    m_octet3 = p_io.read_u1();
+    m_octet4 = p_io.read_u1();
+    m_octet5 = p_io.read_u1();
+}
 
 void dot11_ie_70_rm_cap::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_octet1 = p_io->read_u1();
-    m_octet2 = p_io->read_u1();
-    m_octet3 = p_io->read_u1();
-    m_octet4 = p_io->read_u1();
-    m_octet5 = p_io->read_u1();
+    parse_stream(*p_io);
+}
+
+void dot11_ie_70_rm_cap::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
 }
 
@@ -17,18 +17,20 @@
 */
 
 #include "dot11_ie_7_country.h"
+#include "dot11_span_stream.h"
 
-void dot11_ie_7_country::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_country_code = p_io->read_bytes(2);
-    m_environment = p_io->read_u1();
+template<typename IO>
+void dot11_ie_7_country::parse_stream(IO& p_io) {
+    m_country_code = p_io.read_bytes(2);
+    m_environment = p_io.read_u1();
     m_country_list.reset(new shared_dot11d_country_triplet_vector());
-    while (!p_io->is_eof()) {
+    while (!p_io.is_eof()) {
         // Do our best to read all the channel codings; if we allow broken
         // country tags, read as far as we can and then stop, otherwise
         // pass the error upstream
         try {
             std::shared_ptr<dot11d_country_triplet> c(new dot11d_country_triplet());
-            c->parse(p_io);
+            c->parse_stream(p_io);
             m_country_list->push_back(c);
         } catch (std::exception& e) {
             if (i_allow_fragments)
@@ -39,9 +41,23 @@ void dot11_ie_7_country::parse(std::shared_ptr<kaitai::kstream> p_io) {
     }
 }
 
+void dot11_ie_7_country::parse(std::shared_ptr<kaitai::kstream> p_io) {
+    parse_stream(*p_io);
+}
+
+void dot11_ie_7_country::parse(const char *data, size_t len) {
+    dot11_span_stream p_io(data, len);
+    parse_stream(p_io);
+}
+
+template<typename IO>
+void dot11_ie_7_country::dot11d_country_triplet::parse_stream(IO& p_io) {
+    m_first_channel = p_io.read_u1();
+    m_num_channels = p_io.read_u1();
+    m_max_power = p_io.read_u1();
+}
+
 void dot11_ie_7_country::dot11d_country_triplet::parse(std::shared_ptr<kaitai::kstream> p_io) {
-    m_first_channel = p_io->read_u1();
-    m_num_channels = p_io->read_u1();
-    m_max_power = p_io->read_u1();
+    parse_stream(*p_io);
 }
 
@@ -0,0 +1,123 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DOT11_SPAN_STREAM_H__
+#define __DOT11_SPAN_STREAM_H__
+
+/* In-place reader over a span of tag data
+ *
+ * Provides the subset of the kaitai::kstream read calls used by the IE parsers, so
+ * each parser has one body for both; reads come straight from the tag data instead of
+ * through an istream.  Reading past the end of the span throws, as kstream does.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <stdexcept>
+#include <string>
+
+class dot11_span_stream {
+public:
+    dot11_span_stream(const char *data, size_t len) :
+        m_data {data},
+        m_len {len},
+        m_pos {0} { }
+
+    dot11_span_stream(const std::string& data) :
+        m_data {data.data()},
+        m_len {data.length()},
+        m_pos {0} { }
+
+    bool is_eof() const {
+        return m_pos >= m_len;
+    }
+
+    uint64_t size() const {
+        return m_len;
+    }
+
+    uint64_t pos() const {
+        return m_pos;
+    }
+
+    uint8_t read_u1() {
+        return (uint8_t) *take(1);
+    }
+
+    uint16_t read_u2be() {
+        auto d = (const uint8_t *) take(2);
+        return ((uint16_t) d[0] << 8) | d[1];
+    }
+
+    uint16_t read_u2le() {
+        auto d = (const uint8_t *) take(2);
+        return ((uint16_t) d[1] << 8) | d[0];
+    }
+
+    int16_t read_s2le() {
+        return (int16_t) read_u2le();
+    }
+
+    uint32_t read_u4be() {
+        auto d = (const uint8_t *) take(4);
+        return ((uint32_t) d[0] << 24) | ((uint32_t) d[1] << 16) |
+            ((uint32_t) d[2] << 8) | d[3];
+    }
+
+    uint32_t read_u4le() {
+        auto d = (const uint8_t *) take(4);
+        return ((uint32_t) d[3] << 24) | ((uint32_t) d[2] << 16) |
+            ((uint32_t) d[1] << 8) | d[0];
+    }
+
+    int32_t read_s4le() {
+        return (int32_t) read_u4le();
+    }
+
+    uint64_t read_u8be() {
+        uint64_t hi = read_u4be();
+        return (hi << 32) | read_u4be();
+    }
+
+    std::string read_bytes(size_t len) {
+        return std::string(take(len), len);
+    }
+
+    std::string read_bytes_full() {
+        return read_bytes(m_len - m_pos);
+    }
+
+protected:
+    const char *take(size_t len) {
+        if (len > m_len - m_pos)
+            throw std::runtime_error("attempted to read past the end of the tag");
+
+        auto r = m_data + m_pos;
+        m_pos += len;
+        return r;
+    }
+
+    const char *m_data;
+    size_t m_len;
+    size_t m_pos;
+};
+
+#endif
+
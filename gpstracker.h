@@ -48,7 +48,10 @@ class kis_gps_packinfo : public packet_component {
 public:
     kis_gps_packinfo() {
         self_destruct = 1;
+        reset();
+    }
 
+    virtual void reset() override {
         merge_partial = false;
         merge_flags = 0;
 
@@ -60,6 +63,8 @@ public:
         error_x = 0;
         error_y = 0;
         error_v = 0;
+        gpsuuid = uuid();
+        gpsname.clear();
     }
 
     kis_gps_packinfo(kis_gps_packinfo *src) {
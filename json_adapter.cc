@@ -26,7 +26,13 @@
 #include <algorithm>
 #include <string>
 #include <math.h>
+#include <string.h>
 #include <cmath>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "globalregistry.h"
 #include "trackedelement.h"
@@ -34,6 +40,7 @@
 #include "entrytracker.h"
 #include "uuid.h"
 #include "devicetracker_component.h"
+#include "endian_magic.h"
 #include "json_adapter.h"
 
 /* sanitize_extra_space and sanitize_string taken from nlohmann's jsonhpp library,
@@ -1069,3 +1076,713 @@ void storage_json_adapter::pack(std::ostream &stream, shared_tracker_element e,
     // close wrapping object
     stream << "}";
 }
+
+namespace fast_json_adapter {
+
+// Field ids above this are dynamic entities keyed by a hash of their name, which are
+// named locally and not worth caching
+static const int max_cached_field_id = 65536;
+
+// Output is written to the stream once the buffer passes this size
+static const size_t flush_size = 65536;
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_upper[] = "0123456789ABCDEF";
+static const char hex_lower[] = "0123456789abcdef";
+
+// Find the first byte which must be escaped in a JSON string - quotes, backslashes,
+// and control characters.  Returns len if there are none.
+static size_t json_escape_scan(const char *s, size_t len) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+
+        // Control characters are the bytes for which unsigned min(v, 0x1f) == v
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+
+        int mask = _mm_movemask_epi8(m);
+
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#else
+    // Test 8 bytes at a time for a zero byte after xoring with quote and backslash, or
+    // for a byte less than 0x20; then find the exact position below
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+
+        uint64_t q = w ^ (ones * '"');
+        uint64_t b = w ^ (ones * '\\');
+
+        if ((((q - ones) & ~q) | ((b - ones) & ~b) | ((w - ones * 0x20) & ~w)) & highs)
+            break;
+    }
+#endif
+
+    for (; i < len; i++) {
+        unsigned char c = s[i];
+
+        if (c == '"' || c == '\\' || c < 0x20)
+            return i;
+    }
+
+    return len;
+}
+
+// Output buffer and the element walker
+class packer {
+public:
+    packer(serializer *in_serializer, std::ostream& in_stream,
+            std::shared_ptr<tracker_element_serializer::rename_map> in_name_map) :
+        parent {in_serializer},
+        stream {in_stream},
+        name_map {in_name_map},
+        ek_names {in_serializer->get_ek_names()},
+        names {in_serializer->get_name_cache()} {
+        buf.reserve(flush_size + 4096);
+    }
+
+    ~packer() {
+        flush();
+
+        if (new_names.size() != 0)
+            parent->merge_name_cache(new_names);
+    }
+
+    void flush() {
+        if (buf.length() != 0) {
+            stream.write(buf.data(), buf.length());
+            buf.clear();
+        }
+    }
+
+    void maybe_flush() {
+        if (buf.length() >= flush_size)
+            flush();
+    }
+
+    void put(char c) {
+        buf.push_back(c);
+    }
+
+    void put(const char *s, size_t len) {
+        buf.append(s, len);
+    }
+
+    void put_uint(uint64_t v) {
+        char tmp[20];
+        char *p = tmp + sizeof(tmp);
+
+        while (v >= 100) {
+            auto d = (v % 100) * 2;
+            v /= 100;
+            *--p = digit_pairs[d + 1];
+            *--p = digit_pairs[d];
+        }
+
+        if (v < 10) {
+            *--p = '0' + v;
+        } else {
+            *--p = digit_pairs[v * 2 + 1];
+            *--p = digit_pairs[v * 2];
+        }
+
+        buf.append(p, tmp + sizeof(tmp) - p);
+    }
+
+    void put_int(int64_t v) {
+        if (v < 0) {
+            put('-');
+            put_uint(0 - static_cast<uint64_t>(v));
+        } else {
+            put_uint(v);
+        }
+    }
+
+    // Doubles follow the ostream formatting of the json adapter:  nan and inf become 0,
+    // integral values have no decimals, and everything else is fixed with 6 decimals.
+    //
+    // Double vectors and the values of double:double maps are formatted the same way.
+    // The json adapter streams those without setting the format, so they came out fixed
+    // or in the default ostream format depending on what had been written to the
+    // stream before them.
+    void put_double(double d) {
+        char tmp[512];
+
+        if (std::isnan(d) || std::isinf(d)) {
+            put('0');
+            return;
+        }
+
+        if (std::floor(d) == d) {
+            // Negative zero keeps its sign, as printf does
+            if (d == 0 && std::signbit(d)) {
+                put("-0", 2);
+                return;
+            }
+
+            if (d > -9.2e18 && d < 9.2e18) {
+                put_int(static_cast<int64_t>(d));
+                return;
+            }
+
+            buf.append(tmp, snprintf(tmp, sizeof(tmp), "%.0f", d));
+            return;
+        }
+
+        // Below 2^32 the scaled value stays under 2^52, so it has a fractional part and
+        // the multiply is off by at most an epsilon of it; values which land within
+        // that of a rounding tie are left to printf, so the last digit always matches
+        double scaled_d = std::fabs(d) * 1000000;
+
+        if (std::fabs(d) < 4294967296.0 && 
+                std::fabs(scaled_d - std::floor(scaled_d) - 0.5) > 
+                scaled_d * std::numeric_limits<double>::epsilon()) {
+            if (d < 0)
+                put('-');
+
+            auto scaled = static_cast<uint64_t>(std::llround(scaled_d));
+            auto frac = scaled % 1000000;
+
+            put_uint(scaled / 1000000);
+            put('.');
+
+            char fd[6];
+            for (int x = 5; x >= 0; x--) {
+                fd[x] = '0' + (frac % 10);
+                frac /= 10;
+            }
+
+            put(fd, 6);
+            return;
+        }
+
+        buf.append(tmp, snprintf(tmp, sizeof(tmp), "%.6f", d));
+    }
+
+    void put_escaped(const char *s, size_t len) {
+        while (len > 0) {
+            size_t n = json_escape_scan(s, len);
+
+            buf.append(s, n);
+
+            if (n == len)
+                return;
+
+            unsigned char c = s[n];
+
+            switch (c) {
+                case '"':
+                    put("\\\"", 2);
+                    break;
+                case '\\':
+                    put("\\\\", 2);
+                    break;
+                case '\b':
+                    put("\\b", 2);
+                    break;
+                case '\f':
+                    put("\\f", 2);
+                    break;
+                case '\n':
+                    put("\\n", 2);
+                    break;
+                case '\r':
+                    put("\\r", 2);
+                    break;
+                case '\t':
+                    put("\\t", 2);
+                    break;
+                default:
+                    {
+                        char u[6] = {'\\', 'u', '0', '0', hex_lower[c >> 4], hex_lower[c & 0xF]};
+                        put(u, 6);
+                    }
+                    break;
+            }
+
+            s += n + 1;
+            len -= n + 1;
+        }
+    }
+
+    void put_string(const std::string& s) {
+        put('"');
+        put_escaped(s.data(), s.length());
+        put('"');
+    }
+
+    void put_mac(const mac_addr& m) {
+        char tmp[19];
+
+        tmp[0] = '"';
+        for (int i = 0; i < 6; i++) {
+            tmp[1 + i * 3] = hex_upper[(m[i] >> 4) & 0xF];
+            tmp[2 + i * 3] = hex_upper[m[i] & 0xF];
+            tmp[3 + i * 3] = ':';
+        }
+        tmp[18] = '"';
+
+        put(tmp, 19);
+    }
+
+    void put_hex64(uint64_t v, unsigned int min_width) {
+        char tmp[16];
+        char *p = tmp + sizeof(tmp);
+
+        do {
+            *--p = hex_upper[v & 0xF];
+            v >>= 4;
+        } while (v != 0);
+
+        while (static_cast<unsigned int>(tmp + sizeof(tmp) - p) < min_width)
+            *--p = '0';
+
+        put(p, tmp + sizeof(tmp) - p);
+    }
+
+    // Keys are formatted the same as the device_key stream operator
+    void put_key(const device_key& k) {
+        put('"');
+        put_hex64(kis_hton64(k.get_spkey()), 2);
+        put('_');
+        put_hex64(kis_hton64(k.get_dkey()), 0);
+        put('"');
+    }
+
+    void put_name_token(const std::string& name) {
+        put('"');
+
+        if (ek_names) {
+            auto permuted = name;
+            std::replace(permuted.begin(), permuted.end(), '.', '_');
+            put_escaped(permuted.data(), permuted.length());
+        } else {
+            put_escaped(name.data(), name.length());
+        }
+
+        put("\": ", 3);
+    }
+
+    void put_field_name(int id, const shared_tracker_element& e) {
+        if (name_map != nullptr) {
+            auto nmi = name_map->find(e);
+            if (nmi != name_map->end() && nmi->second->rename.length() != 0) {
+                put_name_token(nmi->second->rename);
+                return;
+            }
+        }
+
+        if (e->has_local_name()) {
+            put_name_token(e->get_local_name());
+            return;
+        }
+
+        if (id < 0 || id >= max_cached_field_id) {
+            put_name_token(Globalreg::globalreg->entrytracker->get_field_name(id));
+            return;
+        }
+
+        if (static_cast<size_t>(id) < names->size() && (*names)[id].length() != 0) {
+            buf.append((*names)[id]);
+            return;
+        }
+
+        auto nni = new_names.find(id);
+        if (nni != new_names.end()) {
+            buf.append(nni->second);
+            return;
+        }
+
+        auto start = buf.length();
+        put_name_token(Globalreg::globalreg->entrytracker->get_field_name(id));
+        new_names[id] = buf.substr(start);
+    }
+
+    // Keyed maps with shared element values
+    template<class M, class K>
+    void pack_keyed_map(M *m, K key_fn) {
+        bool as_vector = m->as_vector();
+        bool as_key_vector = m->as_key_vector();
+        bool prepend_comma = false;
+
+        put((as_vector || as_key_vector) ? '[' : '{');
+
+        for (const auto& i : *m) {
+            if (i.second == nullptr && !as_key_vector)
+                continue;
+
+            if (prepend_comma)
+                put(',');
+            prepend_comma = true;
+
+            if (!as_vector) {
+                key_fn(i.first);
+
+                if (!as_key_vector)
+                    put(": ", 2);
+            }
+
+            if (!as_key_vector)
+                pack(i.second);
+
+            maybe_flush();
+        }
+
+        put((as_vector || as_key_vector) ? ']' : '}');
+    }
+
+    void pack(shared_tracker_element e);
+
+protected:
+    // Pre- and post-serialization of an element, as in serializer_scope, without
+    // copying the element
+    class element_scope {
+    public:
+        element_scope(const shared_tracker_element& e,
+                const std::shared_ptr<tracker_element_serializer::rename_map>& name_map) :
+            elem {e.get()},
+            summary {nullptr} {
+
+            if (name_map != nullptr) {
+                auto nmi = name_map->find(e);
+                if (nmi != name_map->end()) {
+                    summary = &(nmi->second);
+                    tracker_element_serializer::pre_serialize_path(*summary);
+                    return;
+                }
+            }
+
+            elem->pre_serialize();
+        }
+
+        ~element_scope() {
+            if (summary != nullptr)
+                tracker_element_serializer::post_serialize_path(*summary);
+            else
+                elem->post_serialize();
+        }
+
+    protected:
+        tracker_element *elem;
+        const SharedElementSummary *summary;
+    };
+
+    serializer *parent;
+    std::ostream& stream;
+    std::shared_ptr<tracker_element_serializer::rename_map> name_map;
+    bool ek_names;
+
+    std::string buf;
+
+    std::shared_ptr<const serializer::name_cache> names;
+    std::map<int, std::string> new_names;
+};
+
+void packer::pack(shared_tracker_element e) {
+    if (e == nullptr)
+        return;
+
+    element_scope s(e, name_map);
+
+    // If we're serializing an alias, remap as the aliased element
+    if (e->get_type() == tracker_type::tracker_alias)
+        e = std::static_pointer_cast<tracker_element_alias>(e)->get();
+
+    auto ep = e.get();
+
+    switch (e->get_type()) {
+        case tracker_type::tracker_string:
+            put_string(static_cast<tracker_element_string *>(ep)->get());
+            break;
+        case tracker_type::tracker_int8:
+            put_int(static_cast<tracker_element_int8 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint8:
+            put_uint(static_cast<tracker_element_uint8 *>(ep)->get());
+            break;
+        case tracker_type::tracker_int16:
+            put_int(static_cast<tracker_element_int16 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint16:
+            put_uint(static_cast<tracker_element_uint16 *>(ep)->get());
+            break;
+        case tracker_type::tracker_int32:
+            put_int(static_cast<tracker_element_int32 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint32:
+            put_uint(static_cast<tracker_element_uint32 *>(ep)->get());
+            break;
+        case tracker_type::tracker_int64:
+            put_int(static_cast<tracker_element_int64 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint64:
+            put_uint(static_cast<tracker_element_uint64 *>(ep)->get());
+            break;
+        case tracker_type::tracker_float:
+            put_double(static_cast<tracker_element_float *>(ep)->get());
+            break;
+        case tracker_type::tracker_double:
+            put_double(static_cast<tracker_element_double *>(ep)->get());
+            break;
+        case tracker_type::tracker_mac_addr:
+            put_mac(static_cast<tracker_element_mac_addr *>(ep)->get());
+            break;
+        case tracker_type::tracker_uuid:
+            put('"');
+            buf.append(static_cast<tracker_element_uuid *>(ep)->get().uuid_to_string());
+            put('"');
+            break;
+        case tracker_type::tracker_key:
+            put_key(static_cast<tracker_element_device_key *>(ep)->get());
+            break;
+        case tracker_type::tracker_vector:
+            {
+                bool prepend_comma = false;
+
+                put('[');
+
+                for (const auto& i : *static_cast<tracker_element_vector *>(ep)) {
+                    if (i == nullptr)
+                        continue;
+
+                    if (prepend_comma)
+                        put(',');
+                    prepend_comma = true;
+
+                    pack(i);
+                    maybe_flush();
+                }
+
+                put(']');
+            }
+            break;
+        case tracker_type::tracker_vector_double:
+            {
+                bool prepend_comma = false;
+
+                put('[');
+
+                for (const auto& i : *static_cast<tracker_element_vector_double *>(ep)) {
+                    if (prepend_comma)
+                        put(',');
+                    prepend_comma = true;
+
+                    put_double(i);
+                }
+
+                put(']');
+            }
+            break;
+        case tracker_type::tracker_vector_string:
+            {
+                bool prepend_comma = false;
+
+                put('[');
+
+                for (const auto& i : *static_cast<tracker_element_vector_string *>(ep)) {
+                    if (prepend_comma)
+                        put(',');
+                    prepend_comma = true;
+
+                    put_string(i);
+                }
+
+                put(']');
+            }
+            break;
+        case tracker_type::tracker_map:
+            {
+                auto m = static_cast<tracker_element_map *>(ep);
+                bool as_vector = m->as_vector();
+                bool as_key_vector = m->as_key_vector();
+                bool prepend_comma = false;
+
+                put((as_vector || as_key_vector) ? '[' : '{');
+
+                for (const auto& i : *m) {
+                    if (i.second == nullptr)
+                        continue;
+
+                    if (prepend_comma)
+                        put(',');
+                    prepend_comma = true;
+
+                    if (!as_vector)
+                        put_field_name(i.first, i.second);
+
+                    pack(i.second);
+                    maybe_flush();
+                }
+
+                put((as_vector || as_key_vector) ? ']' : '}');
+            }
+            break;
+        case tracker_type::tracker_int_map:
+            pack_keyed_map(static_cast<tracker_element_int_map *>(ep),
+                    [this](int k) {
+                        // Integer dictionary keys in json are still quoted as strings
+                        put('"');
+                        put_int(k);
+                        put('"');
+                    });
+            break;
+        case tracker_type::tracker_mac_map:
+            pack_keyed_map(static_cast<tracker_element_mac_map *>(ep),
+                    [this](const mac_addr& k) {
+                        put_mac(k);
+                    });
+            break;
+        case tracker_type::tracker_string_map:
+            pack_keyed_map(static_cast<tracker_element_string_map *>(ep),
+                    [this](const std::string& k) {
+                        put_string(k);
+                    });
+            break;
+        case tracker_type::tracker_double_map:
+            pack_keyed_map(static_cast<tracker_element_double_map *>(ep),
+                    [this](double k) {
+                        put('"');
+                        put_double(k);
+                        put('"');
+                    });
+            break;
+        case tracker_type::tracker_hashkey_map:
+            pack_keyed_map(static_cast<tracker_element_hashkey_map *>(ep),
+                    [this](size_t k) {
+                        put('"');
+                        put_uint(k);
+                        put('"');
+                    });
+            break;
+        case tracker_type::tracker_key_map:
+            pack_keyed_map(static_cast<tracker_element_device_key_map *>(ep),
+                    [this](const device_key& k) {
+                        put_key(k);
+                    });
+            break;
+        case tracker_type::tracker_double_map_double:
+            {
+                auto m = static_cast<tracker_element_double_map_double *>(ep);
+                bool as_vector = m->as_vector();
+                bool as_key_vector = m->as_key_vector();
+                bool prepend_comma = false;
+
+                put((as_vector || as_key_vector) ? '[' : '{');
+
+                for (const auto& i : *m) {
+                    if (prepend_comma)
+                        put(',');
+                    prepend_comma = true;
+
+                    if (!as_vector) {
+                        put('"');
+                        put_double(i.first);
+                        put('"');
+
+                        if (!as_key_vector)
+                            put(": ", 2);
+                    }
+
+                    if (!as_key_vector)
+                        put_double(i.second);
+                }
+
+                put((as_vector || as_key_vector) ? ']' : '}');
+            }
+            break;
+        case tracker_type::tracker_byte_array:
+            {
+                const auto& bytes = static_cast<tracker_element_byte_array *>(ep)->get();
+
+                put('"');
+                for (unsigned char c : bytes) {
+                    put(hex_upper[c >> 4]);
+                    put(hex_upper[c & 0xF]);
+                }
+                put('"');
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+serializer::serializer(json_mode in_mode) :
+    tracker_element_serializer(),
+    mode {in_mode},
+    names {std::make_shared<name_cache>()} { }
+
+std::shared_ptr<const serializer::name_cache> serializer::get_name_cache() const {
+    return std::atomic_load(&names);
+}
+
+void serializer::merge_name_cache(const std::map<int, std::string>& in_names) {
+    std::lock_guard<std::mutex> lk(names_mutex);
+
+    auto merged = std::make_shared<name_cache>(*std::atomic_load(&names));
+
+    for (const auto& n : in_names) {
+        if (static_cast<size_t>(n.first) >= merged->size())
+            merged->resize(n.first + 1);
+        (*merged)[n.first] = n.second;
+    }
+
+    std::atomic_store(&names, std::shared_ptr<const name_cache>(merged));
+}
+
+int serializer::serialize(shared_tracker_element in_elem, std::ostream &stream,
+        std::shared_ptr<rename_map> name_map) {
+
+    packer p(this, stream, name_map);
+
+    if (mode == json_mode::json) {
+        p.pack(in_elem);
+        return 0;
+    }
+
+    // ekjson and itjson serialize each member of a vector as a complete object per line
+    if (in_elem == nullptr || in_elem->get_type() != tracker_type::tracker_vector) {
+        if (mode == json_mode::ekjson)
+            stream << "<h1>Invalid format for ekjson</h1>ekjson endpoints can only be used with array or list results\n";
+        else
+            stream << "<h1>Invalid format for itjson</h1>itjson endpoints can only be used with array or list results\n";
+        return -1;
+    }
+
+    for (const auto& i : *(std::static_pointer_cast<tracker_element_vector>(in_elem))) {
+        p.pack(i);
+        p.put('\n');
+        p.maybe_flush();
+    }
+
+    if (mode == json_mode::ekjson)
+        return 0;
+
+    return 1;
+}
+
+}
+
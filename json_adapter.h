@@ -21,6 +21,10 @@
 
 #include "config.h"
 
+#include <map>
+#include <mutex>
+#include <vector>
+
 #include "globalregistry.h"
 #include "trackedelement.h"
 #include "devicetracker_component.h"
@@ -55,6 +59,43 @@ public:
 
 }
 
+// Fast JSON adapter.  Produces the same output as the json, ekjson, and itjson adapters
+// (without pretty-printing), but formats directly into a local buffer which is written
+// to the stream in large blocks, formats numbers by hand instead of through the
+// ostream, and caches the escaped form of every field name.
+namespace fast_json_adapter {
+
+enum class json_mode {
+    json, ekjson, itjson
+};
+
+class serializer : public tracker_element_serializer {
+public:
+    serializer(json_mode in_mode = json_mode::json);
+
+    virtual int serialize(shared_tracker_element in_elem, std::ostream &stream,
+            std::shared_ptr<rename_map> name_map = nullptr) override;
+
+    // Escaped '"name": ' tokens indexed by field id.  The cache is replaced as a whole
+    // when new names are seen, so serializing never has to lock to read it.
+    using name_cache = std::vector<std::string>;
+
+    std::shared_ptr<const name_cache> get_name_cache() const;
+    void merge_name_cache(const std::map<int, std::string>& in_names);
+
+    bool get_ek_names() const {
+        return mode == json_mode::ekjson;
+    }
+
+protected:
+    json_mode mode;
+
+    std::shared_ptr<const name_cache> names;
+    std::mutex names_mutex;
+};
+
+}
+
 // "ELK-style" JSON adapter.  This will behave the same as the normal JSON
 // serializer with a few important differences:  
 // 1. If the top-level object *is a vector type*, it will serialize each 
@@ -0,0 +1,249 @@
+/* test harness for the Kismet json serializers
+ *
+ * Serializes the same records with the json adapter and the fast json adapter and
+ * compares the output, and checks the fast double formatting against printf for a
+ * sweep of values: integral values with no decimals, everything else fixed with 6
+ * decimals, and nan and inf as 0.
+ *
+ * Double vectors and double:double map values are checked against printf only; the
+ * json adapter streams them without setting the format, so its output for them
+ * depends on what was written before them.
+ *
+ * # configure kismet with asan
+ * ./configure --enable-asan
+ *
+ * # build kismet
+ * make
+ *
+ * # build test harness
+ * g++ -o json_adapter_test json_adapter_test.cc json_adapter.cc.o trackedelement.cc.o \
+ *     util.cc.o macaddr.cc.o uuid.cc.o -lasan
+ *
+ * ./json_adapter_test
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "json_adapter.h"
+#include "trackedelement.h"
+
+// Every field here has a local name, so the entrytracker is never asked for one
+#define TEST_HARNESS_TRACKER_STUBS
+#include "test_harness.h"
+
+static std::string legacy_json(shared_tracker_element e) {
+    std::stringstream ss;
+    json_adapter::pack(ss, e);
+    return ss.str();
+}
+
+static std::string fast_json(shared_tracker_element e) {
+    std::stringstream ss;
+    fast_json_adapter::serializer s(fast_json_adapter::json_mode::json);
+    s.serialize(e, ss);
+    return ss.str();
+}
+
+// Reference formatting for doubles
+static std::string printf_double(double d) {
+    char buf[512];
+
+    if (std::isnan(d) || std::isinf(d))
+        return "0";
+
+    if (std::floor(d) == d)
+        snprintf(buf, sizeof(buf), "%.0f", d);
+    else
+        snprintf(buf, sizeof(buf), "%.6f", d);
+
+    return buf;
+}
+
+template<typename T, typename V>
+std::shared_ptr<T> named(int id, const std::string& name, V v) {
+    auto e = std::make_shared<T>(id, v);
+    e->set_local_name(name);
+    return e;
+}
+
+// One of every scalar, nested maps and vectors, and strings needing escapes
+static shared_tracker_element build_record() {
+    auto rec = std::make_shared<tracker_element_map>();
+    int id = 1;
+
+    rec->insert(named<tracker_element_string>(id++, "kismet.test.string",
+                std::string("plain")));
+    rec->insert(named<tracker_element_string>(id++, "kismet.test.escapes",
+                std::string("quote\" slash\\ nl\n cr\r tab\t bs\b ff\f ctl\x01\x1f utf8 \xc3\xa9")));
+    rec->insert(named<tracker_element_string>(id++, "kismet.test.empty", std::string("")));
+    rec->insert(named<tracker_element_int8>(id++, "kismet.test.int8", (int8_t) -128));
+    rec->insert(named<tracker_element_uint8>(id++, "kismet.test.uint8", (uint8_t) 255));
+    rec->insert(named<tracker_element_int16>(id++, "kismet.test.int16", (int16_t) -32768));
+    rec->insert(named<tracker_element_uint16>(id++, "kismet.test.uint16", (uint16_t) 65535));
+    rec->insert(named<tracker_element_int32>(id++, "kismet.test.int32",
+                std::numeric_limits<int32_t>::min()));
+    rec->insert(named<tracker_element_uint32>(id++, "kismet.test.uint32",
+                std::numeric_limits<uint32_t>::max()));
+    rec->insert(named<tracker_element_int64>(id++, "kismet.test.int64",
+                std::numeric_limits<int64_t>::min()));
+    rec->insert(named<tracker_element_uint64>(id++, "kismet.test.uint64",
+                std::numeric_limits<uint64_t>::max()));
+    rec->insert(named<tracker_element_uint64>(id++, "kismet.test.zero", (uint64_t) 0));
+    rec->insert(named<tracker_element_float>(id++, "kismet.test.float", 3.25f));
+    rec->insert(named<tracker_element_double>(id++, "kismet.test.lat", 37.774929));
+    rec->insert(named<tracker_element_double>(id++, "kismet.test.lon", -122.419416));
+    rec->insert(named<tracker_element_double>(id++, "kismet.test.integral", 1e20));
+    rec->insert(named<tracker_element_double>(id++, "kismet.test.nan", std::nan("")));
+    rec->insert(named<tracker_element_double>(id++, "kismet.test.big", 123456789012.125));
+    rec->insert(named<tracker_element_mac_addr>(id++, "kismet.test.mac",
+                mac_addr("AA:BB:CC:DD:EE:FF")));
+    rec->insert(named<tracker_element_uuid>(id++, "kismet.test.uuid",
+                uuid("12345678-9ABC-DEF0-1234-56789ABCDEF0")));
+
+    auto key = std::make_shared<tracker_element_device_key>(id++);
+    key->set_local_name("kismet.test.key");
+    key->set(device_key(0x1234, mac_addr("00:11:22:33:44:55")));
+    rec->insert(key);
+
+    auto vec = std::make_shared<tracker_element_vector>(id++);
+    vec->set_local_name("kismet.test.vector");
+    for (int i = 0; i < 3; i++) {
+        auto sub = std::make_shared<tracker_element_map>(id++);
+        sub->insert(named<tracker_element_int32>(id++, "kismet.test.sub.n", i));
+        sub->insert(named<tracker_element_double>(id++, "kismet.test.sub.d", i * 0.1));
+        vec->push_back(sub);
+    }
+    vec->push_back(std::make_shared<tracker_element_vector>(id++));
+    rec->insert(vec);
+
+    auto imap = std::make_shared<tracker_element_int_map>(id++);
+    imap->set_local_name("kismet.test.int_map");
+    imap->insert(-5, named<tracker_element_string>(id++, "x", std::string("neg")));
+    imap->insert(42, named<tracker_element_uint64>(id++, "y", (uint64_t) 42));
+    rec->insert(imap);
+
+    auto smap = std::make_shared<tracker_element_string_map>(id++);
+    smap->set_local_name("kismet.test.string_map");
+    smap->insert("key \"q\"", named<tracker_element_int32>(id++, "z", -1));
+    rec->insert(smap);
+
+    auto mmap = std::make_shared<tracker_element_mac_map>(id++);
+    mmap->set_local_name("kismet.test.mac_map");
+    mmap->insert(mac_addr("01:02:03:04:05:06"), named<tracker_element_int32>(id++, "m", 7));
+    rec->insert(mmap);
+
+    auto dmap = std::make_shared<tracker_element_double_map>(id++);
+    dmap->set_local_name("kismet.test.double_map");
+    dmap->insert(2412.0, named<tracker_element_uint64>(id++, "f", (uint64_t) 1));
+    dmap->insert(5180.5, named<tracker_element_uint64>(id++, "g", (uint64_t) 2));
+    rec->insert(dmap);
+
+    return rec;
+}
+
+int main(int argc, char *argv[]) {
+    // Whole records, with both adapters; string vectors are left out since the json
+    // adapter writes their values unquoted, and are checked on their own
+    auto rec = build_record();
+    expect("record", legacy_json(rec), fast_json(rec));
+
+    auto top = std::make_shared<tracker_element_vector>();
+    top->push_back(build_record());
+    top->push_back(build_record());
+    expect("vector of records", legacy_json(top), fast_json(top));
+
+    auto svec = std::make_shared<tracker_element_vector_string>();
+    svec->push_back("one");
+    svec->push_back("two \"quoted\"\n");
+    expect("string vector", "[\"one\",\"two \\\"quoted\\\"\\n\"]", fast_json(svec));
+
+    // Doubles around every formatting boundary, and a random sweep
+    std::vector<double> doubles = {
+        0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 0.1, 0.0000005, 0.0000015, 0.0000025,
+        0.0078125, 1.0 / 3.0, -2.0 / 3.0, 0.9999995, 0.99999949999, 9.9999995,
+        4294967295.999999, 4294967296.0, 4294967296.5, 4294967297.1234565,
+        1e12 + 0.123456, 1e15 + 0.5, 9.2e18, 9.3e18, 1e300, -1e300,
+        std::numeric_limits<double>::min(), std::numeric_limits<double>::denorm_min(),
+        std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+        std::nan("")
+    };
+
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+    for (int e = -8; e <= 12; e++) {
+        for (int i = 0; i < 20000; i++)
+            doubles.push_back(unit(rng) * std::pow(10.0, e));
+    }
+
+    // Exact six-decimal values and their neighbours, which sit on rounding ties
+    for (int i = 0; i < 20000; i++) {
+        double d = (double) (rng() % 100000000000ULL) / 1000000.0 + 0.0000005;
+        doubles.push_back(d);
+        doubles.push_back(std::nextafter(d, 0.0));
+        doubles.push_back(std::nextafter(d, 1e300));
+    }
+
+    auto dvec = std::make_shared<tracker_element_vector_double>();
+
+    for (auto d : doubles)
+        dvec->push_back(d);
+
+    auto dvec_json = fast_json(dvec);
+
+    if (dvec_json.length() < 2 || dvec_json.front() != '[' || dvec_json.back() != ']') {
+        expect("double vector", "[...]", dvec_json);
+    } else {
+        // Compare value by value, so a failure names the double
+        size_t pos = 1;
+
+        for (auto d : doubles) {
+            auto end = dvec_json.find_first_of(",]", pos);
+            char what[64];
+
+            snprintf(what, sizeof(what), "double %.17g", d);
+            expect(what, printf_double(d), dvec_json.substr(pos, end - pos));
+
+            pos = end + 1;
+        }
+    }
+
+    // Scalar doubles match the json adapter too
+    for (size_t i = 0; i < doubles.size(); i += (i < 64 ? 1 : 7)) {
+        auto d = std::make_shared<tracker_element_double>(0, doubles[i]);
+        expect("scalar double", legacy_json(d), fast_json(d));
+        expect("scalar double printf", printf_double(doubles[i]), fast_json(d));
+    }
+
+    auto ddmap = std::make_shared<tracker_element_double_map_double>();
+    ddmap->insert(1.5, 2.0);
+    ddmap->insert(-3.0, 0.1234565);
+    ddmap->insert(1e20, std::nan(""));
+
+    std::string ddmap_expected = "{";
+    bool comma = false;
+    for (const auto& i : *ddmap) {
+        if (comma)
+            ddmap_expected += ",";
+        comma = true;
+        ddmap_expected += "\"" + printf_double(i.first) + "\": " + printf_double(i.second);
+    }
+    ddmap_expected += "}";
+
+    expect("double:double map", ddmap_expected, fast_json(ddmap));
+
+    printf("%lu doubles checked, %u failures\n", doubles.size(), test_failures());
+
+    return test_failures() == 0 ? 0 : 1;
+}
+
@@ -68,6 +68,12 @@ bool kis_database::database_open(std::string in_file_path) {
         return false;
     }
 
+    if (!database_configure_connection()) {
+        sqlite3_close(db);
+        db = NULL;
+        return false;
+    }
+
     // Do we have a KISMET table?  If not, this is probably a new database.
     bool k_t_exists = false;
 
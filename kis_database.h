@@ -80,6 +80,10 @@ public:
 protected:
     virtual bool database_create_master_table();
 
+    // Configure a freshly opened connection before any tables are created or
+    // queried, for instance to set the page size or journal mode
+    virtual bool database_configure_connection() { return true; }
+
     // Force-set db version, to be called after upgrading the db or
     // creating a new db
     virtual bool database_set_db_version(unsigned int in_version);
@@ -23,6 +23,8 @@
 
 #include "globalregistry.h"
 #include "json_adapter.h"
+#include "msgpack_adapter.h"
+#include "zstr.hpp"
 #include "kis_databaselogfile.h"
 #include "kis_datasource.h"
 #include "kismet_json.h"
@@ -31,6 +33,27 @@
 #include "structured.h"
 #include "sqlite3_cpp11.h"
 
+// Turn a single-row 'INSERT ... VALUES (?, ...)' statement into a multi-row insert
+static std::string batch_insert_sql(const std::string& single_sql, unsigned int rows) {
+    auto values_pos = single_sql.find("VALUES ");
+
+    if (values_pos == std::string::npos)
+        return single_sql;
+
+    values_pos += 7;
+
+    auto row_group = single_sql.substr(values_pos);
+    auto sql = single_sql.substr(0, values_pos);
+
+    for (unsigned int i = 0; i < rows; i++) {
+        if (i > 0)
+            sql += ", ";
+        sql += row_group;
+    }
+
+    return sql;
+}
+
 kis_database_logfile::kis_database_logfile():
     kis_logfile(shared_log_builder(NULL)), 
     kis_database(Globalreg::globalreg, "kismetlog"),
@@ -75,6 +98,136 @@ kis_database_logfile::kis_database_logfile():
     snapshot_stmt = NULL;
     snapshot_pz = NULL;
 
+    packet_batch_stmt = NULL;
+    packet_batch_pz = NULL;
+
+    data_batch_stmt = NULL;
+    data_batch_pz = NULL;
+
+    device_batch_stmt = NULL;
+    device_batch_pz = NULL;
+
+    device_counters_stmt = NULL;
+    device_counters_pz = NULL;
+
+    device_counters_batch_stmt = NULL;
+    device_counters_batch_pz = NULL;
+
+    device_incremental =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_device_incremental", false);
+    device_full_rate =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_device_full_rate", 300);
+    device_log_state_swept = 0;
+
+    device_format =
+        str_lower(Globalreg::globalreg->kismet_config->fetch_opt_dfl("kis_log_device_format",
+                    "json"));
+
+    if (device_format != "json" && device_format != "msgpack") {
+        _MSG_ERROR("Unknown kis_log_device_format '{}', expected json or msgpack; using json.",
+                device_format);
+        device_format = "json";
+    }
+
+    db_journal_mode = 
+        str_lower(Globalreg::globalreg->kismet_config->fetch_opt_dfl("kis_log_journal_mode", 
+                    "persist"));
+
+    if (db_journal_mode != "persist" && db_journal_mode != "wal" && 
+            db_journal_mode != "truncate" && db_journal_mode != "delete") {
+        _MSG_ERROR("Unknown kis_log_journal_mode '{}', expected persist, wal, truncate, or "
+                "delete; using persist.", db_journal_mode);
+        db_journal_mode = "persist";
+    }
+
+    db_synchronous = 
+        str_lower(Globalreg::globalreg->kismet_config->fetch_opt("kis_log_synchronous"));
+
+    if (db_synchronous != "" && db_synchronous != "off" && db_synchronous != "normal" &&
+            db_synchronous != "full" && db_synchronous != "extra") {
+        _MSG_ERROR("Unknown kis_log_synchronous '{}', expected off, normal, full, or extra; "
+                "using the sqlite default.", db_synchronous);
+        db_synchronous = "";
+    }
+
+    db_page_size = 
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_page_size", 0);
+    db_cache_size = 
+        Globalreg::globalreg->kismet_config->fetch_opt_int("kis_log_cache_size", 0);
+    db_mmap_size = 
+        Globalreg::globalreg->kismet_config->fetch_opt_ulong("kis_log_mmap_size", 0);
+
+    commit_interval =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_commit_interval", 10);
+
+    if (commit_interval == 0)
+        commit_interval = 1;
+
+    commit_rows_max =
+        Globalreg::globalreg->kismet_config->fetch_opt_ulong("kis_log_commit_rows", 0);
+    commit_bytes_max =
+        Globalreg::globalreg->kismet_config->fetch_opt_ulong("kis_log_commit_bytes", 0);
+    uncommitted_rows = 0;
+    uncommitted_bytes = 0;
+
+    writer_shutdown = false;
+    writer_queue_max = 
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_write_queue", 8192);
+
+    if (writer_queue_max == 0)
+        writer_queue_max = 1;
+
+    writer_rows_written = 0;
+    writer_rows_dropped = 0;
+    writer_backpressure = 0;
+    writer_flushes = 0;
+    writer_flush_last_us = 0;
+    writer_flush_max_us = 0;
+    writer_flush_total_us = 0;
+    writer_devices_full = 0;
+    writer_devices_incremental = 0;
+
+    writer_queued_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.queued",
+                tracker_element_factory<tracker_element_uint64>(),
+                "rows waiting for the database writer");
+    writer_written_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.written",
+                tracker_element_factory<tracker_element_uint64>(),
+                "rows written by the database writer");
+    writer_dropped_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.dropped",
+                tracker_element_factory<tracker_element_uint64>(),
+                "packet and data rows dropped because the writer queue was full");
+    writer_backpressure_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.backpressure",
+                tracker_element_factory<tracker_element_uint64>(),
+                "device rows which waited for space in the writer queue");
+    writer_flushes_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.flushes",
+                tracker_element_factory<tracker_element_uint64>(),
+                "batches written by the database writer");
+    writer_flush_last_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.flush_last_us",
+                tracker_element_factory<tracker_element_uint64>(),
+                "time taken by the most recent batch, in microseconds");
+    writer_flush_max_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.flush_max_us",
+                tracker_element_factory<tracker_element_uint64>(),
+                "longest time taken by a batch, in microseconds");
+    writer_flush_avg_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.flush_avg_us",
+                tracker_element_factory<tracker_element_uint64>(),
+                "average time taken by a batch, in microseconds");
+    writer_devices_full_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.devices_full",
+                tracker_element_factory<tracker_element_uint64>(),
+                "device records written with the full device");
+    writer_devices_incremental_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.kismetdb.writer.devices_incremental",
+                tracker_element_factory<tracker_element_uint64>(),
+                "device records written as counters only");
+
     devicetracker =
         Globalreg::fetch_mandatory_global_as<device_tracker>();
 
@@ -183,6 +336,19 @@ bool kis_database_logfile::open_log(std::string in_path) {
 
                     sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
 
+                    pkt_delete = 
+                        fmt::format("DELETE FROM device_counters WHERE last_time < {}",
+                                time(0) - device_timeout);
+
+                    sqlite3_exec(db, pkt_delete.c_str(), NULL, NULL, NULL);
+
+                    // Expired spilled devices are forgotten by the tracker too, so it 
+                    // doesn't keep looking for them
+                    auto expired = expire_spilled_devices(time(0) - device_timeout);
+
+                    if (expired.size() > 0)
+                        devicetracker->forget_spilled_devices(expired);
+
                     return 1;
                     });
     } else {
@@ -271,6 +437,12 @@ bool kis_database_logfile::open_log(std::string in_path) {
                     return list_poi_endp_handler();
                 });
 
+    writer_stats_endp =
+        std::make_shared<kis_net_httpd_simple_tracked_endpoint>("/logging/kismetdb/writer", 
+                [this]() -> std::shared_ptr<tracker_element> {
+                    return writer_stats_endp_handler();
+                });
+
     device_mac_filter = 
         std::make_shared<class_filter_mac_addr>("kismetdb_devices", 
                 "Kismetdb device MAC filtering");
@@ -375,23 +547,27 @@ bool kis_database_logfile::open_log(std::string in_path) {
 
     db_enabled = true;
 
-    sqlite3_exec(db, "PRAGMA journal_mode=PERSIST", NULL, NULL, NULL);
-    
-    // Go into transactional mode where we only commit every 10 seconds
+    // Go into transactional mode where we only commit on the transaction timer, or 
+    // when the writer has accumulated enough rows
+    uncommitted_rows = 0;
+    uncommitted_bytes = 0;
     sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
 
+    {
+        std::lock_guard<std::mutex> lk(device_log_state_mutex);
+        device_log_states.clear();
+        device_log_state_swept = time(0);
+    }
+
+    start_writer();
+
     transaction_timer = 
-        timetracker->register_timer(SERVER_TIMESLICES_SEC * 10, NULL, 1,
+        timetracker->register_timer(SERVER_TIMESLICES_SEC * commit_interval, NULL, 1,
             [this](int) -> int {
 
             local_locker dblock(&ds_mutex);
 
-            in_transaction_sync = true;
-
-            sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
-            sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
-
-            in_transaction_sync = false;
+            commit_transaction();
 
             return 1;
         });
@@ -404,6 +580,9 @@ bool kis_database_logfile::open_log(std::string in_path) {
 }
 
 void kis_database_logfile::close_log() {
+    // Flush everything queued before the database goes away
+    stop_writer();
+
     local_demand_locker dblock(&ds_mutex);
 
     db_lock_with_sync_check(dblock, return);
@@ -476,6 +655,28 @@ void kis_database_logfile::close_log() {
         snapshot_stmt = NULL;
     }
 
+    {
+        if (packet_batch_stmt != NULL)
+            sqlite3_finalize(packet_batch_stmt);
+        packet_batch_stmt = NULL;
+
+        if (data_batch_stmt != NULL)
+            sqlite3_finalize(data_batch_stmt);
+        data_batch_stmt = NULL;
+
+        if (device_batch_stmt != NULL)
+            sqlite3_finalize(device_batch_stmt);
+        device_batch_stmt = NULL;
+
+        if (device_counters_stmt != NULL)
+            sqlite3_finalize(device_counters_stmt);
+        device_counters_stmt = NULL;
+
+        if (device_counters_batch_stmt != NULL)
+            sqlite3_finalize(device_counters_batch_stmt);
+        device_counters_batch_stmt = NULL;
+    }
+
     sqlite3_exec(db, "PRAGMA journal_mode=DELETE", NULL, NULL, NULL);
     sqlite3_exec(db, "BEGIN_EXCLUSIVE", NULL, NULL, NULL);
     sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
@@ -483,6 +684,101 @@ void kis_database_logfile::close_log() {
     database_close();
 }
 
+bool kis_database_logfile::database_configure_connection() {
+    // The page size has to be set before the first table is created, and before 
+    // switching to WAL
+    if (db_page_size != 0) 
+        sqlite3_exec(db, fmt::format("PRAGMA page_size={}", db_page_size).c_str(), 
+                NULL, NULL, NULL);
+
+    auto journal_mode = db_journal_mode;
+
+    // An ephemeral log is unlinked as soon as it is opened, so there is no path to
+    // open a WAL reader against
+    if (journal_mode == "wal" && 
+            Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_ephemeral_dangerous", false)) {
+        _MSG_INFO("kismetdb log is ephemeral, using the persist journal instead of WAL");
+        journal_mode = db_journal_mode = "persist";
+    }
+
+    char *sErrMsg = NULL;
+    std::string mode_result;
+
+    int r = sqlite3_exec(db, fmt::format("PRAGMA journal_mode={}", journal_mode).c_str(),
+            [] (void *aux, int argc, char **argv, char **) -> int {
+                if (argc > 0 && argv[0] != NULL)
+                    *((std::string *) aux) = argv[0];
+                return 0;
+            }, (void *) &mode_result, &sErrMsg);
+
+    if (r != SQLITE_OK) {
+        _MSG_ERROR("kismetdb log unable to set journal mode {} in {}: {}", journal_mode,
+                ds_dbfile, sErrMsg);
+        sqlite3_free(sErrMsg);
+        return false;
+    }
+
+    // sqlite reports the journal mode it actually ended up in, which may not be WAL
+    // if the filesystem can't support it
+    if (str_lower(mode_result) != journal_mode) {
+        _MSG_ERROR("kismetdb log could not use journal mode {} in {}, using {}", 
+                journal_mode, ds_dbfile, mode_result);
+        db_journal_mode = str_lower(mode_result);
+    }
+
+    if (db_synchronous != "")
+        sqlite3_exec(db, fmt::format("PRAGMA synchronous={}", db_synchronous).c_str(),
+                NULL, NULL, NULL);
+
+    if (db_cache_size != 0)
+        sqlite3_exec(db, fmt::format("PRAGMA cache_size={}", db_cache_size).c_str(),
+                NULL, NULL, NULL);
+
+    if (db_mmap_size != 0)
+        sqlite3_exec(db, fmt::format("PRAGMA mmap_size={}", db_mmap_size).c_str(),
+                NULL, NULL, NULL);
+
+    return true;
+}
+
+void kis_database_logfile::commit_transaction() {
+    in_transaction_sync = true;
+
+    sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
+    sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+
+    in_transaction_sync = false;
+
+    uncommitted_rows = 0;
+    uncommitted_bytes = 0;
+}
+
+sqlite3 *kis_database_logfile::open_read_connection() {
+    if (!db_wal() || ds_dbfile.length() == 0)
+        return nullptr;
+
+    sqlite3 *rdb = nullptr;
+
+    int r = sqlite3_open_v2(ds_dbfile.c_str(), &rdb, SQLITE_OPEN_READONLY, NULL);
+
+    if (r != SQLITE_OK) {
+        _MSG_ERROR("kismetdb log unable to open a read-only connection to {}: {}", 
+                ds_dbfile, rdb != nullptr ? sqlite3_errmsg(rdb) : "unknown error");
+        if (rdb != nullptr)
+            sqlite3_close(rdb);
+        return nullptr;
+    }
+
+    // Don't fail immediately if the writer is in the middle of a checkpoint
+    sqlite3_busy_timeout(rdb, 1000);
+
+    if (db_mmap_size != 0)
+        sqlite3_exec(rdb, fmt::format("PRAGMA mmap_size={}", db_mmap_size).c_str(),
+                NULL, NULL, NULL);
+
+    return rdb;
+}
+
 int kis_database_logfile::database_upgrade_db() {
     local_locker dblock(&ds_mutex);
 
@@ -532,6 +828,58 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
+    sql =
+        "CREATE TABLE device_counters ("
+
+        "devkey TEXT, " // Device key
+
+        "phyname TEXT, " // Phy records
+        "devmac TEXT, "
+
+        "last_time INT, " // Last seen
+
+        "packets INT, " // Total packets
+
+        "bytes_data INT, " // Amount of data seen on device
+
+        "strongest_signal INT, " // Strongest signal
+
+        "UNIQUE(phyname, devmac) ON CONFLICT REPLACE)";
+
+    r = sqlite3_exec(db, sql.c_str(),
+            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+    if (r != SQLITE_OK) {
+        _MSG("Kismet log was unable to create device_counters table in " + ds_dbfile + ": " +
+                std::string(sErrMsg), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
+    sql =
+        "CREATE TABLE spilled_devices ("
+
+        "devkey TEXT, " // Device key
+
+        "phyname TEXT, " // Phy records
+        "devmac TEXT, "
+
+        "last_time INT, " // Last seen
+
+        "device BLOB, " // Storage-format device record, possibly compressed
+
+        "UNIQUE(devkey) ON CONFLICT REPLACE)";
+
+    r = sqlite3_exec(db, sql.c_str(),
+            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+
+    if (r != SQLITE_OK) {
+        _MSG("Kismet log was unable to create spilled_devices table in " + ds_dbfile + ": " +
+                std::string(sErrMsg), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
     sql =
         "CREATE TABLE packets ("
 
@@ -731,6 +1079,44 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
+    sql = batch_insert_sql(sql, db_batch_rows);
+
+    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &device_batch_stmt, &device_batch_pz);
+
+    if (r != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare batched database insert for devices in " +
+                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
+    sql =
+        "INSERT INTO device_counters "
+        "(devkey, phyname, devmac, last_time, packets, bytes_data, strongest_signal) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?)";
+
+    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &device_counters_stmt, 
+            &device_counters_pz);
+
+    if (r != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare database insert for device counters in " +
+                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
+    sql = batch_insert_sql(sql, db_batch_rows);
+
+    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &device_counters_batch_stmt, 
+            &device_counters_batch_pz);
+
+    if (r != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare batched database insert for device "
+                "counters in " + ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
     sql =
         "INSERT INTO packets "
         "(ts_sec, ts_usec, phyname, "
@@ -751,6 +1137,17 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
+    sql = batch_insert_sql(sql, db_batch_rows);
+
+    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &packet_batch_stmt, &packet_batch_pz);
+
+    if (r != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare batched database insert for packets in " +
+                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
     sql =
         "INSERT INTO data "
         "(ts_sec, ts_usec, "
@@ -769,6 +1166,17 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
+    sql = batch_insert_sql(sql, db_batch_rows);
+
+    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &data_batch_stmt, &data_batch_pz);
+
+    if (r != SQLITE_OK) {
+        _MSG("kis_database_logfile unable to prepare batched database insert for data in " +
+                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+        close_log();
+        return -1;
+    }
+
     sql =
         "INSERT INTO datasources "
         "(uuid, "
@@ -887,101 +1295,347 @@ void kis_database_logfile::process_message(std::string in_msg, int in_flags) {
 }
 
 int kis_database_logfile::log_device(std::shared_ptr<kis_tracked_device_base> d) {
-    // We avoid using external mutexes here and try to let sqlite3 handle its own
-    // internal locking state; we don't want a huge device list write to block packet
-    // writes for instance
+    // Devices are serialized by the caller, but written by the writer thread; we don't
+    // want a huge device list write to block packet writes for instance
     
     if (!db_enabled)
         return 0;
 
-    std::string sql;
-
-    std::string phystring;
-    std::string macstring;
-    std::string typestring;
-    std::string keystring;
-
     if (d == nullptr)
         return 0;
 
     if (device_mac_filter->filter(d->get_macaddr(), d->get_phyid()))
         return 0;
 
-    phystring = d->get_phyname();
-    macstring = d->get_macaddr().mac_to_string();
-    typestring = d->get_type_string();
-    keystring = d->get_key().as_string();
+    bool full_record = true;
+
+    if (device_incremental) {
+        auto internal_id = d->get_kis_internal_id();
+        auto generation = d->get_content_generation();
+        auto now = time(0);
+
+        std::lock_guard<std::mutex> lk(device_log_state_mutex);
+
+        // A device whose last full record is older than the full rate gets a full record
+        // next time anyhow, so dropping its state changes nothing; sweeping them keeps
+        // removed and evicted devices from accumulating forever
+        if (now - device_log_state_swept >= (time_t) device_full_rate) {
+            for (auto si = device_log_states.begin(); si != device_log_states.end(); ) {
+                if (now - si->second.full_ts >= (time_t) device_full_rate)
+                    si = device_log_states.erase(si);
+                else
+                    ++si;
+            }
+
+            device_log_state_swept = now;
+        }
+
+        auto state = device_log_states.find(d->get_key());
+
+        if (state != device_log_states.end() && state->second.internal_id == internal_id &&
+                state->second.generation == generation &&
+                now - state->second.full_ts < (time_t) device_full_rate) {
+            full_record = false;
+        } else {
+            device_log_states[d->get_key()] = device_log_state{internal_id, generation, now};
+        }
+    }
+
+    device_counters_row counters_row;
 
-    int spos = 1;
+    if (device_incremental) {
+        counters_row.keystring = d->get_key().as_string();
+        counters_row.phystring = d->get_phyname();
+        counters_row.macstring = d->get_macaddr().mac_to_string();
+        counters_row.last_time = d->get_last_time();
+        counters_row.packets = d->get_packets();
+        counters_row.datasize = d->get_datasize();
+        counters_row.max_signal = d->get_signal_data()->get_max_signal();
+    }
+
+    if (!full_record) {
+        writer_devices_incremental++;
+
+        std::unique_lock<std::mutex> lk(writer_mutex);
+
+        if (writer_device_counters.size() >= writer_queue_max) {
+            writer_backpressure++;
+
+            writer_space_cv.wait(lk, [this] {
+                return writer_device_counters.size() < writer_queue_max || 
+                    writer_shutdown || !db_enabled;
+            });
+        }
+
+        if (writer_shutdown || !db_enabled)
+            return 0;
+
+        writer_device_counters.push_back(std::move(counters_row));
+        writer_cv.notify_one();
+
+        return 1;
+    }
+
+    writer_devices_full++;
+
+    device_row row;
+
+    row.first_time = d->get_first_time();
+    row.last_time = d->get_last_time();
+    row.keystring = d->get_key().as_string();
+    row.phystring = d->get_phyname();
+    row.macstring = d->get_macaddr().mac_to_string();
+    row.max_signal = d->get_signal_data()->get_max_signal();
+
+    if (d->get_tracker_location() != NULL) {
+        row.min_lat = d->get_location()->get_min_loc()->get_lat();
+        row.min_lon = d->get_location()->get_min_loc()->get_lon();
+        row.max_lat = d->get_location()->get_max_loc()->get_lat();
+        row.max_lon = d->get_location()->get_max_loc()->get_lon();
+        row.avg_lat = d->get_location()->get_avg_loc()->get_lat();
+        row.avg_lon = d->get_location()->get_avg_loc()->get_lon();
+    } else {
+        // Empty location
+        row.min_lat = row.min_lon = row.max_lat = row.max_lon = row.avg_lat = row.avg_lon = 0;
+    }
+
+    row.datasize = d->get_datasize();
+    row.typestring = d->get_type_string();
 
     std::stringstream sstr;
 
     // serialize the device
-    int r = Globalreg::globalreg->entrytracker->serialize("json", sstr, d, nullptr);
+    int r = Globalreg::globalreg->entrytracker->serialize(device_format, sstr, d, nullptr);
    
     if (r < 0) {
         _MSG_ERROR("Failure serializing device key {} to the kisdatabaselog", d->get_key());
         return 0;
     }
 
+    row.json = sstr.str();
+
+    // Device records aren't dropped; wait for the writer to make room
+    {
+        std::unique_lock<std::mutex> lk(writer_mutex);
+
+        if (writer_devices.size() >= writer_queue_max ||
+                writer_device_counters.size() >= writer_queue_max) {
+            writer_backpressure++;
+
+            writer_space_cv.wait(lk, [this] {
+                return (writer_devices.size() < writer_queue_max &&
+                        writer_device_counters.size() < writer_queue_max) || 
+                    writer_shutdown || !db_enabled;
+            });
+        }
+
+        if (writer_shutdown || !db_enabled)
+            return 0;
+
+        writer_devices.push_back(std::move(row));
+
+        // Keep the counters table complete, so that it always holds the newest
+        // counters for every device in incremental mode
+        if (device_incremental)
+            writer_device_counters.push_back(std::move(counters_row));
+
+        writer_cv.notify_one();
+    }
+
+    return 1;
+}
+
+bool kis_database_logfile::spill_devices(const std::vector<std::shared_ptr<kis_tracked_device_base>>& devices) {
+    {
+        std::lock_guard<std::mutex> lk(writer_mutex);
+
+        if (writer_shutdown || !db_enabled)
+            return false;
+
+        for (auto d : devices) {
+            writer_spill_ops.push_back(spill_op{d->get_key(), d});
+            writer_spilled[d->get_key()] = d;
+        }
+    }
+
+    writer_cv.notify_one();
+
+    return true;
+}
+
+std::shared_ptr<kis_tracked_device_base> kis_database_logfile::unspill_device(const device_key& key,
+        std::string& out_stored) {
+    out_stored.clear();
+
+    // A device the writer hasn't stored yet is handed back as-is; the removal is queued
+    // behind the spill in case the writer is storing it now
+    {
+        std::lock_guard<std::mutex> lk(writer_mutex);
+
+        if (writer_shutdown || !db_enabled)
+            return nullptr;
+
+        auto si = writer_spilled.find(key);
+
+        if (si != writer_spilled.end()) {
+            auto device = si->second;
+            writer_spilled.erase(si);
+            writer_spill_ops.push_back(spill_op{key, nullptr});
+            writer_cv.notify_one();
+            return device;
+        }
+    }
 
-    std::string streamstring = sstr.str();
+    auto keystring = key.as_string();
 
     {
         local_demand_locker dblock(&ds_mutex);
-        db_lock_with_sync_check(dblock, return -1);
+        db_lock_with_sync_check(dblock, return nullptr);
 
-        sqlite3_reset(device_stmt);
-
-        sqlite3_bind_int64(device_stmt, spos++, d->get_first_time());
-        sqlite3_bind_int64(device_stmt, spos++, d->get_last_time());
-        sqlite3_bind_text(device_stmt, spos++, keystring.c_str(), 
-                keystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(device_stmt, spos++, phystring.c_str(), 
-                phystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(device_stmt, spos++, macstring.c_str(), 
-                macstring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_int(device_stmt, spos++, d->get_signal_data()->get_max_signal());
-
-        if (d->get_tracker_location() != NULL) {
-            sqlite3_bind_double(device_stmt, spos++, 
-                    d->get_location()->get_min_loc()->get_lat());
-            sqlite3_bind_double(device_stmt, spos++,
-                    d->get_location()->get_min_loc()->get_lon());
-            sqlite3_bind_double(device_stmt, spos++,
-                    d->get_location()->get_max_loc()->get_lat());
-            sqlite3_bind_double(device_stmt, spos++,
-                    d->get_location()->get_max_loc()->get_lon());
-            sqlite3_bind_double(device_stmt, spos++,
-                    d->get_location()->get_avg_loc()->get_lat());
-            sqlite3_bind_double(device_stmt, spos++,
-                    d->get_location()->get_avg_loc()->get_lon());
-        } else {
-            // Empty location
-            sqlite3_bind_double(device_stmt, spos++, 0);
-            sqlite3_bind_double(device_stmt, spos++, 0);
-            sqlite3_bind_double(device_stmt, spos++, 0);
-            sqlite3_bind_double(device_stmt, spos++, 0);
-            sqlite3_bind_double(device_stmt, spos++, 0);
-            sqlite3_bind_double(device_stmt, spos++, 0);
+        sqlite3_stmt *stmt = NULL;
+        const char *pz = NULL;
+
+        std::string sql = "SELECT device FROM spilled_devices WHERE devkey = ?";
+
+        if (sqlite3_prepare(db, sql.c_str(), sql.length(), &stmt, &pz) != SQLITE_OK)
+            return nullptr;
+
+        sqlite3_bind_text(stmt, 1, keystring.c_str(), keystring.length(), SQLITE_TRANSIENT);
+
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto blob = (const char *) sqlite3_column_blob(stmt, 0);
+            auto len = sqlite3_column_bytes(stmt, 0);
+
+            if (blob != nullptr)
+                out_stored.assign(blob, len);
         }
 
-        sqlite3_bind_int64(device_stmt, spos++, d->get_datasize());
-        sqlite3_bind_text(device_stmt, spos++, typestring.c_str(), 
-                typestring.length(), SQLITE_TRANSIENT);
+        sqlite3_finalize(stmt);
+    }
 
-        sqlite3_bind_blob(device_stmt, spos++, streamstring.c_str(), 
-                streamstring.length(), SQLITE_TRANSIENT);
+    if (out_stored.length() == 0)
+        return nullptr;
 
-        if (sqlite3_step(device_stmt) != SQLITE_DONE) {
-            _MSG("kis_database_logfile unable to insert device in " +
-                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-            close_log();
-            return -1;
+    // The writer removes the stored record
+    {
+        std::lock_guard<std::mutex> lk(writer_mutex);
+
+        if (!writer_shutdown && db_enabled) {
+            writer_spill_ops.push_back(spill_op{key, nullptr});
+            writer_cv.notify_one();
         }
     }
 
-    return 1;
+    return nullptr;
+}
+
+std::vector<device_key> kis_database_logfile::expire_spilled_devices(time_t in_before) {
+    std::vector<device_key> ret;
+
+    local_demand_locker dblock(&ds_mutex);
+    db_lock_with_sync_check(dblock, return ret);
+
+    sqlite3_stmt *stmt = NULL;
+    const char *pz = NULL;
+
+    std::string sql = "SELECT devkey FROM spilled_devices WHERE last_time < ?";
+
+    if (sqlite3_prepare(db, sql.c_str(), sql.length(), &stmt, &pz) != SQLITE_OK)
+        return ret;
+
+    sqlite3_bind_int64(stmt, 1, in_before);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto keystr = (const char *) sqlite3_column_text(stmt, 0);
+
+        if (keystr == nullptr)
+            continue;
+
+        auto key = device_key(std::string(keystr));
+
+        if (!key.get_error())
+            ret.push_back(key);
+    }
+
+    sqlite3_finalize(stmt);
+
+    sql = "DELETE FROM spilled_devices WHERE last_time < ?";
+
+    if (sqlite3_prepare(db, sql.c_str(), sql.length(), &stmt, &pz) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, in_before);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
+    return ret;
+}
+
+int kis_database_logfile::write_spills(const std::vector<spill_row>& spills) {
+    if (spills.size() == 0)
+        return 1;
+
+    sqlite3_stmt *insert_stmt = NULL;
+    sqlite3_stmt *delete_stmt = NULL;
+    const char *pz = NULL;
+
+    std::string sql = 
+        "INSERT INTO spilled_devices "
+        "(devkey, phyname, devmac, last_time, device) "
+        "VALUES (?, ?, ?, ?, ?)";
+
+    if (sqlite3_prepare(db, sql.c_str(), sql.length(), &insert_stmt, &pz) != SQLITE_OK) {
+        _MSG_ERROR("kis_database_logfile unable to prepare insert for spilled devices in {}: {}",
+                ds_dbfile, sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sql = "DELETE FROM spilled_devices WHERE devkey = ?";
+
+    if (sqlite3_prepare(db, sql.c_str(), sql.length(), &delete_stmt, &pz) != SQLITE_OK) {
+        _MSG_ERROR("kis_database_logfile unable to prepare delete for spilled devices in {}: {}",
+                ds_dbfile, sqlite3_errmsg(db));
+        sqlite3_finalize(insert_stmt);
+        return -1;
+    }
+
+    int r = 1;
+
+    for (const auto& row : spills) {
+        if (row.remove) {
+            sqlite3_reset(delete_stmt);
+            sqlite3_bind_text(delete_stmt, 1, row.keystring.c_str(), row.keystring.length(), 
+                    SQLITE_TRANSIENT);
+
+            if (sqlite3_step(delete_stmt) != SQLITE_DONE) {
+                _MSG_ERROR("kis_database_logfile unable to remove spilled device in {}: {}",
+                        ds_dbfile, sqlite3_errmsg(db));
+                r = -1;
+                break;
+            }
+
+            continue;
+        }
+
+        sqlite3_reset(insert_stmt);
+
+        sqlite3_bind_text(insert_stmt, 1, row.keystring.c_str(), row.keystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert_stmt, 2, row.phystring.c_str(), row.phystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert_stmt, 3, row.macstring.c_str(), row.macstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(insert_stmt, 4, row.last_time);
+        sqlite3_bind_blob(insert_stmt, 5, row.storage.data(), row.storage.length(), SQLITE_TRANSIENT);
+
+        if (sqlite3_step(insert_stmt) != SQLITE_DONE) {
+            _MSG_ERROR("kis_database_logfile unable to insert spilled device in {}: {}",
+                    ds_dbfile, sqlite3_errmsg(db));
+            r = -1;
+            break;
+        }
+    }
+
+    sqlite3_finalize(insert_stmt);
+    sqlite3_finalize(delete_stmt);
+
+    return r;
 }
 
 int kis_database_logfile::log_packet(kis_packet *in_pack) {
@@ -1051,52 +1705,39 @@ int kis_database_logfile::log_packet(kis_packet *in_pack) {
 
     // Log into the PACKET table if we're a loggable packet (ie, have a link frame)
     if (chunk != nullptr) {
-        local_demand_locker dblock(&ds_mutex);
-        db_lock_with_sync_check(dblock, return -1);
-
-        sqlite3_reset(packet_stmt);
+        packet_row row;
 
-        int sql_pos = 1;
+        row.ts_sec = in_pack->ts.tv_sec;
+        row.ts_usec = in_pack->ts.tv_usec;
 
-        sqlite3_bind_int64(packet_stmt, sql_pos++, in_pack->ts.tv_sec);
-        sqlite3_bind_int64(packet_stmt, sql_pos++, in_pack->ts.tv_usec);
-
-        sqlite3_bind_text(packet_stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, deststring.c_str(), deststring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, transstring.c_str(), transstring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, keystring.c_str(), keystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_double(packet_stmt, sql_pos++, frequency);
+        row.phystring = phystring;
+        row.macstring = macstring;
+        row.deststring = deststring;
+        row.transstring = transstring;
+        row.keystring = keystring;
+        row.frequency = frequency;
 
         if (gpsdata != NULL) {
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->lat);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->lon);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->alt);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->speed);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->heading);
+            row.lat = gpsdata->lat;
+            row.lon = gpsdata->lon;
+            row.alt = gpsdata->alt;
+            row.speed = gpsdata->speed;
+            row.heading = gpsdata->heading;
         } else {
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
+            row.lat = row.lon = row.alt = row.speed = row.heading = 0;
         }
 
-        sqlite3_bind_int64(packet_stmt, sql_pos++, chunk->length);
-
-        if (radioinfo != nullptr) {
-            sqlite3_bind_int(packet_stmt, sql_pos++, radioinfo->signal_dbm);
-        } else {
-            sqlite3_bind_int(packet_stmt, sql_pos++, 0);
-        }
+        row.packet_len = chunk->length;
 
-        sqlite3_bind_text(packet_stmt, sql_pos++, sourceuuidstring.c_str(), 
-                sourceuuidstring.length(), SQLITE_TRANSIENT);
+        if (radioinfo != nullptr)
+            row.signal = radioinfo->signal_dbm;
+        else
+            row.signal = 0;
 
-        sqlite3_bind_int(packet_stmt, sql_pos++, chunk->dlt);
-        sqlite3_bind_blob(packet_stmt, sql_pos++, (const char *) chunk->data, chunk->length, 0);
-
-        sqlite3_bind_int(packet_stmt, sql_pos++, in_pack->error);
+        row.sourceuuidstring = sourceuuidstring;
+        row.dlt = chunk->dlt;
+        row.packet = std::string((const char *) chunk->data, chunk->length);
+        row.error = in_pack->error;
 
         std::stringstream tagstream;
         bool space_needed = false;
@@ -1108,13 +1749,19 @@ int kis_database_logfile::log_packet(kis_packet *in_pack) {
             tagstream << tag;
         }
 
-        sqlite3_bind_text(packet_stmt, sql_pos++, tagstream.str().c_str(), tagstream.str().length(), SQLITE_TRANSIENT);
+        row.tags = tagstream.str();
 
-        if (sqlite3_step(packet_stmt) != SQLITE_DONE) {
-            _MSG("kis_database_logfile unable to insert packet in " +
-                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-            close_log();
-            return -1;
+        // Never stall the packet chain on the disk; if the writer is too far behind,
+        // drop the row and count it
+        {
+            std::lock_guard<std::mutex> lk(writer_mutex);
+
+            if (writer_shutdown || writer_packets.size() >= writer_queue_max) {
+                writer_rows_dropped++;
+            } else {
+                writer_packets.push_back(std::move(row));
+                writer_cv.notify_one();
+            }
         }
     }
 
@@ -1144,48 +1791,38 @@ int kis_database_logfile::log_data(kis_gps_packinfo *gps, struct timeval tv,
     if (!db_enabled)
         return 0;
 
-    std::string macstring = devmac.mac_to_string();
-    std::string uuidstring = datasource_uuid.uuid_to_string();
+    data_row row;
 
-    {
-        local_demand_locker dblock(&ds_mutex);
-        db_lock_with_sync_check(dblock, return -1);
+    row.ts_sec = tv.tv_sec;
+    row.ts_usec = tv.tv_usec;
 
-        sqlite3_reset(data_stmt);
+    row.phystring = phystring;
+    row.macstring = devmac.mac_to_string();
 
-        int sql_pos = 1;
+    if (gps != NULL) {
+        row.lat = gps->lat;
+        row.lon = gps->lon;
+        row.alt = gps->alt;
+        row.speed = gps->speed;
+        row.heading = gps->heading;
+    } else {
+        row.lat = row.lon = row.alt = row.speed = row.heading = 0;
+    }
 
-        sqlite3_bind_int64(data_stmt, sql_pos++, tv.tv_sec);
-        sqlite3_bind_int64(data_stmt, sql_pos++, tv.tv_usec);
+    row.uuidstring = datasource_uuid.uuid_to_string();
+    row.type = type;
+    row.json = json;
 
-        sqlite3_bind_text(data_stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(data_stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
+    {
+        std::lock_guard<std::mutex> lk(writer_mutex);
 
-        if (gps != NULL) {
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->lat);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->lon);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->alt);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->speed);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->heading);
-        } else {
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
+        if (writer_shutdown || writer_data.size() >= writer_queue_max) {
+            writer_rows_dropped++;
+            return 0;
         }
 
-        sqlite3_bind_text(data_stmt, sql_pos++, uuidstring.c_str(), uuidstring.length(), SQLITE_TRANSIENT);
-
-        sqlite3_bind_text(data_stmt, sql_pos++, type.data(), type.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(data_stmt, sql_pos++, json.data(), json.length(), SQLITE_TRANSIENT);
-
-        if (sqlite3_step(data_stmt) != SQLITE_DONE) {
-            _MSG("kis_database_logfile unable to insert data in " +
-                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-            close_log();
-            return -1;
-        }
+        writer_data.push_back(std::move(row));
+        writer_cv.notify_one();
     }
 
     return 1;
@@ -1358,6 +1995,422 @@ int kis_database_logfile::packet_handler(CHAINCALL_PARMS) {
     return logfile->log_packet(in_pack);
 }
 
+int kis_database_logfile::bind_packet_row(sqlite3_stmt *stmt, int pos, const packet_row& row) {
+    // Rows are held until the statement has been stepped, so nothing needs to be copied
+    sqlite3_bind_int64(stmt, pos++, row.ts_sec);
+    sqlite3_bind_int64(stmt, pos++, row.ts_usec);
+
+    sqlite3_bind_text(stmt, pos++, row.phystring.data(), row.phystring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.macstring.data(), row.macstring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.deststring.data(), row.deststring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.transstring.data(), row.transstring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.keystring.data(), row.keystring.length(), SQLITE_STATIC);
+    sqlite3_bind_double(stmt, pos++, row.frequency);
+
+    sqlite3_bind_double(stmt, pos++, row.lat);
+    sqlite3_bind_double(stmt, pos++, row.lon);
+    sqlite3_bind_double(stmt, pos++, row.alt);
+    sqlite3_bind_double(stmt, pos++, row.speed);
+    sqlite3_bind_double(stmt, pos++, row.heading);
+
+    sqlite3_bind_int64(stmt, pos++, row.packet_len);
+    sqlite3_bind_int(stmt, pos++, row.signal);
+
+    sqlite3_bind_text(stmt, pos++, row.sourceuuidstring.data(), 
+            row.sourceuuidstring.length(), SQLITE_STATIC);
+
+    sqlite3_bind_int(stmt, pos++, row.dlt);
+    sqlite3_bind_blob(stmt, pos++, row.packet.data(), row.packet.length(), SQLITE_STATIC);
+
+    sqlite3_bind_int(stmt, pos++, row.error);
+
+    sqlite3_bind_text(stmt, pos++, row.tags.data(), row.tags.length(), SQLITE_STATIC);
+
+    return pos;
+}
+
+int kis_database_logfile::bind_data_row(sqlite3_stmt *stmt, int pos, const data_row& row) {
+    sqlite3_bind_int64(stmt, pos++, row.ts_sec);
+    sqlite3_bind_int64(stmt, pos++, row.ts_usec);
+
+    sqlite3_bind_text(stmt, pos++, row.phystring.data(), row.phystring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.macstring.data(), row.macstring.length(), SQLITE_STATIC);
+
+    sqlite3_bind_double(stmt, pos++, row.lat);
+    sqlite3_bind_double(stmt, pos++, row.lon);
+    sqlite3_bind_double(stmt, pos++, row.alt);
+    sqlite3_bind_double(stmt, pos++, row.speed);
+    sqlite3_bind_double(stmt, pos++, row.heading);
+
+    sqlite3_bind_text(stmt, pos++, row.uuidstring.data(), row.uuidstring.length(), SQLITE_STATIC);
+
+    sqlite3_bind_text(stmt, pos++, row.type.data(), row.type.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.json.data(), row.json.length(), SQLITE_STATIC);
+
+    return pos;
+}
+
+int kis_database_logfile::bind_device_row(sqlite3_stmt *stmt, int pos, const device_row& row) {
+    sqlite3_bind_int64(stmt, pos++, row.first_time);
+    sqlite3_bind_int64(stmt, pos++, row.last_time);
+    sqlite3_bind_text(stmt, pos++, row.keystring.data(), row.keystring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.phystring.data(), row.phystring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.macstring.data(), row.macstring.length(), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, pos++, row.max_signal);
+
+    sqlite3_bind_double(stmt, pos++, row.min_lat);
+    sqlite3_bind_double(stmt, pos++, row.min_lon);
+    sqlite3_bind_double(stmt, pos++, row.max_lat);
+    sqlite3_bind_double(stmt, pos++, row.max_lon);
+    sqlite3_bind_double(stmt, pos++, row.avg_lat);
+    sqlite3_bind_double(stmt, pos++, row.avg_lon);
+
+    sqlite3_bind_int64(stmt, pos++, row.datasize);
+    sqlite3_bind_text(stmt, pos++, row.typestring.data(), row.typestring.length(), SQLITE_STATIC);
+
+    sqlite3_bind_blob(stmt, pos++, row.json.data(), row.json.length(), SQLITE_STATIC);
+
+    return pos;
+}
+
+int kis_database_logfile::bind_device_counters_row(sqlite3_stmt *stmt, int pos, 
+        const device_counters_row& row) {
+    sqlite3_bind_text(stmt, pos++, row.keystring.data(), row.keystring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.phystring.data(), row.phystring.length(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, pos++, row.macstring.data(), row.macstring.length(), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, pos++, row.last_time);
+    sqlite3_bind_int64(stmt, pos++, row.packets);
+    sqlite3_bind_int64(stmt, pos++, row.datasize);
+    sqlite3_bind_int(stmt, pos++, row.max_signal);
+
+    return pos;
+}
+
+// Insert rows as full multi-row batches, and the remainder one row at a time
+template<typename R>
+static int write_batched_rows(const std::vector<R>& rows, sqlite3_stmt *batch_stmt,
+        sqlite3_stmt *single_stmt, unsigned int batch_rows,
+        int (*bind)(sqlite3_stmt *, int, const R&)) {
+
+    size_t i = 0;
+
+    if (batch_stmt != NULL) {
+        for (; i + batch_rows <= rows.size(); i += batch_rows) {
+            sqlite3_reset(batch_stmt);
+
+            int pos = 1;
+            for (unsigned int b = 0; b < batch_rows; b++)
+                pos = (*bind)(batch_stmt, pos, rows[i + b]);
+
+            if (sqlite3_step(batch_stmt) != SQLITE_DONE)
+                return -1;
+        }
+    }
+
+    for (; i < rows.size(); i++) {
+        sqlite3_reset(single_stmt);
+
+        (*bind)(single_stmt, 1, rows[i]);
+
+        if (sqlite3_step(single_stmt) != SQLITE_DONE)
+            return -1;
+    }
+
+    return 1;
+}
+
+int kis_database_logfile::write_rows(std::vector<packet_row>& packets, 
+        std::vector<data_row>& data, std::vector<device_row>& devices,
+        std::vector<device_counters_row>& counters) {
+
+    if (write_batched_rows(packets, packet_batch_stmt, packet_stmt, db_batch_rows,
+                &kis_database_logfile::bind_packet_row) < 0) {
+        _MSG_ERROR("kis_database_logfile unable to insert packets in {}: {}", ds_dbfile, 
+                sqlite3_errmsg(db));
+        return -1;
+    }
+
+    if (write_batched_rows(data, data_batch_stmt, data_stmt, db_batch_rows,
+                &kis_database_logfile::bind_data_row) < 0) {
+        _MSG_ERROR("kis_database_logfile unable to insert data in {}: {}", ds_dbfile, 
+                sqlite3_errmsg(db));
+        return -1;
+    }
+
+    if (write_batched_rows(devices, device_batch_stmt, device_stmt, db_batch_rows,
+                &kis_database_logfile::bind_device_row) < 0) {
+        _MSG_ERROR("kis_database_logfile unable to insert devices in {}: {}", ds_dbfile, 
+                sqlite3_errmsg(db));
+        return -1;
+    }
+
+    if (write_batched_rows(counters, device_counters_batch_stmt, device_counters_stmt, 
+                db_batch_rows, &kis_database_logfile::bind_device_counters_row) < 0) {
+        _MSG_ERROR("kis_database_logfile unable to insert device counters in {}: {}", 
+                ds_dbfile, sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return 1;
+}
+
+void kis_database_logfile::start_writer() {
+    std::lock_guard<std::mutex> lk(writer_mutex);
+
+    if (writer_thread.joinable())
+        return;
+
+    writer_shutdown = false;
+
+    writer_thread = std::thread([this]() {
+            thread_set_process_name("kismetdb");
+            writer_thread_func();
+            });
+}
+
+void kis_database_logfile::stop_writer() {
+    {
+        std::lock_guard<std::mutex> lk(writer_mutex);
+        writer_shutdown = true;
+    }
+
+    writer_cv.notify_all();
+    writer_space_cv.notify_all();
+
+    // The writer closes the log itself when a write fails, and can't wait on itself;
+    // the thread is joined when the log is closed again on destruction
+    if (writer_thread.joinable() && writer_thread.get_id() != std::this_thread::get_id())
+        writer_thread.join();
+}
+
+void kis_database_logfile::writer_failed(const std::string& in_error, size_t in_lost_rows) {
+    size_t queued;
+
+    // Stop accepting rows and discard anything still queued; setting the state under 
+    // the writer lock guarantees that any producer waiting for space sees it
+    {
+        std::lock_guard<std::mutex> lk(writer_mutex);
+
+        db_enabled = false;
+        writer_shutdown = true;
+
+        queued = writer_packets.size() + writer_data.size() + writer_devices.size() +
+            writer_device_counters.size() + writer_spill_ops.size();
+
+        writer_packets.clear();
+        writer_data.clear();
+        writer_devices.clear();
+        writer_device_counters.clear();
+        writer_spill_ops.clear();
+        writer_spilled.clear();
+    }
+
+    writer_space_cv.notify_all();
+
+    writer_rows_dropped += queued + in_lost_rows;
+
+    _MSG_ERROR("kismetdb log {} could not be written and will be closed, {} queued rows "
+            "were discarded: {}", ds_dbfile, queued + in_lost_rows, in_error);
+
+    try {
+        close_log();
+    } catch (const std::exception& e) {
+        _MSG_ERROR("kismetdb log {} could not be closed cleanly: {}", ds_dbfile, e.what());
+    }
+}
+
+void kis_database_logfile::writer_thread_func() {
+    std::vector<packet_row> packets;
+    std::vector<data_row> data;
+    std::vector<device_row> devices;
+    std::vector<device_counters_row> counters;
+    std::vector<spill_op> spill_ops;
+    std::vector<spill_row> spills;
+
+    while (1) {
+        bool shutdown;
+
+        {
+            std::unique_lock<std::mutex> lk(writer_mutex);
+
+            writer_cv.wait(lk, [this] {
+                return writer_shutdown || writer_packets.size() > 0 || 
+                    writer_data.size() > 0 || writer_devices.size() > 0 ||
+                    writer_device_counters.size() > 0 || writer_spill_ops.size() > 0;
+            });
+
+            shutdown = writer_shutdown;
+
+            // Take everything queued so far in one go; producers can keep queuing 
+            // while we write
+            packets.swap(writer_packets);
+            data.swap(writer_data);
+            devices.swap(writer_devices);
+            counters.swap(writer_device_counters);
+            spill_ops.swap(writer_spill_ops);
+        }
+
+        writer_space_cv.notify_all();
+
+        // Serialize spilled devices before taking the database lock
+        for (const auto& op : spill_ops) {
+            spill_row row;
+
+            row.keystring = op.key.as_string();
+            row.last_time = 0;
+            row.remove = op.device == nullptr;
+
+            if (!row.remove) {
+                std::stringbuf sbuf;
+
+                {
+                    zstr::ostreambuf zobuf(&sbuf, 1 << 16, true);
+                    std::ostream zstream(&zobuf);
+
+                    local_shared_locker devlocker(&op.device->device_mutex);
+                    storage_msgpack_adapter::pack(zstream, op.device);
+
+                    row.phystring = op.device->get_phyname();
+                    row.macstring = op.device->get_macaddr().mac_to_string();
+                    row.last_time = op.device->get_last_time();
+
+                    zstream.flush();
+                    zobuf.pubsync();
+                }
+
+                row.storage = sbuf.str();
+            }
+
+            spills.push_back(std::move(row));
+        }
+
+        size_t n_rows = packets.size() + data.size() + devices.size() + counters.size() +
+            spills.size();
+
+        if (n_rows > 0 && db_enabled) {
+            auto start = std::chrono::steady_clock::now();
+            int r;
+            std::string err;
+
+            try {
+                local_demand_locker dblock(&ds_mutex);
+                db_lock_with_sync_check(dblock, return);
+
+                r = write_rows(packets, data, devices, counters);
+
+                if (r >= 0)
+                    r = write_spills(spills);
+
+                if (r >= 0) {
+                    // Roughly account for the payload we've added to the transaction;
+                    // the fixed columns are small compared to packets and json
+                    unsigned long n_bytes = 0;
+
+                    for (const auto& p : packets)
+                        n_bytes += p.packet.length() + 128;
+                    for (const auto& d : data)
+                        n_bytes += d.json.length() + 128;
+                    for (const auto& d : devices)
+                        n_bytes += d.json.length() + 128;
+                    for (const auto& s : spills)
+                        n_bytes += s.storage.length() + 128;
+                    n_bytes += counters.size() * 64;
+
+                    uncommitted_rows += n_rows;
+                    uncommitted_bytes += n_bytes;
+
+                    if ((commit_rows_max != 0 && uncommitted_rows >= commit_rows_max) ||
+                            (commit_bytes_max != 0 && uncommitted_bytes >= commit_bytes_max))
+                        commit_transaction();
+                }
+            } catch (const std::exception& e) {
+                // A disk too slow to complete a transaction has already been flagged as
+                // fatal by the lock check
+                r = -1;
+                err = e.what();
+            }
+
+            if (r < 0) {
+                if (err.length() == 0)
+                    err = "unable to insert rows";
+
+                writer_failed(err, n_rows);
+                return;
+            }
+
+            uint64_t flush_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+
+            writer_rows_written += n_rows;
+            writer_flushes++;
+            writer_flush_last_us = flush_us;
+            writer_flush_total_us += flush_us;
+
+            if (flush_us > writer_flush_max_us)
+                writer_flush_max_us = flush_us;
+
+            // Spilled devices which have been written are restored from the log now,
+            // unless they were restored or spilled again in the meantime
+            if (spill_ops.size() > 0) {
+                std::lock_guard<std::mutex> lk(writer_mutex);
+
+                for (const auto& op : spill_ops) {
+                    if (op.device == nullptr)
+                        continue;
+
+                    auto si = writer_spilled.find(op.key);
+
+                    if (si != writer_spilled.end() && si->second == op.device)
+                        writer_spilled.erase(si);
+                }
+            }
+        }
+
+        packets.clear();
+        data.clear();
+        devices.clear();
+        counters.clear();
+        spill_ops.clear();
+        spills.clear();
+
+        if (shutdown)
+            break;
+    }
+}
+
+std::shared_ptr<tracker_element> kis_database_logfile::writer_stats_endp_handler() {
+    auto ret = std::make_shared<tracker_element_map>();
+
+    uint64_t queued;
+
+    {
+        std::lock_guard<std::mutex> lk(writer_mutex);
+        queued = writer_packets.size() + writer_data.size() + writer_devices.size() +
+            writer_device_counters.size() + writer_spill_ops.size();
+    }
+
+    uint64_t flushes = writer_flushes;
+    uint64_t avg_us = 0;
+
+    if (flushes > 0)
+        avg_us = writer_flush_total_us / flushes;
+
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_queued_id, queued));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_written_id, writer_rows_written));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_dropped_id, writer_rows_dropped));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_backpressure_id, writer_backpressure));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_flushes_id, flushes));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_flush_last_id, writer_flush_last_us));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_flush_max_id, writer_flush_max_us));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_flush_avg_id, avg_us));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_devices_full_id, 
+                writer_devices_full));
+    ret->insert(std::make_shared<tracker_element_uint64>(writer_devices_incremental_id, 
+                writer_devices_incremental));
+
+    return ret;
+}
+
 void kis_database_logfile::usage(const char *argv0) {
 
 }
@@ -1388,13 +2441,18 @@ int kis_database_logfile::httpd_create_stream_response(kis_net_httpd *httpd,
     }
 
     if (stripped.find("/logging/kismetdb/pcap/") == 0 && suffix == "pcapng") {
-        if (db == nullptr || db_enabled) {
+        // In WAL mode the log is read through its own connection, without blocking the
+        // writer; otherwise only a closed log can be queried
+        std::unique_ptr<sqlite3, int (*)(sqlite3 *)> rdb(open_read_connection(), sqlite3_close);
+        sqlite3 *qdb = rdb != nullptr ? rdb.get() : db;
+
+        if (rdb == nullptr && (db == nullptr || db_enabled)) {
             connection->httpcode = 500;
             return MHD_YES;
         }
 
         using namespace kissqlite3;
-        auto query = _SELECT(db, "packets", {"ts_sec", "ts_usec", "datasource", "dlt", "packet"});
+        auto query = _SELECT(qdb, "packets", {"ts_sec", "ts_usec", "datasource", "dlt", "packet"});
 
         try {
             if (connection->has_cached_variable("timestamp_start"))
@@ -1507,7 +2565,7 @@ int kis_database_logfile::httpd_create_stream_response(kis_net_httpd *httpd,
 
         // Get the list of all the interfaces we know about in the database and push them into the
         // pcapng handler
-        auto datasource_query = _SELECT(db, "datasources", {"uuid", "name", "interface"});
+        auto datasource_query = _SELECT(qdb, "datasources", {"uuid", "name", "interface"});
 
         for (auto ds : datasource_query)  {
             dbrb->add_database_interface(sqlite3_column_as<std::string>(ds, 0),
@@ -1544,8 +2602,18 @@ int kis_database_logfile::httpd_post_complete(kis_net_httpd_connection *concls)
         return MHD_YES;
     }
 
+    std::unique_ptr<sqlite3, int (*)(sqlite3 *)> rdb(nullptr, sqlite3_close);
+    sqlite3 *qdb = db;
+
     if (stripped.find("/logging/kismetdb/pcap/") == 0 && suffix == "pcapng") {
-        if (db == nullptr || db_enabled) {
+        // In WAL mode the log is read through its own connection, without blocking the
+        // writer; otherwise only a closed log can be queried
+        rdb.reset(open_read_connection());
+
+        if (rdb != nullptr)
+            qdb = rdb.get();
+
+        if (rdb == nullptr && (db == nullptr || db_enabled)) {
             concls->httpcode = 500;
             return MHD_YES;
         }
@@ -1593,7 +2661,7 @@ int kis_database_logfile::httpd_post_complete(kis_net_httpd_connection *concls)
     }
 
     using namespace kissqlite3;
-    auto query = _SELECT(db, "packets", {"ts_sec", "ts_usec", "datasource", "dlt", "packet"});
+    auto query = _SELECT(qdb, "packets", {"ts_sec", "ts_usec", "datasource", "dlt", "packet"});
 
     if (filterdata != nullptr) {
         try {
@@ -1722,7 +2790,7 @@ int kis_database_logfile::httpd_post_complete(kis_net_httpd_connection *concls)
 
     // Get the list of all the interfaces we know about in the database and push them into the
     // pcapng handler
-    auto datasource_query = _SELECT(db, "datasources", {"uuid", "name", "interface"});
+    auto datasource_query = _SELECT(qdb, "datasources", {"uuid", "name", "interface"});
 
     for (auto ds : datasource_query)  {
         dbrb->add_database_interface(sqlite3_column_as<std::string>(ds, 0),
@@ -38,8 +38,13 @@
 #include "config.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
@@ -90,9 +95,28 @@ public:
 
     virtual int database_upgrade_db() override;
 
+    // Open a separate read-only connection to the log, for streaming queries which
+    // must not hold the database lock; only available in WAL mode, otherwise
+    // returns null.  The caller closes the connection.
+    sqlite3 *open_read_connection();
+
     // Log a vector of multiple devices, replacing any old device records
     virtual int log_device(std::shared_ptr<kis_tracked_device_base> in_device);
 
+    // Queue devices evicted from the device tracker to be stored, in storage format, so
+    // they can be restored if they are seen again; they are serialized and written by
+    // the writer thread.  Returns false if the log is not accepting records.
+    bool spill_devices(const std::vector<std::shared_ptr<kis_tracked_device_base>>& devices);
+
+    // Fetch and remove a spilled device.  A device still waiting for the writer is 
+    // returned directly; otherwise the stored record is returned in out_stored, which is
+    // left empty if the device was not spilled.
+    std::shared_ptr<kis_tracked_device_base> unspill_device(const device_key& key,
+            std::string& out_stored);
+
+    // Remove spilled devices last seen before a time, returning their keys
+    std::vector<device_key> expire_spilled_devices(time_t in_before);
+
     // Device logs are non-streaming; we need to know the last time we generated
     // device logs so that we can update just the logs we need.
     virtual time_t get_last_device_log_ts() { return last_device_log; }
@@ -167,6 +191,29 @@ protected:
 
     std::atomic<bool> in_transaction_sync;
 
+    // sqlite tuning profile, applied when the log is opened
+    virtual bool database_configure_connection() override;
+
+    std::string db_journal_mode;
+    std::string db_synchronous;
+    unsigned int db_page_size;
+    int db_cache_size;
+    unsigned long db_mmap_size;
+
+    bool db_wal() const {
+        return db_journal_mode == "wal";
+    }
+
+    // Commit the current transaction and start a new one; ds_mutex must be held
+    void commit_transaction();
+
+    // Commit early once this many rows or bytes have been written since the last
+    // commit (0 to only commit on the timer); guarded by ds_mutex
+    unsigned long commit_rows_max;
+    unsigned long commit_bytes_max;
+    unsigned long uncommitted_rows;
+    unsigned long uncommitted_bytes;
+
     // Nasty define hack for checking if we're blocked on a really slow
     // device by comparing the transaction sync
 #define db_lock_with_sync_check(locker, errcode) \
@@ -196,6 +243,25 @@ protected:
 
     sqlite3_stmt *data_stmt;
     const char *data_pz;
+
+    // Multi-row versions of the packet, data, and device inserts, used by the writer
+    // thread to insert db_batch_rows rows per statement
+    const static unsigned int db_batch_rows = 16;
+
+    sqlite3_stmt *packet_batch_stmt;
+    const char *packet_batch_pz;
+
+    sqlite3_stmt *data_batch_stmt;
+    const char *data_batch_pz;
+
+    sqlite3_stmt *device_batch_stmt;
+    const char *device_batch_pz;
+
+    sqlite3_stmt *device_counters_stmt;
+    const char *device_counters_pz;
+
+    sqlite3_stmt *device_counters_batch_stmt;
+    const char *device_counters_batch_pz;
     
     sqlite3_stmt *alert_stmt;
     const char *alert_pz;
@@ -208,10 +274,149 @@ protected:
 
     static int packet_handler(CHAINCALL_PARMS);
 
+    // Packets, data records, and devices are extracted into rows on the calling thread 
+    // and written by a dedicated writer thread, so that a slow disk stalls the writer 
+    // instead of the packet chain.
+    struct packet_row {
+        int64_t ts_sec, ts_usec;
+        std::string phystring, macstring, deststring, transstring, keystring;
+        double frequency;
+        double lat, lon, alt, speed, heading;
+        int64_t packet_len;
+        int signal;
+        std::string sourceuuidstring;
+        unsigned int dlt;
+        std::string packet;
+        int error;
+        std::string tags;
+    };
+
+    struct data_row {
+        int64_t ts_sec, ts_usec;
+        std::string phystring, macstring;
+        double lat, lon, alt, speed, heading;
+        std::string uuidstring, type, json;
+    };
+
+    struct device_row {
+        int64_t first_time, last_time;
+        std::string keystring, phystring, macstring;
+        int max_signal;
+        double min_lat, min_lon, max_lat, max_lon, avg_lat, avg_lon;
+        int64_t datasize;
+        std::string typestring, json;
+    };
+
+    // Narrow record of the fields which change on every packet, written to the 
+    // device_counters table in incremental mode
+    struct device_counters_row {
+        std::string keystring, phystring, macstring;
+        int64_t last_time;
+        int64_t packets;
+        int64_t datasize;
+        int max_signal;
+    };
+
+    // Spilled devices are stored and removed in the order they were queued; a spill
+    // with no device removes the stored record
+    struct spill_op {
+        device_key key;
+        std::shared_ptr<kis_tracked_device_base> device;
+    };
+
+    struct spill_row {
+        std::string keystring, phystring, macstring;
+        int64_t last_time;
+        std::string storage;
+        bool remove;
+    };
+
+    static int bind_packet_row(sqlite3_stmt *stmt, int pos, const packet_row& row);
+    static int bind_data_row(sqlite3_stmt *stmt, int pos, const data_row& row);
+    static int bind_device_row(sqlite3_stmt *stmt, int pos, const device_row& row);
+    static int bind_device_counters_row(sqlite3_stmt *stmt, int pos, 
+            const device_counters_row& row);
+
+    // Bounded queues feeding the writer; packets and data are dropped when the queue
+    // is full, devices wait for space
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    std::condition_variable writer_space_cv;
+    std::thread writer_thread;
+    bool writer_shutdown;
+    size_t writer_queue_max;
+
+    std::vector<packet_row> writer_packets;
+    std::vector<data_row> writer_data;
+    std::vector<device_row> writer_devices;
+    std::vector<device_counters_row> writer_device_counters;
+
+    // Spills aren't bounded, since the tracker can't wait while evicting; spilled 
+    // devices stay in writer_spilled until they're written, so they can be restored
+    // before then
+    std::vector<spill_op> writer_spill_ops;
+    std::unordered_map<device_key, std::shared_ptr<kis_tracked_device_base>> writer_spilled;
+
+    void start_writer();
+    void stop_writer();
+    void writer_thread_func();
+
+    // Called by the writer thread when the log can no longer be written; discards the
+    // queue, wakes any blocked producers, and closes the log
+    void writer_failed(const std::string& in_error, size_t in_lost_rows);
+
+    // Write a batch of rows; returns negative on a database error
+    int write_rows(std::vector<packet_row>& packets, std::vector<data_row>& data,
+            std::vector<device_row>& devices, std::vector<device_counters_row>& counters);
+
+    // Write spilled device records and removals, in order; returns negative on a 
+    // database error
+    int write_spills(const std::vector<spill_row>& spills);
+
+    // Incremental device logging; when enabled, the full device record is only 
+    // re-serialized when the structure of the device has changed (or the full 
+    // refresh interval has passed), otherwise only the counters row is written
+    bool device_incremental;
+    unsigned int device_full_rate;
+
+    // Serializer used for the device records, json or msgpack
+    std::string device_format;
+
+    // A device is unchanged if it is the same device record, by internal id, at the
+    // same content generation
+    struct device_log_state {
+        uint64_t internal_id;
+        uint64_t generation;
+        time_t full_ts;
+    };
+
+    std::mutex device_log_state_mutex;
+    std::unordered_map<device_key, device_log_state> device_log_states;
+    time_t device_log_state_swept;
+
+    // Writer statistics
+    std::atomic<uint64_t> writer_rows_written;
+    std::atomic<uint64_t> writer_rows_dropped;
+    std::atomic<uint64_t> writer_backpressure;
+    std::atomic<uint64_t> writer_flushes;
+    std::atomic<uint64_t> writer_flush_last_us;
+    std::atomic<uint64_t> writer_flush_max_us;
+    std::atomic<uint64_t> writer_flush_total_us;
+    std::atomic<uint64_t> writer_devices_full;
+    std::atomic<uint64_t> writer_devices_incremental;
+
+    int writer_queued_id, writer_written_id, writer_dropped_id, writer_backpressure_id,
+        writer_flushes_id, writer_flush_last_id, writer_flush_max_id, writer_flush_avg_id,
+        writer_devices_full_id, writer_devices_incremental_id;
+
+    std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> writer_stats_endp;
+    std::shared_ptr<tracker_element> writer_stats_endp_handler();
+
     // Keep track of our commit cycles; to avoid thrashing the filesystem with
-    // commit state we run a 10 second tranasction commit loop
+    // commit state we run a tranasction commit loop, 10 seconds by default
     kis_recursive_timed_mutex transaction_mutex;
     int transaction_timer;
+    unsigned int commit_interval;
 
     // Packet time limit
     unsigned int packet_timeout;
@@ -26,6 +26,9 @@
 #include "alertracker.h"
 #include "packetchain.h"
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
 // We never instantiate from a generic tracker component or from a stored
 // record so we always re-allocate ourselves
 kis_datasource::kis_datasource(shared_datasource_builder in_builder, std::shared_ptr<kis_recursive_timed_mutex> mutex) :
@@ -63,6 +66,10 @@ kis_datasource::kis_datasource(shared_datasource_builder in_builder, std::shared
 
     suppress_gps = false;
 
+    clobber_timestamp = false;
+    batch_max_packets = 0;
+    batch_max_latency_ms = 0;
+
     error_timer_id = -1;
     ping_timer_id = -1;
 
@@ -579,6 +586,11 @@ bool kis_datasource::parse_interface_definition(std::string in_definition) {
     clobber_timestamp = get_definition_opt_bool("timestamp", 
             datasourcetracker->get_config_defaults()->get_remote_cap_timestamp());
 
+    batch_max_packets = string_to_n<unsigned int>(get_definition_opt("batch"),
+            datasourcetracker->get_config_defaults()->get_batch_packets());
+    batch_max_latency_ms = string_to_n<unsigned int>(get_definition_opt("batch_latency"),
+            datasourcetracker->get_config_defaults()->get_batch_latency());
+
     set_source_info_antenna_type(get_definition_opt("info_antenna_type"));
     set_source_info_antenna_gain(get_definition_opt_double("info_antenna_gain", 0.0f));
     set_source_info_antenna_orientation(get_definition_opt_double("info_antenna_orientation", 0.0f));
@@ -669,6 +681,10 @@ bool kis_datasource::dispatch_rx_packet(std::shared_ptr<KismetExternal::Command>
     } else if (c->command() == "KDSDATAREPORT") {
         handle_packet_data_report(c->seqno(), c->content());
         return true;
+    } else if (c->command() == "KDSDATAREPORTBATCH") {
+        handle_packet_data_report_batch(c->seqno(), 
+                (const uint8_t *) c->content().data(), c->content().length());
+        return true;
     } else if (c->command() == "KDSERRORREPORT") {
         handle_packet_error_report(c->seqno(), c->content());
         return true;
@@ -691,6 +707,19 @@ bool kis_datasource::dispatch_rx_packet(std::shared_ptr<KismetExternal::Command>
     return false;
 }
 
+bool kis_datasource::dispatch_rx_packet_direct(const std::string& command, uint32_t in_seqno,
+        const uint8_t *in_content, size_t in_content_sz) {
+    if (command == "KDSDATAREPORT") {
+        handle_packet_data_report(in_seqno, in_content, in_content_sz);
+        return true;
+    } else if (command == "KDSDATAREPORTBATCH") {
+        handle_packet_data_report_batch(in_seqno, in_content, in_content_sz);
+        return true;
+    }
+
+    return false;
+}
+
 void kis_datasource::handle_msg_proxy(const std::string& msg, const int type) {
     if (get_source_remote())
         _MSG(fmt::format("{} - {}", get_source_name(), msg), type);
@@ -1136,7 +1165,176 @@ void kis_datasource::handle_packet_configure_report(uint32_t in_seqno, const std
 
 }
 
+// Location of the packet payload inside a data report
+struct data_report_packet {
+    data_report_packet() :
+        present {false},
+        time_sec {0},
+        time_usec {0},
+        dlt {0},
+        data {nullptr},
+        data_sz {0} { }
+
+    bool present;
+    uint64_t time_sec, time_usec;
+    uint32_t dlt;
+    const uint8_t *data;
+    size_t data_sz;
+};
+
+// Parse a DataReport, locating the packet payload in place instead of copying it into the
+// report; all the other fields are small and are merged into the report normally.
+static bool parse_data_report(const uint8_t *in_content, size_t in_content_sz,
+        KismetDatasource::DataReport& report, data_report_packet& packet) {
+    using google::protobuf::internal::WireFormatLite;
+
+    google::protobuf::io::CodedInputStream cis(in_content, in_content_sz);
+    uint32_t tag, len;
+
+    while (1) {
+        int field_start = cis.CurrentPosition();
+
+        if ((tag = cis.ReadTag()) == 0)
+            break;
+
+        if (WireFormatLite::GetTagFieldNumber(tag) != KismetDatasource::DataReport::kPacketFieldNumber) {
+            if (!WireFormatLite::SkipField(&cis, tag))
+                return false;
+
+            // Merge just this field into the report
+            google::protobuf::io::CodedInputStream fcis(in_content + field_start, 
+                    cis.CurrentPosition() - field_start);
+            if (!report.MergePartialFromCodedStream(&fcis))
+                return false;
+
+            continue;
+        }
+
+        if (!cis.ReadVarint32(&len))
+            return false;
+
+        auto limit = cis.PushLimit(len);
+
+        // The SubPacket fields are all required; the framed path rejects a report 
+        // missing any of them when it parses the message, so we must as well
+        bool have_sec = false, have_usec = false, have_dlt = false, have_size = false,
+             have_data = false;
+        uint64_t size;
+
+        while ((tag = cis.ReadTag()) != 0) {
+            switch (WireFormatLite::GetTagFieldNumber(tag)) {
+                case KismetDatasource::SubPacket::kTimeSecFieldNumber:
+                    if (!cis.ReadVarint64(&packet.time_sec))
+                        return false;
+                    have_sec = true;
+                    break;
+                case KismetDatasource::SubPacket::kTimeUsecFieldNumber:
+                    if (!cis.ReadVarint64(&packet.time_usec))
+                        return false;
+                    have_usec = true;
+                    break;
+                case KismetDatasource::SubPacket::kDltFieldNumber:
+                    if (!cis.ReadVarint32(&packet.dlt))
+                        return false;
+                    have_dlt = true;
+                    break;
+                case KismetDatasource::SubPacket::kSizeFieldNumber:
+                    if (!cis.ReadVarint64(&size))
+                        return false;
+                    have_size = true;
+                    break;
+                case KismetDatasource::SubPacket::kDataFieldNumber:
+                    if (!cis.ReadVarint32(&len))
+                        return false;
+
+                    packet.data_sz = len;
+                    packet.data = nullptr;
+
+                    if (len > 0) {
+                        const void *ptr;
+                        int avail;
+
+                        if (!cis.GetDirectBufferPointer(&ptr, &avail) || (uint32_t) avail < len)
+                            return false;
+
+                        packet.data = (const uint8_t *) ptr;
+
+                        if (!cis.Skip(len))
+                            return false;
+                    }
+
+                    have_data = true;
+                    break;
+                default:
+                    if (!WireFormatLite::SkipField(&cis, tag))
+                        return false;
+                    break;
+            }
+        }
+
+        if (!cis.ConsumedEntireMessage() || 
+                !have_sec || !have_usec || !have_dlt || !have_size || !have_data)
+            return false;
+
+        cis.PopLimit(limit);
+
+        packet.present = true;
+    }
+
+    return cis.ConsumedEntireMessage() && report.IsInitialized();
+}
+
+void kis_datasource::handle_packet_data_report_batch(uint32_t in_seqno, const uint8_t *in_content,
+        size_t in_content_sz) {
+    using google::protobuf::internal::WireFormatLite;
+
+    // Each report in the batch is handled exactly as if it had arrived in its own frame,
+    // straight out of the batch buffer
+    google::protobuf::io::CodedInputStream cis(in_content, in_content_sz);
+    uint32_t tag, len;
+
+    while ((tag = cis.ReadTag()) != 0) {
+        if (WireFormatLite::GetTagFieldNumber(tag) != 
+                KismetDatasource::DataReportBatch::kReportsFieldNumber ||
+                WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+            if (!WireFormatLite::SkipField(&cis, tag))
+                break;
+            continue;
+        }
+
+        const void *ptr;
+        int avail;
+
+        if (!cis.ReadVarint32(&len))
+            break;
+
+        if (len == 0) {
+            handle_packet_data_report(in_seqno, nullptr, 0);
+            continue;
+        }
+
+        if (!cis.GetDirectBufferPointer(&ptr, &avail) || (uint32_t) avail < len)
+            break;
+
+        handle_packet_data_report(in_seqno, (const uint8_t *) ptr, len);
+
+        cis.Skip(len);
+    }
+
+    if (!cis.ConsumedEntireMessage()) {
+        _MSG(std::string("Kismet datasource driver ") + get_source_builder()->get_source_type() + 
+                std::string(" could not parse the data report batch, something is wrong with "
+                    "the remote capture tool"), MSGFLAG_ERROR);
+        trigger_error("Invalid KDSDATAREPORTBATCH");
+    }
+}
+
 void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::string& in_content) {
+    handle_packet_data_report(in_seqno, (const uint8_t *) in_content.data(), in_content.length());
+}
+
+void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const uint8_t *in_content,
+        size_t in_content_sz) {
     // If we're paused, throw away this packet
     {
         local_locker lock(ext_mutex);
@@ -1146,8 +1344,9 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
     }
 
     KismetDatasource::DataReport report;
+    data_report_packet report_packet;
 
-    if (!report.ParseFromString(in_content)) {
+    if (!parse_data_report(in_content, in_content_sz, report, report_packet)) {
         _MSG(std::string("Kismet datasource driver ") + get_source_builder()->get_source_type() + 
                 std::string(" could not parse the data report, something is wrong with "
                     "the remote capture tool"), MSGFLAG_ERROR);
@@ -1163,25 +1362,25 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
 
     kis_packet *packet = packetchain->generate_packet();
 
-    // Process the data chunk
-    if (report.has_packet()) {
-        kis_datachunk *datachunk = new kis_datachunk();
+    // Process the data chunk; this is the only copy of the packet payload, straight out
+    // of the report
+    if (report_packet.present) {
+        kis_datachunk *datachunk = packetchain->datachunk_pool->acquire();
 
         if (clobber_timestamp && get_source_remote()) {
             gettimeofday(&(packet->ts), NULL);
         } else {
-            packet->ts.tv_sec = report.packet().time_sec();
-            packet->ts.tv_usec = report.packet().time_usec();
+            packet->ts.tv_sec = report_packet.time_sec;
+            packet->ts.tv_usec = report_packet.time_usec;
         }
 
         // Override the DLT if we have one
         if (get_source_override_linktype()) {
             datachunk->dlt = get_source_override_linktype();
         } else {
-            datachunk->dlt = report.packet().dlt();
+            datachunk->dlt = report_packet.dlt;
         }
-        datachunk->copy_data((const uint8_t *) report.packet().data().data(), 
-                report.packet().data().length());
+        datachunk->copy_data(report_packet.data, report_packet.data_sz);
 
         packet->insert(pack_comp_linkframe, datachunk);
     }
@@ -1240,7 +1439,7 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
 
     // TODO handle spectrum
    
-    packetchain_comp_datasource *datasrcinfo = new packetchain_comp_datasource();
+    packetchain_comp_datasource *datasrcinfo = packetchain->datasrc_pool->acquire();
     datasrcinfo->ref_source = this;
 
     packet->insert(pack_comp_datasrc, datasrcinfo);
@@ -1276,7 +1475,7 @@ void kis_datasource::handle_packet_warning_report(uint32_t in_seqno, const std::
 kis_layer1_packinfo *kis_datasource::handle_sub_signal(KismetDatasource::SubSignal in_sig) {
     // Extract l1 info from a KV pair so we can add it to a packet
     
-    kis_layer1_packinfo *siginfo = new kis_layer1_packinfo();
+    kis_layer1_packinfo *siginfo = packetchain->l1info_pool->acquire();
 
     if (in_sig.has_signal_dbm()) {
         siginfo->signal_type = kis_l1_signal_type_dbm;
@@ -1312,7 +1511,7 @@ kis_layer1_packinfo *kis_datasource::handle_sub_signal(KismetDatasource::SubSign
 
 kis_gps_packinfo *kis_datasource::handle_sub_gps(KismetDatasource::SubGps in_gps) {
     // Extract a GPS record from a packet and turn it into a packinfo gps log
-    kis_gps_packinfo *gpsinfo = new kis_gps_packinfo();
+    kis_gps_packinfo *gpsinfo = packetchain->gpsinfo_pool->acquire();
 
     gpsinfo->lat = in_gps.lat();
     gpsinfo->lon = in_gps.lon();
@@ -1377,6 +1576,12 @@ unsigned int kis_datasource::send_open_source(std::string in_definition,
     KismetDatasource::OpenSource o;
     o.set_definition(in_definition);
 
+    // Capture binaries which don't understand batching ignore these
+    if (batch_max_packets > 1) {
+        o.set_batch_max_packets(batch_max_packets);
+        o.set_batch_max_latency_ms(batch_max_latency_ms);
+    }
+
     c->set_content(o.SerializeAsString());
 
     seqno = send_packet(c);
@@ -493,10 +493,18 @@ protected:
     // Central packet dispatch override to add the datasource commands
     virtual bool dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) override;
 
+    // Zero-copy dispatch of data reports out of the receive buffer
+    virtual bool dispatch_rx_packet_direct(const std::string& command, uint32_t in_seqno,
+            const uint8_t *in_content, size_t in_content_sz) override;
+
     virtual void handle_msg_proxy(const std::string& msg, const int type) override;
 
     virtual void handle_packet_configure_report(uint32_t in_seqno, const std::string& in_packet);
     virtual void handle_packet_data_report(uint32_t in_seqno, const std::string& in_packet);
+    virtual void handle_packet_data_report(uint32_t in_seqno, const uint8_t *in_content,
+            size_t in_content_sz);
+    virtual void handle_packet_data_report_batch(uint32_t in_seqno, const uint8_t *in_content,
+            size_t in_content_sz);
     virtual void handle_packet_error_report(uint32_t in_seqno, const std::string& in_packet);
     virtual void handle_packet_interfaces_report(uint32_t in_seqno, const std::string& in_packet);
     virtual void handle_packet_opensource_report(uint32_t in_seqno, const std::string& in_packet);
@@ -676,6 +684,10 @@ protected:
     // Do we clobber the remote timestamp?
     bool clobber_timestamp;
 
+    // Batching requested from the capture binary when opening the source
+    unsigned int batch_max_packets;
+    unsigned int batch_max_latency_ms;
+
     __ProxySetMS(int_source_remote, uint8_t, bool, source_remote, ext_mutex);
     std::shared_ptr<tracker_element_uint8> source_remote;
 
@@ -832,6 +844,10 @@ public:
         ref_source = NULL;
     }
 
+    virtual void reset() override {
+        ref_source = NULL;
+    }
+
     virtual ~packetchain_comp_datasource() { }
 };
 
@@ -29,6 +29,9 @@
 #include "protobuf_cpp/kismet.pb.h"
 #include "protobuf_cpp/http.pb.h"
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
 kis_external_interface::kis_external_interface() :
     buffer_interface(),
     ext_mutex {std::make_shared<kis_recursive_timed_mutex>()},
@@ -95,6 +98,60 @@ void kis_external_interface::trigger_error(std::string in_error) {
     buffer_error(in_error);
 }
 
+// Walk the wire format of a KismetExternal::Command and locate the content in place,
+// without copying it out of the buffer
+static bool scan_command_frame(const uint8_t *in_data, size_t in_sz, std::string& command,
+        uint32_t& seqno, const uint8_t **content, size_t& content_sz) {
+    using google::protobuf::internal::WireFormatLite;
+
+    google::protobuf::io::CodedInputStream cis(in_data, in_sz);
+    uint32_t tag, len;
+    bool have_command = false, have_seqno = false, have_content = false;
+
+    while ((tag = cis.ReadTag()) != 0) {
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+            case KismetExternal::Command::kCommandFieldNumber:
+                if (!cis.ReadVarint32(&len) || !cis.ReadString(&command, len))
+                    return false;
+                have_command = true;
+                break;
+            case KismetExternal::Command::kSeqnoFieldNumber:
+                if (!cis.ReadVarint32(&seqno))
+                    return false;
+                have_seqno = true;
+                break;
+            case KismetExternal::Command::kContentFieldNumber:
+                if (!cis.ReadVarint32(&len))
+                    return false;
+
+                if (len == 0) {
+                    *content = nullptr;
+                } else {
+                    const void *ptr;
+                    int avail;
+
+                    if (!cis.GetDirectBufferPointer(&ptr, &avail) || (uint32_t) avail < len)
+                        return false;
+
+                    *content = (const uint8_t *) ptr;
+
+                    if (!cis.Skip(len))
+                        return false;
+                }
+
+                content_sz = len;
+                have_content = true;
+                break;
+            default:
+                if (!WireFormatLite::SkipField(&cis, tag))
+                    return false;
+                break;
+        }
+    }
+
+    return have_command && have_seqno && have_content;
+}
+
 void kis_external_interface::buffer_available(size_t in_amt) {
     if (in_amt == 0)
         return;
@@ -179,6 +236,41 @@ void kis_external_interface::buffer_available(size_t in_amt) {
             return;
         }
 
+        // Offer the command to the zero-copy handlers first; this lets high-volume 
+        // commands like data reports be processed straight out of the buffer.  Hold our
+        // own reference to the buffer since the handler may close the interface; the 
+        // peeked frame stays valid until we free it, so we can unlock before dispatching
+        // the same as we do for parsed commands.
+        std::string direct_cmd;
+        uint32_t direct_seqno;
+        const uint8_t *direct_content = nullptr;
+        size_t direct_content_sz = 0;
+
+        if (scan_command_frame(frame->data, data_sz, direct_cmd, direct_seqno, 
+                    &direct_content, direct_content_sz)) {
+            auto handler = ringbuf_handler;
+
+            lock.unlock();
+
+            bool handled = dispatch_rx_packet_direct(direct_cmd, direct_seqno, 
+                    direct_content, direct_content_sz);
+
+            if (handled) {
+                handler->peek_free_read_buffer_data(frame);
+                handler->consume_read_buffer_data(frame_sz);
+                continue;
+            }
+
+            lock.lock();
+
+            // Not a direct command, but make sure the interface didn't go away while we
+            // were unlocked before parsing it normally
+            if (ringbuf_handler != handler) {
+                handler->peek_free_read_buffer_data(frame);
+                return;
+            }
+        }
+
         // Process the data payload as a protobuf frame
         std::shared_ptr<KismetExternal::Command> cmd(new KismetExternal::Command());
 
@@ -97,6 +97,17 @@ protected:
     // Central packet dispatch handler
     virtual bool dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c);
 
+    // Zero-copy dispatch handler, called with the command content still in the receive
+    // buffer before the command is parsed; the content is only valid for the duration
+    // of the call.  Return true if the command was handled, otherwise it is parsed and 
+    // passed to dispatch_rx_packet
+    virtual bool dispatch_rx_packet_direct(const std::string& command __attribute__((unused)), 
+            uint32_t in_seqno __attribute__((unused)), 
+            const uint8_t *in_content __attribute__((unused)), 
+            size_t in_content_sz __attribute__((unused))) {
+        return false;
+    }
+
     // Generic msg proxy
     virtual void handle_msg_proxy(const std::string& msg, const int msgtype) = 0; 
 
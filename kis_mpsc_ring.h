@@ -0,0 +1,206 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_MPSC_RING_H__
+#define __KIS_MPSC_RING_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free multi-producer, single-consumer ring of pointer-sized items.
+//
+// Producers claim a slot with a single CAS on the enqueue position and publish it
+// by updating the per-slot sequence number; no lock is taken and no syscall is made
+// unless the consumer has parked itself waiting for data.
+//
+// The consumer drains in batches and spins briefly before parking on a condition
+// variable, so a busy queue never touches the mutex and an idle queue doesn't burn
+// a core.
+//
+// Capacity is rounded up to a power of two.
+template<typename T>
+class kis_mpsc_ring {
+public:
+    kis_mpsc_ring(size_t in_capacity) :
+        enqueue_pos {0},
+        dequeue_pos {0},
+        consumer_parked {false} {
+
+        capacity = 2;
+        while (capacity < in_capacity)
+            capacity <<= 1;
+
+        mask = capacity - 1;
+
+        slots = std::unique_ptr<slot[]>(new slot[capacity]);
+
+        for (size_t i = 0; i < capacity; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    kis_mpsc_ring(const kis_mpsc_ring&) = delete;
+    kis_mpsc_ring& operator=(const kis_mpsc_ring&) = delete;
+
+    // Push an item from any thread; returns false if the ring is full
+    bool push(T in_item) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        slot *s;
+
+        while (1) {
+            s = &slots[pos & mask];
+            size_t seq = s->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        s->item = in_item;
+        s->sequence.store(pos + 1, std::memory_order_release);
+
+        // Only wake the consumer if it has gone to sleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer_parked.load(std::memory_order_relaxed)) {
+            { std::lock_guard<std::mutex> lk(park_mutex); }
+            park_cv.notify_one();
+        }
+
+        return true;
+    }
+
+    // Pop a single item; consumer thread only
+    bool pop(T& out_item) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        slot *s = &slots[pos & mask];
+        size_t seq = s->sequence.load(std::memory_order_acquire);
+
+        if ((intptr_t) seq - (intptr_t) (pos + 1) < 0)
+            return false;
+
+        out_item = s->item;
+        s->sequence.store(pos + capacity, std::memory_order_release);
+        dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    // Pop up to max_items into the batch vector; consumer thread only.  Returns the
+    // number of items appended.
+    size_t pop_batch(std::vector<T>& batch, size_t max_items) {
+        size_t n = 0;
+        T item;
+
+        while (n < max_items && pop(item)) {
+            batch.push_back(item);
+            n++;
+        }
+
+        return n;
+    }
+
+    // Wait for data to become available; spins for spin_count iterations before
+    // parking on the condition variable for no longer than max_wait.  The predicate
+    // is checked while parked to allow the caller to abort the wait (such as on
+    // shutdown).  Returns true if there is data available.
+    template<class Predicate>
+    bool wait(unsigned int spin_count, std::chrono::milliseconds max_wait, Predicate abort) {
+        for (unsigned int i = 0; i < spin_count; i++) {
+            if (!empty())
+                return true;
+
+            if (i > spin_count / 2)
+                std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lk(park_mutex);
+
+        consumer_parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        park_cv.wait_for(lk, max_wait, [this, &abort] {
+            return !empty() || abort();
+        });
+
+        consumer_parked.store(false, std::memory_order_relaxed);
+
+        return !empty();
+    }
+
+    // Wake a parked consumer regardless of the queue state
+    void wake() {
+        { std::lock_guard<std::mutex> lk(park_mutex); }
+        park_cv.notify_all();
+    }
+
+    bool empty() const {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        size_t seq = slots[pos & mask].sequence.load(std::memory_order_acquire);
+        return (intptr_t) seq - (intptr_t) (pos + 1) < 0;
+    }
+
+    // Approximate number of queued items; may be briefly stale under concurrent
+    // pushes
+    size_t size() const {
+        size_t e = enqueue_pos.load(std::memory_order_relaxed);
+        size_t d = dequeue_pos.load(std::memory_order_relaxed);
+
+        if (e < d)
+            return 0;
+
+        return e - d;
+    }
+
+    size_t get_capacity() const {
+        return capacity;
+    }
+
+protected:
+    struct slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    std::unique_ptr<slot[]> slots;
+    size_t capacity;
+    size_t mask;
+
+    // Keep the producer and consumer positions on their own cache lines so they
+    // don't thrash each other
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
+
+    alignas(64) std::atomic<bool> consumer_parked;
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
+};
+
+#endif
+
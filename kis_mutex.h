@@ -46,6 +46,13 @@
 
 #include "fmt.h"
 
+#ifdef PROFILE_MUTEX
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#endif
+
 // Seconds a lock is allowed to be held before throwing a timeout error
 // Tuning this is a balance between slower systems or systems swapping heavily, 
 // and faulting more quickly.
@@ -91,6 +98,10 @@ public:
         return true;
     }
 
+    bool try_lock() {
+        return pthread_mutex_trylock(&mutex) == 0;
+    }
+
     void lock() {
         pthread_mutex_lock(&mutex);
     }
@@ -103,6 +114,133 @@ private:
     pthread_mutex_t mutex;
 };
 
+#ifdef PROFILE_MUTEX
+// Lock contention statistics, shared by every mutex with the same name.  Names are
+// aggregated up to the first '(' so that per-object mutexes such as
+// "kis_tracked_device(...)" roll up into a single entry.
+//
+// Only the underlying lock is measured; recursive re-locks by the owning thread and
+// shared locks joining an existing shared hold never wait and are not counted.
+class kis_mutex_profile {
+public:
+    // Wait histogram buckets are powers of two in microseconds:  <1us, <2us, <4us, ...
+    // with the final bucket holding everything longer
+    static constexpr unsigned int wait_buckets = 24;
+
+    kis_mutex_profile(const std::string& in_name) :
+        name {in_name},
+        acquisitions {0},
+        contended {0},
+        wait_total_us {0},
+        wait_max_us {0},
+        hold_total_us {0},
+        hold_max_us {0} {
+        for (auto& b : wait_histogram)
+            b = 0;
+    }
+
+    const std::string name;
+
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contended;
+    std::atomic<uint64_t> wait_total_us;
+    std::atomic<uint64_t> wait_max_us;
+    std::atomic<uint64_t> hold_total_us;
+    std::atomic<uint64_t> hold_max_us;
+    std::atomic<uint64_t> wait_histogram[wait_buckets];
+
+    void record_uncontended() {
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+        wait_histogram[0].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record_contended(uint64_t wait_us) {
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+        contended.fetch_add(1, std::memory_order_relaxed);
+        wait_total_us.fetch_add(wait_us, std::memory_order_relaxed);
+        update_max(wait_max_us, wait_us);
+
+        unsigned int b = 0;
+        while (wait_us > 0 && b < wait_buckets - 1) {
+            wait_us >>= 1;
+            b++;
+        }
+
+        wait_histogram[b].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record_hold(uint64_t hold_us) {
+        hold_total_us.fetch_add(hold_us, std::memory_order_relaxed);
+        update_max(hold_max_us, hold_us);
+    }
+
+protected:
+    static void update_max(std::atomic<uint64_t>& m, uint64_t v) {
+        auto cur = m.load(std::memory_order_relaxed);
+        while (v > cur && !m.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+            ;
+    }
+};
+
+// Global registry of mutex profiles; profiles are never removed so mutexes may keep a
+// raw pointer to theirs.  Guarded by a plain std::mutex so profiling never recurses
+// into itself.
+class kis_mutex_profiler {
+public:
+    static kis_mutex_profile *fetch_profile(const std::string& name) {
+        auto key = name.substr(0, name.find('('));
+
+        std::lock_guard<std::mutex> lk(registry_mutex());
+        auto& profiles = registry();
+
+        for (const auto& p : profiles) {
+            if (p->name == key)
+                return p.get();
+        }
+
+        profiles.push_back(std::unique_ptr<kis_mutex_profile>(new kis_mutex_profile(key)));
+        return profiles.back().get();
+    }
+
+    // Snapshot of all known profiles, sorted by total time spent waiting; the wait times
+    // are read once up front, since the live counters can change under the sort
+    static std::vector<kis_mutex_profile *> profiles() {
+        std::vector<std::pair<kis_mutex_profile *, uint64_t>> snap;
+
+        {
+            std::lock_guard<std::mutex> lk(registry_mutex());
+            for (const auto& p : registry())
+                snap.push_back(std::make_pair(p.get(), p->wait_total_us.load()));
+        }
+
+        std::sort(snap.begin(), snap.end(), 
+                [](const std::pair<kis_mutex_profile *, uint64_t>& a, 
+                    const std::pair<kis_mutex_profile *, uint64_t>& b) {
+                    return a.second > b.second;
+                });
+
+        std::vector<kis_mutex_profile *> ret;
+        ret.reserve(snap.size());
+
+        for (const auto& s : snap)
+            ret.push_back(s.first);
+
+        return ret;
+    }
+
+protected:
+    static std::mutex& registry_mutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::vector<std::unique_ptr<kis_mutex_profile>>& registry() {
+        static std::vector<std::unique_ptr<kis_mutex_profile>> r;
+        return r;
+    }
+};
+#endif
+
 // C++14 defines a shared_mutex, and a timed shared mutex, but not a recursive, timed,
 // shared mutex; implement our own thread ID 
 class kis_recursive_timed_mutex {
@@ -110,6 +248,9 @@ public:
     kis_recursive_timed_mutex() :
 #ifdef DEBUG_MUTEX_NAME
         mutex_name {"unnamed"},
+#endif
+#ifdef PROFILE_MUTEX
+        profile {kis_mutex_profiler::fetch_profile("unnamed")},
 #endif
         owner {std::thread::id()},
         owner_count {0},
@@ -119,6 +260,9 @@ public:
     std::string mutex_name;
     void set_name(const std::string& name) {
         mutex_name = name;
+#ifdef PROFILE_MUTEX
+        profile = kis_mutex_profiler::fetch_profile(name);
+#endif
     }
 #else
     void set_name(const std::string& name) { }
@@ -133,7 +277,7 @@ public:
             state_mutex.unlock();
 
             // This will be unlocked when the shared count hits 0 so sit trying to lock it again
-            if (mutex.try_lock_for(d) == false) {
+            if (acquire_for(d) == false) {
 #ifdef DEBUG_MUTEX_NAME
                 throw(std::runtime_error(fmt::format("deadlock: mutex {} not available within {} (shared held)", mutex_name, KIS_THREAD_DEADLOCK_TIMEOUT)));
 #else
@@ -162,7 +306,7 @@ public:
 
         // Attempt to acquire and continue
         state_mutex.unlock();
-        if (mutex.try_lock_for(d) == false) {
+        if (acquire_for(d) == false) {
 #ifdef DEBUG_MUTEX_NAME
             throw(std::runtime_error(fmt::format("deadlock: shared mutex {} lock not available within {} (claiming write)", mutex_name, KIS_THREAD_DEADLOCK_TIMEOUT)));
 #else
@@ -192,7 +336,7 @@ public:
             // If we have any other writer lock, we must block until it's gone; the RW 
             // count hitting 0 will unlock us
             state_mutex.unlock();
-            if (mutex.try_lock_for(d) == false) {
+            if (acquire_for(d) == false) {
 #ifdef DEBUG_MUTEX_NAME
                 throw(std::runtime_error(fmt::format("deadlock: shared mutex {} lock not available within {} (write held)", mutex_name, KIS_THREAD_DEADLOCK_TIMEOUT)));
 #else
@@ -211,7 +355,7 @@ public:
         if (shared_owner_count == 0) {
             // Grab the lock
             state_mutex.unlock();
-            if (mutex.try_lock_for(d) == false) {
+            if (acquire_for(d) == false) {
 #ifdef DEBUG_MUTEX_NAME
                 throw(std::runtime_error(fmt::format("deadlock: shared mutex {} lock not available within {} (claiming shared)", mutex_name, KIS_THREAD_DEADLOCK_TIMEOUT)));
 #else
@@ -234,7 +378,7 @@ public:
         if (shared_owner_count) {
             state_mutex.unlock();
             // This will be unlocked when the shared count hits 0
-            mutex.lock();
+            acquire();
 
             state_mutex.lock();
             // Set the owner & count
@@ -256,7 +400,7 @@ public:
         // Attempt to acquire and continue; this blocks
         state_mutex.unlock();
 
-        mutex.lock();
+        acquire();
         state_mutex.lock();
         owner = std::this_thread::get_id();
         owner_count = 1;
@@ -282,7 +426,7 @@ public:
             // count hitting 0 will unlock us
             state_mutex.unlock();
 
-            mutex.lock();
+            acquire();
 
             state_mutex.lock();
             // We now own the lock, increment RO
@@ -294,7 +438,7 @@ public:
         if (shared_owner_count == 0) {
             state_mutex.unlock();
             // Grab the lock
-            mutex.lock();
+            acquire();
 
             state_mutex.lock();
         }
@@ -312,7 +456,7 @@ public:
             // Write lock has expired, unlock mutex
             if (--owner_count == 0) {
                 owner = std::thread::id();
-                mutex.unlock();
+                release();
             }
 
             state_mutex.unlock();
@@ -333,7 +477,7 @@ public:
                     // Write lock has expired, unlock mutex
                     if (--owner_count == 0) {
                         owner = std::thread::id();
-                        mutex.unlock();
+                        release();
                     }
 
                     state_mutex.unlock();
@@ -353,7 +497,7 @@ public:
             // Decrement RO lock count
             if (--shared_owner_count == 0) {
                 // Release the lock if we've hit 0
-                mutex.unlock();
+                release();
                 state_mutex.unlock();
                 return;
             }
@@ -364,6 +508,62 @@ public:
     }
 
 private:
+    // Acquire and release the underlying mutex; when profiling, record how long we
+    // waited for it and how long it was held
+    bool acquire_for(const std::chrono::seconds& d) {
+#ifdef PROFILE_MUTEX
+        if (mutex.try_lock()) {
+            profile->record_uncontended();
+            hold_start = std::chrono::steady_clock::now();
+            return true;
+        }
+
+        auto wait_start = std::chrono::steady_clock::now();
+
+        if (mutex.try_lock_for(d) == false)
+            return false;
+
+        hold_start = std::chrono::steady_clock::now();
+        profile->record_contended(std::chrono::duration_cast<std::chrono::microseconds>(hold_start - wait_start).count());
+        return true;
+#else
+        return mutex.try_lock_for(d);
+#endif
+    }
+
+    void acquire() {
+#ifdef PROFILE_MUTEX
+        if (mutex.try_lock()) {
+            profile->record_uncontended();
+            hold_start = std::chrono::steady_clock::now();
+            return;
+        }
+
+        auto wait_start = std::chrono::steady_clock::now();
+
+        mutex.lock();
+
+        hold_start = std::chrono::steady_clock::now();
+        profile->record_contended(std::chrono::duration_cast<std::chrono::microseconds>(hold_start - wait_start).count());
+#else
+        mutex.lock();
+#endif
+    }
+
+    void release() {
+#ifdef PROFILE_MUTEX
+        profile->record_hold(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hold_start).count());
+#endif
+        mutex.unlock();
+    }
+
+#ifdef PROFILE_MUTEX
+    kis_mutex_profile *profile;
+
+    // Only touched while the underlying mutex is held
+    std::chrono::steady_clock::time_point hold_start;
+#endif
+
     // Recursive write lock
     std::thread::id owner;
     unsigned int owner_count;
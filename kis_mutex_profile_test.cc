@@ -0,0 +1,191 @@
+/* test harness for the mutex contention profiler
+ *
+ * Checks the wait histogram bucket boundaries, that profiles of mutexes are shared by
+ * every name with the same prefix before the first '(', and that locking a named
+ * mutex records uncontended and contended acquisitions and hold times without
+ * counting recursive re-locks.
+ *
+ * The profiler is only compiled with --enable-mutex-profiling; the harness turns it
+ * on itself, and does not need kismet to be configured with it.
+ *
+ * # configure kismet
+ * ./configure
+ *
+ * # build test harness
+ * g++ -o kis_mutex_profile_test kis_mutex_profile_test.cc -lpthread
+ *
+ * ./kis_mutex_profile_test
+ *
+ */
+
+#include "config.h"
+
+#ifndef PROFILE_MUTEX
+#define PROFILE_MUTEX 1
+#endif
+
+#ifndef DEBUG_MUTEX_NAME
+#define DEBUG_MUTEX_NAME 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+
+#include "kis_mutex.h"
+#include "test_harness.h"
+
+// Bucket a single contended wait lands in
+static int bucket_of(uint64_t wait_us) {
+    kis_mutex_profile p("bucket");
+
+    p.record_contended(wait_us);
+
+    for (unsigned int b = 0; b < kis_mutex_profile::wait_buckets; b++) {
+        if (p.wait_histogram[b].load() != 0)
+            return b;
+    }
+
+    return -1;
+}
+
+static void check_buckets() {
+    char what[64];
+
+    expect("0us", bucket_of(0) == 0);
+    expect("1us", bucket_of(1) == 1);
+    expect("2us", bucket_of(2) == 2);
+    expect("3us", bucket_of(3) == 2);
+
+    // Bucket b holds waits of at least 2^(b-1) and under 2^b microseconds
+    for (unsigned int b = 2; b < kis_mutex_profile::wait_buckets - 1; b++) {
+        snprintf(what, sizeof(what), "bucket %u low edge", b);
+        expect(what, bucket_of(1ULL << (b - 1)) == (int) b);
+
+        snprintf(what, sizeof(what), "bucket %u high edge", b);
+        expect(what, bucket_of((1ULL << b) - 1) == (int) b);
+    }
+
+    // Everything longer lands in the last bucket
+    auto last = (int) kis_mutex_profile::wait_buckets - 1;
+    expect("last bucket low edge", bucket_of(1ULL << (last - 1)) == last);
+    expect("last bucket", bucket_of(1ULL << 40) == last);
+    expect("last bucket max", bucket_of(UINT64_MAX) == last);
+
+    kis_mutex_profile p("counts");
+
+    p.record_uncontended();
+    p.record_contended(5);
+    p.record_contended(300);
+    p.record_hold(7);
+    p.record_hold(2);
+
+    expect("acquisitions", p.acquisitions.load() == 3);
+    expect("contended", p.contended.load() == 2);
+    expect("uncontended in the first bucket", p.wait_histogram[0].load() == 1);
+    expect("wait total", p.wait_total_us.load() == 305);
+    expect("wait max", p.wait_max_us.load() == 300);
+    expect("hold total", p.hold_total_us.load() == 9);
+    expect("hold max", p.hold_max_us.load() == 7);
+}
+
+static void check_names() {
+    auto a = kis_mutex_profiler::fetch_profile("test_device(AA:BB:CC:DD:EE:FF)");
+    auto b = kis_mutex_profiler::fetch_profile("test_device(00:11:22:33:44:55)");
+    auto c = kis_mutex_profiler::fetch_profile("test_device");
+    auto d = kis_mutex_profiler::fetch_profile("test_device_view");
+    auto e = kis_mutex_profiler::fetch_profile("test_nested(a(b))");
+
+    expect("per-object names share a profile", a == b && a == c);
+    expect("aggregated name", a->name == "test_device");
+    expect("longer names are kept apart", d != a && d->name == "test_device_view");
+    expect("cut at the first paren", e->name == "test_nested");
+    expect("repeat lookup", kis_mutex_profiler::fetch_profile("test_device_view") == d);
+
+    bool found = false;
+    for (auto p : kis_mutex_profiler::profiles()) {
+        if (p->name.find('(') != std::string::npos)
+            expect("no parens in profile names", false);
+
+        if (p == a) {
+            expect("listed once", !found);
+            found = true;
+        }
+    }
+
+    expect("listed", found);
+}
+
+static void check_locking() {
+    kis_recursive_timed_mutex m1, m2;
+
+    m1.set_name("test_lock(1)");
+    m2.set_name("test_lock(2)");
+
+    auto p = kis_mutex_profiler::fetch_profile("test_lock");
+
+    // Recursive re-locks by the owner are not acquisitions of the underlying lock
+    m1.lock();
+    m1.lock();
+    m1.unlock();
+    m1.unlock();
+
+    m2.lock_shared();
+    m2.unlock_shared();
+
+    expect("uncontended acquisitions", p->acquisitions.load() == 2);
+    expect("uncontended", p->contended.load() == 0);
+
+    // Hold m1 while another thread waits for it
+    std::atomic<bool> waiting {false};
+
+    m1.lock();
+
+    std::thread t([&]() {
+        waiting = true;
+        m1.lock();
+        m1.unlock();
+    });
+
+    while (!waiting)
+        std::this_thread::yield();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    m1.unlock();
+    t.join();
+
+    expect("contended acquisitions", p->acquisitions.load() == 4);
+    expect("contended", p->contended.load() == 1);
+
+    // The wait is at least most of the 50ms the lock was held for, 2^15us and up
+    uint64_t long_waits = 0;
+    for (unsigned int b = 16; b < kis_mutex_profile::wait_buckets; b++)
+        long_waits += p->wait_histogram[b].load();
+
+    expect("contended wait bucketed", long_waits == 1);
+    expect("wait recorded", p->wait_max_us.load() >= 32768);
+    expect("hold recorded", p->hold_max_us.load() >= 32768);
+
+    // Profiles are listed by total wait, longest first
+    auto profiles = kis_mutex_profiler::profiles();
+
+    for (size_t i = 1; i < profiles.size(); i++)
+        expect("sorted by wait", profiles[i - 1]->wait_total_us.load() >=
+                profiles[i]->wait_total_us.load());
+
+    expect("longest wait first", profiles.size() > 0 && profiles[0] == p);
+}
+
+int main(int argc, char *argv[]) {
+    check_buckets();
+    check_names();
+    check_locking();
+
+    printf("%u failures\n", test_failures());
+
+    return test_failures() == 0 ? 0 : 1;
+}
+
@@ -95,6 +95,16 @@ std::string kishttpd::escape_html(const std::string& in) {
     return ss.str();
 }
 
+bool kishttpd::accepts_encoding(struct MHD_Connection *connection, const std::string& encoding) {
+    const char *accept = 
+        MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+
+    if (accept == nullptr)
+        return false;
+
+    return http_accepts_encoding(accept, encoding);
+}
+
 std::shared_ptr<tracker_element> kishttpd::summarize_with_structured(std::shared_ptr<tracker_element> in_data,
         shared_structured structured, std::shared_ptr<tracker_element_serializer::rename_map> rename_map) {
 
@@ -130,6 +140,7 @@ std::shared_ptr<tracker_element> kishttpd::summarize_with_structured(std::shared
 kis_net_httpd::kis_net_httpd() {
     controller_mutex.set_name("kis_net_httpd_controller");
     session_mutex.set_name("kis_net_httpd_session");
+    suspended_mutex.set_name("kis_net_httpd_suspended");
 
     running = false;
 
@@ -151,6 +162,8 @@ kis_net_httpd::kis_net_httpd() {
 
     uri_prefix = Globalreg::globalreg->kismet_config->fetch_opt_dfl("httpd_uri_prefix", "");
 
+    http_threads = Globalreg::globalreg->kismet_config->fetch_opt_uint("httpd_threads", 0);
+
     std::string http_data_dir, http_aux_data_dir;
 
     http_data_dir = Globalreg::globalreg->kismet_config->fetch_opt("httpd_home");
@@ -212,6 +225,7 @@ kis_net_httpd::kis_net_httpd() {
     register_mime_type("json", "application/json");
     register_mime_type("ekjson", "application/json");
     register_mime_type("itjson", "application/json");
+    register_mime_type("msgpack", "application/msgpack");
     register_mime_type("pcap", "application/vnd.tcpdump.pcap");
 
     std::vector<std::string> mimeopts = Globalreg::globalreg->kismet_config->fetch_opt_vec("httpd_mime");
@@ -479,20 +493,37 @@ int kis_net_httpd::start_httpd() {
         }
     }
 
+    // By default every connection gets its own thread; otherwise run a bounded pool of
+    // event-driven threads, which requires suspending streams which are waiting on data
+    unsigned int mhd_flags;
+    unsigned int mhd_pool_sz = 0;
+
+    if (http_threads == 0) {
+        mhd_flags = MHD_USE_THREAD_PER_CONNECTION;
+    } else {
+        mhd_flags = MHD_USE_SELECT_INTERNALLY | MHD_USE_SUSPEND_RESUME;
+#ifdef __linux__
+        mhd_flags |= MHD_USE_EPOLL_LINUX_ONLY;
+#endif
+        mhd_pool_sz = http_threads;
+    }
+
     if (!use_ssl) {
-        microhttpd = MHD_start_daemon(MHD_USE_THREAD_PER_CONNECTION,
+        microhttpd = MHD_start_daemon(mhd_flags,
                 http_port, NULL, NULL, 
                 &http_request_handler, this, 
                 MHD_OPTION_NOTIFY_COMPLETED, &http_request_completed, NULL,
                 MHD_OPTION_SOCK_ADDR, (struct sockaddr *) &listen_addr, 
+                MHD_OPTION_THREAD_POOL_SIZE, mhd_pool_sz,
                 MHD_OPTION_END); 
     } else {
-        microhttpd = MHD_start_daemon(MHD_USE_THREAD_PER_CONNECTION | MHD_USE_SSL,
+        microhttpd = MHD_start_daemon(mhd_flags | MHD_USE_SSL,
                 http_port, NULL, NULL, &http_request_handler, this, 
                 MHD_OPTION_NOTIFY_COMPLETED, &http_request_completed, NULL,
                 MHD_OPTION_SOCK_ADDR, (struct sockaddr *) &listen_addr, 
                 MHD_OPTION_HTTPS_MEM_KEY, cert_key,
                 MHD_OPTION_HTTPS_MEM_CERT, cert_pem,
+                MHD_OPTION_THREAD_POOL_SIZE, mhd_pool_sz,
                 MHD_OPTION_END); 
     }
 
@@ -513,6 +544,9 @@ int kis_net_httpd::start_httpd() {
     else
         _MSG_INFO("Started http server on {}:{}", http_host, http_port);
 
+    if (http_threads > 0)
+        _MSG_INFO("HTTP server handling connections with {} event-driven threads", http_threads);
+
     return 1;
 }
 
@@ -525,6 +559,21 @@ int kis_net_httpd::stop_httpd() {
     if (microhttpd != NULL) {
         running = false;
 
+        // Wake any suspended streams so they can close out; the server can't shut down
+        // cleanly with suspended connections
+        {
+            local_locker sl(&suspended_mutex);
+
+            for (auto s : suspended_streams) {
+                s->in_error = true;
+
+                if (s->suspended.exchange(false))
+                    MHD_resume_connection(s->mhd_connection);
+            }
+
+            suspended_streams.clear();
+        }
+
         // If possible we want to quiesce the daemon and stop it fully in our 
         // deconstructor; however on some implementations of microhttpd that's 
         // not available.
@@ -543,6 +592,16 @@ int kis_net_httpd::stop_httpd() {
     return 0;
 }
 
+void kis_net_httpd::add_suspended_stream(kis_net_httpd_buffer_stream_aux *in_aux) {
+    local_locker sl(&suspended_mutex);
+    suspended_streams.insert(in_aux);
+}
+
+void kis_net_httpd::remove_suspended_stream(kis_net_httpd_buffer_stream_aux *in_aux) {
+    local_locker sl(&suspended_mutex);
+    suspended_streams.erase(in_aux);
+}
+
 void kis_net_httpd::MHD_Panic(void *cls, const char *file __attribute__((unused)), 
             unsigned int line __attribute__((unused)), const char *reason) {
     kis_net_httpd *httpd = (kis_net_httpd *) cls;
@@ -1242,6 +1301,12 @@ void kis_net_httpd::append_standard_headers(kis_net_httpd *httpd,
         MHD_add_response_header(connection->response, "Content-Disposition", disp.c_str());
     }
 
+    if (connection->content_encoding != "") {
+        MHD_add_response_header(connection->response, "Content-Encoding", 
+                connection->content_encoding.c_str());
+        MHD_add_response_header(connection->response, "Vary", "Accept-Encoding");
+    }
+
     // Never let the browser cache our responses.  Maybe moderate this
     // in the future to cache for 60 seconds or something?
     MHD_add_response_header(connection->response, "Cache-Control", "no-cache");
@@ -26,6 +26,7 @@
 #include <time.h>
 #include <list>
 #include <map>
+#include <set>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -51,6 +52,9 @@ namespace kishttpd {
     std::string strip_suffix(const std::string& path);
     std::string escape_html(const std::string& path);
 
+    // Does the Accept-Encoding header of the request allow the given content encoding
+    bool accepts_encoding(struct MHD_Connection *connection, const std::string& encoding);
+
     // Summarize based on a summarization dictionary, if one is present.
     // MAY THROW EXCEPTIONS if summarization is malformed.
     // Calls the standard, nested/vectorization summarization if passed a vector, single summarization
@@ -115,6 +119,9 @@ public:
     // Optional alternate filename to pass to the browser for downloading
     std::string optional_filename;
 
+    // Content-Encoding of the response body (such as gzip), if the handler compresses it
+    std::string content_encoding;
+
     // HTTP code of response
     int httpcode;
 
@@ -352,6 +359,15 @@ public:
     unsigned int fetch_port() { return http_port; };
     bool fetch_using_ssl() { return use_ssl; };
 
+    // Are we running a bounded pool of event-driven threads?  If so, streaming responses
+    // must never block the server thread waiting for data, and suspend the connection
+    // instead.
+    bool fetch_nonblocking_streams() { return http_threads > 0; }
+
+    // Track suspended streams so they can be woken when the server shuts down
+    void add_suspended_stream(kis_net_httpd_buffer_stream_aux *in_aux);
+    void remove_suspended_stream(kis_net_httpd_buffer_stream_aux *in_aux);
+
     void register_session_handler(std::shared_ptr<kis_httpd_websession> in_session);
 
     // All standard handlers require a login
@@ -414,6 +430,9 @@ protected:
     unsigned int http_port;
     std::string http_host;
 
+    // Number of event-driven server threads, or 0 for a thread per connection
+    unsigned int http_threads;
+
     bool http_serve_files, http_serve_user_files;
 
     std::string uri_prefix;
@@ -459,6 +478,9 @@ protected:
     kis_recursive_timed_mutex controller_mutex;
     kis_recursive_timed_mutex session_mutex;
 
+    kis_recursive_timed_mutex suspended_mutex;
+    std::set<kis_net_httpd_buffer_stream_aux *> suspended_streams;
+
     // Handle the requests and dispatch to controllers
     static int http_request_handler(void *cls, struct MHD_Connection *connection,
             const char *url, const char *method, const char *version,
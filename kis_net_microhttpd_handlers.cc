@@ -191,6 +191,11 @@ kis_net_httpd_buffer_stream_aux::kis_net_httpd_buffer_stream_aux(
     aux = in_aux;
     free_aux_cb = in_free_aux;
 
+    httpd = in_httpd_connection->httpd;
+    mhd_connection = in_httpd_connection->connection;
+    nonblocking = httpd != nullptr && httpd->fetch_nonblocking_streams();
+    suspended = false;
+
     cl = std::make_shared<conditional_locker<int>>();
     cl->lock();
 
@@ -221,6 +226,37 @@ void kis_net_httpd_buffer_stream_aux::buffer_available(size_t in_amt __attribute
     // re-lock and block
     // fmt::print(stderr, "buffer available {}\n", in_amt);
     cl->unlock(1);
+
+    resume_stream();
+}
+
+void kis_net_httpd_buffer_stream_aux::suspend_stream(std::shared_ptr<buffer_handler_generic> rbh) {
+    if (!nonblocking)
+        return;
+
+    // Register before suspending so the server can always find a suspended connection
+    // to wake it during shutdown
+    httpd->add_suspended_stream(this);
+
+    MHD_suspend_connection(mhd_connection);
+    suspended = true;
+
+    // The generator may have written or completed between checking the buffer and
+    // suspending; if so, wake right back up instead of losing the event
+    if (rbh->get_read_buffer_used() || get_in_error())
+        resume_stream();
+}
+
+void kis_net_httpd_buffer_stream_aux::resume_stream() {
+    if (!nonblocking)
+        return;
+
+    // Only one waker may resume a suspended connection
+    if (!suspended.exchange(false))
+        return;
+
+    httpd->remove_suspended_stream(this);
+    MHD_resume_connection(mhd_connection);
 }
 
 void kis_net_httpd_buffer_stream_aux::block_until_data(std::shared_ptr<buffer_handler_generic> rbh) {
@@ -268,6 +304,25 @@ ssize_t kis_net_httpd_buffer_stream_handler::buffer_event_cb(void *cls, uint64_t
     size_t read_sz = 0;
     unsigned char *zbuf;
 
+    // Event-driven servers can't block a server thread waiting for the generator; send 
+    // whatever is available, or suspend the connection until there is more
+    if (stream_aux->nonblocking) {
+        read_sz = rbh->zero_copy_peek_write_buffer_data((void **) &zbuf, max);
+
+        if (read_sz == 0) {
+            rbh->peek_free_write_buffer_data(zbuf);
+
+            if (stream_aux->get_in_error()) {
+                stream_aux->get_buffer_event_mutex()->unlock();
+                return MHD_CONTENT_READER_END_OF_STREAM;
+            }
+
+            stream_aux->suspend_stream(rbh);
+            stream_aux->get_buffer_event_mutex()->unlock();
+            return 0;
+        }
+    }
+
     // Keep going until we have something to send
     while (read_sz == 0) {
         // We get called as soon as the webserver has either a) processed our request
@@ -366,6 +421,9 @@ int kis_net_httpd_buffer_stream_handler::httpd_handle_get_request(kis_net_httpd
             new kis_net_httpd_buffer_stream_aux(this, connection, rbh, NULL, NULL);
         connection->custom_extension = aux;
 
+        // Negotiate the encoding before the generator starts so it never races the headers
+        connection->content_encoding = httpd_stream_encoding(connection, url);
+
         std::promise<int> launch_promise;
         std::future<int> launch_future = launch_promise.get_future();
 
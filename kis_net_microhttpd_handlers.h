@@ -216,6 +216,14 @@ public:
     // buf to have data available to write.
     static ssize_t buffer_event_cb(void *cls, uint64_t pos, char *buf, size_t max);
 
+    // Called before the stream response is generated to pick the Content-Encoding of the
+    // response, if the handler compresses it; the generator finds the chosen encoding in
+    // connection->content_encoding.
+    virtual std::string httpd_stream_encoding(kis_net_httpd_connection *connection __attribute__((unused)),
+            const char *url __attribute__((unused))) {
+        return "";
+    }
+
     virtual void httpd_set_buffer_size(size_t in_sz) {
         k_n_h_r_ringbuf_size = in_sz;
     }
@@ -272,6 +280,7 @@ public:
     void trigger_error() {
         in_error = true;
         cl->unlock(0);
+        resume_stream();
     }
 
     void set_aux(void *in_aux, 
@@ -305,6 +314,11 @@ public:
     // session)
     void block_until_data(std::shared_ptr<buffer_handler_generic> rbh);
 
+    // Non-blocking alternative to block_until_data for event-driven servers; suspend the
+    // connection until the generator provides more data or completes
+    void suspend_stream(std::shared_ptr<buffer_handler_generic> rbh);
+    void resume_stream();
+
     // Get the buffer event mutex
     kis_recursive_timed_mutex *get_buffer_event_mutex() {
         return &buffer_event_mutex;
@@ -320,6 +334,16 @@ public:
     // kis httpd connection we belong to
     kis_net_httpd_connection *httpd_connection;
 
+    // Server and MHD connection, cached because the kis connection may be removed
+    // before the stream is complete
+    kis_net_httpd *httpd;
+    struct MHD_Connection *mhd_connection;
+
+    // Is the server event-driven, and is the connection currently suspended waiting
+    // for data
+    bool nonblocking;
+    std::atomic<bool> suspended;
+
     // Buffer handler
     std::shared_ptr<buffer_handler_generic> ringbuf_handler;
 
@@ -0,0 +1,153 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include "kis_work_pool.h"
+#include "util.h"
+
+kis_work_pool::kis_work_pool(const std::string& in_name, unsigned int in_threads) :
+    name {in_name},
+    shutdown {false} {
+
+    for (unsigned int i = 0; i < in_threads; i++) {
+        threads.push_back(std::thread([this]() {
+                    thread_set_process_name(name);
+                    worker_thread();
+                    }));
+    }
+}
+
+kis_work_pool::~kis_work_pool() {
+    {
+        std::lock_guard<std::mutex> lk(queue_mutex);
+        shutdown = true;
+    }
+
+    queue_cv.notify_all();
+
+    for (auto& t : threads) {
+        if (t.joinable())
+            t.join();
+    }
+}
+
+void kis_work_pool::worker_thread() {
+    while (1) {
+        std::function<void ()> task;
+
+        {
+            std::unique_lock<std::mutex> lk(queue_mutex);
+
+            queue_cv.wait(lk, [this] { return shutdown || queue.size() > 0; });
+
+            if (shutdown)
+                return;
+
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        task();
+    }
+}
+
+void kis_work_pool::submit(std::function<void ()> fn) {
+    {
+        std::lock_guard<std::mutex> lk(queue_mutex);
+        queue.push_back(std::move(fn));
+    }
+
+    queue_cv.notify_one();
+}
+
+void kis_work_pool::run_shards(size_t n_shards, const std::function<void (size_t)>& fn) {
+    if (n_shards == 0)
+        return;
+
+    // Shared state outlives the call for any pool task which is dequeued after the
+    // caller has already finished every shard
+    struct shard_state {
+        shard_state(size_t n, const std::function<void (size_t)>& f) :
+            n_shards {n},
+            fn {f},
+            next {0},
+            complete {0} { }
+
+        size_t n_shards;
+        std::function<void (size_t)> fn;
+
+        std::atomic<size_t> next;
+
+        std::mutex complete_mutex;
+        std::condition_variable complete_cv;
+        size_t complete;
+        std::exception_ptr error;
+    };
+
+    auto state = std::make_shared<shard_state>(n_shards, fn);
+
+    auto run = [state]() {
+        size_t shard;
+
+        while ((shard = state->next++) < state->n_shards) {
+            std::exception_ptr e;
+
+            try {
+                state->fn(shard);
+            } catch (...) {
+                e = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lk(state->complete_mutex);
+
+            if (e != nullptr && state->error == nullptr)
+                state->error = e;
+
+            if (++state->complete == state->n_shards)
+                state->complete_cv.notify_all();
+        }
+    };
+
+    // Wake up to one pool thread per remaining shard; the caller takes a share too
+    size_t helpers = std::min<size_t>(threads.size(), n_shards - 1);
+
+    if (helpers > 0) {
+        {
+            std::lock_guard<std::mutex> lk(queue_mutex);
+            for (size_t i = 0; i < helpers; i++)
+                queue.push_back(run);
+        }
+
+        queue_cv.notify_all();
+    }
+
+    run();
+
+    std::unique_lock<std::mutex> lk(state->complete_mutex);
+    state->complete_cv.wait(lk, [state] { return state->complete == state->n_shards; });
+
+    if (state->error != nullptr)
+        std::rethrow_exception(state->error);
+}
+
@@ -0,0 +1,73 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_WORK_POOL_H__
+#define __KIS_WORK_POOL_H__
+
+#include "config.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Simple fixed-size pool of threads for splitting CPU-bound work, such as filtering
+// the device list, into shards.
+//
+// The calling thread participates in the work, so a pool is never required to make
+// progress and a shard may safely run more sharded work.
+class kis_work_pool {
+public:
+    kis_work_pool(const std::string& in_name, unsigned int in_threads);
+    ~kis_work_pool();
+
+    kis_work_pool(const kis_work_pool&) = delete;
+    kis_work_pool& operator=(const kis_work_pool&) = delete;
+
+    unsigned int get_threads() const {
+        return threads.size();
+    }
+
+    // Call fn(shard) for every shard in [0, n_shards) across the pool and the calling
+    // thread, and wait for all of them to complete.  Shards may run in any order.  If
+    // a shard throws, the first exception is re-thrown to the caller once all shards
+    // have finished.
+    void run_shards(size_t n_shards, const std::function<void (size_t)>& fn);
+
+    // Queue a single task to run on a pool thread without waiting for it.  Tasks
+    // still queued when the pool is destroyed are discarded.
+    void submit(std::function<void ()> fn);
+
+protected:
+    void worker_thread();
+
+    std::string name;
+
+    std::vector<std::thread> threads;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<std::function<void ()>> queue;
+    bool shutdown;
+};
+
+#endif
+
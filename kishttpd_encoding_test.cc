@@ -0,0 +1,213 @@
+/* test harness for http content encoding
+ *
+ * Checks the parsing of Accept-Encoding used to pick the content encoding of streamed
+ * responses: weights of q=0 refusing a coding, the '*' wildcard and an explicit entry
+ * for the coding overriding it, and case and whitespace in codings and weights.
+ *
+ * Also checks that a gzip stream built the way the all_devices.ekjson generator builds
+ * it, with the connection stream synced between chunks, is a single gzip member which
+ * inflates back to the original data.
+ *
+ * # configure kismet
+ * ./configure
+ *
+ * # build kismet
+ * make
+ *
+ * # build test harness
+ * g++ -o kishttpd_encoding_test kishttpd_encoding_test.cc util.cc.o macaddr.cc.o -lz
+ *
+ * ./kishttpd_encoding_test
+ *
+ */
+
+#include "config.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <stdio.h>
+
+#include <zlib.h>
+
+#include "test_harness.h"
+#include "util.h"
+#include "zstr.hpp"
+
+static void expect_accepts(const std::string& accept, const std::string& encoding, bool want) {
+    expect("'" + accept + "' " + (want ? "accepts " : "refuses ") + encoding,
+            http_accepts_encoding(accept, encoding) == want);
+}
+
+static void check_accept_encoding() {
+    expect_accepts("", "gzip", false);
+    expect_accepts("gzip", "gzip", true);
+    expect_accepts("deflate", "gzip", false);
+    expect_accepts("gzip, deflate, br", "gzip", true);
+    expect_accepts("deflate, br", "gzip", false);
+    expect_accepts("gzip,,deflate", "gzip", true);
+    expect_accepts(",;", "gzip", false);
+
+    // Codings are only matched whole
+    expect_accepts("x-gzip", "gzip", false);
+    expect_accepts("gzipped", "gzip", false);
+
+    // Case
+    expect_accepts("GZIP", "gzip", true);
+    expect_accepts("Gzip;Q=1", "gzip", true);
+    expect_accepts("gzip", "GZip", true);
+    expect_accepts("GZIP;Q=0", "gzip", false);
+
+    // Whitespace around codings, separators and weights
+    expect_accepts(" gzip ", "gzip", true);
+    expect_accepts("deflate ,\tgzip", "gzip", true);
+    expect_accepts("gzip ; q=0.5", "gzip", true);
+    expect_accepts("gzip ;q=0", "gzip", false);
+    expect_accepts("gzip;\tq=0", "gzip", false);
+    expect_accepts("gzip; q = 0", "gzip", false);
+    expect_accepts("deflate, gzip ; q=0 ", "gzip", false);
+
+    // Weights
+    expect_accepts("gzip;q=0", "gzip", false);
+    expect_accepts("gzip;q=0.000", "gzip", false);
+    expect_accepts("gzip;q=0.001", "gzip", true);
+    expect_accepts("gzip;q=1", "gzip", true);
+    expect_accepts("gzip;q=1.0", "gzip", true);
+    expect_accepts("deflate;q=0, gzip;q=0.2", "gzip", true);
+    expect_accepts("gzip;level=9", "gzip", true);
+    expect_accepts("gzip;level=0", "gzip", true);
+
+    // Wildcard, and an entry for the coding itself taking precedence over it
+    expect_accepts("*", "gzip", true);
+    expect_accepts("*;q=0.5", "gzip", true);
+    expect_accepts("*;q=0", "gzip", false);
+    expect_accepts("deflate, *", "gzip", true);
+    expect_accepts("identity;q=1, *;q=0", "gzip", false);
+    expect_accepts("gzip;q=0, *", "gzip", false);
+    expect_accepts("*, gzip;q=0", "gzip", false);
+    expect_accepts("*;q=0, gzip", "gzip", true);
+    expect_accepts("gzip, *;q=0", "gzip", true);
+}
+
+// Inflate a gzip stream, returning the number of members and the inflated data; the
+// data must end with the last member
+static bool gunzip(const std::string& in, std::string& out, unsigned int& members) {
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+
+    // Window bits + 16 accepts only the gzip format
+    if (inflateInit2(&zs, 15 + 16) != Z_OK)
+        return false;
+
+    zs.next_in = (Bytef *) in.data();
+    zs.avail_in = in.size();
+
+    members = 0;
+    out.clear();
+
+    bool ok = true;
+
+    while (zs.avail_in > 0) {
+        char buf[4096];
+
+        zs.next_out = (Bytef *) buf;
+        zs.avail_out = sizeof(buf);
+
+        auto r = inflate(&zs, Z_NO_FLUSH);
+
+        out.append(buf, sizeof(buf) - zs.avail_out);
+
+        if (r == Z_STREAM_END) {
+            members++;
+            inflateReset(&zs);
+            continue;
+        }
+
+        if (r != Z_OK) {
+            ok = false;
+            break;
+        }
+    }
+
+    // Everything was consumed by complete members
+    if (ok && (members == 0 || zs.total_in != 0))
+        ok = false;
+
+    inflateEnd(&zs);
+
+    return ok;
+}
+
+static void check_gzip_stream() {
+    std::stringbuf sink;
+    std::ostream stream(&sink);
+
+    std::string data;
+
+    {
+        // The same construction and teardown as the all_devices.ekjson generator
+        std::unique_ptr<zstr::ostreambuf> zbuf;
+        std::unique_ptr<std::ostream> zstream;
+
+        zbuf.reset(new zstr::ostreambuf(stream.rdbuf(), 1 << 16));
+        zstream.reset(new std::ostream(zbuf.get()));
+
+        std::ostream *out = zstream.get();
+
+        // Enough records to fill the compression buffer several times over, with the
+        // connection stream synced between chunks the way the httpd syncs it
+        for (unsigned int i = 0; i < 20000; i++) {
+            std::stringstream line;
+
+            line << "{\"kismet.device.base.key\": \"" << i * 7919 << "_" << i << "\", " <<
+                "\"kismet.device.base.packets.total\": " << i * 31 << "}\n";
+
+            data += line.str();
+            *out << line.str();
+
+            if ((i + 1) % 64 == 0)
+                stream.flush();
+        }
+
+        zstream.reset();
+        zbuf.reset();
+    }
+
+    auto compressed = sink.str();
+    std::string inflated;
+    unsigned int members;
+
+    expect("compressed", compressed.size() > 0 && compressed.size() < data.size());
+    expect("gzip stream inflates", gunzip(compressed, inflated, members));
+    expect("single gzip member", members == 1);
+    expect("gzip stream round trips", inflated == data);
+
+    // Flushing the compressed stream itself finishes the member, which is why the
+    // generator never flushes it before the end
+    std::stringbuf split_sink;
+
+    {
+        zstr::ostreambuf zbuf(&split_sink, 1 << 16);
+        std::ostream out(&zbuf);
+
+        out << "first\n";
+        out.flush();
+        out << "second\n";
+    }
+
+    expect("flushed gzip stream inflates", gunzip(split_sink.str(), inflated, members));
+    expect("flush ends the gzip member", members == 2);
+    expect("flushed gzip stream round trips", inflated == "first\nsecond\n");
+}
+
+int main(int argc, char *argv[]) {
+    check_accept_encoding();
+    check_gzip_stream();
+
+    printf("%u failures\n", test_failures());
+
+    return test_failures() == 0 ? 0 : 1;
+}
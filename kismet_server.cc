@@ -112,6 +112,7 @@
 #include "manuf.h"
 #include "entrytracker.h"
 #include "json_adapter.h"
+#include "msgpack_adapter.h"
 
 #ifndef exec_name
 char *exec_name;
@@ -756,11 +757,16 @@ int main(int argc, char *argv[], char *envp[]) {
         SpindownKismet(pollabletracker);
 
     // Base serializers
-    entrytracker->register_serializer("json", std::make_shared<json_adapter::serializer>());
-    entrytracker->register_serializer("ekjson", std::make_shared<ek_json_adapter::serializer>());
-    entrytracker->register_serializer("itjson", std::make_shared<it_json_adapter::serializer>());
+    entrytracker->register_serializer("json", 
+            std::make_shared<fast_json_adapter::serializer>(fast_json_adapter::json_mode::json));
+    entrytracker->register_serializer("ekjson", 
+            std::make_shared<fast_json_adapter::serializer>(fast_json_adapter::json_mode::ekjson));
+    entrytracker->register_serializer("itjson", 
+            std::make_shared<fast_json_adapter::serializer>(fast_json_adapter::json_mode::itjson));
     entrytracker->register_serializer("prettyjson", std::make_shared<pretty_json_adapter::serializer>());
     entrytracker->register_serializer("storagejson", std::make_shared<storage_json_adapter::serializer>());
+    entrytracker->register_serializer("msgpack", std::make_shared<msgpack_adapter::serializer>());
+    entrytracker->register_serializer("storagemsgpack", std::make_shared<storage_msgpack_adapter::serializer>());
 
     entrytracker->register_serializer("jcmd", std::make_shared<json_adapter::serializer>());
     entrytracker->register_serializer("cmd", std::make_shared<json_adapter::serializer>());
@@ -18,14 +18,22 @@
 
 #include "config.h"
 
+#include <atomic>
+
 #include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "configfile.h"
 #include "entrytracker.h"
 #include "messagebus.h"
 #include "util.h"
 #include "manuf.h"
 
-kis_manuf::kis_manuf() {
+kis_manuf::kis_manuf() :
+    source_size {0},
+    source_mtime {0} {
+
     auto entrytracker = Globalreg::fetch_mandatory_global_as<entry_tracker>();
 
     manuf_id = 
@@ -82,261 +90,140 @@ kis_manuf::kis_manuf() {
 
     for (auto f : fname) {
         auto expanded = Globalreg::globalreg->kismet_config->expand_log_path(f, "", "", 0, 1);
+        struct stat sbuf;
 
-        if ((mfile = fopen(expanded.c_str(), "r")) != NULL) {
+        if (stat(expanded.c_str(), &sbuf) == 0 && access(expanded.c_str(), R_OK) == 0) {
             _MSG("Opened OUI file '" + expanded, MSGFLAG_INFO);
+            oui_path = expanded;
+            source_size = sbuf.st_size;
+            source_mtime = sbuf.st_mtime;
             break;
         }
 
         _MSG("Could not open OUI file '" + expanded + "': " + std::string(strerror(errno)), MSGFLAG_INFO);
     }
 
-    if (mfile == NULL) {
+    if (oui_path.length() == 0) {
         _MSG("No OUI files were available, will not resolve manufacturer "
              "names for MAC addresses", MSGFLAG_ERROR);
         return;
     }
 
+    auto config_dir_path_raw = 
+        Globalreg::globalreg->kismet_config->fetch_opt("configdir");
+
+    if (config_dir_path_raw.length() != 0)
+        cache_path = 
+            Globalreg::globalreg->kismet_config->expand_log_path(config_dir_path_raw, 
+                    "", "", 0, 1) + "/kismet_manuf.bin";
+
     IndexOUI();
 }
 
-void kis_manuf::IndexOUI() {
-    char buf[1024];
-    int line = 0;
-    fpos_t prev_pos;
-    short int m[3];
-    uint32_t last_oui = 0;
+kis_manuf::~kis_manuf() {
 
-    local_locker l(&mutex);
+}
 
-    if (mfile == NULL)
+void kis_manuf::IndexOUI() {
+    if (oui_path.length() == 0 || table.valid())
         return;
 
-    _MSG("Indexing manufacturer db", MSGFLAG_INFO);
-
-    fgetpos(mfile, &prev_pos);
-
-    while (!feof(mfile)) {
-        if (fgets(buf, 1024, mfile) == NULL || feof(mfile))
-            break;
-
-        if ((line % 50) == 0) {
-            if (sscanf(buf, "%hx:%hx:%hx",
-                       &(m[0]), &(m[1]), &(m[2])) == 3) {
-
-                // Log a position at the previous pos - which is the line before
-                // this one, so we're inclusive
-                index_pos ip;
-                uint32_t oui;
-
-                oui = 0;
-                oui |= (uint32_t) m[0] << 16;
-                oui |= (uint32_t) m[1] << 8;
-                oui |= (uint32_t) m[2];
-
-                if (oui < last_oui) {
-                    _MSG("Warning:  kis_manuf file appears to be out of order, expected "
-                            "sorted manuf OUI data", MSGFLAG_ERROR);
-                }
-
-                ip.oui = oui;
-                ip.pos = prev_pos;
-
-                last_oui = oui;
-
-                index_vec.push_back(ip);
-            } else {
-                // Compensate for not getting a reasonable line (probably a
-                // comment) by decrementing here so we keep trying at each
-                // index point until we get info we're looking for
-                line--;
-            }
-        }
+    // Use the compiled cache if it matches the OUI file
+    if (cache_path.length() != 0 && table.map_file(cache_path, source_size, source_mtime)) {
+        entry_manufs.clear();
+        entry_manufs.resize(table.size());
 
-        fgetpos(mfile, &prev_pos);
-        line++;
+        _MSG_INFO("Loaded compiled manufacturer db '{}', {} entries", cache_path, table.size());
+        return;
     }
 
-    _MSG("Completed indexing manufacturer db, " + int_to_string(line) + " lines " +
-         int_to_string(index_vec.size()) + " indexes", MSGFLAG_INFO);
-}
-
-std::shared_ptr<tracker_element_string> kis_manuf::lookup_oui(mac_addr in_mac) {
-    uint32_t soui = in_mac.OUI(), toui;
-    int matched = -1;
-    char buf[1024];
-    short int m[3];
-
-    if (mfile == NULL)
-        return unknown_manuf;
+    _MSG("Indexing manufacturer db", MSGFLAG_INFO);
 
-    {
-        local_shared_locker sl(&mutex);
+    FILE *mfile = fopen(oui_path.c_str(), "r");
 
-        // Use the cache first
-        if (oui_map.find(soui) != oui_map.end()) {
-            return oui_map[soui].manuf;
-        }
+    if (mfile == NULL) {
+        _MSG_ERROR("Could not open OUI file '{}': {}", oui_path, strerror(errno));
+        return;
+    }
 
-        for (unsigned int x = 0; x < index_vec.size(); x++) {
-            if (soui > index_vec[x].oui) {
-                matched = x;
-                continue;
-            }
+    std::string image;
+    auto lines = kis_manuf_table::compile(mfile, source_size, source_mtime, image);
+    fclose(mfile);
 
-            break;
-        }
+    // Save the compiled table for the next run and map it; if the cache can't be 
+    // written, use the copy in memory
+    if (cache_path.length() != 0) {
+        auto tmp_path = cache_path + ".tmp";
+        FILE *cfile = fopen(tmp_path.c_str(), "wb");
 
-        // Cache unknown to save us effort in the future
-        if (matched < 0) {
-            manuf_data md;
-            md.oui = soui;
-            md.manuf = unknown_manuf;
-            oui_map[soui] = md;
+        if (cfile != NULL) {
+            bool written = fwrite(image.data(), image.length(), 1, cfile) == 1;
+            written = (fclose(cfile) == 0) && written;
 
-            return md.manuf;
+            if (written && rename(tmp_path.c_str(), cache_path.c_str()) == 0) 
+                table.map_file(cache_path, source_size, source_mtime);
+            else
+                unlink(tmp_path.c_str());
         }
 
-        // Jump backwards one index in the matching unless we're in the first block
-        if (matched > 0)
-            matched -= 1;
+        if (!table.valid())
+            _MSG_INFO("Could not save compiled manufacturer db to '{}', keeping it in memory",
+                    cache_path);
     }
 
-    {
-        local_locker l(&mutex);
+    if (!table.valid())
+        table.use_image(std::move(image), source_size, source_mtime);
 
-        fsetpos(mfile, &(index_vec[matched].pos));
+    entry_manufs.clear();
+    entry_manufs.resize(table.size());
 
-        while (!feof(mfile)) {
-            if (fgets(buf, 1024, mfile) == NULL || feof(mfile))
-                break;
+    _MSG_INFO("Compiled manufacturer db, {} lines {} entries", lines, table.size());
+}
 
-            if (strlen(buf) < 10)
-                continue;
+std::shared_ptr<tracker_element_string> kis_manuf::entry_manuf(size_t in_entry) {
+    auto manuf = std::atomic_load(&entry_manufs[in_entry]);
 
-            // Trim \n
-            auto mlen = strlen(buf + 9) - 1;
+    if (manuf != nullptr)
+        return manuf;
 
-            if (mlen == 0)
-                continue;
+    auto new_manuf = std::make_shared<tracker_element_string>(manuf_id);
+    new_manuf->set(table.entry_name(in_entry));
 
+    // Someone else may have beaten us to it; everyone uses the same record
+    if (!std::atomic_compare_exchange_strong(&entry_manufs[in_entry], &manuf, new_manuf))
+        return manuf;
 
-            if (sscanf(buf, "%hx:%hx:%hx\t", &(m[0]), &(m[1]), &(m[2])) == 3) {
+    return new_manuf;
+}
 
-                // Log a position at the previous pos - which is the line before
-                // this one, so we're inclusive
-                toui = mac_addr::OUI(m);
+std::shared_ptr<tracker_element_string> kis_manuf::lookup_oui(mac_addr in_mac) {
+    if (oui_map.size() > 0) {
+        auto cm = oui_map.find(in_mac.OUI());
 
-                if (toui == soui) {
-                    manuf_data md;
-                    md.oui = soui;
+        if (cm != oui_map.end())
+            return cm->second.manuf;
+    }
 
-                    md.manuf = std::make_shared<tracker_element_string>(manuf_id);
-                    md.manuf->set(munge_to_printable(std::string(buf + 9, mlen)));
-                    oui_map[soui] = md;
-                    return md.manuf;
-                }
+    auto e = table.lookup(in_mac.longmac);
 
-                if (toui > soui) {
-                    manuf_data md;
-                    md.oui = soui;
-                    md.manuf = unknown_manuf;
-                    oui_map[soui] = md;
-                    return md.manuf;
-                }
-            }
-        }
-    }
+    if (e >= 0)
+        return entry_manuf(e);
 
     return unknown_manuf;
 }
 
 std::shared_ptr<tracker_element_string> kis_manuf::lookup_oui(uint32_t in_oui) {
-    uint32_t soui = in_oui, toui;
-    int matched = -1;
-    char buf[1024];
-    short int m[3];
-
-    if (mfile == NULL)
-        return unknown_manuf;
-
-    {
-        local_shared_locker sl(&mutex);
-
-        // Use the cache first
-        if (oui_map.find(soui) != oui_map.end()) {
-            return oui_map[soui].manuf;
-        }
+    if (oui_map.size() > 0) {
+        auto cm = oui_map.find(in_oui);
 
-        for (unsigned int x = 0; x < index_vec.size(); x++) {
-            if (soui > index_vec[x].oui) {
-                matched = x;
-                continue;
-            }
-
-            break;
-        }
-
-        // Cache unknown to save us effort in the future
-        if (matched < 0) {
-            manuf_data md;
-            md.oui = soui;
-            md.manuf = unknown_manuf;
-            oui_map[soui] = md;
-
-            return md.manuf;
-        }
-
-        // Jump backwards one index in the matching unless we're in the first block
-        if (matched > 0)
-            matched -= 1;
+        if (cm != oui_map.end())
+            return cm->second.manuf;
     }
 
-    {
-        local_locker l(&mutex); 
-
-        fsetpos(mfile, &(index_vec[matched].pos));
-
-        while (!feof(mfile)) {
-            if (fgets(buf, 1024, mfile) == NULL || feof(mfile))
-                break;
-
-            if (strlen(buf) < 10)
-                continue;
-
-            // Trim \n
-            auto mlen = strlen(buf + 9) - 1;
-
-            if (mlen == 0)
-                continue;
-
+    auto e = table.find_entry((uint64_t) (in_oui & 0xFFFFFF) << 24, 24);
 
-            if (sscanf(buf, "%hx:%hx:%hx\t", &(m[0]), &(m[1]), &(m[2])) == 3) {
-
-                // Log a position at the previous pos - which is the line before
-                // this one, so we're inclusive
-                toui = mac_addr::OUI(m);
-
-                if (toui == soui) {
-                    manuf_data md;
-                    md.oui = soui;
-
-                    md.manuf = std::make_shared<tracker_element_string>(manuf_id);
-                    md.manuf->set(munge_to_printable(std::string(buf + 9, mlen)));
-                    oui_map[soui] = md;
-                    return md.manuf;
-                }
-
-                if (toui > soui) {
-                    manuf_data md;
-                    md.oui = soui;
-                    md.manuf = unknown_manuf;
-                    oui_map[soui] = md;
-                    return md.manuf;
-                }
-            }
-        }
-    }
+    if (e >= 0)
+        return entry_manuf(e);
 
     return unknown_manuf;
 }
@@ -350,4 +237,3 @@ std::shared_ptr<tracker_element_string> kis_manuf::make_manuf(const std::string&
 bool kis_manuf::is_unknown_manuf(std::shared_ptr<tracker_element_string> in_manuf) {
     return in_manuf == unknown_manuf;
 }
-
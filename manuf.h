@@ -34,16 +34,28 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include "util.h"
 #include "globalregistry.h"
+#include "manuf_table.h"
 
 #include "trackedelement.h"
 
+// Manufacturer lookup.
+//
+// The text OUI file is compiled into a sorted binary table (see manuf_table.h), which 
+// is cached in the Kismet config directory and memory-mapped on later runs.  The table
+// holds the IEEE MA-L (24 bit) blocks as well as the MA-M (28 bit) and MA-S (36 bit) 
+// blocks when the OUI file provides them, in the Wireshark 'aa:bb:cc:dd:ee:ff/36' format.
+//
+// The table is immutable once loaded, so lookups take no locks.
 class kis_manuf {
 public:
     kis_manuf();
+    ~kis_manuf();
 
+    // Load the OUI table, compiling it if the cached copy is missing or out of date
     void IndexOUI();
 
     std::shared_ptr<tracker_element_string> lookup_oui(mac_addr in_mac);
@@ -55,11 +67,6 @@ public:
         return random_manuf;
     }
 
-    struct index_pos {
-        uint32_t oui;
-        fpos_t pos;
-    };
-
     struct manuf_data {
         uint32_t oui;
         std::shared_ptr<tracker_element_string> manuf;
@@ -68,13 +75,24 @@ public:
     bool is_unknown_manuf(std::shared_ptr<tracker_element_string> in_manuf);
 
 protected:
-    kis_recursive_timed_mutex mutex;
+    std::shared_ptr<tracker_element_string> entry_manuf(size_t in_entry);
 
-    std::vector<index_pos> index_vec;
+    std::string oui_path;
+    std::string cache_path;
 
-    std::unordered_map<uint32_t, manuf_data> oui_map;
+    uint64_t source_size;
+    int64_t source_mtime;
 
-    FILE *mfile;
+    // Mapped cache file, or the table built in memory if the cache can't be written
+    kis_manuf_table table;
+
+    // Manufacturer elements are only created the first time an entry is matched, and
+    // are shared by every device with that manufacturer; slots are published with 
+    // atomic shared_ptr operations
+    std::vector<std::shared_ptr<tracker_element_string>> entry_manufs;
+
+    // Manufacturers from the config file, which override the table
+    std::unordered_map<uint32_t, manuf_data> oui_map;
 
     // IDs for manufacturer objects
     int manuf_id;
@@ -0,0 +1,260 @@
+/* benchmark harness for the Kismet manufacturer lookup
+ *
+ * Compares the compiled OUI table (manuf_table.cc) against the previous lookup,
+ * which scanned a sparse index of every 50th line and then re-read the text file
+ * with fsetpos/fgets/sscanf.  The previous path is reproduced here with its cache
+ * of results disabled, since randomized MACs make nearly every lookup a miss.
+ *
+ * Lookups are made for MACs drawn from the OUI file (hits) and for random locally
+ * administered MACs (misses).  The results of the two paths are compared for every
+ * MA-L lookup.
+ *
+ * # configure and build kismet
+ * ./configure
+ * make
+ *
+ * # build benchmark
+ * g++ -O2 -o manuf_bench manuf_bench.cc manuf_table.cc.o util.cc.o
+ *
+ * ./manuf_bench conf/kismet_manuf.txt [lookups]
+ *
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "manuf_table.h"
+#include "util.h"
+
+// The previous implementation: sparse file index and a re-read of the text file
+class legacy_manuf {
+public:
+    legacy_manuf(FILE *in_file) : mfile {in_file} {
+        char buf[1024];
+        int line = 0;
+        fpos_t prev_pos;
+        short int m[3];
+
+        fgetpos(mfile, &prev_pos);
+
+        while (!feof(mfile)) {
+            if (fgets(buf, 1024, mfile) == NULL || feof(mfile))
+                break;
+
+            if ((line % 50) == 0) {
+                if (sscanf(buf, "%hx:%hx:%hx", &(m[0]), &(m[1]), &(m[2])) == 3) {
+                    index_pos ip;
+
+                    ip.oui = ((uint32_t) m[0] << 16) | ((uint32_t) m[1] << 8) | (uint32_t) m[2];
+                    ip.pos = prev_pos;
+
+                    index_vec.push_back(ip);
+                } else {
+                    line--;
+                }
+            }
+
+            fgetpos(mfile, &prev_pos);
+            line++;
+        }
+    }
+
+    // Returns the name, or an empty string when unknown
+    std::string lookup(uint32_t soui) {
+        char buf[1024];
+        short int m[3];
+        int matched = -1;
+
+        for (unsigned int x = 0; x < index_vec.size(); x++) {
+            if (soui > index_vec[x].oui) {
+                matched = x;
+                continue;
+            }
+
+            break;
+        }
+
+        if (matched < 0)
+            return "";
+
+        if (matched > 0)
+            matched -= 1;
+
+        fsetpos(mfile, &(index_vec[matched].pos));
+
+        while (!feof(mfile)) {
+            if (fgets(buf, 1024, mfile) == NULL || feof(mfile))
+                break;
+
+            if (strlen(buf) < 10)
+                continue;
+
+            auto mlen = strlen(buf + 9) - 1;
+
+            if (mlen == 0)
+                continue;
+
+            if (sscanf(buf, "%hx:%hx:%hx\t", &(m[0]), &(m[1]), &(m[2])) == 3) {
+                uint32_t toui =
+                    ((uint32_t) m[0] << 16) | ((uint32_t) m[1] << 8) | (uint32_t) m[2];
+
+                if (toui == soui)
+                    return munge_to_printable(std::string(buf + 9, mlen));
+
+                if (toui > soui)
+                    return "";
+            }
+        }
+
+        return "";
+    }
+
+protected:
+    struct index_pos {
+        uint32_t oui;
+        fpos_t pos;
+    };
+
+    FILE *mfile;
+    std::vector<index_pos> index_vec;
+};
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s ouifile [lookups]\n", argv[0]);
+        exit(1);
+    }
+
+    size_t n_lookups = 200000;
+
+    if (argc > 2)
+        n_lookups = strtoul(argv[2], NULL, 10);
+
+    struct stat sbuf;
+
+    if (stat(argv[1], &sbuf) < 0) {
+        fprintf(stderr, "could not stat %s: %s\n", argv[1], strerror(errno));
+        exit(1);
+    }
+
+    FILE *mfile = fopen(argv[1], "r");
+
+    if (mfile == NULL) {
+        fprintf(stderr, "could not open %s: %s\n", argv[1], strerror(errno));
+        exit(1);
+    }
+
+    // Compile the table
+    auto start = std::chrono::steady_clock::now();
+
+    std::string image;
+    auto lines = kis_manuf_table::compile(mfile, sbuf.st_size, sbuf.st_mtime, image);
+
+    kis_manuf_table table;
+    table.use_image(std::move(image), sbuf.st_size, sbuf.st_mtime);
+
+    auto compile_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+    printf("compiled %lu lines into %lu entries in %ld us\n", lines, table.size(),
+            (long) compile_us);
+
+    rewind(mfile);
+
+    start = std::chrono::steady_clock::now();
+    legacy_manuf legacy(mfile);
+    auto index_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+    printf("indexed with the previous method in %ld us\n", (long) index_us);
+
+    // Known OUIs from the file, and random locally administered macs
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> known_macs;
+    std::vector<uint64_t> random_macs;
+
+    rewind(mfile);
+
+    char buf[1024];
+    short int m[3];
+
+    while (fgets(buf, 1024, mfile) != NULL) {
+        if (sscanf(buf, "%hx:%hx:%hx\t", &(m[0]), &(m[1]), &(m[2])) == 3 && buf[8] == '\t') {
+            uint64_t oui = ((uint64_t) m[0] << 16) | ((uint64_t) m[1] << 8) | (uint64_t) m[2];
+            known_macs.push_back((oui << 24) | (rng() & 0xFFFFFF));
+        }
+    }
+
+    if (known_macs.size() == 0) {
+        fprintf(stderr, "no OUI records found in %s\n", argv[1]);
+        exit(1);
+    }
+
+    std::vector<uint64_t> hit_macs;
+    for (size_t i = 0; i < n_lookups; i++) {
+        hit_macs.push_back(known_macs[rng() % known_macs.size()]);
+        random_macs.push_back((rng() & 0xFFFFFFFFFFFFULL) | 0x020000000000ULL);
+    }
+
+    // Both paths have to agree on every MA-L lookup
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 1000 && i < hit_macs.size(); i++) {
+        auto e = table.find_entry(hit_macs[i] & 0xFFFFFF000000ULL, 24);
+        auto tname = e >= 0 ? table.entry_name(e) : std::string("");
+
+        if (tname != legacy.lookup(hit_macs[i] >> 24))
+            mismatches++;
+    }
+
+    auto bench = [](const char *name, const std::vector<uint64_t>& macs,
+            std::function<bool (uint64_t)> fn) {
+        size_t found = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto mac : macs)
+            if (fn(mac))
+                found++;
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+        printf("%-24s %8lu lookups %8lu found %10ld us %10.1f ns/lookup\n", name,
+                macs.size(), found, (long) us, (us * 1000.0f) / macs.size());
+    };
+
+    // The previous path is orders of magnitude slower; sample it
+    std::vector<uint64_t> legacy_hit(hit_macs.begin(),
+            hit_macs.begin() + std::min<size_t>(hit_macs.size(), 5000));
+    std::vector<uint64_t> legacy_random(random_macs.begin(),
+            random_macs.begin() + std::min<size_t>(random_macs.size(), 5000));
+
+    bench("previous, known", legacy_hit,
+            [&](uint64_t mac) { return legacy.lookup(mac >> 24).length() != 0; });
+    bench("previous, randomized", legacy_random,
+            [&](uint64_t mac) { return legacy.lookup(mac >> 24).length() != 0; });
+
+    bench("table, known", hit_macs,
+            [&](uint64_t mac) { return table.lookup(mac) >= 0; });
+    bench("table, randomized", random_macs,
+            [&](uint64_t mac) { return table.lookup(mac) >= 0; });
+
+    printf("%lu mismatches between the previous and table lookups\n", mismatches);
+
+    fclose(mfile);
+
+    return mismatches == 0 ? 0 : 1;
+}
+
@@ -0,0 +1,292 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "manuf_table.h"
+#include "util.h"
+
+#define MANUF_COMPILED_MAGIC "KISMANUF"
+#define MANUF_COMPILED_VERSION 1
+
+kis_manuf_table::kis_manuf_table() :
+    map_data {nullptr},
+    map_len {0},
+    table_header {nullptr},
+    table_entries {nullptr},
+    table_strings {nullptr} { }
+
+kis_manuf_table::~kis_manuf_table() {
+    reset();
+}
+
+void kis_manuf_table::reset() {
+    if (map_data != nullptr)
+        munmap(map_data, map_len);
+
+    map_data = nullptr;
+    map_len = 0;
+    mem_image.clear();
+
+    table_header = nullptr;
+    table_entries = nullptr;
+    table_strings = nullptr;
+    table_prefix_bits.clear();
+}
+
+size_t kis_manuf_table::compile(FILE *in_file, uint64_t in_source_size,
+        int64_t in_source_mtime, std::string& out_image) {
+    char buf[1024];
+    std::vector<compiled_entry> entries;
+    std::string strings;
+    size_t line = 0;
+
+    while (fgets(buf, 1024, in_file) != NULL) {
+        line++;
+
+        if (buf[0] == '#' || buf[0] == '\n' || buf[0] == '\r')
+            continue;
+
+        // Prefix is hex octets separated by ':' or '-', optionally followed by
+        // '/bits' for blocks smaller than a full OUI
+        char *name = strchr(buf, '\t');
+
+        if (name == NULL)
+            continue;
+
+        *name = 0;
+        name++;
+
+        uint64_t prefix = 0;
+        unsigned int n_octets = 0;
+        unsigned int bits = 0;
+        char *p = buf;
+
+        while (*p != 0 && n_octets < 6) {
+            char *end;
+            unsigned long octet = strtoul(p, &end, 16);
+
+            if (end == p || octet > 0xFF)
+                break;
+
+            prefix |= (uint64_t) octet << ((5 - n_octets) * 8);
+            n_octets++;
+
+            p = end;
+
+            if (*p == ':' || *p == '-')
+                p++;
+            else
+                break;
+        }
+
+        if (n_octets < 3)
+            continue;
+
+        if (*p == '/')
+            bits = strtoul(p + 1, NULL, 10);
+        else
+            bits = n_octets * 8;
+
+        if (bits < 8 || bits > 48)
+            continue;
+
+        prefix &= (~0ULL << (48 - bits)) & 0xFFFFFFFFFFFFULL;
+
+        // Trim the newline
+        size_t name_len = strlen(name);
+        while (name_len > 0 && (name[name_len - 1] == '\n' || name[name_len - 1] == '\r'))
+            name_len--;
+
+        if (name_len == 0)
+            continue;
+
+        auto printable = munge_to_printable(std::string(name, name_len));
+
+        if (printable.length() > 0xFFFF)
+            printable.resize(0xFFFF);
+
+        compiled_entry e;
+        e.prefix = prefix;
+        e.prefix_bits = bits;
+        e.name_offset = strings.length();
+        e.name_len = printable.length();
+        e.reserved = 0;
+
+        strings += printable;
+        entries.push_back(e);
+    }
+
+    // Keep the first record for any duplicated prefix
+    std::stable_sort(entries.begin(), entries.end(),
+            [](const compiled_entry& a, const compiled_entry& b) -> bool {
+                if (a.prefix == b.prefix)
+                    return a.prefix_bits < b.prefix_bits;
+                return a.prefix < b.prefix;
+            });
+
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                [](const compiled_entry& a, const compiled_entry& b) -> bool {
+                    return a.prefix == b.prefix && a.prefix_bits == b.prefix_bits;
+                }), entries.end());
+
+    compiled_header hdr;
+    memset(&hdr, 0, sizeof(compiled_header));
+    memcpy(hdr.magic, MANUF_COMPILED_MAGIC, sizeof(hdr.magic));
+    hdr.version = MANUF_COMPILED_VERSION;
+    hdr.num_entries = entries.size();
+    hdr.source_size = in_source_size;
+    hdr.source_mtime = in_source_mtime;
+    hdr.strings_len = strings.length();
+
+    out_image.clear();
+    out_image.reserve(sizeof(compiled_header) +
+            (sizeof(compiled_entry) * entries.size()) + strings.length());
+    out_image.append((const char *) &hdr, sizeof(compiled_header));
+    if (entries.size() > 0)
+        out_image.append((const char *) entries.data(), sizeof(compiled_entry) * entries.size());
+    out_image.append(strings);
+
+    return line;
+}
+
+bool kis_manuf_table::load(const char *in_data, size_t in_len, uint64_t in_source_size,
+        int64_t in_source_mtime) {
+    if (in_len < sizeof(compiled_header))
+        return false;
+
+    auto hdr = (const compiled_header *) in_data;
+
+    if (memcmp(hdr->magic, MANUF_COMPILED_MAGIC, sizeof(hdr->magic)) != 0 ||
+            hdr->version != MANUF_COMPILED_VERSION ||
+            hdr->source_size != in_source_size ||
+            hdr->source_mtime != in_source_mtime)
+        return false;
+
+    if (in_len != sizeof(compiled_header) +
+            ((size_t) hdr->num_entries * sizeof(compiled_entry)) + hdr->strings_len)
+        return false;
+
+    auto entries = (const compiled_entry *) (in_data + sizeof(compiled_header));
+    auto strings = in_data + sizeof(compiled_header) +
+        ((size_t) hdr->num_entries * sizeof(compiled_entry));
+
+    std::vector<uint8_t> bits;
+
+    for (size_t i = 0; i < hdr->num_entries; i++) {
+        if ((size_t) entries[i].name_offset + entries[i].name_len > hdr->strings_len)
+            return false;
+
+        if (std::find(bits.begin(), bits.end(), entries[i].prefix_bits) == bits.end())
+            bits.push_back(entries[i].prefix_bits);
+    }
+
+    std::sort(bits.begin(), bits.end(), std::greater<uint8_t>());
+
+    table_header = hdr;
+    table_entries = entries;
+    table_strings = strings;
+    table_prefix_bits = bits;
+
+    return true;
+}
+
+bool kis_manuf_table::map_file(const std::string& in_path, uint64_t in_source_size,
+        int64_t in_source_mtime) {
+    reset();
+
+    int fd = open(in_path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    struct stat sbuf;
+
+    if (fstat(fd, &sbuf) == 0 && sbuf.st_size > 0) {
+        void *m = mmap(NULL, sbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (m != MAP_FAILED) {
+            if (load((const char *) m, sbuf.st_size, in_source_size, in_source_mtime)) {
+                map_data = m;
+                map_len = sbuf.st_size;
+            } else {
+                munmap(m, sbuf.st_size);
+            }
+        }
+    }
+
+    close(fd);
+
+    return valid();
+}
+
+bool kis_manuf_table::use_image(std::string&& in_image, uint64_t in_source_size,
+        int64_t in_source_mtime) {
+    reset();
+
+    mem_image = std::move(in_image);
+
+    if (!load(mem_image.data(), mem_image.length(), in_source_size, in_source_mtime)) {
+        mem_image.clear();
+        return false;
+    }
+
+    return true;
+}
+
+ssize_t kis_manuf_table::find_entry(uint64_t in_prefix, uint8_t in_bits) const {
+    if (table_header == nullptr)
+        return -1;
+
+    auto end = table_entries + table_header->num_entries;
+
+    auto e = std::lower_bound(table_entries, end, std::make_pair(in_prefix, in_bits),
+            [](const compiled_entry& a, const std::pair<uint64_t, uint8_t>& k) -> bool {
+                if (a.prefix == k.first)
+                    return a.prefix_bits < k.second;
+                return a.prefix < k.first;
+            });
+
+    if (e == end || e->prefix != in_prefix || e->prefix_bits != in_bits)
+        return -1;
+
+    return e - table_entries;
+}
+
+ssize_t kis_manuf_table::lookup(uint64_t in_mac) const {
+    uint64_t mac = in_mac & 0xFFFFFFFFFFFFULL;
+
+    // Match the most specific block first
+    for (auto bits : table_prefix_bits) {
+        auto e = find_entry(mac & (~0ULL << (48 - bits)) & 0xFFFFFFFFFFFFULL, bits);
+
+        if (e >= 0)
+            return e;
+    }
+
+    return -1;
+}
+
@@ -0,0 +1,123 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __MANUF_TABLE_H__
+#define __MANUF_TABLE_H__
+
+#include "config.h"
+
+#include <stdio.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+// Compiled OUI table used by kis_manuf.
+//
+// The text OUI file is compiled into a sorted binary image: a header, fixed-size prefix
+// entries, and a string table.  The image can be written to disk and memory-mapped
+// later, or used from memory.  Entries carry a prefix length, so Wireshark-style MA-M
+// (28 bit) and MA-S (36 bit) blocks sit alongside the MA-L OUIs and are matched first.
+//
+// The table is immutable once loaded, so lookups take no locks.  It has no dependencies
+// on the rest of the server, so it can be used by standalone tools.
+class kis_manuf_table {
+public:
+    kis_manuf_table();
+    ~kis_manuf_table();
+
+    kis_manuf_table(const kis_manuf_table&) = delete;
+    kis_manuf_table& operator=(const kis_manuf_table&) = delete;
+
+    struct compiled_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t num_entries;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint32_t strings_len;
+        uint32_t reserved;
+    };
+
+    struct compiled_entry {
+        // Prefix as the high bits of a 48 bit mac, and the number of bits
+        uint64_t prefix;
+        uint32_t name_offset;
+        uint16_t name_len;
+        uint8_t prefix_bits;
+        uint8_t reserved;
+    };
+
+    // Compile a text OUI file into a table image; the size and mtime of the source
+    // are recorded so a cached image can be matched against the file later.  Returns
+    // the number of lines read.
+    static size_t compile(FILE *in_file, uint64_t in_source_size, int64_t in_source_mtime,
+            std::string& out_image);
+
+    // Map a compiled image from disk; fails if it doesn't match the source
+    bool map_file(const std::string& in_path, uint64_t in_source_size, int64_t in_source_mtime);
+
+    // Take ownership of an image built in memory
+    bool use_image(std::string&& in_image, uint64_t in_source_size, int64_t in_source_mtime);
+
+    bool valid() const {
+        return table_header != nullptr;
+    }
+
+    size_t size() const {
+        return table_header == nullptr ? 0 : table_header->num_entries;
+    }
+
+    // Find the entry matching a prefix exactly, or -1
+    ssize_t find_entry(uint64_t in_prefix, uint8_t in_bits) const;
+
+    // Find the most specific entry matching a 48 bit mac, or -1
+    ssize_t lookup(uint64_t in_mac) const;
+
+    std::string entry_name(size_t in_entry) const {
+        return std::string(table_strings + table_entries[in_entry].name_offset,
+                table_entries[in_entry].name_len);
+    }
+
+protected:
+    bool load(const char *in_data, size_t in_len, uint64_t in_source_size,
+            int64_t in_source_mtime);
+
+    void reset();
+
+    // Mapped cache file, or the table built in memory
+    void *map_data;
+    size_t map_len;
+    std::string mem_image;
+
+    const compiled_header *table_header;
+    const compiled_entry *table_entries;
+    const char *table_strings;
+
+    // Distinct prefix lengths in the table, longest first
+    std::vector<uint8_t> table_prefix_bits;
+};
+
+#endif
+
@@ -0,0 +1,1021 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+
+#include "msgpack_adapter.h"
+
+#include "endian_magic.h"
+#include "entrytracker.h"
+#include "globalregistry.h"
+#include "macaddr.h"
+#include "trackedelement.h"
+#include "uuid.h"
+
+namespace {
+
+// Output buffer and the element walkers for both msgpack formats
+class packer {
+public:
+    packer(std::ostream& in_stream,
+            std::shared_ptr<tracker_element_serializer::rename_map> in_name_map,
+            const std::function<std::string (int)>& in_name_fn = nullptr) :
+        stream {in_stream},
+        name_map {in_name_map},
+        name_fn {in_name_fn} {
+        buf.reserve(flush_size + 4096);
+    }
+
+    ~packer() {
+        flush();
+    }
+
+    void flush() {
+        if (buf.length() != 0) {
+            stream.write(buf.data(), buf.length());
+            buf.clear();
+        }
+    }
+
+    void maybe_flush() {
+        if (buf.length() >= flush_size)
+            flush();
+    }
+
+    void put(uint8_t c) {
+        buf.push_back(static_cast<char>(c));
+    }
+
+    void put(const void *data, size_t len) {
+        buf.append(static_cast<const char *>(data), len);
+    }
+
+    void put_be(uint64_t v, unsigned int width) {
+        for (unsigned int i = width; i > 0; i--)
+            put(static_cast<uint8_t>(v >> ((i - 1) * 8)));
+    }
+
+    void put_nil() {
+        put(0xc0);
+    }
+
+    void put_uint(uint64_t v) {
+        if (v < 0x80) {
+            put(static_cast<uint8_t>(v));
+        } else if (v <= 0xFF) {
+            put(0xcc);
+            put_be(v, 1);
+        } else if (v <= 0xFFFF) {
+            put(0xcd);
+            put_be(v, 2);
+        } else if (v <= 0xFFFFFFFF) {
+            put(0xce);
+            put_be(v, 4);
+        } else {
+            put(0xcf);
+            put_be(v, 8);
+        }
+    }
+
+    void put_int(int64_t v) {
+        if (v >= 0) {
+            put_uint(static_cast<uint64_t>(v));
+        } else if (v >= -32) {
+            put(static_cast<uint8_t>(v));
+        } else if (v >= INT8_MIN) {
+            put(0xd0);
+            put_be(static_cast<uint64_t>(v), 1);
+        } else if (v >= INT16_MIN) {
+            put(0xd1);
+            put_be(static_cast<uint64_t>(v), 2);
+        } else if (v >= INT32_MIN) {
+            put(0xd2);
+            put_be(static_cast<uint64_t>(v), 4);
+        } else {
+            put(0xd3);
+            put_be(static_cast<uint64_t>(v), 8);
+        }
+    }
+
+    void put_float(float f) {
+        uint32_t v;
+        memcpy(&v, &f, sizeof(v));
+        put(0xca);
+        put_be(v, 4);
+    }
+
+    void put_double(double d) {
+        uint64_t v;
+        memcpy(&v, &d, sizeof(v));
+        put(0xcb);
+        put_be(v, 8);
+    }
+
+    void put_str(const char *s, size_t len) {
+        if (len < 32) {
+            put(static_cast<uint8_t>(0xa0 | len));
+        } else if (len <= 0xFF) {
+            put(0xd9);
+            put_be(len, 1);
+        } else if (len <= 0xFFFF) {
+            put(0xda);
+            put_be(len, 2);
+        } else {
+            put(0xdb);
+            put_be(len, 4);
+        }
+
+        put(s, len);
+    }
+
+    void put_str(const std::string& s) {
+        put_str(s.data(), s.length());
+    }
+
+    void put_bin(const std::string& s) {
+        if (s.length() <= 0xFF) {
+            put(0xc4);
+            put_be(s.length(), 1);
+        } else if (s.length() <= 0xFFFF) {
+            put(0xc5);
+            put_be(s.length(), 2);
+        } else {
+            put(0xc6);
+            put_be(s.length(), 4);
+        }
+
+        put(s.data(), s.length());
+    }
+
+    void put_array(size_t n) {
+        if (n < 16) {
+            put(static_cast<uint8_t>(0x90 | n));
+        } else if (n <= 0xFFFF) {
+            put(0xdc);
+            put_be(n, 2);
+        } else {
+            put(0xdd);
+            put_be(n, 4);
+        }
+    }
+
+    void put_map(size_t n) {
+        if (n < 16) {
+            put(static_cast<uint8_t>(0x80 | n));
+        } else if (n <= 0xFFFF) {
+            put(0xde);
+            put_be(n, 2);
+        } else {
+            put(0xdf);
+            put_be(n, 4);
+        }
+    }
+
+    void put_ext_header(msgpack_adapter::ext_type type, size_t len) {
+        switch (len) {
+            case 1:
+                put(0xd4);
+                break;
+            case 2:
+                put(0xd5);
+                break;
+            case 4:
+                put(0xd6);
+                break;
+            case 8:
+                put(0xd7);
+                break;
+            case 16:
+                put(0xd8);
+                break;
+            default:
+                put(0xc7);
+                put_be(len, 1);
+                break;
+        }
+
+        put(static_cast<uint8_t>(type));
+    }
+
+    void put_mac(const mac_addr& m) {
+        put_ext_header(msgpack_adapter::ext_type::mac, 6);
+        for (unsigned int i = 0; i < 6; i++)
+            put(m[i]);
+    }
+
+    void put_uuid(const uuid& u) {
+        put_ext_header(msgpack_adapter::ext_type::uuid, 16);
+        put_be(*u.time_low, 4);
+        put_be(*u.time_mid, 2);
+        put_be(*u.time_hi, 2);
+        put_be(*u.clock_seq, 2);
+        put(u.node, 6);
+    }
+
+    void put_key(const device_key& k) {
+        put_ext_header(msgpack_adapter::ext_type::device_key, 16);
+        put_be(kis_hton64(k.get_spkey()), 8);
+        put_be(kis_hton64(k.get_dkey()), 8);
+    }
+
+    // Scalar and scalar-collection types are written the same way by both formats;
+    // returns false if the element is a collection of elements
+    bool pack_scalar(tracker_element *ep);
+
+    // Json-structured output
+    void pack(shared_tracker_element e);
+
+    // Storage-structured output
+    void pack_storage(shared_tracker_element e);
+
+protected:
+    // Pre- and post-serialization of an element, as in serializer_scope, without
+    // copying the element
+    class element_scope {
+    public:
+        element_scope(const shared_tracker_element& e,
+                const std::shared_ptr<tracker_element_serializer::rename_map>& name_map) :
+            elem {e.get()},
+            summary {nullptr} {
+
+            if (name_map != nullptr) {
+                auto nmi = name_map->find(e);
+                if (nmi != name_map->end()) {
+                    summary = &(nmi->second);
+                    tracker_element_serializer::pre_serialize_path(*summary);
+                    return;
+                }
+            }
+
+            elem->pre_serialize();
+        }
+
+        ~element_scope() {
+            if (summary != nullptr)
+                tracker_element_serializer::post_serialize_path(*summary);
+            else
+                elem->post_serialize();
+        }
+
+    protected:
+        tracker_element *elem;
+        const SharedElementSummary *summary;
+    };
+
+    const std::string& field_name(int id) {
+        auto ni = names.find(id);
+        if (ni != names.end())
+            return ni->second;
+
+        if (name_fn != nullptr)
+            return names.emplace(id, name_fn(id)).first->second;
+
+        return names.emplace(id, Globalreg::globalreg->entrytracker->get_field_name(id)).first->second;
+    }
+
+    void put_field_name(int id, const shared_tracker_element& e) {
+        if (name_map != nullptr) {
+            auto nmi = name_map->find(e);
+            if (nmi != name_map->end() && nmi->second->rename.length() != 0) {
+                put_str(nmi->second->rename);
+                return;
+            }
+        }
+
+        if (e->has_local_name()) {
+            put_str(e->get_local_name());
+            return;
+        }
+
+        put_str(field_name(id));
+    }
+
+    // Keyed maps with shared element values, json-structured
+    template<class M, class K>
+    void pack_keyed_map(M *m, K key_fn) {
+        bool as_vector = m->as_vector();
+        bool as_key_vector = m->as_key_vector();
+
+        size_t n = 0;
+        for (const auto& i : *m) {
+            if (i.second != nullptr || as_key_vector)
+                n++;
+        }
+
+        if (as_vector || as_key_vector)
+            put_array(n);
+        else
+            put_map(n);
+
+        for (const auto& i : *m) {
+            if (i.second == nullptr && !as_key_vector)
+                continue;
+
+            if (!as_vector)
+                key_fn(i.first);
+
+            if (!as_key_vector)
+                pack(i.second);
+
+            maybe_flush();
+        }
+    }
+
+    // Keyed maps with shared element values, storage-structured
+    template<class M, class K>
+    void pack_storage_keyed_map(M *m, K key_fn) {
+        put_map(m->size());
+
+        for (const auto& i : *m) {
+            key_fn(i.first);
+            pack_storage(i.second);
+            maybe_flush();
+        }
+    }
+
+    static constexpr size_t flush_size = 65536;
+
+    std::ostream& stream;
+    std::shared_ptr<tracker_element_serializer::rename_map> name_map;
+    std::function<std::string (int)> name_fn;
+
+    std::string buf;
+
+    std::map<int, std::string> names;
+};
+
+bool packer::pack_scalar(tracker_element *ep) {
+    switch (ep->get_type()) {
+        case tracker_type::tracker_string:
+            put_str(static_cast<tracker_element_string *>(ep)->get());
+            break;
+        case tracker_type::tracker_int8:
+            put_int(static_cast<tracker_element_int8 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint8:
+            put_uint(static_cast<tracker_element_uint8 *>(ep)->get());
+            break;
+        case tracker_type::tracker_int16:
+            put_int(static_cast<tracker_element_int16 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint16:
+            put_uint(static_cast<tracker_element_uint16 *>(ep)->get());
+            break;
+        case tracker_type::tracker_int32:
+            put_int(static_cast<tracker_element_int32 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint32:
+            put_uint(static_cast<tracker_element_uint32 *>(ep)->get());
+            break;
+        case tracker_type::tracker_int64:
+            put_int(static_cast<tracker_element_int64 *>(ep)->get());
+            break;
+        case tracker_type::tracker_uint64:
+            put_uint(static_cast<tracker_element_uint64 *>(ep)->get());
+            break;
+        case tracker_type::tracker_float:
+            put_float(static_cast<tracker_element_float *>(ep)->get());
+            break;
+        case tracker_type::tracker_double:
+            put_double(static_cast<tracker_element_double *>(ep)->get());
+            break;
+        case tracker_type::tracker_mac_addr:
+            put_mac(static_cast<tracker_element_mac_addr *>(ep)->get());
+            break;
+        case tracker_type::tracker_uuid:
+            put_uuid(static_cast<tracker_element_uuid *>(ep)->get());
+            break;
+        case tracker_type::tracker_key:
+            put_key(static_cast<tracker_element_device_key *>(ep)->get());
+            break;
+        case tracker_type::tracker_byte_array:
+            put_bin(static_cast<tracker_element_byte_array *>(ep)->get());
+            break;
+        case tracker_type::tracker_vector_double:
+            {
+                auto v = static_cast<tracker_element_vector_double *>(ep);
+
+                put_array(v->size());
+                for (const auto& i : *v)
+                    put_double(i);
+            }
+            break;
+        case tracker_type::tracker_vector_string:
+            {
+                auto v = static_cast<tracker_element_vector_string *>(ep);
+
+                put_array(v->size());
+                for (const auto& i : *v) {
+                    put_str(i);
+                    maybe_flush();
+                }
+            }
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+void packer::pack(shared_tracker_element e) {
+    if (e == nullptr) {
+        put_nil();
+        return;
+    }
+
+    element_scope s(e, name_map);
+
+    // If we're serializing an alias, remap as the aliased element
+    if (e->get_type() == tracker_type::tracker_alias)
+        e = std::static_pointer_cast<tracker_element_alias>(e)->get();
+
+    auto ep = e.get();
+
+    if (pack_scalar(ep))
+        return;
+
+    switch (ep->get_type()) {
+        case tracker_type::tracker_vector:
+            {
+                auto v = static_cast<tracker_element_vector *>(ep);
+
+                size_t n = 0;
+                for (const auto& i : *v) {
+                    if (i != nullptr)
+                        n++;
+                }
+
+                put_array(n);
+
+                for (const auto& i : *v) {
+                    if (i == nullptr)
+                        continue;
+
+                    pack(i);
+                    maybe_flush();
+                }
+            }
+            break;
+        case tracker_type::tracker_map:
+            {
+                auto m = static_cast<tracker_element_map *>(ep);
+                bool as_vector = m->as_vector();
+                bool as_key_vector = m->as_key_vector();
+
+                size_t n = 0;
+                for (const auto& i : *m) {
+                    if (i.second != nullptr)
+                        n++;
+                }
+
+                if (as_vector || as_key_vector)
+                    put_array(n);
+                else
+                    put_map(n);
+
+                for (const auto& i : *m) {
+                    if (i.second == nullptr)
+                        continue;
+
+                    if (!as_vector)
+                        put_field_name(i.first, i.second);
+
+                    if (!as_key_vector)
+                        pack(i.second);
+
+                    maybe_flush();
+                }
+            }
+            break;
+        case tracker_type::tracker_int_map:
+            pack_keyed_map(static_cast<tracker_element_int_map *>(ep),
+                    [this](int k) { put_int(k); });
+            break;
+        case tracker_type::tracker_mac_map:
+            pack_keyed_map(static_cast<tracker_element_mac_map *>(ep),
+                    [this](const mac_addr& k) { put_mac(k); });
+            break;
+        case tracker_type::tracker_string_map:
+            pack_keyed_map(static_cast<tracker_element_string_map *>(ep),
+                    [this](const std::string& k) { put_str(k); });
+            break;
+        case tracker_type::tracker_double_map:
+            pack_keyed_map(static_cast<tracker_element_double_map *>(ep),
+                    [this](double k) { put_double(k); });
+            break;
+        case tracker_type::tracker_hashkey_map:
+            pack_keyed_map(static_cast<tracker_element_hashkey_map *>(ep),
+                    [this](size_t k) { put_uint(k); });
+            break;
+        case tracker_type::tracker_key_map:
+            pack_keyed_map(static_cast<tracker_element_device_key_map *>(ep),
+                    [this](const device_key& k) { put_key(k); });
+            break;
+        case tracker_type::tracker_double_map_double:
+            {
+                auto m = static_cast<tracker_element_double_map_double *>(ep);
+                bool as_vector = m->as_vector();
+                bool as_key_vector = m->as_key_vector();
+
+                if (as_vector || as_key_vector)
+                    put_array(m->size());
+                else
+                    put_map(m->size());
+
+                for (const auto& i : *m) {
+                    if (!as_vector)
+                        put_double(i.first);
+
+                    if (!as_key_vector)
+                        put_double(i.second);
+                }
+            }
+            break;
+        default:
+            put_nil();
+            break;
+    }
+}
+
+void packer::pack_storage(shared_tracker_element e) {
+    if (e == nullptr) {
+        put_nil();
+        return;
+    }
+
+    element_scope s(e, nullptr);
+
+    // Aliases are stored under their own name as a copy of the aliased element
+    auto id = e->get_id();
+
+    if (e->get_type() == tracker_type::tracker_alias)
+        e = std::static_pointer_cast<tracker_element_alias>(e)->get();
+
+    auto ep = e.get();
+
+    put_array(3);
+    put_str(field_name(id));
+    put_uint(static_cast<unsigned int>(ep->get_type()));
+
+    if (pack_scalar(ep))
+        return;
+
+    switch (ep->get_type()) {
+        case tracker_type::tracker_vector:
+            {
+                auto v = static_cast<tracker_element_vector *>(ep);
+
+                size_t n = 0;
+                for (const auto& i : *v) {
+                    if (i != nullptr)
+                        n++;
+                }
+
+                put_array(n);
+
+                for (const auto& i : *v) {
+                    if (i == nullptr)
+                        continue;
+
+                    pack_storage(i);
+                    maybe_flush();
+                }
+            }
+            break;
+        case tracker_type::tracker_map:
+            {
+                auto m = static_cast<tracker_element_map *>(ep);
+
+                size_t n = 0;
+                for (const auto& i : *m) {
+                    if (i.second != nullptr)
+                        n++;
+                }
+
+                put_array(n);
+
+                for (const auto& i : *m) {
+                    if (i.second == nullptr)
+                        continue;
+
+                    pack_storage(i.second);
+                    maybe_flush();
+                }
+            }
+            break;
+        case tracker_type::tracker_int_map:
+            pack_storage_keyed_map(static_cast<tracker_element_int_map *>(ep),
+                    [this](int k) { put_int(k); });
+            break;
+        case tracker_type::tracker_mac_map:
+            pack_storage_keyed_map(static_cast<tracker_element_mac_map *>(ep),
+                    [this](const mac_addr& k) { put_mac(k); });
+            break;
+        case tracker_type::tracker_string_map:
+            pack_storage_keyed_map(static_cast<tracker_element_string_map *>(ep),
+                    [this](const std::string& k) { put_str(k); });
+            break;
+        case tracker_type::tracker_double_map:
+            pack_storage_keyed_map(static_cast<tracker_element_double_map *>(ep),
+                    [this](double k) { put_double(k); });
+            break;
+        case tracker_type::tracker_hashkey_map:
+            pack_storage_keyed_map(static_cast<tracker_element_hashkey_map *>(ep),
+                    [this](size_t k) { put_uint(k); });
+            break;
+        case tracker_type::tracker_key_map:
+            pack_storage_keyed_map(static_cast<tracker_element_device_key_map *>(ep),
+                    [this](const device_key& k) { put_key(k); });
+            break;
+        case tracker_type::tracker_double_map_double:
+            {
+                auto m = static_cast<tracker_element_double_map_double *>(ep);
+
+                put_map(m->size());
+
+                for (const auto& i : *m) {
+                    put_double(i.first);
+                    put_double(i.second);
+                }
+            }
+            break;
+        default:
+            put_nil();
+            break;
+    }
+}
+
+}
+
+int msgpack_adapter::serializer::serialize(shared_tracker_element in_elem, std::ostream &stream,
+        std::shared_ptr<rename_map> name_map) {
+    packer p(stream, name_map);
+    p.pack(in_elem);
+    return 0;
+}
+
+void storage_msgpack_adapter::pack(std::ostream &stream, shared_tracker_element e,
+        const std::function<std::string (int)>& in_field_name) {
+    packer p(stream, nullptr, in_field_name);
+    p.pack_storage(e);
+}
+
+uint8_t msgpack_adapter::reader::next() {
+    if (data >= end)
+        throw msgpack_exception("truncated msgpack object");
+
+    return *data++;
+}
+
+const uint8_t *msgpack_adapter::reader::take(size_t len) {
+    if (static_cast<size_t>(end - data) < len)
+        throw msgpack_exception("truncated msgpack object");
+
+    auto r = data;
+    data += len;
+    return r;
+}
+
+uint64_t msgpack_adapter::reader::read_be(unsigned int width) {
+    auto p = take(width);
+    uint64_t v = 0;
+
+    for (unsigned int i = 0; i < width; i++)
+        v = (v << 8) | p[i];
+
+    return v;
+}
+
+bool msgpack_adapter::reader::read_nil() {
+    if (data < end && *data == 0xc0) {
+        data++;
+        return true;
+    }
+
+    return false;
+}
+
+uint64_t msgpack_adapter::reader::read_uint() {
+    // uint64 is the only encoding which does not fit in an int64
+    if (data < end && *data == 0xcf) {
+        data++;
+        return read_be(8);
+    }
+
+    auto v = read_int();
+
+    if (v < 0)
+        throw msgpack_exception("expected unsigned msgpack integer");
+
+    return static_cast<uint64_t>(v);
+}
+
+int64_t msgpack_adapter::reader::read_int() {
+    auto c = next();
+
+    if (c < 0x80)
+        return c;
+
+    if (c >= 0xe0)
+        return static_cast<int8_t>(c);
+
+    switch (c) {
+        case 0xcc:
+            return read_be(1);
+        case 0xcd:
+            return read_be(2);
+        case 0xce:
+            return read_be(4);
+        case 0xcf:
+            return static_cast<int64_t>(read_be(8));
+        case 0xd0:
+            return static_cast<int8_t>(read_be(1));
+        case 0xd1:
+            return static_cast<int16_t>(read_be(2));
+        case 0xd2:
+            return static_cast<int32_t>(read_be(4));
+        case 0xd3:
+            return static_cast<int64_t>(read_be(8));
+    }
+
+    throw msgpack_exception("expected msgpack integer");
+}
+
+double msgpack_adapter::reader::read_double() {
+    if (data < end && *data == 0xca) {
+        data++;
+        uint32_t v = read_be(4);
+        float f;
+        memcpy(&f, &v, sizeof(f));
+        return f;
+    }
+
+    if (data < end && *data == 0xcb) {
+        data++;
+        uint64_t v = read_be(8);
+        double d;
+        memcpy(&d, &v, sizeof(d));
+        return d;
+    }
+
+    if (data < end && *data == 0xcf)
+        return static_cast<double>(read_uint());
+
+    return static_cast<double>(read_int());
+}
+
+std::string msgpack_adapter::reader::read_str() {
+    auto c = next();
+    size_t len;
+
+    if ((c & 0xe0) == 0xa0)
+        len = c & 0x1f;
+    else if (c == 0xd9)
+        len = read_be(1);
+    else if (c == 0xda)
+        len = read_be(2);
+    else if (c == 0xdb)
+        len = read_be(4);
+    else
+        throw msgpack_exception("expected msgpack string");
+
+    auto p = take(len);
+    return std::string(reinterpret_cast<const char *>(p), len);
+}
+
+std::string msgpack_adapter::reader::read_bin() {
+    auto c = next();
+    size_t len;
+
+    if (c == 0xc4)
+        len = read_be(1);
+    else if (c == 0xc5)
+        len = read_be(2);
+    else if (c == 0xc6)
+        len = read_be(4);
+    else
+        throw msgpack_exception("expected msgpack binary");
+
+    auto p = take(len);
+    return std::string(reinterpret_cast<const char *>(p), len);
+}
+
+size_t msgpack_adapter::reader::read_array() {
+    auto c = next();
+
+    if ((c & 0xf0) == 0x90)
+        return c & 0x0f;
+    if (c == 0xdc)
+        return read_be(2);
+    if (c == 0xdd)
+        return read_be(4);
+
+    throw msgpack_exception("expected msgpack array");
+}
+
+size_t msgpack_adapter::reader::read_map() {
+    auto c = next();
+
+    if ((c & 0xf0) == 0x80)
+        return c & 0x0f;
+    if (c == 0xde)
+        return read_be(2);
+    if (c == 0xdf)
+        return read_be(4);
+
+    throw msgpack_exception("expected msgpack map");
+}
+
+size_t msgpack_adapter::reader::read_ext(ext_type type) {
+    auto c = next();
+    size_t len;
+
+    switch (c) {
+        case 0xd4:
+            len = 1;
+            break;
+        case 0xd5:
+            len = 2;
+            break;
+        case 0xd6:
+            len = 4;
+            break;
+        case 0xd7:
+            len = 8;
+            break;
+        case 0xd8:
+            len = 16;
+            break;
+        case 0xc7:
+            len = read_be(1);
+            break;
+        case 0xc8:
+            len = read_be(2);
+            break;
+        case 0xc9:
+            len = read_be(4);
+            break;
+        default:
+            throw msgpack_exception("expected msgpack extension type");
+    }
+
+    if (static_cast<int8_t>(next()) != static_cast<int8_t>(type))
+        throw msgpack_exception("unexpected msgpack extension type");
+
+    return len;
+}
+
+mac_addr msgpack_adapter::reader::read_mac() {
+    if (read_ext(ext_type::mac) != 6)
+        throw msgpack_exception("invalid msgpack mac address length");
+
+    return mac_addr(take(6), 6);
+}
+
+uuid msgpack_adapter::reader::read_uuid() {
+    if (read_ext(ext_type::uuid) != 16)
+        throw msgpack_exception("invalid msgpack uuid length");
+
+    uuid u;
+
+    *u.time_low = read_be(4);
+    *u.time_mid = read_be(2);
+    *u.time_hi = read_be(2);
+    *u.clock_seq = read_be(2);
+    memcpy(u.node, take(6), 6);
+    u.error = 0;
+
+    return u;
+}
+
+device_key msgpack_adapter::reader::read_key() {
+    if (read_ext(ext_type::device_key) != 16)
+        throw msgpack_exception("invalid msgpack device key length");
+
+    uint64_t k1 = read_be(8);
+    uint64_t k2 = read_be(8);
+
+    return device_key(fmt::format("{:016X}_{:016X}", k1, k2));
+}
+
+void msgpack_adapter::reader::skip() {
+    auto c = next();
+    size_t n;
+
+    if (c < 0x80 || c >= 0xe0 || c == 0xc0 || c == 0xc2 || c == 0xc3)
+        return;
+
+    if ((c & 0xf0) == 0x80) {
+        for (n = (c & 0x0f) * 2; n > 0; n--)
+            skip();
+        return;
+    }
+
+    if ((c & 0xf0) == 0x90) {
+        for (n = c & 0x0f; n > 0; n--)
+            skip();
+        return;
+    }
+
+    if ((c & 0xe0) == 0xa0) {
+        take(c & 0x1f);
+        return;
+    }
+
+    switch (c) {
+        case 0xc4:
+        case 0xd9:
+            take(read_be(1));
+            return;
+        case 0xc5:
+        case 0xda:
+            take(read_be(2));
+            return;
+        case 0xc6:
+        case 0xdb:
+            take(read_be(4));
+            return;
+        case 0xc7:
+            take(read_be(1) + 1);
+            return;
+        case 0xc8:
+            take(read_be(2) + 1);
+            return;
+        case 0xc9:
+            take(read_be(4) + 1);
+            return;
+        case 0xca:
+        case 0xce:
+        case 0xd2:
+            take(4);
+            return;
+        case 0xcb:
+        case 0xcf:
+        case 0xd3:
+            take(8);
+            return;
+        case 0xcc:
+        case 0xd0:
+            take(1);
+            return;
+        case 0xcd:
+        case 0xd1:
+            take(2);
+            return;
+        case 0xd4:
+            take(2);
+            return;
+        case 0xd5:
+            take(3);
+            return;
+        case 0xd6:
+            take(5);
+            return;
+        case 0xd7:
+            take(9);
+            return;
+        case 0xd8:
+            take(17);
+            return;
+        case 0xdc:
+            for (n = read_be(2); n > 0; n--)
+                skip();
+            return;
+        case 0xdd:
+            for (n = read_be(4); n > 0; n--)
+                skip();
+            return;
+        case 0xde:
+            for (n = read_be(2) * 2; n > 0; n--)
+                skip();
+            return;
+        case 0xdf:
+            for (n = read_be(4) * 2; n > 0; n--)
+                skip();
+            return;
+    }
+
+    throw msgpack_exception("invalid msgpack type byte");
+}
+
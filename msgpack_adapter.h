@@ -0,0 +1,144 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __MSGPACK_ADAPTER_H__
+#define __MSGPACK_ADAPTER_H__
+
+#include "config.h"
+
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "globalregistry.h"
+#include "trackedelement.h"
+#include "devicetracker_component.h"
+
+// MessagePack serialization adapters.  Kismet types which have no native msgpack
+// representation are written as application extension types:
+//
+//   ext 1, 6 bytes   mac address, network byte order
+//   ext 2, 16 bytes  uuid, in the byte order of its string form
+//   ext 3, 16 bytes  device key, the two big-endian 64bit halves of the string form
+//
+// Integers are written in the smallest encoding which holds the value, floats as
+// float32 and doubles as float64.
+//
+// The 'msgpack' serializer produces the same structure as the json serializer:
+// maps are keyed by field name, and maps flagged as vectors or key vectors are
+// written as arrays.
+namespace msgpack_adapter {
+
+enum class ext_type : int8_t {
+    mac = 1,
+    uuid = 2,
+    device_key = 3,
+};
+
+class serializer : public tracker_element_serializer {
+public:
+    serializer() :
+        tracker_element_serializer() { }
+
+    virtual int serialize(shared_tracker_element in_elem, std::ostream &stream,
+            std::shared_ptr<rename_map> name_map = nullptr) override;
+};
+
+class msgpack_exception : public std::runtime_error {
+public:
+    msgpack_exception(const std::string& what) : std::runtime_error(what) { }
+};
+
+// Minimal msgpack reader over a complete buffer; throws msgpack_exception on a
+// truncated buffer or a type mismatch.  The buffer must outlive the reader.
+class reader {
+public:
+    reader(const char *in_data, size_t in_len) :
+        data {reinterpret_cast<const uint8_t *>(in_data)},
+        end {reinterpret_cast<const uint8_t *>(in_data) + in_len} { }
+
+    bool at_end() const {
+        return data >= end;
+    }
+
+    // Consume a nil and return true, or leave the buffer alone and return false
+    bool read_nil();
+
+    uint64_t read_uint();
+    int64_t read_int();
+    // Floats, doubles, and integers are all accepted
+    double read_double();
+
+    std::string read_str();
+    std::string read_bin();
+
+    size_t read_array();
+    size_t read_map();
+
+    mac_addr read_mac();
+    uuid read_uuid();
+    device_key read_key();
+
+    // Skip a complete object of any type
+    void skip();
+
+protected:
+    uint8_t next();
+    const uint8_t *take(size_t len);
+    uint64_t read_be(unsigned int width);
+    size_t read_ext(ext_type type);
+
+    const uint8_t *data;
+    const uint8_t *end;
+};
+
+}
+
+// Storage MessagePack adapter, the binary equivalent of the storagejson adapter.
+// Every element is written as a 3-element array of
+//
+//   [field name, tracker_type, data]
+//
+// and a null element is written as nil.  Maps and vectors of elements contain
+// complete elements; tracker_map is written as an array of its elements, keyed
+// maps are written as msgpack maps using the native key type.
+//
+// Stored objects are restored with storage_loader::storage_msgpack_to_tracker(..)
+namespace storage_msgpack_adapter {
+
+// Field names come from the entrytracker unless a lookup function is given
+void pack(std::ostream &stream, shared_tracker_element e,
+        const std::function<std::string (int)>& in_field_name = nullptr);
+
+class serializer : public tracker_element_serializer {
+public:
+    serializer() :
+        tracker_element_serializer() { }
+
+    virtual int serialize(shared_tracker_element in_elem, std::ostream &stream,
+            std::shared_ptr<rename_map> name_map = nullptr) override {
+        pack(stream, in_elem);
+        return 1;
+    }
+};
+
+}
+
+#endif
+
@@ -0,0 +1,479 @@
+/* test harness for the Kismet msgpack serializers
+ *
+ * Packs a record covering every tracker type with the storagemsgpack adapter,
+ * restores it with the storage loader, and compares the restored record to the
+ * original field by field; maps are compared by key, since most of them are
+ * unordered and are not packed in a fixed order.
+ *
+ * Every truncation of a packed record, and a sweep of corrupted records, has to be
+ * rejected with an exception and not read out of bounds; build with asan to catch
+ * the latter.  The json-structured msgpack serializer is checked with the reader.
+ *
+ * Field names are resolved with a local table instead of the entrytracker.
+ *
+ * # configure kismet with asan
+ * ./configure --enable-asan
+ *
+ * # build kismet
+ * make
+ *
+ * # build test harness
+ * g++ -o msgpack_adapter_test msgpack_adapter_test.cc msgpack_adapter.cc.o \
+ *     storageloader.cc.o trackedelement.cc.o util.cc.o macaddr.cc.o uuid.cc.o -lasan
+ *
+ * ./msgpack_adapter_test
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "msgpack_adapter.h"
+#include "storageloader.h"
+#include "trackedelement.h"
+
+// Names are resolved through the functions below and the entrytracker is never used
+#define TEST_HARNESS_TRACKER_STUBS
+#include "test_harness.h"
+
+// Field names and ids, as the entrytracker would assign them
+static std::map<std::string, int> field_ids;
+static std::map<int, std::string> field_names;
+
+static int field(const std::string& name) {
+    auto fi = field_ids.find(name);
+    if (fi != field_ids.end())
+        return fi->second;
+
+    int id = field_ids.size() + 1;
+    field_ids[name] = id;
+    field_names[id] = name;
+    return id;
+}
+
+static std::string field_name(int id) {
+    auto ni = field_names.find(id);
+    if (ni != field_names.end())
+        return ni->second;
+
+    return "";
+}
+
+static std::string pack(shared_tracker_element e) {
+    std::stringstream ss;
+    storage_msgpack_adapter::pack(ss, e, field_name);
+    return ss.str();
+}
+
+static shared_tracker_element restore(const std::string& data) {
+    return storage_loader::storage_msgpack_to_tracker(data, field);
+}
+
+template<typename T, typename V>
+std::shared_ptr<T> make(const std::string& name, V v) {
+    auto e = std::make_shared<T>(field(name));
+    e->set(v);
+    return e;
+}
+
+// One of every type, with the limits of each scalar, nested collections, and
+// strings which aren't valid text
+static shared_tracker_element build_record() {
+    auto rec = std::make_shared<tracker_element_map>(field("kismet.test.record"));
+
+    rec->insert(make<tracker_element_int8>("kismet.test.int8", (int8_t) -128));
+    rec->insert(make<tracker_element_uint8>("kismet.test.uint8", (uint8_t) 255));
+    rec->insert(make<tracker_element_int16>("kismet.test.int16", (int16_t) -32768));
+    rec->insert(make<tracker_element_uint16>("kismet.test.uint16", (uint16_t) 65535));
+    rec->insert(make<tracker_element_int32>("kismet.test.int32",
+                std::numeric_limits<int32_t>::min()));
+    rec->insert(make<tracker_element_uint32>("kismet.test.uint32",
+                std::numeric_limits<uint32_t>::max()));
+    rec->insert(make<tracker_element_int64>("kismet.test.int64",
+                std::numeric_limits<int64_t>::min()));
+    rec->insert(make<tracker_element_int64>("kismet.test.int64_small", (int64_t) -33));
+    rec->insert(make<tracker_element_uint64>("kismet.test.uint64",
+                std::numeric_limits<uint64_t>::max()));
+    rec->insert(make<tracker_element_uint64>("kismet.test.zero", (uint64_t) 0));
+    rec->insert(make<tracker_element_float>("kismet.test.float", -3.25f));
+    rec->insert(make<tracker_element_double>("kismet.test.double", 37.774929123456789));
+    rec->insert(make<tracker_element_double>("kismet.test.tiny",
+                std::numeric_limits<double>::denorm_min()));
+    rec->insert(make<tracker_element_string>("kismet.test.string",
+                std::string("quote\" nul\0 utf8 \xc3\xa9 bad \xff", 26)));
+    rec->insert(make<tracker_element_string>("kismet.test.long", std::string(70000, 'x')));
+    rec->insert(make<tracker_element_byte_array>("kismet.test.bytes",
+                std::string("\x00\x01\x02\xff", 4)));
+    rec->insert(make<tracker_element_mac_addr>("kismet.test.mac",
+                mac_addr("AA:BB:CC:DD:EE:FF")));
+    rec->insert(make<tracker_element_mac_addr>("kismet.test.mac_masked",
+                mac_addr("AA:BB:CC:00:00:00/FF:FF:FF:00:00:00")));
+    rec->insert(make<tracker_element_uuid>("kismet.test.uuid",
+                uuid("12345678-9ABC-DEF0-1234-56789ABCDEF0")));
+    rec->insert(make<tracker_element_device_key>("kismet.test.key",
+                device_key(0x1234, mac_addr("00:11:22:33:44:55"))));
+
+    auto vec = std::make_shared<tracker_element_vector>(field("kismet.test.vector"));
+    for (int i = 0; i < 20; i++) {
+        auto sub = std::make_shared<tracker_element_map>(field("kismet.test.sub"));
+        sub->insert(make<tracker_element_int32>("kismet.test.sub.n", i));
+        sub->insert(make<tracker_element_double>("kismet.test.sub.d", i * 0.1));
+        vec->push_back(sub);
+    }
+    vec->push_back(std::make_shared<tracker_element_vector>(field("kismet.test.empty_vector")));
+    vec->push_back(std::make_shared<tracker_element_map>(field("kismet.test.empty_map")));
+    rec->insert(vec);
+
+    auto dvec = std::make_shared<tracker_element_vector_double>(field("kismet.test.vector_double"));
+    dvec->push_back(-0.0);
+    dvec->push_back(1e300);
+    dvec->push_back(1.0 / 3.0);
+    rec->insert(dvec);
+
+    auto svec = std::make_shared<tracker_element_vector_string>(field("kismet.test.vector_string"));
+    svec->push_back("");
+    svec->push_back(std::string(40, 'y'));
+    rec->insert(svec);
+
+    auto imap = std::make_shared<tracker_element_int_map>(field("kismet.test.int_map"));
+    imap->insert(-5, make<tracker_element_string>("kismet.test.int_map.v", std::string("neg")));
+    imap->insert(1 << 20, make<tracker_element_string>("kismet.test.int_map.v", std::string("pos")));
+    rec->insert(imap);
+
+    auto smap = std::make_shared<tracker_element_string_map>(field("kismet.test.string_map"));
+    smap->insert("a", make<tracker_element_int32>("kismet.test.string_map.v", -1));
+    smap->insert("b", make<tracker_element_int32>("kismet.test.string_map.v", 1));
+    rec->insert(smap);
+
+    auto mmap = std::make_shared<tracker_element_mac_map>(field("kismet.test.mac_map"));
+    mmap->insert(mac_addr("01:02:03:04:05:06"), make<tracker_element_int32>("kismet.test.mac_map.v", 7));
+    mmap->insert(mac_addr("01:02:03:04:05:07"), make<tracker_element_int32>("kismet.test.mac_map.v", 8));
+    rec->insert(mmap);
+
+    auto dmap = std::make_shared<tracker_element_double_map>(field("kismet.test.double_map"));
+    dmap->insert(2412.0, make<tracker_element_uint64>("kismet.test.double_map.v", (uint64_t) 1));
+    dmap->insert(5180.5, make<tracker_element_uint64>("kismet.test.double_map.v", (uint64_t) 2));
+    rec->insert(dmap);
+
+    auto hmap = std::make_shared<tracker_element_hashkey_map>(field("kismet.test.hashkey_map"));
+    auto kmap = std::make_shared<tracker_element_device_key_map>(field("kismet.test.key_map"));
+    auto ddmap = std::make_shared<tracker_element_double_map_double>(field("kismet.test.double_map_double"));
+
+    for (unsigned int i = 0; i < 100; i++) {
+        hmap->insert((size_t) i * 0xdeadbeefcafe, make<tracker_element_uint32>("kismet.test.hashkey_map.v", i));
+        kmap->insert(device_key(i, test_mac((uint64_t) i << 8)),
+                make<tracker_element_uint32>("kismet.test.key_map.v", i));
+        ddmap->insert(i * -0.5, i * 1e-9);
+    }
+
+    rec->insert(hmap);
+    rec->insert(kmap);
+    rec->insert(ddmap);
+
+    return rec;
+}
+
+static bool same(const shared_tracker_element& a, const shared_tracker_element& b);
+
+template<typename T>
+bool same_value(const shared_tracker_element& a, const shared_tracker_element& b) {
+    return std::static_pointer_cast<T>(a)->get() == std::static_pointer_cast<T>(b)->get();
+}
+
+template<typename T>
+bool same_vector(const shared_tracker_element& a, const shared_tracker_element& b) {
+    auto va = std::static_pointer_cast<T>(a);
+    auto vb = std::static_pointer_cast<T>(b);
+    return va->size() == vb->size() && std::equal(va->begin(), va->end(), vb->begin());
+}
+
+template<typename T>
+bool same_map(const shared_tracker_element& a, const shared_tracker_element& b) {
+    auto ma = std::static_pointer_cast<T>(a);
+    auto mb = std::static_pointer_cast<T>(b);
+
+    if (ma->size() != mb->size())
+        return false;
+
+    for (const auto& i : *ma) {
+        auto j = mb->find(i.first);
+        if (j == mb->end() || !same(i.second, j->second))
+            return false;
+    }
+
+    return true;
+}
+
+static bool same(double a, double b) {
+    return a == b && std::signbit(a) == std::signbit(b);
+}
+
+static bool same(const shared_tracker_element& a, const shared_tracker_element& b) {
+    if (a == nullptr || b == nullptr)
+        return a == b;
+
+    if (a->get_type() != b->get_type() || a->get_id() != b->get_id())
+        return false;
+
+    switch (a->get_type()) {
+        case tracker_type::tracker_int8:
+            return same_value<tracker_element_int8>(a, b);
+        case tracker_type::tracker_uint8:
+            return same_value<tracker_element_uint8>(a, b);
+        case tracker_type::tracker_int16:
+            return same_value<tracker_element_int16>(a, b);
+        case tracker_type::tracker_uint16:
+            return same_value<tracker_element_uint16>(a, b);
+        case tracker_type::tracker_int32:
+            return same_value<tracker_element_int32>(a, b);
+        case tracker_type::tracker_uint32:
+            return same_value<tracker_element_uint32>(a, b);
+        case tracker_type::tracker_int64:
+            return same_value<tracker_element_int64>(a, b);
+        case tracker_type::tracker_uint64:
+            return same_value<tracker_element_uint64>(a, b);
+        case tracker_type::tracker_float:
+            return same(std::static_pointer_cast<tracker_element_float>(a)->get(),
+                    std::static_pointer_cast<tracker_element_float>(b)->get());
+        case tracker_type::tracker_double:
+            return same(std::static_pointer_cast<tracker_element_double>(a)->get(),
+                    std::static_pointer_cast<tracker_element_double>(b)->get());
+        case tracker_type::tracker_string:
+            return same_value<tracker_element_string>(a, b);
+        case tracker_type::tracker_byte_array:
+            return same_value<tracker_element_byte_array>(a, b);
+        case tracker_type::tracker_mac_addr:
+            return same_value<tracker_element_mac_addr>(a, b);
+        case tracker_type::tracker_uuid:
+            return same_value<tracker_element_uuid>(a, b);
+        case tracker_type::tracker_key:
+            return same_value<tracker_element_device_key>(a, b);
+        case tracker_type::tracker_vector:
+            {
+                auto va = std::static_pointer_cast<tracker_element_vector>(a);
+                auto vb = std::static_pointer_cast<tracker_element_vector>(b);
+
+                if (va->size() != vb->size())
+                    return false;
+
+                for (size_t i = 0; i < va->size(); i++)
+                    if (!same(va->at(i), vb->at(i)))
+                        return false;
+
+                return true;
+            }
+        case tracker_type::tracker_vector_double:
+            {
+                auto va = std::static_pointer_cast<tracker_element_vector_double>(a);
+                auto vb = std::static_pointer_cast<tracker_element_vector_double>(b);
+                return va->size() == vb->size() &&
+                    std::equal(va->begin(), va->end(), vb->begin(),
+                            [](double x, double y) { return same(x, y); });
+            }
+        case tracker_type::tracker_vector_string:
+            return same_vector<tracker_element_vector_string>(a, b);
+        case tracker_type::tracker_map:
+            return same_map<tracker_element_map>(a, b);
+        case tracker_type::tracker_int_map:
+            return same_map<tracker_element_int_map>(a, b);
+        case tracker_type::tracker_hashkey_map:
+            return same_map<tracker_element_hashkey_map>(a, b);
+        case tracker_type::tracker_double_map:
+            return same_map<tracker_element_double_map>(a, b);
+        case tracker_type::tracker_mac_map:
+            return same_map<tracker_element_mac_map>(a, b);
+        case tracker_type::tracker_string_map:
+            return same_map<tracker_element_string_map>(a, b);
+        case tracker_type::tracker_key_map:
+            return same_map<tracker_element_device_key_map>(a, b);
+        case tracker_type::tracker_double_map_double:
+            {
+                auto ma = std::static_pointer_cast<tracker_element_double_map_double>(a);
+                auto mb = std::static_pointer_cast<tracker_element_double_map_double>(b);
+
+                if (ma->size() != mb->size())
+                    return false;
+
+                for (const auto& i : *ma) {
+                    auto j = mb->find(i.first);
+                    if (j == mb->end() || !same(i.second, j->second))
+                        return false;
+                }
+
+                return true;
+            }
+        default:
+            return false;
+    }
+}
+
+static void check_round_trip() {
+    auto rec = build_record();
+    auto packed = pack(rec);
+
+    shared_tracker_element restored;
+
+    try {
+        restored = restore(packed);
+    } catch (const std::exception& e) {
+        fail(std::string("restoring record: ") + e.what());
+        return;
+    }
+
+    if (restored == nullptr || restored->get_type() != tracker_type::tracker_map ||
+            restored->get_id() != rec->get_id()) {
+        fail("restored record type");
+        return;
+    }
+
+    expect("restored record", same(rec, restored));
+
+    // Packed again, only the order of unordered maps may differ
+    expect("repacked length", pack(restored).length() == packed.length());
+
+    // Null elements are written as nil and skipped when restored
+    auto nvec = std::make_shared<tracker_element_vector>(field("kismet.test.vector"));
+    nvec->push_back(make<tracker_element_uint8>("kismet.test.uint8", (uint8_t) 1));
+    nvec->push_back(nullptr);
+    nvec->push_back(make<tracker_element_uint8>("kismet.test.uint8", (uint8_t) 2));
+
+    try {
+        auto rnvec = std::static_pointer_cast<tracker_element_vector>(restore(pack(nvec)));
+        expect("null element", rnvec->size() == 2);
+        expect("null record", restore(pack(nullptr)) == nullptr);
+    } catch (const std::exception& e) {
+        fail(std::string("restoring null elements: ") + e.what());
+    }
+}
+
+// Returns true if restoring the data threw
+static bool rejected(const std::string& data) {
+    try {
+        restore(data);
+    } catch (const std::runtime_error& e) {
+        return true;
+    }
+
+    return false;
+}
+
+static void check_malformed() {
+    auto packed = pack(build_record());
+
+    // Every truncation of a record has to be caught, never read past
+    for (size_t len = 0; len < packed.length(); len += (len < 4096 ? 1 : 997)) {
+        if (!rejected(packed.substr(0, len))) {
+            char what[64];
+            snprintf(what, sizeof(what), "truncated to %lu of %lu", len, packed.length());
+            fail(what);
+        }
+    }
+
+    // Corrupted records either restore or throw; asan catches any overrun
+    std::mt19937_64 rng(1);
+    unsigned int corrupt_rejected = 0;
+    const unsigned int n_corrupt = 5000;
+
+    for (unsigned int i = 0; i < n_corrupt; i++) {
+        auto corrupt = packed.substr(0, 4096);
+
+        for (unsigned int c = 0; c < 4; c++)
+            corrupt[rng() % corrupt.length()] = (char) rng();
+
+        if (rejected(corrupt))
+            corrupt_rejected++;
+    }
+
+    printf("%u of %u corrupted records rejected\n", corrupt_rejected, n_corrupt);
+
+    // An unknown type, and the wrong shape of record
+    std::string unknown("\x93\xa1x\xcc\xc8\xc0", 6);
+    expect("unknown type", rejected(unknown));
+    std::string pair("\x92\xa1x\x01", 4);
+    expect("two element record", rejected(pair));
+    std::string bad_key("\x93\xa1x\xcc\x00\x00", 6);
+    bad_key[4] = (char) static_cast<unsigned int>(tracker_type::tracker_key);
+    expect("key with the wrong extension", rejected(bad_key + std::string("\xd4\x01\x00", 3)));
+}
+
+// The json-structured serializer, read back by hand
+static void check_json_structure() {
+    auto rec = std::make_shared<tracker_element_map>();
+
+    auto s = std::make_shared<tracker_element_string>(1, "plain");
+    s->set_local_name("kismet.test.string");
+    rec->insert(s);
+
+    auto u = std::make_shared<tracker_element_uint64>(2, (uint64_t) 1 << 40);
+    u->set_local_name("kismet.test.uint64");
+    rec->insert(u);
+
+    auto m = std::make_shared<tracker_element_mac_addr>(3, mac_addr("AA:BB:CC:DD:EE:FF"));
+    m->set_local_name("kismet.test.mac");
+    rec->insert(m);
+
+    auto v = std::make_shared<tracker_element_vector_double>(4);
+    v->set_local_name("kismet.test.vector_double");
+    v->push_back(0.5);
+    v->push_back(-2.0);
+    rec->insert(v);
+
+    std::stringstream ss;
+    msgpack_adapter::serializer ser;
+    ser.serialize(rec, ss);
+    auto packed = ss.str();
+
+    try {
+        msgpack_adapter::reader r(packed.data(), packed.length());
+
+        unsigned int seen = 0;
+
+        // Fields are written in map order, which isn't fixed
+        for (size_t n = r.read_map(); n > 0; n--) {
+            auto name = r.read_str();
+
+            if (name == "kismet.test.string") {
+                expect("json string", r.read_str() == "plain");
+            } else if (name == "kismet.test.uint64") {
+                expect("json uint64", r.read_uint() == (uint64_t) 1 << 40);
+            } else if (name == "kismet.test.mac") {
+                expect("json mac", r.read_mac() == mac_addr("AA:BB:CC:DD:EE:FF"));
+            } else if (name == "kismet.test.vector_double") {
+                expect("json vector size", r.read_array() == 2);
+                expect("json vector 0", r.read_double() == 0.5);
+                expect("json vector 1", r.read_double() == -2.0);
+            } else {
+                fail("json field " + name);
+                r.skip();
+                continue;
+            }
+
+            seen++;
+        }
+
+        expect("json fields", seen == 4);
+        expect("json end", r.at_end());
+    } catch (const std::exception& e) {
+        fail(std::string("reading json structure: ") + e.what());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    check_round_trip();
+    check_malformed();
+    check_json_structure();
+
+    printf("%u failures\n", test_failures());
+
+    return test_failures() == 0 ? 0 : 1;
+}
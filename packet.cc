@@ -59,9 +59,32 @@ kis_packet::~kis_packet() {
             continue;
 
         if (pcm->self_destruct)
-            delete pcm;
+            packet_component_release(pcm);
     }
 }
+
+void kis_packet::reset() {
+    for (auto& pcm : content_vec) {
+        if (pcm == nullptr)
+            continue;
+
+        if (pcm->self_destruct)
+            packet_component_release(pcm);
+
+        pcm = nullptr;
+    }
+
+    ts.tv_sec = 0;
+    ts.tv_usec = 0;
+
+    error = 0;
+    crc_ok = 0;
+    filtered = 0;
+    duplicate = 0;
+
+    process_complete_events.clear();
+    tag_vec.clear();
+}
    
 void kis_packet::insert(const unsigned int index, packet_component *data) {
 	if (index >= MAX_PACKET_COMPONENTS) 
@@ -92,7 +115,7 @@ void kis_packet::erase(const unsigned int index) {
 	// to happen or it will be very unhappy
 	if (content_vec[index] != NULL) {
 		if (content_vec[index]->self_destruct)
-			delete content_vec[index];
+			packet_component_release(content_vec[index]);
 
 		content_vec[index] = NULL;
 	}
@@ -29,6 +29,9 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <map>
@@ -52,14 +55,127 @@
 // even when we don't have pcap
 #define KDLT_IEEE802_11			105
 
+class packet_component_pool_base;
+
 // High-level packet component so that we can provide our own destructors
 class packet_component {
 public:
-    packet_component() { self_destruct = 1; };
+    packet_component() { 
+        self_destruct = 1; 
+        pool = nullptr;
+    };
     virtual ~packet_component() { }
+
+    // Return a recycled component to the state of a freshly constructed one; 
+    // components which are allocated from a pool must implement this
+    virtual void reset() { }
+
     int self_destruct;
+
+    // Pool this component is returned to instead of being deleted, if any
+    packet_component_pool_base *pool;
+};
+
+// Common stats for the packet and packet component recycling pools; packets and
+// the components every datasource report attaches are allocated and freed at the 
+// packet rate, so they're recycled instead of being returned to the allocator.
+// Pools are bounded; objects released to a full pool are deleted.
+class packet_pool_base {
+public:
+    packet_pool_base(const std::string& in_name, size_t in_max_size) :
+        name {in_name},
+        max_size {in_max_size},
+        hits {0},
+        misses {0} { }
+
+    virtual ~packet_pool_base() { }
+
+    const std::string& get_name() const { return name; }
+    uint64_t get_hits() const { return hits; }
+    uint64_t get_misses() const { return misses; }
+
+    virtual size_t get_size() = 0;
+
+protected:
+    std::string name;
+    size_t max_size;
+
+    std::atomic<uint64_t> hits, misses;
+};
+
+class packet_component_pool_base : public packet_pool_base {
+public:
+    packet_component_pool_base(const std::string& in_name, size_t in_max_size) :
+        packet_pool_base(in_name, in_max_size) { }
+
+    virtual void release(packet_component *in_comp) = 0;
+};
+
+template<class T>
+class packet_component_pool : public packet_component_pool_base {
+public:
+    packet_component_pool(const std::string& in_name, size_t in_max_size) :
+        packet_component_pool_base(in_name, in_max_size) { }
+
+    virtual ~packet_component_pool() {
+        for (auto c : free_vec)
+            delete c;
+    }
+
+    T *acquire() {
+        {
+            std::lock_guard<std::mutex> lk(pool_mutex);
+
+            if (free_vec.size()) {
+                auto c = free_vec.back();
+                free_vec.pop_back();
+                hits++;
+                return c;
+            }
+        }
+
+        misses++;
+
+        auto c = new T();
+        c->pool = this;
+        return c;
+    }
+
+    virtual void release(packet_component *in_comp) override {
+        auto c = static_cast<T *>(in_comp);
+
+        c->reset();
+
+        {
+            std::lock_guard<std::mutex> lk(pool_mutex);
+
+            if (free_vec.size() < max_size) {
+                free_vec.push_back(c);
+                return;
+            }
+        }
+
+        delete c;
+    }
+
+    virtual size_t get_size() override {
+        std::lock_guard<std::mutex> lk(pool_mutex);
+        return free_vec.size();
+    }
+
+protected:
+    std::mutex pool_mutex;
+    std::vector<T *> free_vec;
 };
 
+// Release a component to its pool, or delete it if it was not pool allocated
+inline void packet_component_release(packet_component *in_comp) {
+    if (in_comp->pool != nullptr)
+        in_comp->pool->release(in_comp);
+    else
+        delete in_comp;
+}
+
 // Overall packet container that holds packet information
 class kis_packet {
 public:
@@ -96,6 +212,9 @@ public:
     kis_packet(global_registry *in_globalreg);
     ~kis_packet();
 
+    // Release all components and clear the packet for re-use
+    void reset();
+
     void insert(const unsigned int index, packet_component *data);
     void *fetch(const unsigned int index) const;
     template<class T> T* fetch(const unsigned int index) {
@@ -117,6 +236,58 @@ protected:
     global_registry *globalreg;
 };
 
+// Recycling pool for the packets themselves
+class kis_packet_pool : public packet_pool_base {
+public:
+    kis_packet_pool(size_t in_max_size) :
+        packet_pool_base("kis_packet", in_max_size) { }
+
+    virtual ~kis_packet_pool() {
+        for (auto p : free_vec)
+            delete p;
+    }
+
+    kis_packet *acquire() {
+        {
+            std::lock_guard<std::mutex> lk(pool_mutex);
+
+            if (free_vec.size()) {
+                auto p = free_vec.back();
+                free_vec.pop_back();
+                hits++;
+                return p;
+            }
+        }
+
+        misses++;
+
+        return new kis_packet(Globalreg::globalreg);
+    }
+
+    void release(kis_packet *in_pack) {
+        in_pack->reset();
+
+        {
+            std::lock_guard<std::mutex> lk(pool_mutex);
+
+            if (free_vec.size() < max_size) {
+                free_vec.push_back(in_pack);
+                return;
+            }
+        }
+
+        delete in_pack;
+    }
+
+    virtual size_t get_size() override {
+        std::lock_guard<std::mutex> lk(pool_mutex);
+        return free_vec.size();
+    }
+
+protected:
+    std::mutex pool_mutex;
+    std::vector<kis_packet *> free_vec;
+};
 
 // A generic tracked packet, which allows us to save some frames in a way we
 // can recall and expose via the REST interface, for instance
@@ -198,12 +369,17 @@ public:
     uint16_t source_id;
     bool self_data;
 
+    // Size of our own data allocation, which is kept when a pooled chunk is recycled
+    unsigned int alloc_length;
+
     kis_datachunk() {
         self_destruct = 1; // Our delete() handles everything
         self_data = true; // We assume for now we have our own data alloc
         data = NULL;
         length = 0;
+        alloc_length = 0;
         source_id = 0;
+        dlt = 0;
     }
 
     virtual ~kis_datachunk() {
@@ -213,33 +389,50 @@ public:
         length = 0;
     }
 
+    virtual void reset() override {
+        // Keep our own buffer to copy the next packet into, drop references to 
+        // anyone elses
+        if (!self_data) {
+            data = NULL;
+            alloc_length = 0;
+        }
+
+        self_data = true;
+        length = 0;
+        source_id = 0;
+        dlt = 0;
+    }
+
     // Default to copy=true; it's always safe to copy, it's not always safe not to
     virtual void set_data(uint8_t *in_data, unsigned int in_length, bool copy = true) {
-        if (data != NULL && self_data)
-            delete[] data;
-
         if (copy) {
-            data = new uint8_t[in_length];
-            memcpy(data, in_data, in_length);
-            self_data = true;
-        } else {
-            data = in_data;
-            self_data = false;
+            kis_datachunk::copy_data(in_data, in_length);
+            return;
         }
 
+        if (data != NULL && self_data)
+            delete[] data;
+
+        data = in_data;
+        self_data = false;
+        alloc_length = 0;
         length = in_length;
     }
 
     virtual void copy_data(const uint8_t *in_data, unsigned int in_length) {
-        if (data != NULL && self_data)
-            delete[] data;
+        // Re-use our existing buffer if it's big enough
+        if (data == NULL || !self_data || alloc_length < in_length) {
+            if (data != NULL && self_data)
+                delete[] data;
+
+            data = new uint8_t[in_length];
+            alloc_length = in_length;
+        }
 
-        data = new uint8_t[in_length];
         memcpy(data, in_data, in_length);
         self_data = true;
 
         length = in_length;
-
     }
 };
 
@@ -435,6 +628,10 @@ class kis_layer1_packinfo : public packet_component {
 public:
     kis_layer1_packinfo() {
         self_destruct = 1;  // Safe to delete us
+        reset();
+    }
+
+    virtual void reset() override {
         signal_type = kis_l1_signal_type_none;
         signal_dbm = noise_dbm = 0;
         signal_rssi = noise_rssi = 0;
@@ -444,6 +641,8 @@ public:
         freq_khz = 0;
         accuracy = 0;
         channel = "0";
+        antenna_signal_map.clear();
+        content_checkum = 0;
     }
 
     // How "accurate" are we?  Higher == better.  Nothing uses this yet
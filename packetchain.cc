@@ -30,10 +30,18 @@
 #include "alertracker.h"
 #include "configfile.h"
 #include "globalregistry.h"
+#include "gpstracker.h"
+#include "kis_datasource.h"
 #include "messagebus.h"
 #include "packet.h"
 #include "packetchain.h"
 
+// Maximum number of packets pulled from the ingest queue at once
+#define PACKETCHAIN_BATCH_SIZE      64
+
+// Number of times the packethandler thread polls an empty ingest queue before parking
+#define PACKETCHAIN_SPIN_COUNT      256
+
 class SortLinkPriority {
 public:
     inline bool operator() (const packet_chain::pc_link *x, 
@@ -56,8 +64,63 @@ packet_chain::packet_chain() {
     packet_queue_drop =
         Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_backlog_limit", 8192);
 
+    // The ingest ring is bounded; size it to hold the full backlog limit, or pick a 
+    // large ring and stall the producers when it's full if the backlog is unlimited
+    if (packet_queue_drop == 0)
+        packet_queue = std::unique_ptr<kis_mpsc_ring<kis_packet *>>(new kis_mpsc_ring<kis_packet *>(65536));
+    else
+        packet_queue = std::unique_ptr<kis_mpsc_ring<kis_packet *>>(new kis_mpsc_ring<kis_packet *>(packet_queue_drop + 1));
+
     packetchain_shutdown = false;
 
+    pack_comp_datasrc = register_packet_component("KISDATASRC");
+
+    // Number of idle packets and components of each type kept for re-use
+    auto pool_size = 
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_pool_size", 1024);
+
+    packet_pool = std::make_shared<kis_packet_pool>(pool_size);
+    datachunk_pool = 
+        std::make_shared<packet_component_pool<kis_datachunk>>("kis_datachunk", pool_size);
+    l1info_pool = 
+        std::make_shared<packet_component_pool<kis_layer1_packinfo>>("kis_layer1_packinfo", pool_size);
+    gpsinfo_pool = 
+        std::make_shared<packet_component_pool<kis_gps_packinfo>>("kis_gps_packinfo", pool_size);
+    datasrc_pool = 
+        std::make_shared<packet_component_pool<packetchain_comp_datasource>>("packetchain_comp_datasource", 
+                pool_size);
+
+    // Number of threads to spread packet dissection over; 0 or 1 processes every packet 
+    // on the single packethandler thread
+    packet_threads =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_threads", 0);
+
+    if (packet_threads == 1)
+        packet_threads = 0;
+
+    packet_worker_backlog = 0;
+
+    if (packet_threads > 0) {
+        _MSG_INFO("Processing packets with {} dissection threads", packet_threads);
+
+        for (unsigned int i = 0; i < packet_threads; i++) {
+            auto worker = std::unique_ptr<packet_worker>(new packet_worker());
+            auto worker_p = worker.get();
+
+            worker->thread = std::thread([this, worker_p]() {
+                    thread_set_process_name("packetworker");
+                    packet_worker_processor(worker_p);
+                    });
+
+            packet_workers.push_back(std::move(worker));
+        }
+
+        tracker_thread = std::thread([this]() {
+                thread_set_process_name("packettracker");
+                packet_tracker_processor();
+                });
+    }
+
     packet_thread = std::thread([this]() {
             thread_set_process_name("packethandler");
             packet_queue_processor();
@@ -68,9 +131,36 @@ packet_chain::~packet_chain() {
     {
         // Tell the packet thread we're dying and unlock it
         packetchain_shutdown = true;
-        packetqueue_cv.notify_all();
+        packet_queue->wake();
 
         packet_thread.join();
+
+        // Shut down the worker pool and the tracker thread, if we're running them
+        for (auto& w : packet_workers) {
+            w->queue_cv.notify_all();
+            w->thread.join();
+        }
+
+        if (packet_workers.size()) {
+            trackerqueue_cv.notify_all();
+            tracker_thread.join();
+        }
+
+        for (auto& w : packet_workers) {
+            while (w->queue.size()) {
+                destroy_packet(w->queue.front());
+                w->queue.pop();
+            }
+        }
+
+        while (tracker_queue.size()) {
+            destroy_packet(tracker_queue.front());
+            tracker_queue.pop();
+        }
+
+        kis_packet *packet;
+        while (packet_queue->pop(packet))
+            destroy_packet(packet);
     }
 
     {
@@ -163,13 +253,98 @@ std::string packet_chain::fetch_packet_component_name(int in_id) {
 }
 
 kis_packet *packet_chain::generate_packet() {
-    kis_packet *newpack = new kis_packet(Globalreg::globalreg);
+    return packet_pool->acquire();
+}
+
+std::vector<std::shared_ptr<packet_pool_base>> packet_chain::get_packet_pools() {
+    return std::vector<std::shared_ptr<packet_pool_base>>{packet_pool, datachunk_pool, 
+        l1info_pool, gpsinfo_pool, datasrc_pool};
+}
 
-    return newpack;
+void packet_chain::process_chain(std::vector<packet_chain::pc_link *>& chain, 
+        kis_packet *in_pack) {
+    for (auto pcl : chain) {
+        if (pcl->callback != NULL)
+            pcl->callback(Globalreg::globalreg, pcl->auxdata, in_pack);
+        else if (pcl->l_callback != NULL)
+            pcl->l_callback(in_pack);
+    }
 }
 
 void packet_chain::packet_queue_processor() {
-    std::unique_lock<std::mutex> lock(packetqueue_cv_mutex);
+    std::vector<kis_packet *> batch;
+    batch.reserve(PACKETCHAIN_BATCH_SIZE);
+
+    auto abort_wait = [this]() {
+        return (packetchain_shutdown || 
+                Globalreg::globalreg->spindown || 
+                Globalreg::globalreg->fatal_condition ||
+                Globalreg::globalreg->complete);
+    };
+
+    while (!abort_wait()) {
+        // Spin briefly while packets are arriving, then park until a producer wakes us;
+        // the timed park lets us notice spindown even if nothing wakes us
+        if (!packet_queue->wait(PACKETCHAIN_SPIN_COUNT, std::chrono::milliseconds(100), abort_wait))
+            continue;
+
+        batch.clear();
+        packet_queue->pop_batch(batch, PACKETCHAIN_BATCH_SIZE);
+
+        if (batch.size() == 0)
+            continue;
+
+        // In parallel mode we only dispatch the packets to the workers which own
+        // their partitions
+        if (packet_workers.size()) {
+            for (auto packet : batch) {
+                auto worker = partition_packet(packet);
+
+                packet_worker_backlog++;
+
+                {
+                    std::lock_guard<std::mutex> wl(worker->queue_cv_mutex);
+                    worker->queue.push(packet);
+                }
+                worker->queue_cv.notify_one();
+            }
+
+            continue;
+        }
+
+        // Lock the chain mutexes until we're done processing this batch of packets
+        local_locker chainl(&packetchain_mutex);
+
+        // These can only be perturbed inside a sync, which can only occur when
+        // the worker thread is between batches, so we shouldn't need to worry 
+        // about the integrity of these vectors while running
+        for (auto packet : batch) {
+            process_chain(postcap_chain, packet);
+            process_chain(llcdissect_chain, packet);
+            process_chain(decrypt_chain, packet);
+            process_chain(datadissect_chain, packet);
+            process_chain(classifier_chain, packet);
+            process_chain(tracker_chain, packet);
+            process_chain(logging_chain, packet);
+
+            destroy_packet(packet);
+        }
+    }
+}
+
+packet_chain::packet_worker *packet_chain::partition_packet(kis_packet *in_pack) {
+    // Keep all packets from a datasource on the same worker so that they are
+    // dissected in order; packets with no source all land on the first worker
+    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+
+    if (datasrc == nullptr || datasrc->ref_source == nullptr)
+        return packet_workers[0].get();
+
+    return packet_workers[datasrc->ref_source->get_source_number() % packet_workers.size()].get();
+}
+
+void packet_chain::packet_worker_processor(packet_worker *worker) {
+    std::unique_lock<std::mutex> lock(worker->queue_cv_mutex);
 
     kis_packet *packet = NULL;
 
@@ -178,144 +353,146 @@ void packet_chain::packet_queue_processor() {
             !Globalreg::globalreg->fatal_condition &&
             !Globalreg::globalreg->complete) {
 
-        packetqueue_cv.wait(lock, [this] {
-            return (packet_queue.size() ||
+        worker->queue_cv.wait(lock, [this, worker] {
+            return (worker->queue.size() ||
                     packetchain_shutdown || 
                     Globalreg::globalreg->spindown || 
                     Globalreg::globalreg->fatal_condition ||
                     Globalreg::globalreg->complete);
             });
 
-        // At this point we own lock, and it is locked, we need to re-lock it before we leave the loop
-
-        if (packet_queue.size() != 0) {
-            // Get the next packet
-            packet = packet_queue.front();
-            packet_queue.pop();
+        if (worker->queue.size() == 0)
+            continue;
 
-            // Lock the chain mutexes until we're done processing this packet
-            local_locker chainl(&packetchain_mutex);
+        packet = worker->queue.front();
+        worker->queue.pop();
 
-            // Unlock the queue while we process that packet
-            lock.unlock();
+        lock.unlock();
 
-            // These can only be perturbed inside a sync, which can only occur when
-            // the worker thread is in the sync block above, so we shouldn't
-            // need to worry about the integrity of these vectors while running
+        {
+            // Workers only need to keep the chains from being modified, they can
+            // all share the chain lock.  Only the decode stages run here; the classifier
+            // stages create and update devices and must stay on the tracker thread
+            local_shared_locker chainl(&packetchain_mutex);
 
-            for (auto pcl : postcap_chain) {
-                if (pcl->callback != NULL)
-                    pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-                else if (pcl->l_callback != NULL)
-                    pcl->l_callback(packet);
-            }
+            process_chain(postcap_chain, packet);
+            process_chain(llcdissect_chain, packet);
+            process_chain(decrypt_chain, packet);
+            process_chain(datadissect_chain, packet);
+        }
 
-            for (auto pcl : llcdissect_chain) {
-                if (pcl->callback != NULL)
-                    pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-                else if (pcl->l_callback != NULL)
-                    pcl->l_callback(packet);
-            }
+        queue_tracker_packet(packet);
 
-            for (auto pcl : decrypt_chain) {
-                if (pcl->callback != NULL)
-                    pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-                else if (pcl->l_callback != NULL)
-                    pcl->l_callback(packet);
-            }
+        lock.lock();
+    }
+}
 
-            for (auto pcl : datadissect_chain) {
-                if (pcl->callback != NULL)
-                    pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-                else if (pcl->l_callback != NULL)
-                    pcl->l_callback(packet);
-            }
+void packet_chain::queue_tracker_packet(kis_packet *in_pack) {
+    {
+        std::lock_guard<std::mutex> lock(trackerqueue_cv_mutex);
+        tracker_queue.push(in_pack);
+    }
 
-            for (auto pcl : classifier_chain) {
-                if (pcl->callback != NULL)
-                    pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-                else if (pcl->l_callback != NULL)
-                    pcl->l_callback(packet);
-            }
+    trackerqueue_cv.notify_one();
+}
 
-            for (auto pcl : tracker_chain) {
-                if (pcl->callback != NULL)
-                    pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-                else if (pcl->l_callback != NULL)
-                    pcl->l_callback(packet);
-            }
+void packet_chain::packet_tracker_processor() {
+    std::unique_lock<std::mutex> lock(trackerqueue_cv_mutex);
 
-            for (auto pcl : logging_chain) {
-                if (pcl->callback != NULL)
-                    pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-                else if (pcl->l_callback != NULL)
-                    pcl->l_callback(packet);
-            }
+    kis_packet *packet = NULL;
 
-            destroy_packet(packet);
+    while (!packetchain_shutdown && 
+            !Globalreg::globalreg->spindown && 
+            !Globalreg::globalreg->fatal_condition &&
+            !Globalreg::globalreg->complete) {
 
-            lock.lock();
+        trackerqueue_cv.wait(lock, [this] {
+            return (tracker_queue.size() ||
+                    packetchain_shutdown || 
+                    Globalreg::globalreg->spindown || 
+                    Globalreg::globalreg->fatal_condition ||
+                    Globalreg::globalreg->complete);
+            });
 
+        if (tracker_queue.size() == 0)
             continue;
+
+        packet = tracker_queue.front();
+        tracker_queue.pop();
+
+        lock.unlock();
+
+        {
+            local_shared_locker chainl(&packetchain_mutex);
+
+            process_chain(classifier_chain, packet);
+            process_chain(tracker_chain, packet);
+            process_chain(logging_chain, packet);
         }
 
-        // No packets; fall through to blocking until we have them
+        destroy_packet(packet);
+
+        packet_worker_backlog--;
+
         lock.lock();
     }
 }
 
 int packet_chain::process_packet(kis_packet *in_pack) {
-    std::unique_lock<std::mutex> lock(packetqueue_cv_mutex);
+    // Packets still being dissected by the worker pool count against the backlog
+    auto backlog = packet_queue->size() + packet_worker_backlog;
 
-    if (packet_queue.size() > packet_queue_warning &&
+    if (backlog > packet_queue_warning &&
             packet_queue_warning != 0) {
-        time_t offt = time(0) - last_packet_queue_user_warning;
-
-        if (offt > 30) {
-            last_packet_queue_user_warning = time(0);
+        time_t now = time(0);
+        time_t last = last_packet_queue_user_warning;
 
+        // Only one producer gets to raise the warning
+        if (now - last > 30 && 
+                last_packet_queue_user_warning.compare_exchange_strong(last, now)) {
             auto alertracker = Globalreg::fetch_mandatory_global_as<alert_tracker>();
             alertracker->raise_one_shot("PACKETQUEUE", 
-                    "The packet queue has a backlog of " + int_to_string(packet_queue.size()) + 
+                    "The packet queue has a backlog of " + int_to_string(backlog) + 
                     " packets; if you have multiple data sources it's possible that your "
                     "system is not fast enough.  Kismet will continue to process "
                     "packets, this may be a momentary spike in packet load.", -1);
         }
     }
 
-    if (packet_queue_drop != 0 && packet_queue.size() > packet_queue_drop) {
-        time_t offt = time(0) - last_packet_drop_user_warning;
-
-        if (offt > 30) {
-            last_packet_drop_user_warning = time(0);
+    if (packet_queue_drop != 0 && backlog > packet_queue_drop) {
+        time_t now = time(0);
+        time_t last = last_packet_drop_user_warning;
 
+        if (now - last > 30 &&
+                last_packet_drop_user_warning.compare_exchange_strong(last, now)) {
             std::shared_ptr<alert_tracker> alertracker =
                 Globalreg::fetch_mandatory_global_as<alert_tracker>();
             alertracker->raise_one_shot("PACKETLOST", 
                     "Kismet has started to drop packets; the packet queue has a backlog "
-                    "of " + int_to_string(packet_queue.size()) + " packets.  Your system "
+                    "of " + int_to_string(backlog) + " packets.  Your system "
                     "may not be fast enough to process the number of packets being seen. "
                     "You change this behavior in 'kismet_memory.conf'.", -1);
         }
 
         // Don't queue packets
-        lock.unlock();
         return 1;
     }
 
-    // Queue the packet
-    packet_queue.push(in_pack);
+    // Queue the packet; the ring is sized to the backlog limit so a full ring is
+    // treated the same as exceeding the limit.  With no limit, wait for the 
+    // packethandler thread to make room.
+    while (!packet_queue->push(in_pack)) {
+        if (packet_queue_drop != 0 || packetchain_shutdown)
+            return 1;
 
-    // Unlock and notify all workers
-    lock.unlock();
-    packetqueue_cv.notify_all();
+        std::this_thread::yield();
+    }
 
     return 1;
 }
 
 void packet_chain::destroy_packet(kis_packet *in_pack) {
-
-	delete in_pack;
+    packet_pool->release(in_pack);
 }
 
 int packet_chain::register_int_handler(pc_callback in_cb, void *in_aux,
@@ -35,9 +35,14 @@
 #include <functional>
 #include <queue>
 #include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
 
 #include "globalregistry.h"
+#include "kis_mpsc_ring.h"
 #include "kis_mutex.h"
+#include "packet.h"
 
 
 /* Packets are added to the packet queue from any thread (including the main 
@@ -84,6 +89,8 @@
     kis_packet *in_pack
 
 class kis_packet;
+class kis_gps_packinfo;
+class packetchain_comp_datasource;
 
 class packet_chain : public lifetime_global {
 public:
@@ -113,6 +120,16 @@ public:
     int process_packet(kis_packet *in_pack);
     // Destroy a packet at the end of its life
     void destroy_packet(kis_packet *in_pack);
+
+    // Recycling pools for the components attached to every datasource report; 
+    // components acquired from a pool are returned to it when the packet is destroyed
+    std::shared_ptr<packet_component_pool<kis_datachunk>> datachunk_pool;
+    std::shared_ptr<packet_component_pool<kis_layer1_packinfo>> l1info_pool;
+    std::shared_ptr<packet_component_pool<kis_gps_packinfo>> gpsinfo_pool;
+    std::shared_ptr<packet_component_pool<packetchain_comp_datasource>> datasrc_pool;
+
+    // All packet and component pools, for reporting pool usage
+    std::vector<std::shared_ptr<packet_pool_base>> get_packet_pools();
  
     // Callback and information 
     typedef int (*pc_callback)(CHAINCALL_PARMS);
@@ -133,6 +150,35 @@ public:
 protected:
     void packet_queue_processor();
 
+    // Run a packet through a single chain stage
+    void process_chain(std::vector<packet_chain::pc_link *>& chain, kis_packet *in_pack);
+
+    // Parallel packet processing; the decode stages (post-capture through data-dissect)
+    // are run on a pool of workers.  Packets are partitioned across the workers by their
+    // datasource so that ordering is preserved within a source, and decoded packets
+    // are handed to a single tracker thread which serializes the classifier, tracker, and
+    // logging stages.  Handlers in the decode stages may run concurrently and must
+    // protect any state they share between packets.
+    class packet_worker {
+    public:
+        packet_worker() { }
+
+        std::thread thread;
+
+        std::mutex queue_cv_mutex;
+        std::condition_variable queue_cv;
+        std::queue<kis_packet *> queue;
+    };
+
+    void packet_worker_processor(packet_worker *worker);
+    void packet_tracker_processor();
+
+    // Pick the worker for a packet
+    packet_worker *partition_packet(kis_packet *in_pack);
+
+    // Hand a packet to the serialized tracker stage
+    void queue_tracker_packet(kis_packet *in_pack);
+
     // Common function for both insertion methods
     int register_int_handler(pc_callback in_cb, void *in_aux, 
             std::function<int (kis_packet *)> in_l_cb, 
@@ -160,15 +206,31 @@ protected:
 
     std::thread packet_thread;
 
-    std::mutex packetqueue_cv_mutex;
-    std::condition_variable packetqueue_cv;
+    // Lock-free ingest queue; any number of datasource threads push, the 
+    // packethandler thread drains it in batches
+    std::unique_ptr<kis_mpsc_ring<kis_packet *>> packet_queue;
+    std::atomic<bool> packetchain_shutdown;
+
+    // Worker pool when running in parallel mode; empty in single-thread mode
+    unsigned int packet_threads;
+    std::vector<std::unique_ptr<packet_worker>> packet_workers;
+
+    // Number of packets handed to the workers which have not yet completed the
+    // tracker stage; counted against the backlog limits
+    std::atomic<unsigned int> packet_worker_backlog;
+
+    std::thread tracker_thread;
+    std::mutex trackerqueue_cv_mutex;
+    std::condition_variable trackerqueue_cv;
+    std::queue<kis_packet *> tracker_queue;
+
+    int pack_comp_datasrc;
 
-    std::queue<kis_packet *> packet_queue;
-    bool packetchain_shutdown;
+    std::shared_ptr<kis_packet_pool> packet_pool;
 
     // Warning and discard levels for packet queue being full
     unsigned int packet_queue_warning, packet_queue_drop;
-    time_t last_packet_queue_user_warning, last_packet_drop_user_warning;
+    std::atomic<time_t> last_packet_queue_user_warning, last_packet_drop_user_warning;
 };
 
 #endif
@@ -611,6 +611,30 @@ kis_80211_phy::kis_80211_phy(global_registry *in_globalreg, int in_phyid) :
     if (keep_ie_tags_per_bssid)
         _MSG_INFO("Keeping a copy of advertised IE tags for each SSID; this can use more CPU and RAM.");
 
+    beacon_cache =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_beacon_cache", true);
+    beacon_cache_hits = 0;
+    beacon_cache_misses = 0;
+
+    beacon_cache_hits_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.phy80211.beacon_cache.hits",
+                tracker_element_factory<tracker_element_uint64>(),
+                "beacons and probe responses matching the cached copy");
+    beacon_cache_misses_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.phy80211.beacon_cache.misses",
+                tracker_element_factory<tracker_element_uint64>(),
+                "beacons and probe responses which required full IE dissection");
+    beacon_cache_hit_rate_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.phy80211.beacon_cache.hit_rate",
+                tracker_element_factory<tracker_element_double>(),
+                "percentage of beacons and probe responses matching the cached copy");
+
+    beacon_cache_endp =
+        std::make_shared<kis_net_httpd_simple_tracked_endpoint>("/phy/phy80211/beacon_cache", 
+                [this]() -> std::shared_ptr<tracker_element> {
+                    return beacon_cache_endp_handler();
+                });
+
     // access-point view
     if (Globalreg::globalreg->kismet_config->fetch_opt_bool("dot11_view_accesspoints", true)) {
         ap_view = 
@@ -1736,24 +1760,46 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
         return;
     }
 
-    // If we've processed an identical ssid, don't waste time parsing again, just tweak
-    // the few fields we need to update
-    if (dot11dev->get_last_adv_ie_csum() == dot11info->ietag_csum) {
-        ssid = dot11dev->get_last_adv_ssid();
+    auto& ie_cache = dot11dev->get_adv_ie_cache(dot11info->subtype == packet_sub_beacon);
 
-        if (ssid != NULL) {
-            if (ssid->get_last_time() < in_pack->ts.tv_sec)
-                ssid->set_last_time(in_pack->ts.tv_sec);
+    // A beacon we've been asked to snapshot always takes the full path
+    bool snap_pending = dot11info->subtype == packet_sub_beacon &&
+        dot11dev->get_snap_next_beacon();
 
-            if (dot11info->subtype == packet_sub_beacon) {
-                ssid->inc_beacons_sec();
-            }
+    // If we've processed an identical beacon or response, don't waste time parsing 
+    // again, just tweak the few fields we need to update; signal and packet counts
+    // are handled by the common device path
+    if (beacon_cache && !snap_pending && ie_cache.ssid != nullptr && 
+            ie_cache.ie_hash == dot11info->ietag_hash) {
+        ssid = ie_cache.ssid;
+
+        if (ssid->get_last_time() < in_pack->ts.tv_sec)
+            ssid->set_last_time(in_pack->ts.tv_sec);
+
+        if (dot11info->subtype == packet_sub_beacon) {
+            ssid->inc_beacons_sec();
         }
 
+        // The cached record may not be the last one seen if the device alternates
+        // between beacons and responses
+        dot11dev->get_last_beaconed_ssid_record()->set(ssid);
+
+        if (pack_gpsinfo != NULL && pack_gpsinfo->fix > 1) {
+            if (ssid->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
+                    pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
+                    pack_gpsinfo->heading))
+                basedev->mark_content_changed();
+        }
+
+        beacon_cache_hits++;
+
         return;
     }
 
-    dot11dev->set_last_adv_ie_csum(dot11info->ietag_csum);
+    beacon_cache_misses++;
+
+    // Only cache once the tags have been successfully processed below
+    ie_cache.ssid.reset();
 
     // If we fail parsing...
     if (packet_dot11_ie_dissector(in_pack, dot11info) < 0) {
@@ -1761,8 +1807,7 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
     }
 
     // If we're looking for the beacon, snapshot it
-    if (dot11info->subtype == packet_sub_beacon &&
-            dot11dev->get_snap_next_beacon()) {
+    if (snap_pending) {
 
         // Grab the 80211 frame, if that doesn't exist, grab the link frame
         kis_datachunk *chunk = in_pack->fetch<kis_datachunk>(pack_comp_decap);
@@ -1795,6 +1840,7 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
         
         ssid = dot11dev->new_advertised_ssid();
         adv_ssid_map->insert(dot11info->ssid_csum, ssid);
+        basedev->mark_content_changed();
 
         ssid->set_crypt_set(dot11info->cryptset);
         ssid->set_first_time(in_pack->ts.tv_sec);
@@ -1888,7 +1934,12 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
             ssid->set_last_time(in_pack->ts.tv_sec);
     }
 
-    dot11dev->set_last_adv_ssid(ssid);
+    ie_cache.ie_hash = dot11info->ietag_hash;
+    ie_cache.ssid = ssid;
+
+    // Anything below which changes what the SSID advertises, instead of just its 
+    // counters, marks the device content as changed for incremental loggers
+    bool content_changed = false;
 
     ssid->set_ietag_checksum(dot11info->ietag_csum);
 
@@ -1909,12 +1960,18 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
         ssid->set_last_time(in_pack->ts.tv_sec);
 
     // Update MFP
+    bool mfp_required = false, mfp_supported = false;
+
     if (dot11info->rsn != nullptr) {
-        ssid->set_wpa_mfp_required(dot11info->rsn->rsn_capability_mfp_required());
-        ssid->set_wpa_mfp_supported(dot11info->rsn->rsn_capability_mfp_supported());
-    } else {
-        ssid->set_wpa_mfp_required(false);
-        ssid->set_wpa_mfp_supported(false);
+        mfp_required = dot11info->rsn->rsn_capability_mfp_required();
+        mfp_supported = dot11info->rsn->rsn_capability_mfp_supported();
+    }
+
+    if (ssid->get_wpa_mfp_required() != mfp_required || 
+            ssid->get_wpa_mfp_supported() != mfp_supported) {
+        ssid->set_wpa_mfp_required(mfp_required);
+        ssid->set_wpa_mfp_supported(mfp_supported);
+        content_changed = true;
     }
 
     if (dot11info->subtype == packet_sub_beacon) {
@@ -1944,11 +2001,17 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
         ssid->set_ssid_beacon(true);
 
         // Update beacon info, if any
-        if (dot11info->beacon_info.length() > 0) 
+        if (dot11info->beacon_info.length() > 0 && 
+                (!ssid->has_beacon_info() || ssid->get_beacon_info() != dot11info->beacon_info)) {
             ssid->set_beacon_info(dot11info->beacon_info);
+            content_changed = true;
+        }
 
         // Set the mobility
         if (dot11info->dot11r_mobility != NULL) {
+            if (!ssid->get_dot11r_mobility())
+                content_changed = true;
+
             ssid->set_dot11r_mobility(true);
             ssid->set_dot11r_mobility_domain_id(dot11info->dot11r_mobility->mobility_domain());
         }
@@ -1970,6 +2033,11 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
             ssid->set_dot11e_qbss_channel_load(chperc);
         }
 
+        auto prev_channel = ssid->get_channel();
+        auto prev_ht_mode = ssid->get_ht_mode();
+        auto prev_ht_center_1 = ssid->get_ht_center_1();
+        auto prev_ht_center_2 = ssid->get_ht_center_2();
+
         // Set the HT and VHT info.  If we have VHT, we assume we must have HT; I've never
         // seen VHT without HT.  We handle HT only later on.
         if (dot11info->dot11vht != nullptr && dot11info->dot11ht != nullptr) {
@@ -2016,8 +2084,18 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
             ssid->set_channel(int_to_string(dot11info->dot11ht->primary_channel()));
         }
 
+        if (ssid->get_channel() != prev_channel ||
+                ssid->get_ht_mode() != prev_ht_mode || 
+                ssid->get_ht_center_1() != prev_ht_center_1 ||
+                ssid->get_ht_center_2() != prev_ht_center_2)
+            content_changed = true;
+
         // Update OWE
         if (dot11info->owe_transition != nullptr) {
+            if (!ssid->has_owe_bssid() || 
+                    ssid->get_owe_bssid() != dot11info->owe_transition->bssid())
+                content_changed = true;
+
             ssid->set_owe_bssid(dot11info->owe_transition->bssid());
             ssid->set_owe_ssid_len(dot11info->owe_transition->ssid().length());
             ssid->set_owe_ssid(munge_to_printable(dot11info->owe_transition->ssid()));
@@ -2072,6 +2150,7 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
 
         ssid->set_crypt_set(dot11info->cryptset);
         basedev->set_crypt_string(crypt_to_simple_string(dot11info->cryptset));
+        content_changed = true;
     }
 
     if (ssid->get_channel().length() > 0 &&
@@ -2090,6 +2169,7 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
                     dot11info->channel, al);
 
             ssid->set_channel(dot11info->channel); 
+            content_changed = true;
         } else if (dot11info->subtype == packet_sub_probe_resp) {
             auto al =
                 fmt::format("IEEE80211 Access Point BSSID {} SSID \"{}\" sent a probe response with "
@@ -2142,6 +2222,8 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
                         dot11info->channel, al);
 
             }
+
+            content_changed = true;
         }
 
         ssid->set_dot11d_country(dot11info->dot11d_country);
@@ -2149,19 +2231,39 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
 
     }
 
+    if (ssid->has_wps_state() && ssid->get_wps_state() != dot11info->wps)
+        content_changed = true;
     ssid->set_wps_state(dot11info->wps);
-    if (dot11info->wps_manuf != "")
+
+    if (dot11info->wps_manuf != "" && 
+            (!ssid->has_wps_manuf() || ssid->get_wps_manuf() != dot11info->wps_manuf)) {
         ssid->set_wps_manuf(dot11info->wps_manuf);
-    if (dot11info->wps_model_name != "") {
+        content_changed = true;
+    }
+    if (dot11info->wps_model_name != "" && 
+            (!ssid->has_wps_model_name() || 
+             ssid->get_wps_model_name() != dot11info->wps_model_name)) {
         ssid->set_wps_model_name(dot11info->wps_model_name);
+        content_changed = true;
     }
-    if (dot11info->wps_model_number != "") 
+    if (dot11info->wps_model_number != "" && 
+            (!ssid->has_wps_model_number() || 
+             ssid->get_wps_model_number() != dot11info->wps_model_number)) {
         ssid->set_wps_model_number(dot11info->wps_model_number);
-    if (dot11info->wps_serial_number != "")
+        content_changed = true;
+    }
+    if (dot11info->wps_serial_number != "" &&
+            (!ssid->has_wps_serial_number() || 
+             ssid->get_wps_serial_number() != dot11info->wps_serial_number)) {
         ssid->set_wps_serial_number(dot11info->wps_serial_number);
+        content_changed = true;
+    }
 
-    if (dot11info->wps_uuid_e != "")
+    if (dot11info->wps_uuid_e != "" &&
+            (!ssid->has_wps_uuid_e() || ssid->get_wps_uuid_e() != dot11info->wps_uuid_e)) {
         ssid->set_wps_uuid_e(dot11info->wps_uuid_e);
+        content_changed = true;
+    }
 
     /* kis_manuf should be the IEEE manuf, not inherited from WPS.
      * Also, never do this - this clobbers the universal 'unknown' manuf.
@@ -2189,18 +2291,24 @@ void kis_80211_phy::HandleSSID(std::shared_ptr<kis_tracked_device_base> basedev,
         }
 
         ssid->set_beaconrate(Ieee80211Interval2NSecs(dot11info->beacon_interval));
+        content_changed = true;
     }
 
-    ssid->set_maxrate(dot11info->maxrate);
+    if (ssid->get_maxrate() != dot11info->maxrate) {
+        ssid->set_maxrate(dot11info->maxrate);
+        content_changed = true;
+    }
 
     // Add the location data, if any
     if (pack_gpsinfo != NULL && pack_gpsinfo->fix > 1) {
-        ssid->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
+        if (ssid->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
                 pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
-                pack_gpsinfo->heading);
-
+                pack_gpsinfo->heading))
+            content_changed = true;
     }
 
+    if (content_changed)
+        basedev->mark_content_changed();
 }
 
 void kis_80211_phy::handle_probed_ssid(std::shared_ptr<kis_tracked_device_base> basedev,
@@ -2241,6 +2349,7 @@ void kis_80211_phy::handle_probed_ssid(std::shared_ptr<kis_tracked_device_base>
             probessid->set_first_time(in_pack->ts.tv_sec);
 
             probemap->insert(dot11info->ssid_csum, probessid);
+            basedev->mark_content_changed();
         } else {
             probessid = std::static_pointer_cast<dot11_probed_ssid>(ssid_itr->second);
         }
@@ -2250,9 +2359,10 @@ void kis_80211_phy::handle_probed_ssid(std::shared_ptr<kis_tracked_device_base>
 
         // Add the location data, if any
         if (pack_gpsinfo != nullptr && pack_gpsinfo->fix > 1) {
-            probessid->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
+            if (probessid->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
                     pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
-                    pack_gpsinfo->heading);
+                    pack_gpsinfo->heading))
+                basedev->mark_content_changed();
         }
 
         if (dot11info->dot11r_mobility != nullptr) {
@@ -2346,6 +2456,7 @@ void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssi
             client_record = clientdot11->new_client();
             new_client_record = true;
             client_map->insert(bssiddev->get_macaddr(), client_record);
+            clientdev->mark_content_changed();
         } else {
             client_record = 
                 std::static_pointer_cast<dot11_client>(cmi->second);
@@ -2451,9 +2562,10 @@ void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssi
 
         // Update the GPS info
         if (pack_gpsinfo != NULL && pack_gpsinfo->fix > 1) {
-            client_record->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
+            if (client_record->get_location()->add_loc(pack_gpsinfo->lat, pack_gpsinfo->lon,
                     pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
-                    pack_gpsinfo->heading);
+                    pack_gpsinfo->heading))
+                clientdev->mark_content_changed();
         }
 
         // Update the forward map to the bssid
@@ -2467,6 +2579,7 @@ void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssi
                 bssiddot11->get_associated_client_map()->end()) {
             bssiddot11->get_associated_client_map()->insert(clientdev->get_macaddr(),
                     clientdev->get_tracker_key());
+            bssiddev->mark_content_changed();
         }
     }
 }
@@ -2838,6 +2951,23 @@ std::string kis_80211_phy::crypt_to_simple_string(uint64_t cryptset) {
     return "Other";
 }
 
+std::shared_ptr<tracker_element> kis_80211_phy::beacon_cache_endp_handler() {
+    auto ret = std::make_shared<tracker_element_map>();
+
+    uint64_t hits = beacon_cache_hits;
+    uint64_t misses = beacon_cache_misses;
+    double rate = 0;
+
+    if (hits + misses > 0)
+        rate = ((double) hits / (double) (hits + misses)) * 100.0f;
+
+    ret->insert(std::make_shared<tracker_element_uint64>(beacon_cache_hits_id, hits));
+    ret->insert(std::make_shared<tracker_element_uint64>(beacon_cache_misses_id, misses));
+    ret->insert(std::make_shared<tracker_element_double>(beacon_cache_hit_rate_id, rate));
+
+    return ret;
+}
+
 bool kis_80211_phy::httpd_verify_path(const char *path, const char *method) {
     if (strcmp(method, "GET") == 0) {
         std::vector<std::string> tokenurl = str_tokenize(path, "/");
@@ -3062,10 +3192,7 @@ public:
             ssid = std::static_pointer_cast<dot11_advertised_ssid>(int_itr->second);
 
             if (time(0) - ssid->get_last_time() > timeout && device->get_packets() < packets) {
-                if (dot11dev->get_last_adv_ssid() == ssid) {
-                    dot11dev->set_last_adv_ssid(NULL);
-                    dot11dev->set_last_adv_ie_csum(0);
-                }
+                dot11dev->clear_adv_ie_cache(ssid);
 
                 adv_ssid_map->erase(int_itr);
                 int_itr = adv_ssid_map->begin();
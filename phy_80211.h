@@ -29,6 +29,8 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -136,6 +138,7 @@ class dot11_packinfo : public packet_component {
 
             // Many of thse will not be available until the IE tags are parsed
             ietag_csum = 0;
+            ietag_hash = 0;
 
             dot11d_country = "";
 
@@ -221,6 +224,8 @@ class dot11_packinfo : public packet_component {
 
         uint32_t ssid_csum;
         uint32_t ietag_csum;
+        // Beacon cache hash of the IE tags and fixed parameters
+        uint32_t ietag_hash;
 
         // Tupled hash map
         std::multimap<std::tuple<uint8_t, uint32_t, uint8_t>, size_t> ietag_hash_map;
@@ -402,7 +407,9 @@ protected:
     std::shared_ptr<device_tracker> devicetracker;
     std::shared_ptr<event_bus> eventbus;
 
-    // Checksum of recent packets for duplication filtering
+    // Checksum of recent packets for duplication filtering; the dissector may run
+    // on several packet worker threads at once
+    std::mutex recent_packet_checksum_mutex;
     uint32_t *recent_packet_checksums;
     size_t recent_packet_checksums_sz;
     unsigned int recent_packet_checksum_pos;
@@ -539,6 +546,15 @@ protected:
 
     // Do we store the last beaconed tags in the ssid record?
     bool keep_ie_tags_per_bssid;
+
+    // Do we skip dissecting beacons and probe responses identical to the last one seen?
+    bool beacon_cache;
+    std::atomic<uint64_t> beacon_cache_hits;
+    std::atomic<uint64_t> beacon_cache_misses;
+    int beacon_cache_hits_id, beacon_cache_misses_id, beacon_cache_hit_rate_id;
+
+    std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> beacon_cache_endp;
+    std::shared_ptr<tracker_element> beacon_cache_endp_handler();
 };
 
 #endif
@@ -299,7 +299,7 @@ void dot11_advertised_ssid::set_ietag_content_from_packet(std::shared_ptr<dot11_
     if (tags == nullptr)
         return;
 
-    for (auto t : *(tags->tags())) {
+    for (const auto& t : tags->tag_list()) {
         auto tag = std::make_shared<dot11_tracked_ietag>(ie_tag_content_element_id);
         tag->set_from_tag(t);
         tagmap->insert(tag->get_unique_tag_id(), tag);
@@ -338,16 +338,14 @@ void dot11_tracked_ietag::register_fields() {
         "Complete IE tag data", &complete_tag_data);
 }
 
-void dot11_tracked_ietag::set_from_tag(std::shared_ptr<dot11_ie::dot11_ie_tag> tag) {
-    set_tag_number(tag->tag_num());
-    set_complete_tag_data(tag->tag_data());
+void dot11_tracked_ietag::set_from_tag(const dot11_ie::dot11_ie_tag& tag) {
+    set_tag_number(tag.tag_num());
+    set_complete_tag_data(tag.tag_data());
 
-    if (tag->tag_num() == 150) {
+    if (tag.tag_num() == 150) {
         try {
-            tag->tag_data_stream()->seek(0);
-
             dot11_ie_150_vendor tag150;
-            tag150.parse(tag->tag_data_stream());
+            tag150.parse(tag.tag_data_ptr(), tag.tag_len());
 
             set_tag_oui(tag150.vendor_oui_int());
 
@@ -356,19 +354,17 @@ void dot11_tracked_ietag::set_from_tag(std::shared_ptr<dot11_ie::dot11_ie_tag> t
 
             set_tag_vendor_or_sub(tag150.vendor_oui_type());
 
-            set_unique_tag_id(adler32_checksum(fmt::format("{}{}{}", tag->tag_num(), tag150.vendor_oui_int(), tag150.vendor_oui_type())));
+            set_unique_tag_id(adler32_checksum(fmt::format("{}{}{}", tag.tag_num(), tag150.vendor_oui_int(), tag150.vendor_oui_type())));
 
             return;
         } catch (const std::exception& e) {
             // Do nothing; fall through to setting the tag num
             ;
         }
-    } else if (tag->tag_num() == 221) {
+    } else if (tag.tag_num() == 221) {
         try {
-            tag->tag_data_stream()->seek(0);
-
             dot11_ie_221_vendor tag221;
-            tag221.parse(tag->tag_data_stream());
+            tag221.parse(tag.tag_data_ptr(), tag.tag_len());
 
             set_tag_oui(tag221.vendor_oui_int());
 
@@ -377,23 +373,23 @@ void dot11_tracked_ietag::set_from_tag(std::shared_ptr<dot11_ie::dot11_ie_tag> t
 
             set_tag_vendor_or_sub(tag221.vendor_oui_type());
 
-            set_unique_tag_id(adler32_checksum(fmt::format("{}{}{}", tag->tag_num(), tag221.vendor_oui_int(), tag221.vendor_oui_type())));
+            set_unique_tag_id(adler32_checksum(fmt::format("{}{}{}", tag.tag_num(), tag221.vendor_oui_int(), tag221.vendor_oui_type())));
 
             return; 
         } catch (const std::exception& e) {
             // Do nothing; fall through to setting the tag num
             ;
         }
-    } else if (tag->tag_num() == 255) {
+    } else if (tag.tag_num() == 255) {
         try {
-            tag->tag_data_stream()->seek(0);
+            tag.tag_data_stream()->seek(0);
 
             dot11_ie_255_ext tag255;
-            tag255.parse(tag->tag_data_stream());
+            tag255.parse(tag.tag_data_stream());
 
             set_tag_vendor_or_sub(tag255.subtag_num());
             
-            set_unique_tag_id(adler32_checksum(fmt::format("{}{}", tag->tag_num(), tag255.subtag_num())));
+            set_unique_tag_id(adler32_checksum(fmt::format("{}{}", tag.tag_num(), tag255.subtag_num())));
             return;
         } catch (const std::exception& e) {
             // Do nothing; fall through to setting the tag num
@@ -403,6 +399,6 @@ void dot11_tracked_ietag::set_from_tag(std::shared_ptr<dot11_ie::dot11_ie_tag> t
         set_tag_vendor_or_sub(-1);
     }
 
-    set_unique_tag_id(tag->tag_num());
+    set_unique_tag_id(tag.tag_num());
 }
 
@@ -355,7 +355,7 @@ public:
     __Proxy(tag_vendor_or_sub, int16_t, int16_t, int16_t, tag_vendor_or_sub);
     __Proxy(complete_tag_data, std::string, std::string, std::string, complete_tag_data);
 
-    void set_from_tag(std::shared_ptr<dot11_ie::dot11_ie_tag> ie);
+    void set_from_tag(const dot11_ie::dot11_ie_tag& ie);
 
 protected:
     virtual void register_fields() override;
@@ -885,7 +885,6 @@ public:
     dot11_tracked_device() :
         tracker_component() {
 
-        last_adv_ie_csum = 0;
         last_bss_invalid = 0;
         bss_invalid_count = 0;
         snapshot_next_beacon = false;
@@ -897,7 +896,6 @@ public:
     dot11_tracked_device(int in_id) :
         tracker_component(in_id) { 
 
-        last_adv_ie_csum = 0;
         last_bss_invalid = 0;
         bss_invalid_count = 0;
         snapshot_next_beacon = false;
@@ -909,7 +907,6 @@ public:
     dot11_tracked_device(int in_id, std::shared_ptr<tracker_element_map> e) :
         tracker_component(in_id) {
 
-        last_adv_ie_csum = 0;
         last_bss_invalid = 0;
         bss_invalid_count = 0;
         snapshot_next_beacon = false;
@@ -1011,13 +1008,28 @@ public:
         return std::make_shared<dot11_tracked_nonce>(wpa_nonce_entry_id);
     }
 
-    uint32_t get_last_adv_ie_csum() { return last_adv_ie_csum; }
-    void set_last_adv_ie_csum(uint32_t csum) { last_adv_ie_csum = csum; }
-    std::shared_ptr<dot11_advertised_ssid> get_last_adv_ssid() {
-        return last_adv_ssid;
+    // Last IE hash and matching ssid record, kept separately for beacons and probe
+    // responses since an AP sends different tags in each
+    struct adv_ie_cache_entry {
+        adv_ie_cache_entry() :
+            ie_hash {0} { }
+
+        uint32_t ie_hash;
+        std::shared_ptr<dot11_advertised_ssid> ssid;
+    };
+
+    adv_ie_cache_entry& get_adv_ie_cache(bool beacon) {
+        return beacon ? beacon_ie_cache : proberesp_ie_cache;
     }
-    void set_last_adv_ssid(std::shared_ptr<dot11_advertised_ssid> adv_ssid) {
-        last_adv_ssid = adv_ssid;
+
+    // Forget any cached IE hash pointing to an ssid record which is being removed
+    void clear_adv_ie_cache(std::shared_ptr<dot11_advertised_ssid> adv_ssid) {
+        for (auto c : {&beacon_ie_cache, &proberesp_ie_cache}) {
+            if (c->ssid == adv_ssid) {
+                c->ie_hash = 0;
+                c->ssid.reset();
+            }
+        }
     }
 
     virtual void pre_serialize() override {
@@ -1283,8 +1295,8 @@ protected:
     int pmkid_packet_id;
 
     // Un-exposed internal tracking options
-    uint32_t last_adv_ie_csum;
-    std::shared_ptr<dot11_advertised_ssid> last_adv_ssid;
+    adv_ie_cache_entry beacon_ie_cache;
+    adv_ie_cache_entry proberesp_ie_cache;
 
     // Advertised in association requests but device-centric
     std::shared_ptr<tracker_element_uint8> min_tx_power;
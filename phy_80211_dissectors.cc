@@ -38,6 +38,7 @@
 #include "packetchain.h"
 #include "alertracker.h"
 #include "configfile.h"
+#include "xxhash.h"
 
 #include "kaitai/kaitaistream.h"
 #include "dot11_parsers/dot11_wpa_eap.h"
@@ -226,6 +227,31 @@ static const uint32_t dot11_wep_crc32_table[256] = {
     0x2d02ef8dL
 };
 
+// Hash a beacon or probe response for the beacon cache:  the beacon interval and
+// capabilities, and the IE tags.  The body of the TIM changes with the DTIM count on
+// nearly every beacon and isn't used, so only its tag header is included.
+static uint32_t dot11_ie_cache_hash(const uint8_t *fixparm_tail, const uint8_t *data, size_t len) {
+    uint32_t hash = XXH32(fixparm_tail, 4, 0);
+    size_t run = 0;
+    size_t pos = 0;
+
+    while (pos + 2 <= len) {
+        size_t tag_end = pos + 2 + data[pos + 1];
+
+        if (data[pos] == 5) {
+            hash = XXH32(data + run, pos + 2 - run, hash);
+            run = std::min(tag_end, len);
+        }
+
+        pos = tag_end;
+    }
+
+    if (run < len)
+        hash = XXH32(data + run, len - run, hash);
+
+    return hash;
+}
+
 // Convert WPA cipher elements into crypt_set stuff
 int kis_80211_phy::wpa_cipher_conv(uint8_t cipher_index) {
     int ret = crypt_wpa;
@@ -307,20 +333,24 @@ int kis_80211_phy::packet_dot11_dissector(kis_packet *in_pack) {
     // Compare the checksum and see if we've recently seen this exact packet
     uint32_t chunk_csum = adler32_checksum((const char *) chunk->data, chunk->length);
 
-    for (unsigned int c = 0; c < recent_packet_checksums_sz; c++) {
-        if (recent_packet_checksums[c] == 0)
-            break;
+    {
+        std::lock_guard<std::mutex> lk(recent_packet_checksum_mutex);
 
-        if (recent_packet_checksums[c] == chunk_csum) {
-            in_pack->filtered = 1;
-            in_pack->duplicate = 1;
-            return 0;
+        for (unsigned int c = 0; c < recent_packet_checksums_sz; c++) {
+            if (recent_packet_checksums[c] == 0)
+                break;
+
+            if (recent_packet_checksums[c] == chunk_csum) {
+                in_pack->filtered = 1;
+                in_pack->duplicate = 1;
+                return 0;
+            }
         }
-    }
 
-    if (recent_packet_checksums_sz > 0)
-        recent_packet_checksums[(recent_packet_checksum_pos++ % recent_packet_checksums_sz)] = 
-            chunk_csum;
+        if (recent_packet_checksums_sz > 0)
+            recent_packet_checksums[(recent_packet_checksum_pos++ % recent_packet_checksums_sz)] = 
+                chunk_csum;
+    }
 
     // Flat-out dump if it's not big enough to be 80211, don't even bother making a
     // packinfo record for it because we're completely broken
@@ -763,7 +793,7 @@ int kis_80211_phy::packet_dot11_dissector(kis_packet *in_pack) {
                     if (t->tag_num() == 52) {
                         try {
                             dot11_ie_52_rmm ie_rmm;
-                            ie_rmm.parse(t->tag_data_stream());
+                            ie_rmm.parse(t->tag_data_ptr(), t->tag_len());
 
                             if (ie_rmm.channel_number() > 0xE0) {
                                 std::stringstream ss;
@@ -859,6 +889,12 @@ int kis_80211_phy::packet_dot11_dissector(kis_packet *in_pack) {
                 adler32_checksum((const char *) (chunk->data + packinfo->header_offset),
                                 chunk->length - packinfo->header_offset);
 
+            if (fc->subtype == packet_sub_beacon || fc->subtype == packet_sub_probe_resp)
+                packinfo->ietag_hash =
+                    dot11_ie_cache_hash(chunk->data + packinfo->header_offset - 4,
+                            chunk->data + packinfo->header_offset,
+                            chunk->length - packinfo->header_offset);
+
         } else if (fc->subtype == packet_sub_deauthentication) {
             if ((packinfo->mgt_reason_code >= 25 && packinfo->mgt_reason_code <= 31) ||
                 packinfo->mgt_reason_code > 45) {
@@ -1253,45 +1289,40 @@ std::vector<kis_80211_phy::ie_tag_tuple> kis_80211_phy::PacketDot11IElist(kis_pa
         if (chunk->dlt != KDLT_IEEE802_11)
             return ret;
 
-        membuf tags_membuf((char *) &(chunk->data[packinfo->header_offset]), 
-                (char *) &(chunk->data[chunk->length]));
-        std::istream istream_ietags(&tags_membuf);
+        if (packinfo->header_offset > chunk->length)
+            return ret;
 
         packinfo->ie_tags = std::make_shared<dot11_ie>();
 
         try {
-            std::shared_ptr<kaitai::kstream> stream_ietags(new kaitai::kstream(&istream_ietags));
-            packinfo->ie_tags->parse(stream_ietags);
+            packinfo->ie_tags->parse((const char *) &(chunk->data[packinfo->header_offset]), 
+                    chunk->length - packinfo->header_offset);
         } catch (const std::exception& e) {
             return ret;
         }
     }
 
-    for (auto ie_tag : *(packinfo->ie_tags->tags())) {
-        if (ie_tag->tag_num() == 150) {
+    for (const auto& ie_tag : packinfo->ie_tags->tag_list()) {
+        if (ie_tag.tag_num() == 150) {
             try {
-                ie_tag->tag_data_stream()->seek(0);
-
-                std::shared_ptr<dot11_ie_150_vendor> vendor(new dot11_ie_150_vendor());
-                vendor->parse(ie_tag->tag_data_stream());
+                dot11_ie_150_vendor vendor;
+                vendor.parse(ie_tag.tag_data_ptr(), ie_tag.tag_len());
 
-                ret.push_back(ie_tag_tuple{150, vendor->vendor_oui_int(), vendor->vendor_oui_type()});
+                ret.push_back(ie_tag_tuple{150, vendor.vendor_oui_int(), vendor.vendor_oui_type()});
             } catch (const std::exception &e) {
                 return ret;
             }
-        } else if (ie_tag->tag_num() == 221) {
+        } else if (ie_tag.tag_num() == 221) {
             try {
-                ie_tag->tag_data_stream()->seek(0);
+                dot11_ie_221_vendor vendor;
+                vendor.parse(ie_tag.tag_data_ptr(), ie_tag.tag_len());
 
-                std::shared_ptr<dot11_ie_221_vendor> vendor(new dot11_ie_221_vendor());
-                vendor->parse(ie_tag->tag_data_stream());
-
-                ret.push_back(ie_tag_tuple{221, vendor->vendor_oui_int(), vendor->vendor_oui_type()});
+                ret.push_back(ie_tag_tuple{221, vendor.vendor_oui_int(), vendor.vendor_oui_type()});
             } catch (const std::exception &e) {
                 return ret;
             }
         } else {
-            ret.push_back(ie_tag_tuple{ie_tag->tag_num(), 0, 0});
+            ret.push_back(ie_tag_tuple{ie_tag.tag_num(), 0, 0});
         }
     }
 
@@ -1324,15 +1355,18 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         return 0;
 
     if (packinfo->ie_tags == nullptr) {
-        membuf tags_membuf((char *) &(chunk->data[packinfo->header_offset]), 
-                (char *) &(chunk->data[chunk->length]));
-        std::istream istream_ietags(&tags_membuf);
+        if (packinfo->header_offset > chunk->length) {
+            packinfo->corrupt = 1;
+            return -1;
+        }
 
         packinfo->ie_tags = std::make_shared<dot11_ie>();
 
+        // Walk the tags in place; no per-tag copies or streams are made unless
+        // a tag parser below asks for one
         try {
-            std::shared_ptr<kaitai::kstream> stream_ietags(new kaitai::kstream(&istream_ietags));
-            packinfo->ie_tags->parse(stream_ietags);
+            packinfo->ie_tags->parse((const char *) &(chunk->data[packinfo->header_offset]), 
+                    chunk->length - packinfo->header_offset);
         } catch (const std::exception& e) {
             fmt::print(stderr, "debug - IE tag structure corrupt\n");
             packinfo->corrupt = 1;
@@ -1350,31 +1384,34 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
     bool seen_mcsrates = false;
     unsigned int wmmtspec_responses = 0;
 
-    for (auto ie_tag : *(packinfo->ie_tags->tags())) {
-        auto hash = std::hash<std::string>{};
+    for (const auto& ie_tag_ref : packinfo->ie_tags->tag_list()) {
+        auto ie_tag = &ie_tag_ref;
+
+        // Hash the tag contents in place for the fingerprint
+        auto tag_hash = XXH32(ie_tag->tag_data_ptr(), ie_tag->tag_len(), 0);
 
         if (ie_tag->tag_num() == 150) {
             try {
-                auto vendor = std::make_shared<dot11_ie_150_vendor>();
-                vendor->parse(ie_tag->tag_data_stream());
+                dot11_ie_150_vendor vendor;
+                vendor.parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
-                packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{150, vendor->vendor_oui_int(), vendor->vendor_oui_type()}, hash(ie_tag->tag_data())));
+                packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{150, vendor.vendor_oui_int(), vendor.vendor_oui_type()}, tag_hash));
             } catch (const std::exception& e) {
                 packinfo->corrupt = 1;
                 return -1;
             }
         } else if (ie_tag->tag_num() == 221) {
             try {
-                auto vendor = std::make_shared<dot11_ie_221_vendor>();
-                vendor->parse(ie_tag->tag_data_stream());
+                dot11_ie_221_vendor vendor;
+                vendor.parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
-                packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{221, vendor->vendor_oui_int(), vendor->vendor_oui_type()}, hash(ie_tag->tag_data())));
+                packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{221, vendor.vendor_oui_int(), vendor.vendor_oui_type()}, tag_hash));
             } catch (const std::exception& e) {
                 packinfo->corrupt = 1;
                 return -1;
             }
         } else {
-            packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{ie_tag->tag_num(), 0, 0}, hash(ie_tag->tag_data())));
+            packinfo->ietag_hash_map.insert(std::make_pair(ie_tag_tuple{ie_tag->tag_num(), 0, 0}, tag_hash));
         }
 
         // IE 0 SSID
@@ -1385,9 +1422,9 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
 
             seen_ssid = true;
 
-            packinfo->ssid_len = ie_tag->tag_data().length();
+            packinfo->ssid_len = ie_tag->tag_len();
             packinfo->ssid_csum =
-                adler32_checksum(ie_tag->tag_data().data(), ie_tag->tag_data().length());
+                adler32_checksum(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
             if (packinfo->ssid_len == 0) {
                 packinfo->ssid_blank = true;
@@ -1616,7 +1653,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 dot11_ie_7_country dot11d;
                 // Allow fragmented 11d, take what we can parse
                 dot11d.set_allow_fragments(true);
-                dot11d.parse(ie_tag->tag_data_stream());
+                dot11d.parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                 packinfo->dot11d_country = munge_to_printable(dot11d.country_code());
 
@@ -1642,8 +1679,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 11) {
             try {
                 std::shared_ptr<dot11_ie_11_qbss> qbss(new dot11_ie_11_qbss());
-                ie_tag->tag_data_stream()->seek(0);
-                qbss->parse(ie_tag->tag_data_stream());
+                qbss->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
                 packinfo->qbss = qbss;
             } catch (const std::exception& e) {
                 fprintf(stderr, "debug - corrupt QBSS %s\n", e.what());
@@ -1658,7 +1694,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 33) {
             try {
                 packinfo->tx_power = std::make_shared<dot11_ie_33_power>();
-                packinfo->tx_power->parse(ie_tag->tag_data_stream());
+                packinfo->tx_power->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
             } catch (const std::exception& e) {
                 fmt::print(stderr, "debug - corrupt IE33 power: {}\n", e.what());
             }
@@ -1669,7 +1705,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 36) {
             try {
                 packinfo->supported_channels = std::make_shared<dot11_ie_36_supported_channels>();
-                packinfo->supported_channels->parse(ie_tag->tag_data_stream());
+                packinfo->supported_channels->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
             } catch (const std::exception& e) {
                 fmt::print(stderr, "debug  corrupt ie36 supported channels: {}\n", e.what());
             }
@@ -1686,7 +1722,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
 
             try {
                 std::shared_ptr<dot11_ie_45_ht_cap> ht(new dot11_ie_45_ht_cap());
-                ht->parse(ie_tag->tag_data_stream());
+                ht->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                 std::stringstream mcsstream;
 
@@ -1759,7 +1795,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
 
             try {
                 std::shared_ptr<dot11_ie_48_rsn> rsn(new dot11_ie_48_rsn());
-                rsn->parse(ie_tag->tag_data_stream());
+                rsn->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                 // TODO - don't aggregate these in the future
 
@@ -1800,8 +1836,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
             if (rsn_invalid) {
                 try {
                     std::shared_ptr<dot11_ie_48_rsn_partial> rsn(new dot11_ie_48_rsn_partial());
-                    ie_tag->tag_data_stream()->seek(0);
-                    rsn->parse(ie_tag->tag_data_stream());
+                    rsn->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                     if (rsn->pairwise_count() > 1024) {
                         alertracker->raise_alert(alert_atheros_rsnloop_ref, 
@@ -1828,7 +1863,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 54) {
             try {
                 std::shared_ptr<dot11_ie_54_mobility> mobility(new dot11_ie_54_mobility());
-                mobility->parse(ie_tag->tag_data_stream());
+                mobility->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
                 packinfo->dot11r_mobility = mobility;
             } catch (const std::exception& e) {
                 packinfo->corrupt = 1;
@@ -1841,7 +1876,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 61) {
             try {
                 std::shared_ptr<dot11_ie_61_ht_op> ht(new dot11_ie_61_ht_op());
-                ht->parse(ie_tag->tag_data_stream());
+                ht->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
                 packinfo->dot11ht = ht;
             } catch (const std::exception& e) {
                 fprintf(stderr, "debug - unparsable HT\n");
@@ -1856,7 +1891,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 133) {
             try {
                 std::shared_ptr<dot11_ie_133_cisco_ccx> ccx1(new dot11_ie_133_cisco_ccx());
-                ccx1->parse(ie_tag->tag_data_stream());
+                ccx1->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
                 packinfo->beacon_info = munge_to_printable(ccx1->ap_name());
             } catch (const std::exception& e) {
                 fprintf(stderr, "debug - ccx error %s\n", e.what());
@@ -1887,7 +1922,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 191) {
             try {
                 std::shared_ptr<dot11_ie_191_vht_cap> vht(new dot11_ie_191_vht_cap());
-                vht->parse(ie_tag->tag_data_stream());
+                vht->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                 bool gi80 = vht->vht_cap_80mhz_shortgi();
                 bool gi160 = vht->vht_cap_160mhz_shortgi();
@@ -1965,12 +2000,11 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 150) {
             try {
                 auto vendor = std::make_shared<dot11_ie_150_vendor>();
-                ie_tag->tag_data_stream()->seek(0);
-                vendor->parse(ie_tag->tag_data_stream());
+                vendor->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                 if (vendor->vendor_oui_int() == dot11_ie_150_cisco_powerlevel::cisco_oui()) {
                     auto ccx_power = std::make_shared<dot11_ie_150_cisco_powerlevel>();
-                    ccx_power->parse(vendor->vendor_tag_stream());
+                    ccx_power->parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                     packinfo->ccx_txpower = ccx_power->cisco_ccx_txpower();
                 }
@@ -1984,7 +2018,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 192) {
             try {
                 auto vht = std::make_shared<dot11_ie_192_vht_op>();
-                vht->parse(ie_tag->tag_data_stream());
+                vht->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
                 packinfo->dot11vht = vht;
 
             } catch (const std::exception& e) {
@@ -1998,8 +2032,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
         if (ie_tag->tag_num() == 221) {
             try {
                 auto vendor = std::make_shared<dot11_ie_221_vendor>();
-                ie_tag->tag_data_stream()->seek(0);
-                vendor->parse(ie_tag->tag_data_stream());
+                vendor->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                 // Match mis-sized WMM
                 if (packinfo->subtype == packet_sub_beacon &&
@@ -2026,8 +2059,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                         vendor->vendor_oui_int() == 0x0050f2 &&
                         vendor->vendor_oui_type() == 2) {
                     dot11_ie_221_ms_wmm wmm;
-                    vendor->vendor_tag_stream()->seek(0);
-                    wmm.parse(vendor->vendor_tag_stream());
+                    wmm.parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                     if (wmm.wme_subtype() == 0x02) {
                         wmmtspec_responses++;
@@ -2052,8 +2084,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 // Look for DJI DroneID OUIs
                 if (vendor->vendor_oui_int() == dot11_ie_221_dji_droneid::vendor_oui()) {
                     std::shared_ptr<dot11_ie_221_dji_droneid> droneid(new dot11_ie_221_dji_droneid());
-                    vendor->vendor_tag_stream()->seek(0);
-                    droneid->parse(vendor->vendor_tag_stream());
+                    droneid->parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                     packinfo->droneid = droneid;
                 }
@@ -2062,8 +2093,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 if (vendor->vendor_oui_int() == dot11_ie_221_wfa_wpa::ms_wps_oui() && 
                         vendor->vendor_oui_type() == dot11_ie_221_wfa_wpa::wfa_wpa_subtype()) {
                     std::shared_ptr<dot11_ie_221_wfa_wpa> wpa(new dot11_ie_221_wfa_wpa());
-                    vendor->vendor_tag_stream()->seek(0);
-                    wpa->parse(vendor->vendor_tag_stream());
+                    wpa->parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                     // Merge the group cipher
                     packinfo->cryptset |= 
@@ -2093,8 +2123,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 if (vendor->vendor_oui_int() == dot11_ie_221_cisco_client_mfp::cisco_oui() &&
                         vendor->vendor_oui_type() == dot11_ie_221_cisco_client_mfp::client_mfp_subtype()) {
                     auto mfp = std::make_shared<dot11_ie_221_cisco_client_mfp>();
-                    vendor->vendor_tag_stream()->seek(0);
-                    mfp->parse(vendor->vendor_tag_stream());
+                    mfp->parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                     packinfo->cisco_client_mfp = mfp->client_mfp();
                 }
@@ -2103,8 +2132,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 if (vendor->vendor_oui_int() == dot11_ie_221_owe_transition::vendor_oui()) {
                     if (vendor->vendor_oui_type() == dot11_ie_221_owe_transition::owe_transition_subtype()) {
                         auto owe_trans = std::make_shared<dot11_ie_221_owe_transition>();
-                        vendor->vendor_tag_stream()->seek(0);
-                        owe_trans->parse(vendor->vendor_tag_stream());
+                        owe_trans->parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
                         packinfo->owe_transition = owe_trans;
                         packinfo->cryptset |= crypt_wpa_owe;
                     }
@@ -2113,8 +2141,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 // Look for WFA p2p to check the rtlwifi exploit
                 if (vendor->vendor_oui_int() == dot11_ie_221_wfa::wfa_oui()) {
                     auto wfa = std::make_shared<dot11_ie_221_wfa>();
-                    vendor->vendor_tag_stream()->seek(0);
-                    wfa->parse(vendor->vendor_tag_stream());
+                    wfa->parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                     if (wfa->wfa_subtype() == dot11_ie_221_wfa::wfa_sub_p2p()) {
                         std::shared_ptr<dot11_wfa_p2p_ie> ietags(new dot11_wfa_p2p_ie());
@@ -2144,8 +2171,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 if (vendor->vendor_oui_int() == dot11_ie_221_ms_wps::ms_wps_oui() && 
                         vendor->vendor_oui_type() == dot11_ie_221_ms_wps::ms_wps_subtype()) {
                     auto wps = std::make_shared<dot11_ie_221_ms_wps>();
-                    vendor->vendor_tag_stream()->seek(0);
-                    wps->parse(vendor->vendor_tag_stream());
+                    wps->parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                     for (auto wpselem : *(wps->wps_elements())) {
                         auto state = wpselem->sub_element_state();
@@ -2753,13 +2779,12 @@ std::shared_ptr<dot11_tracked_eapol>
                 for (auto ie_tag : *(ietags->tags())) {
                     if (ie_tag->tag_num() == 221) {
                         auto vendor = std::make_shared<dot11_ie_221_vendor>();
-                        ie_tag->tag_data_stream()->seek(0);
-                        vendor->parse(ie_tag->tag_data_stream());
+                        vendor->parse(ie_tag->tag_data_ptr(), ie_tag->tag_len());
 
                         if (vendor->vendor_oui_int() == dot11_ie_221_rsn_pmkid::vendor_oui() &&
                                 vendor->vendor_oui_type() == dot11_ie_221_rsn_pmkid::rsnpmkid_subtype()) {
                             dot11_ie_221_rsn_pmkid pmkid;
-                            pmkid.parse(vendor->vendor_tag_stream());
+                            pmkid.parse(vendor->vendor_tag().data(), vendor->vendor_tag().length());
 
                             // Log the pmkid for the decoders
                             eapol->set_rsnpmkid_bytes(pmkid.pmkid());
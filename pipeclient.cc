@@ -36,9 +36,14 @@ pipe_client::pipe_client(global_registry *in_globalreg,
     pipe_mutex {in_rbhandler->get_mutex()},
     handler {in_rbhandler},
     read_fd {-1},
-    write_fd {-1} { }
+    write_fd {-1},
+    write_notify {[this](size_t amt) { if (amt > 0) pollable_wake(); }, nullptr} {
+        handler->set_write_buffer_interface(&write_notify);
+    }
 
 pipe_client::~pipe_client() {
+    handler->remove_write_buffer_interface();
+
     // printf("~pipeclient %p\n", this);
     if (read_fd > -1) {
         close(read_fd);
@@ -89,34 +94,24 @@ bool pipe_client::get_connected() {
     return handler == nullptr || read_fd > -1 || write_fd > -1;
 }
 
-int pipe_client::pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset) {
+int pipe_client::pollable_interest(std::vector<kis_pollable_fd>& out_fds) {
     local_locker lock(pipe_mutex);
 
     if (handler == nullptr)
-        return in_max_fd;
+        return 0;
 
-    int max_fd = in_max_fd;
-
-    // If we have data waiting to be written, fill it in
-    if (write_fd > -1 && handler->get_write_buffer_used()) {
-        FD_SET(write_fd, out_wset);
-        if (write_fd > in_max_fd)
-            max_fd = write_fd;
-    }
+    // Write if we have data waiting to be written
+    if (write_fd > -1)
+        out_fds.push_back(kis_pollable_fd(write_fd, false, handler->get_write_buffer_used() > 0));
 
-    // If we have room to read set the readfd, otherwise skip it for now
-    if (read_fd > -1) {
-        if (handler->get_read_buffer_available() > 0) {
-            if (max_fd < read_fd)
-                max_fd = read_fd;
-            FD_SET(read_fd, out_rset);
-        }
-    }
+    // Read if we have room, otherwise skip it for now
+    if (read_fd > -1)
+        out_fds.push_back(kis_pollable_fd(read_fd, handler->get_read_buffer_available() > 0, false));
 
-    return max_fd;
+    return 0;
 }
 
-int pipe_client::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
+int pipe_client::pollable_event(int in_fd, bool in_readable, bool in_writable) {
     local_locker lock(pipe_mutex);
 
     std::stringstream msg;
@@ -126,7 +121,7 @@ int pipe_client::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
     ssize_t ret, iret;
     size_t avail;
 
-    if (read_fd > -1 && FD_ISSET(read_fd, &in_rset) && handler != nullptr) {
+    if (read_fd > -1 && in_fd == read_fd && in_readable && handler != nullptr) {
         // Allocate the biggest buffer we can fit in the ring, read as much
         // as we can at once.
         while ((avail = handler->get_read_buffer_available())) {
@@ -166,7 +161,7 @@ int pipe_client::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
         }
     }
 
-    if (write_fd > -1 && FD_ISSET(write_fd, &in_wset)) {
+    if (write_fd > -1 && in_fd == write_fd && in_writable && handler != nullptr) {
         len = handler->get_write_buffer_used();
 
         // Let the caller consider doing something with a full buffer
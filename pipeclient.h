@@ -52,8 +52,8 @@ public:
     void close_pipes();
 
     // kis_pollable interface
-    virtual int pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset);
-    virtual int pollable_poll(fd_set& in_rset, fd_set& in_wset);
+    virtual int pollable_interest(std::vector<kis_pollable_fd>& out_fds);
+    virtual int pollable_event(int in_fd, bool in_readable, bool in_writable);
 
     // Flush out the read pipe if the process has exited
     virtual int flush_read();
@@ -68,6 +68,9 @@ protected:
     std::shared_ptr<buffer_handler_generic> handler;
 
     std::atomic<int> read_fd, write_fd;
+
+    // Wakes our reactor when data is queued to write outside of an event
+    buffer_interface_func write_notify;
 };
 
 #endif
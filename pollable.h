@@ -25,27 +25,84 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <functional>
+#include <mutex>
+#include <vector>
+
 #include "globalregistry.h"
 
+// A descriptor monitored on behalf of a pollable; read is set when the pollable can
+// accept more data, write when it has data waiting to be written
+struct kis_pollable_fd {
+    kis_pollable_fd(int in_fd, bool in_read, bool in_write) :
+        fd {in_fd},
+        read {in_read},
+        write {in_write} { }
+
+    int fd;
+    bool read;
+    bool write;
+};
+
 // Basic pollable object that plugs into the main pollable system; anything which can
 // respond to a poll() or select() should go in this system.  
 //
-// pollable_merge_set is called to create the FD_SET passed to select(); implementations
-// should inspect their buffers and determine if they hold data which should be included
-// in the next select loop.  pollable_merge_set must return either the largest FD in the
-// set (if larger than in_max_fd), or in the case of unrecoverable error, -1, which will
-// remove this pollable from the system forever.  Recoverable errors should return the
-// maximum fd number provided.
+// pollable_interest is called to find the descriptors to monitor; implementations
+// should inspect their buffers and report each open descriptor, and if they have room
+// to read or data to write.  The interest is re-checked after every event and
+// periodically, so descriptors may come and go over the life of the pollable.  In the
+// case of unrecoverable error, return -1, which will remove this pollable from the
+// system forever.
 //
-// pollable_poll is called for the results of a select; implementations should check if
-// any monitored fds are included in the poll and perform the according read or write
-// operations.  Success and recoverable errors should return 0 or a positive number;
+// pollable_event is called when a monitored descriptor is ready; implementations should
+// perform the according read or write operations.  Descriptors are monitored edge-
+// triggered where possible, so reads should continue until they would block or the
+// buffer is full.  Success and recoverable errors should return 0 or a positive number;
 // exceptional unrecoverable failures should return -1, which will remove this pollable
 // from the polling system forever.
+//
+// Interest which changes outside of an event, such as data queued to write by another
+// thread, is picked up by the periodic re-check; call pollable_wake to have it checked
+// right away.
 class kis_pollable {
 public:
-	virtual int pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset) = 0;
-	virtual int pollable_poll(fd_set& in_rset, fd_set& in_wset) = 0;
+    virtual ~kis_pollable() { }
+
+    virtual int pollable_interest(std::vector<kis_pollable_fd>& out_fds) = 0;
+    virtual int pollable_event(int in_fd, bool in_readable, bool in_writable) = 0;
+
+    // Re-check the interest of this pollable on the next pass of its reactor; safe to
+    // call from any thread
+    void pollable_wake() {
+        std::lock_guard<std::mutex> lk(pollable_wake_mutex);
+
+        if (pollable_wake_cb != nullptr)
+            pollable_wake_cb();
+    }
+
+    // Set by the reactor the pollable is pinned to, and cleared by it when the pollable is
+    // removed; a reactor only clears its own, in case the pollable has already been
+    // registered again and pinned elsewhere
+    void set_pollable_wake(void *in_owner, std::function<void ()> in_cb) {
+        std::lock_guard<std::mutex> lk(pollable_wake_mutex);
+        pollable_wake_owner = in_owner;
+        pollable_wake_cb = in_cb;
+    }
+
+    void clear_pollable_wake(void *in_owner) {
+        std::lock_guard<std::mutex> lk(pollable_wake_mutex);
+
+        if (pollable_wake_owner != in_owner)
+            return;
+
+        pollable_wake_owner = nullptr;
+        pollable_wake_cb = nullptr;
+    }
+
+protected:
+    std::mutex pollable_wake_mutex;
+    void *pollable_wake_owner = nullptr;
+    std::function<void ()> pollable_wake_cb;
 };
 
 #endif
@@ -16,193 +16,512 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
-#include "pollabletracker.h"
-#include "pollable.h"
+#include "config.h"
 
-#undef KIS_USE_POLLABLE_QUEUE
+#include <string.h>
 
-pollable_tracker::pollable_tracker() {
-#ifdef KIS_USE_POLLABLE_QUEUE
-    pollable_shutdown = false;
+#include <tuple>
 
-    for (unsigned int i = 0; i < std::thread::hardware_concurrency(); i++) {
-        pollable_threads.push_back(std::thread([this]() {
-            thread_set_process_name("pollhandler");
-            poll_queue_processor();
-        }));
-	}
+#ifdef SYS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #endif
-}
 
-pollable_tracker::~pollable_tracker() {
-#ifdef KIS_USE_POLLABLE_QUEUE
-    // Cancel, wake up, and collect all the service threads
-    pollable_shutdown = true;
-    pollqueue_cv.notify_all();
+#include "configfile.h"
+#include "pollabletracker.h"
+#include "pollable.h"
+#include "util.h"
+
+pollable_tracker::pollable_tracker() { }
 
-    for (auto& t : pollable_threads)
-        t.join();
-#endif
-}
+pollable_tracker::~pollable_tracker() { }
 
 void pollable_tracker::register_pollable(std::shared_ptr<kis_pollable> in_pollable) {
     local_locker lock(&pollable_mutex);
 
-    add_vec.push_back(in_pollable);
-}
+    if (reactors.size() == 0) {
+        add_vec.push_back(in_pollable);
+        return;
+    }
 
-void pollable_tracker::remove_pollable(std::shared_ptr<kis_pollable> in_pollable) {
-    local_locker lock(&pollable_mutex);
+    // Pin to whichever reactor has the fewest pollables
+    auto target = reactors[0].get();
 
-    remove_map[in_pollable] = 1;
+    for (const auto& r : reactors) {
+        if (r->size() < target->size())
+            target = r.get();
+    }
+
+    target->add(in_pollable);
 }
 
-void pollable_tracker::maintenance() {
+void pollable_tracker::remove_pollable(std::shared_ptr<kis_pollable> in_pollable) {
     local_locker lock(&pollable_mutex);
 
-    for (auto r : remove_map) {
-        for (auto i = pollable_vec.begin(); i != pollable_vec.end(); ++i) {
-            if (r.first == *i) {
-                pollable_vec.erase(i);
-                break;
-            }
-        }
-    }
-
     for (auto i = add_vec.begin(); i != add_vec.end(); ++i) {
-        pollable_vec.push_back(*i);
+        if (*i == in_pollable) {
+            add_vec.erase(i);
+            break;
+        }
     }
 
-    remove_map.clear();
-    add_vec.clear();
+    // Only the owning reactor knows the pollable; the rest ignore it
+    for (const auto& r : reactors)
+        r->remove(in_pollable);
 }
 
 void pollable_tracker::select_loop(bool spindown_mode) {
-    int max_fd;
-    fd_set rset, wset;
-    struct timeval tm;
-    int consec_badfd = 0;
+    {
+        local_locker lock(&pollable_mutex);
+
+        if (reactors.size() == 0) {
+            unsigned int n_reactors = 1;
+
+#ifdef SYS_LINUX
+            if (Globalreg::globalreg->kismet_config != nullptr)
+                n_reactors =
+                    Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("pollable_reactor_threads", 1);
+
+            if (n_reactors < 1)
+                n_reactors = 1;
+#endif
+
+            for (unsigned int i = 0; i < n_reactors; i++)
+                reactors.push_back(std::unique_ptr<reactor>(new reactor()));
+
+            for (size_t i = 0; i < add_vec.size(); i++)
+                reactors[i % n_reactors]->add(add_vec[i]);
+
+            add_vec.clear();
+        }
+    }
 
     time_t shutdown_time = time(0) + 3;
 
-    // Core loop
-    while (1) {
+    std::atomic<bool> reactor_failed {false};
+    std::exception_ptr reactor_error;
+    std::mutex reactor_error_mutex;
+
+    auto should_exit = [&]() -> bool {
+        if (reactor_failed)
+            return true;
+
         if (spindown_mode && time(0) > shutdown_time)
-            break;
+            return true;
 
         if ((!spindown_mode && Globalreg::globalreg->spindown) || 
                 Globalreg::globalreg->fatal_condition ||
                 Globalreg::globalreg->complete) 
-            break;
+            return true;
+
+        return false;
+    };
+
+    // A failed reactor stops all of them and the error is re-thrown from the main loop
+    auto run_reactor = [&](reactor *r) {
+        try {
+            r->run(should_exit);
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(reactor_error_mutex);
+            if (reactor_error == nullptr)
+                reactor_error = std::current_exception();
+            reactor_failed = true;
+        }
+    };
 
-        tm.tv_sec = 0;
-        tm.tv_usec = 100000;
+    std::vector<std::thread> reactor_threads;
 
-        maintenance();
+    for (size_t i = 1; i < reactors.size(); i++) {
+        auto r = reactors[i].get();
+        reactor_threads.push_back(std::thread([&run_reactor, r]() {
+            thread_set_process_name("pollreactor");
+            run_reactor(r);
+        }));
+    }
 
-        max_fd = merge_pollable_fds(&rset, &wset);
+    run_reactor(reactors[0].get());
 
-        if (select(max_fd + 1, &rset, &wset, NULL, &tm) < 0) {
-            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
-                if (errno == EBADF) {
-                    consec_badfd++;
+    for (auto& t : reactor_threads)
+        t.join();
 
-                    if (consec_badfd > 20) 
-                        throw std::runtime_error(fmt::format("select() > 20 consecutive badfd errors, latest {} {}",
-                                    errno, strerror(errno)));
+    if (reactor_error != nullptr)
+        std::rethrow_exception(reactor_error);
+}
 
-                    continue;
-                } else {
-                    throw std::runtime_error(fmt::format("select() failed: {} {}", errno, strerror(errno)));
-                }
-            }
-        }
+pollable_tracker::reactor::reactor() :
+    num_pollables {0},
+    remove_pending {false} {
+#ifdef SYS_LINUX
+    wake_signaled = false;
 
-        consec_badfd = 0;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
 
-        // Run maintenance again so we don't gather purged records after the select()
-        maintenance();
+    if (epoll_fd < 0)
+        throw std::runtime_error(fmt::format("epoll_create1() failed: {} {}", errno, strerror(errno)));
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
 
-        process_pollable_select(rset, wset);
+    if (wake_fd < 0) {
+        close(epoll_fd);
+        throw std::runtime_error(fmt::format("eventfd() failed: {} {}", errno, strerror(errno)));
     }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(struct epoll_event));
+
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) < 0) {
+        close(wake_fd);
+        close(epoll_fd);
+        throw std::runtime_error(fmt::format("epoll_ctl() failed adding wake event: {} {}", 
+                    errno, strerror(errno)));
+    }
+#endif
+}
+
+pollable_tracker::reactor::~reactor() {
+    for (auto& p : pollables)
+        p.second.pollable->clear_pollable_wake(this);
+
+#ifdef SYS_LINUX
+    close(wake_fd);
+    close(epoll_fd);
+#endif
+}
+
+void pollable_tracker::reactor::add(std::shared_ptr<kis_pollable> in_pollable) {
+    local_locker lock(&reactor_mutex);
+
+    add_vec.push_back(in_pollable);
+    num_pollables++;
+
+    signal();
 }
 
-int pollable_tracker::merge_pollable_fds(fd_set *rset, fd_set *wset) {
-    int max_fd = 0;
+void pollable_tracker::reactor::remove(std::shared_ptr<kis_pollable> in_pollable) {
+    local_locker lock(&reactor_mutex);
+
+    remove_map[in_pollable] = 1;
+    remove_pending = true;
+
+    signal();
+}
+
+void pollable_tracker::reactor::wake(kis_pollable *in_pollable) {
+    local_locker lock(&reactor_mutex);
+
+    wake_set.insert(in_pollable);
+
+    signal();
+}
+
+void pollable_tracker::reactor::signal() {
+#ifdef SYS_LINUX
+    // The reactor only needs to be signaled once until it applies the changes
+    if (wake_signaled)
+        return;
+
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(uint64_t)) == sizeof(uint64_t))
+        wake_signaled = true;
+#endif
+}
+
+void pollable_tracker::reactor::maintenance() {
+    std::vector<std::shared_ptr<kis_pollable>> adds;
+    std::map<std::shared_ptr<kis_pollable>, int> removes;
+    std::set<kis_pollable *> wakes;
+
+    {
+        local_locker lock(&reactor_mutex);
+
+        if (add_vec.size() == 0 && remove_map.size() == 0 && wake_set.size() == 0)
+            return;
 
-    FD_ZERO(rset);
-    FD_ZERO(wset);
+        adds.swap(add_vec);
+        removes.swap(remove_map);
+        wakes.swap(wake_set);
+        remove_pending = false;
 
-    for (auto i : pollable_vec) {
-        int r = i->pollable_merge_set(max_fd, rset, wset);
+#ifdef SYS_LINUX
+        if (wake_signaled) {
+            uint64_t count;
 
-        if (r < 0) {
-            remove_pollable(i);
+            if (read(wake_fd, &count, sizeof(uint64_t)) == sizeof(uint64_t))
+                wake_signaled = false;
+        }
+#endif
+    }
+
+    for (const auto& r : removes)
+        remove_entry(r.first.get());
+
+    for (const auto& a : adds) {
+        // Added and removed before we ever saw it, or added twice
+        if (removes.find(a) != removes.end() || pollables.find(a.get()) != pollables.end()) {
+            num_pollables--;
             continue;
         }
 
-        max_fd = r;
+        auto& entry = pollables[a.get()];
+        entry.pollable = a;
+
+        auto p = a.get();
+        a->set_pollable_wake(this, [this, p]() { wake(p); });
+
+        if (!sync_pollable(entry))
+            remove_entry(a.get());
+    }
+
+    // Pollables which were removed since they asked to be woken are skipped
+    std::vector<kis_pollable *> failed;
+
+    for (auto w : wakes) {
+        auto pi = pollables.find(w);
+
+        if (pi != pollables.end() && !sync_pollable(pi->second))
+            failed.push_back(w);
     }
 
-    return max_fd;
+    for (auto f : failed)
+        remove_entry(f);
 }
 
-int pollable_tracker::process_pollable_select(fd_set rset, fd_set wset) {
-#ifdef KIS_USE_POLLABLE_QUEUE
-    // Push all into the pollable vector and let the service threads do the work
-    
-    std::unique_lock<std::mutex> lock(pollqueue_cv_mutex);
+bool pollable_tracker::reactor::sync_pollable(pollable_entry& entry) {
+    std::vector<kis_pollable_fd> want;
 
-    for (auto p : pollable_vec) 
-        pollable_queue.push(pollable_event(rset, wset, p));
+    if (entry.pollable->pollable_interest(want) < 0)
+        return false;
 
-    lock.unlock();
-    pollqueue_cv.notify_all();
-#else
-    int r;
+    // Stop monitoring anything the pollable has closed or dropped
+    for (const auto& old : entry.fds) {
+        bool kept = false;
 
-    for (auto i : pollable_vec) {
-        r = i->pollable_poll(rset, wset);
+        for (const auto& w : want) {
+            if (w.fd == old.fd) {
+                kept = true;
+                break;
+            }
+        }
 
-        if (r < 0) {
-            remove_pollable(i);
+        if (kept)
             continue;
+
+#ifdef SYS_LINUX
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, old.fd, nullptr);
+#endif
+
+        auto fi = fd_map.find(old.fd);
+        if (fi != fd_map.end() && fi->second == entry.pollable.get())
+            fd_map.erase(fi);
+    }
+
+    entry.fds.clear();
+
+    for (const auto& w : want) {
+#ifdef SYS_LINUX
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(struct epoll_event));
+
+        ev.events = EPOLLET | EPOLLRDHUP;
+        if (w.read)
+            ev.events |= EPOLLIN;
+        if (w.write)
+            ev.events |= EPOLLOUT;
+        ev.data.fd = w.fd;
+
+        // Modifying the registration re-arms the edge trigger, so a descriptor which is
+        // already ready (such as a socket with room to write data queued since the last
+        // event) is reported again on the next wait
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, w.fd, &ev) < 0) {
+            if (errno != ENOENT || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, w.fd, &ev) < 0)
+                continue;
         }
+#endif
+
+        fd_map[w.fd] = entry.pollable.get();
+        entry.fds.push_back(w);
     }
+
+    return true;
+}
+
+void pollable_tracker::reactor::remove_entry(kis_pollable *in_pollable) {
+    auto pi = pollables.find(in_pollable);
+
+    if (pi == pollables.end())
+        return;
+
+    pi->second.pollable->clear_pollable_wake(this);
+
+    for (const auto& f : pi->second.fds) {
+#ifdef SYS_LINUX
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, f.fd, nullptr);
 #endif
 
-    return 1;
+        auto fi = fd_map.find(f.fd);
+        if (fi != fd_map.end() && fi->second == in_pollable)
+            fd_map.erase(fi);
+    }
+
+    pollables.erase(pi);
+    num_pollables--;
+}
+
+void pollable_tracker::reactor::dispatch(int in_fd, bool in_readable, bool in_writable) {
+    auto fi = fd_map.find(in_fd);
+    if (fi == fd_map.end())
+        return;
+
+    auto pi = pollables.find(fi->second);
+    if (pi == pollables.end())
+        return;
+
+    // Hold a reference in case the pollable is released during its own event
+    auto pollable = pi->second.pollable;
+
+    if (pollable->pollable_event(in_fd, in_readable, in_writable) < 0 || 
+            !sync_pollable(pi->second))
+        remove_entry(pollable.get());
 }
 
-void pollable_tracker::poll_queue_processor() {
-    std::unique_lock<std::mutex> lock(pollqueue_cv_mutex);
+void pollable_tracker::reactor::run(const std::function<bool ()>& should_exit) {
+#ifdef SYS_LINUX
+    const int max_events = 64;
+    struct epoll_event events[max_events];
+#else
+    int consec_badfd = 0;
+#endif
+
+    while (!should_exit()) {
+        maintenance();
+
+#ifdef SYS_LINUX
+        auto now = std::chrono::steady_clock::now();
+
+        if (now >= next_sync) {
+            std::vector<kis_pollable *> failed;
+
+            for (auto& p : pollables) {
+                if (!sync_pollable(p.second))
+                    failed.push_back(p.first);
+            }
+
+            for (auto f : failed)
+                remove_entry(f);
+
+            next_sync = now + std::chrono::milliseconds(100);
+        }
+
+        auto timeout_ms = 
+            std::chrono::duration_cast<std::chrono::milliseconds>(next_sync - now).count();
+        if (timeout_ms < 0)
+            timeout_ms = 0;
+
+        int n = epoll_wait(epoll_fd, events, max_events, timeout_ms);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+
+            throw std::runtime_error(fmt::format("epoll_wait() failed: {} {}", errno, strerror(errno)));
+        }
 
-    // We only monitor our own shutdown and global complete; we need to continue doing
-    // IO to do a graceful spindown
-    while (!pollable_shutdown && !Globalreg::globalreg->complete) {
+        // Run maintenance again so we don't dispatch purged records after the wait
+        maintenance();
+
+        for (int i = 0; i < n; i++) {
+            // Pending changes were applied by the maintenance pass
+            if (events[i].data.fd == wake_fd)
+                continue;
+
+            if (remove_pending)
+                maintenance();
+
+            // Hangups and errors are delivered as readable so the pollable discovers them
+            // on its next read
+            dispatch(events[i].data.fd, 
+                    events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR),
+                    events[i].events & (EPOLLOUT | EPOLLERR));
+        }
+#else
+        // Without epoll every pollable is synced on every pass and merged into the select set
+        int max_fd = 0;
+        fd_set rset, wset;
+        struct timeval tm;
 
-        pollqueue_cv.wait(lock, [this] {
-            return (pollable_queue.size() || pollable_shutdown);
-            });
+        FD_ZERO(&rset);
+        FD_ZERO(&wset);
 
-        // We own the lock; make sure to re-lock it as we leave the loop
-        
-        if (pollable_queue.size() != 0) {
-            // Get the pollable, unlock the queue
-            auto pollable = pollable_queue.front();
-            pollable_queue.pop();
+        std::vector<kis_pollable *> failed;
+
+        for (auto& p : pollables) {
+            if (!sync_pollable(p.second)) {
+                failed.push_back(p.first);
+                continue;
+            }
+
+            for (const auto& f : p.second.fds) {
+                if (f.fd >= FD_SETSIZE)
+                    continue;
+
+                if (f.read)
+                    FD_SET(f.fd, &rset);
+                if (f.write)
+                    FD_SET(f.fd, &wset);
+
+                if ((f.read || f.write) && f.fd > max_fd)
+                    max_fd = f.fd;
+            }
+        }
+
+        for (auto f : failed)
+            remove_entry(f);
+
+        tm.tv_sec = 0;
+        tm.tv_usec = 100000;
 
-            lock.unlock();
+        if (select(max_fd + 1, &rset, &wset, NULL, &tm) < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                if (errno == EBADF) {
+                    consec_badfd++;
 
-            // Perform the IO and handling
-            pollable.pollable->pollable_poll(pollable.rset, pollable.wset);
+                    if (consec_badfd > 20) 
+                        throw std::runtime_error(fmt::format("select() > 20 consecutive badfd errors, latest {} {}",
+                                    errno, strerror(errno)));
 
-            lock.lock();
+                    continue;
+                } else {
+                    throw std::runtime_error(fmt::format("select() failed: {} {}", errno, strerror(errno)));
+                }
+            }
 
             continue;
         }
 
-        lock.lock();
+        consec_badfd = 0;
+
+        // Run maintenance again so we don't dispatch purged records after the select()
+        maintenance();
+
+        std::vector<std::tuple<int, bool, bool>> ready;
+
+        for (const auto& f : fd_map) {
+            if (f.first >= FD_SETSIZE)
+                continue;
+
+            bool r = FD_ISSET(f.first, &rset);
+            bool w = FD_ISSET(f.first, &wset);
+
+            if (r || w)
+                ready.push_back(std::make_tuple(f.first, r, w));
+        }
+
+        for (const auto& r : ready)
+            dispatch(std::get<0>(r), std::get<1>(r), std::get<2>(r));
+#endif
     }
 }
 
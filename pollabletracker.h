@@ -21,26 +21,35 @@
 
 #include "config.h"
 
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+#include <thread>
 #include <vector>
 
 #include <sys/time.h>
 
 #include "kis_mutex.h"
 #include "globalregistry.h"
+#include "pollable.h"
 
 /* kis_pollable subsystem tracker
  *
- * Monitors pollable events and wraps them into a single select() loop
+ * Monitors pollable descriptors and dispatches IO to the pollables which are ready,
  * and handles erroring out sources after their events have been processed.
  *
- * Add/remove from the pollable vector is handled asynchronously to protect the
- * integrity of the pollable object itself and the internal pollable vectors;
- * adds and removes are synced at the next descriptor or poll event.
+ * On Linux, IO is handled by one or more edge-triggered epoll reactors; each pollable
+ * is pinned to a single reactor for its lifetime, so its IO is never serviced from two
+ * threads at once.  Other platforms fall back to a single select() loop.
+ *
+ * Add/remove from a reactor is handled asynchronously to protect the integrity of the
+ * pollable object itself and the reactor state; adds and removes are synced at the next
+ * pass of the reactor, and wake it if it is waiting.  Pollables whose interest changes
+ * outside of an event, such as by data queued to write, wake it the same way.
  */
 
-class kis_pollable;
-
 class pollable_tracker : public lifetime_global {
 public:
     static std::string global_name() { return "POLLABLETRACKER"; }
@@ -59,7 +68,7 @@ private:
 public:
     virtual ~pollable_tracker();
 
-    // Add a pollable item
+    // Add a pollable item; it is pinned to the least busy reactor
     void register_pollable(std::shared_ptr<kis_pollable> in_pollable);
 
     // Schedule a pollable item to be removed as soon as the current
@@ -67,62 +76,88 @@ public:
     // to remove themselves once their tasks are complete.
     void remove_pollable(std::shared_ptr<kis_pollable> in_pollable);
 
-    // Perform a select loop; blocks until polling exits
+    // Run the IO reactors; blocks until polling exits.  Additional reactor threads
+    // are started on the first call and joined before returning.
     void select_loop(bool spindown_loop);
 
-    // Perform a cleanup of any operations, like adding a pollable to the list or removing it
-    void maintenance();
-
-    // populate the FD sets for polling, populates rset and wset
-    //
-    // returns:
-    // 0+   Maximum FD to be passed to select()
-    // -1   Error
-    int merge_pollable_fds(fd_set *rset, fd_set *wset);
-   
-    // pollable_poll each item in a set
-    //
-    // returns:
-    // 0+   Number of pollable items processed
-    // -1   Error
-    int process_pollable_select(fd_set rset, fd_set wset);
-
 protected:
-    void poll_queue_processor();
+    // A single IO loop servicing the pollables pinned to it
+    class reactor {
+    public:
+        reactor();
+        ~reactor();
+
+        // Run until should_exit returns true
+        void run(const std::function<bool ()>& should_exit);
+
+        void add(std::shared_ptr<kis_pollable> in_pollable);
+        void remove(std::shared_ptr<kis_pollable> in_pollable);
 
-    class pollable_event {
-        public:
-            pollable_event(fd_set in_rset, fd_set in_wset, std::shared_ptr<kis_pollable> in_pollable) :
-                rset {in_rset},
-                wset {in_wset},
-                pollable {in_pollable} { }
+        // Re-sync a pinned pollable on the next pass, waking the reactor if it is waiting
+        void wake(kis_pollable *in_pollable);
 
-            fd_set rset, wset;
+        // Number of pinned and pending pollables
+        size_t size() const {
+            return num_pollables;
+        }
+
+    protected:
+        struct pollable_entry {
             std::shared_ptr<kis_pollable> pollable;
-    };
+            std::vector<kis_pollable_fd> fds;
+        };
+
+        // Apply pending adds, removes, and wakes
+        void maintenance();
+
+        // Wake the reactor if it is waiting, so pending changes are applied right away;
+        // must hold the reactor mutex
+        void signal();
 
-    std::queue<pollable_event> pollable_queue;
-    bool pollable_shutdown;
+        // Bring the monitored descriptors of a pollable in line with its current
+        // interest; returns false if the pollable has failed and should be removed
+        bool sync_pollable(pollable_entry& entry);
 
-    std::vector<std::thread> pollable_threads;
+        void remove_entry(kis_pollable *in_pollable);
 
-    // Poll notification cv
-    std::mutex pollqueue_cv_mutex;
-    std::condition_variable pollqueue_cv;
+        // Service a ready descriptor
+        void dispatch(int in_fd, bool in_readable, bool in_writable);
 
-    // We don't need as complex a synchronization method because we don't modify
-    // ta callback chain like we do for the packet chain; we just don't dispatch 
-    // a pollable.  Pollable items should engage a mutex during poll so it shouldn't
-    // be a problem to just remove them from the main pollable vector through
-    // the normal method of placing it into a queue that gets cleaned up by the 
-    // maintenance cycle
+        kis_recursive_timed_mutex reactor_mutex;
+        std::vector<std::shared_ptr<kis_pollable>> add_vec;
+        std::map<std::shared_ptr<kis_pollable>, int> remove_map;
+        std::set<kis_pollable *> wake_set;
+
+        // Set when a remove is queued, so a pollable removed during an event gets no more
+        // of the events from the same wait
+        std::atomic<bool> remove_pending;
+
+        std::atomic<size_t> num_pollables;
+
+        // Only accessed by the reactor thread
+        std::map<kis_pollable *, pollable_entry> pollables;
+        std::map<int, kis_pollable *> fd_map;
+
+        // Descriptor interest is periodically re-synced to catch writes queued by other
+        // threads and descriptors opened or closed outside of an event
+        std::chrono::steady_clock::time_point next_sync;
+
+#ifdef SYS_LINUX
+        int epoll_fd;
+
+        // Readable while changes are pending, so a waiting reactor returns to apply them
+        int wake_fd;
+        bool wake_signaled;
+#endif
+    };
 
-    kis_recursive_timed_mutex pollable_mutex, maintenance_mutex;
+    kis_recursive_timed_mutex pollable_mutex;
 
-    std::vector<std::shared_ptr<kis_pollable>> pollable_vec;
+    // Pollables registered before the reactors are started are assigned when the
+    // configuration is available
     std::vector<std::shared_ptr<kis_pollable>> add_vec;
-    std::map<std::shared_ptr<kis_pollable>, int> remove_map;
 
+    std::vector<std::unique_ptr<reactor>> reactors;
 };
 
 #endif
@@ -35,9 +35,13 @@ serial_client_v2::serial_client_v2(global_registry *in_globalreg,
     globalreg {in_globalreg},
     serial_mutex {in_rbhandler->get_mutex()},
     handler {in_rbhandler},
-    device_fd {-1} { }
+    device_fd {-1},
+    write_notify {[this](size_t amt) { if (amt > 0) pollable_wake(); }, nullptr} {
+        handler->set_write_buffer_interface(&write_notify);
+    }
 
 serial_client_v2::~serial_client_v2() {
+    handler->remove_write_buffer_interface();
     close_device();
 }
 
@@ -128,27 +132,20 @@ bool serial_client_v2::get_connected() {
     return device_fd > -1;
 }
 
-int serial_client_v2::pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset) {
+int serial_client_v2::pollable_interest(std::vector<kis_pollable_fd>& out_fds) {
     local_locker l(serial_mutex);
 
     if (device_fd < 0)
-        return in_max_fd;
-
-    // If we have data waiting to be written, fill it in
-    if (handler->get_write_buffer_used())
-        FD_SET(device_fd, out_wset);
-
-    // We always want to read data if we have any space
-    if (handler->get_read_buffer_available() > 0)
-        FD_SET(device_fd, out_rset);
+        return 0;
 
-    if (in_max_fd < device_fd)
-        return device_fd;
+    // We always want to read data if we have any space, and write if we have data waiting
+    out_fds.push_back(kis_pollable_fd(device_fd, handler->get_read_buffer_available() > 0,
+                handler->get_write_buffer_used() > 0));
 
-    return in_max_fd;
+    return 0;
 }
 
-int serial_client_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
+int serial_client_v2::pollable_event(int in_fd, bool in_readable, bool in_writable) {
     local_locker l(serial_mutex);
 
     std::stringstream msg;
@@ -160,7 +157,7 @@ int serial_client_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
     if (device_fd < 0)
         return 0;
 
-    if (FD_ISSET(device_fd, &in_rset)) {
+    if (in_fd == device_fd && in_readable) {
         // Trigger an event on buffer full
         if (handler->get_read_buffer_available() == 0)
             handler->trigger_read_callback(0);
@@ -208,7 +205,7 @@ int serial_client_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
         }
     }
 
-    if (FD_ISSET(device_fd, &in_wset)) {
+    if (device_fd >= 0 && in_fd == device_fd && in_writable && handler->get_write_buffer_used()) {
         len = handler->get_write_buffer_used();
 
         // Peek the data into our buffer
@@ -50,8 +50,8 @@ public:
     void close_device();
 
     // kis_pollable interface
-    virtual int pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset);
-    virtual int pollable_poll(fd_set& in_rset, fd_set& in_wset);
+    virtual int pollable_interest(std::vector<kis_pollable_fd>& out_fds);
+    virtual int pollable_event(int in_fd, bool in_readable, bool in_writable);
 
     bool get_connected();
 
@@ -66,6 +66,9 @@ protected:
 
     std::string device;
     unsigned int baud;
+
+    // Wakes our reactor when data is queued to write outside of an event
+    buffer_interface_func write_notify;
 };
 
 #endif
@@ -34,9 +34,13 @@ socket_client::socket_client(int fd, std::shared_ptr<buffer_handler_generic> in_
     handler {in_rbhandler},
     tcp_mutex {in_rbhandler->get_mutex()} ,
     cli_fd {fd},
-    connected {true} { }
+    connected {true},
+    write_notify {[this](size_t amt) { if (amt > 0) pollable_wake(); }, nullptr} {
+        handler->set_write_buffer_interface(&write_notify);
+    }
 
 socket_client::~socket_client() {
+    handler->remove_write_buffer_interface();
     disconnect();
 }
 
@@ -49,28 +53,20 @@ void socket_client::set_mutex(std::shared_ptr<kis_recursive_timed_mutex> in_pare
         tcp_mutex = std::make_shared<kis_recursive_timed_mutex>();
 }
 
-int socket_client::pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset) {
+int socket_client::pollable_interest(std::vector<kis_pollable_fd>& out_fds) {
     local_locker l(tcp_mutex);
 
     // If we lose our socket, remove ourselves from the pollable system; we cannot re-acquire
     if (!connected)
         return -1;
 
-    // If we have data waiting to be written, fill it in
-    if (handler->get_write_buffer_used()) {
-        FD_SET(cli_fd, out_wset);
-    }
-
-    // We always want to read data
-    FD_SET(cli_fd, out_rset);
+    // We always want to read data, and write if we have data waiting
+    out_fds.push_back(kis_pollable_fd(cli_fd, true, handler->get_write_buffer_used() > 0));
 
-    if (in_max_fd < cli_fd)
-        return cli_fd;
-
-    return in_max_fd;
+    return 0;
 }
 
-int socket_client::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
+int socket_client::pollable_event(int in_fd, bool in_readable, bool in_writable) {
     local_locker l(tcp_mutex);
     
     std::string msg;
@@ -84,7 +80,7 @@ int socket_client::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
     if (!connected)
         return -1;
 
-    if (FD_ISSET(cli_fd, &in_rset)) {
+    if (in_fd == cli_fd && in_readable) {
         // If we have pending data and the buffer is full, call the pending function immediately
         if (handler->get_read_buffer_available() == 0)
             handler->trigger_read_callback(0);
@@ -145,7 +141,7 @@ int socket_client::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
         }
     }
 
-    if (connected && FD_ISSET(cli_fd, &in_wset) && handler->get_write_buffer_used()) {
+    if (connected && in_fd == cli_fd && in_writable && handler->get_write_buffer_used()) {
         // Peek the entire data 
         len = handler->zero_copy_peek_write_buffer_data((void **) &buf, 
                 handler->get_write_buffer_used());
@@ -28,6 +28,7 @@
 #include "entrytracker.h"
 #include "structured.h"
 #include "devicetracker.h"
+#include "msgpack_adapter.h"
 
 shared_tracker_element storage_loader::storage_to_tracker(shared_structured d) {
 
@@ -196,6 +197,8 @@ shared_tracker_element storage_loader::storage_to_tracker(shared_structured d) {
                     if (re != NULL) 
                         std::static_pointer_cast<tracker_element_double_map>(elem)->insert(i.first, re);
                 }
+
+                break;
             case tracker_type::tracker_string_map:
                 elem = std::make_shared<tracker_element_string_map>();
 
@@ -236,6 +239,200 @@ shared_tracker_element storage_loader::storage_to_tracker(shared_structured d) {
                 objtypestr + "' " + std::string(e.what()));
     }
 
+    elem->set_id(elemid);
+
     return elem;
 }
 
+namespace {
+
+template<typename T, typename V>
+shared_tracker_element msgpack_scalar(int id, const V& v) {
+    auto e = std::make_shared<T>(id);
+    e->set(v);
+    return e;
+}
+
+shared_tracker_element msgpack_to_tracker(msgpack_adapter::reader& r,
+        const std::function<int (const std::string&)>& field_id) {
+    // A nil object is a NULL reference, skip it
+    if (r.read_nil())
+        return nullptr;
+
+    if (r.read_array() != 3)
+        throw std::runtime_error("expected [name, type, data] storage record");
+
+    auto objname = r.read_str();
+    auto objtype = static_cast<tracker_type>(r.read_uint());
+    auto elemid = field_id(objname);
+
+    size_t n;
+
+    try {
+        switch (objtype) {
+            case tracker_type::tracker_int8:
+                return msgpack_scalar<tracker_element_int8>(elemid, r.read_int());
+            case tracker_type::tracker_uint8:
+                return msgpack_scalar<tracker_element_uint8>(elemid, r.read_uint());
+            case tracker_type::tracker_int16:
+                return msgpack_scalar<tracker_element_int16>(elemid, r.read_int());
+            case tracker_type::tracker_uint16:
+                return msgpack_scalar<tracker_element_uint16>(elemid, r.read_uint());
+            case tracker_type::tracker_int32:
+                return msgpack_scalar<tracker_element_int32>(elemid, r.read_int());
+            case tracker_type::tracker_uint32:
+                return msgpack_scalar<tracker_element_uint32>(elemid, r.read_uint());
+            case tracker_type::tracker_int64:
+                return msgpack_scalar<tracker_element_int64>(elemid, r.read_int());
+            case tracker_type::tracker_uint64:
+                return msgpack_scalar<tracker_element_uint64>(elemid, r.read_uint());
+            case tracker_type::tracker_float:
+                return msgpack_scalar<tracker_element_float>(elemid, r.read_double());
+            case tracker_type::tracker_double:
+                return msgpack_scalar<tracker_element_double>(elemid, r.read_double());
+            case tracker_type::tracker_string:
+                return msgpack_scalar<tracker_element_string>(elemid, r.read_str());
+            case tracker_type::tracker_byte_array:
+                return msgpack_scalar<tracker_element_byte_array>(elemid, r.read_bin());
+            case tracker_type::tracker_mac_addr:
+                return msgpack_scalar<tracker_element_mac_addr>(elemid, r.read_mac());
+            case tracker_type::tracker_uuid:
+                return msgpack_scalar<tracker_element_uuid>(elemid, r.read_uuid());
+            case tracker_type::tracker_key:
+                return msgpack_scalar<tracker_element_device_key>(elemid, r.read_key());
+            case tracker_type::tracker_vector_double:
+                {
+                    auto elem = std::make_shared<tracker_element_vector_double>(elemid);
+                    for (n = r.read_array(); n > 0; n--)
+                        elem->push_back(r.read_double());
+                    return elem;
+                }
+            case tracker_type::tracker_vector_string:
+                {
+                    auto elem = std::make_shared<tracker_element_vector_string>(elemid);
+                    for (n = r.read_array(); n > 0; n--)
+                        elem->push_back(r.read_str());
+                    return elem;
+                }
+            case tracker_type::tracker_vector:
+                {
+                    auto elem = std::make_shared<tracker_element_vector>(elemid);
+                    for (n = r.read_array(); n > 0; n--) {
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->push_back(re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_map:
+                {
+                    auto elem = std::make_shared<tracker_element_map>(elemid);
+                    for (n = r.read_array(); n > 0; n--) {
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->insert(re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_int_map:
+                {
+                    auto elem = std::make_shared<tracker_element_int_map>(elemid);
+                    for (n = r.read_map(); n > 0; n--) {
+                        int k = r.read_int();
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->insert(k, re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_hashkey_map:
+                {
+                    auto elem = std::make_shared<tracker_element_hashkey_map>(elemid);
+                    for (n = r.read_map(); n > 0; n--) {
+                        size_t k = r.read_uint();
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->insert(k, re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_double_map:
+                {
+                    auto elem = std::make_shared<tracker_element_double_map>(elemid);
+                    for (n = r.read_map(); n > 0; n--) {
+                        double k = r.read_double();
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->insert(k, re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_mac_map:
+                {
+                    auto elem = std::make_shared<tracker_element_mac_map>(elemid);
+                    for (n = r.read_map(); n > 0; n--) {
+                        auto k = r.read_mac();
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->insert(k, re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_string_map:
+                {
+                    auto elem = std::make_shared<tracker_element_string_map>(elemid);
+                    for (n = r.read_map(); n > 0; n--) {
+                        auto k = r.read_str();
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->insert(k, re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_key_map:
+                {
+                    auto elem = std::make_shared<tracker_element_device_key_map>(elemid);
+                    for (n = r.read_map(); n > 0; n--) {
+                        auto k = r.read_key();
+                        if (k.get_error())
+                            throw std::runtime_error("unable to process device key in keymap");
+
+                        auto re = msgpack_to_tracker(r, field_id);
+                        if (re != nullptr)
+                            elem->insert(k, re);
+                    }
+                    return elem;
+                }
+            case tracker_type::tracker_double_map_double:
+                {
+                    auto elem = std::make_shared<tracker_element_double_map_double>(elemid);
+                    for (n = r.read_map(); n > 0; n--) {
+                        double k = r.read_double();
+                        elem->insert(k, r.read_double());
+                    }
+                    return elem;
+                }
+            default:
+                throw std::runtime_error(fmt::format("unknown trackerelement type {}",
+                            static_cast<int>(objtype)));
+        }
+    } catch (const msgpack_adapter::msgpack_exception& e) {
+        throw std::runtime_error("unable to process field '" + objname + "' type '" + 
+                tracker_element::type_to_typestring(objtype) + "' " + std::string(e.what()));
+    }
+}
+
+}
+
+shared_tracker_element storage_loader::storage_msgpack_to_tracker(const std::string& in_data) {
+    return storage_msgpack_to_tracker(in_data, [](const std::string& name) {
+            return Globalreg::globalreg->entrytracker->get_field_id(name);
+        });
+}
+
+shared_tracker_element storage_loader::storage_msgpack_to_tracker(const std::string& in_data,
+        const std::function<int (const std::string&)>& in_field_id) {
+    msgpack_adapter::reader r(in_data.data(), in_data.length());
+    return msgpack_to_tracker(r, in_field_id);
+}
+
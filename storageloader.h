@@ -21,6 +21,7 @@
 #ifndef __STORAGELOADER_H__
 #define __STORAGELOADER_H__
 
+#include <functional>
 #include <string>
 #include <memory>
 #include <fstream>
@@ -39,6 +40,13 @@ namespace storage_loader {
 
 shared_tracker_element storage_to_tracker(shared_structured d); 
 
+// Convert a storagemsgpack record; throws std::runtime_error on malformed records
+shared_tracker_element storage_msgpack_to_tracker(const std::string& in_data);
+
+// As above, resolving field names to ids with in_field_id instead of the entrytracker
+shared_tracker_element storage_msgpack_to_tracker(const std::string& in_data,
+        const std::function<int (const std::string&)>& in_field_id);
+
 };
 
 #endif
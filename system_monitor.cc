@@ -36,6 +36,8 @@
 #include "globalregistry.h"
 #include "json_adapter.h"
 #include "kis_databaselogfile.h"
+#include "messagebus.h"
+#include "packetchain.h"
 #include "system_monitor.h"
 #include "util.h"
 #include "version.h"
@@ -64,6 +66,78 @@ Systemmonitor::Systemmonitor() :
     // Link the RRD out of the devicetracker
     status->insert(devicetracker->get_packets_rrd());
 
+    pool_hits_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.packet_pool.hits",
+                tracker_element_factory<tracker_element_uint64>(),
+                "allocations served from recycled objects");
+    pool_misses_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.packet_pool.misses",
+                tracker_element_factory<tracker_element_uint64>(),
+                "allocations which required a new object");
+    pool_free_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.packet_pool.free",
+                tracker_element_factory<tracker_element_uint64>(),
+                "idle objects held for re-use");
+
+#ifdef PROFILE_MUTEX
+    mutex_profile_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex",
+                tracker_element_factory<tracker_element_map>(),
+                "lock contention profile");
+    mutex_name_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.name",
+                tracker_element_factory<tracker_element_string>(),
+                "mutex name");
+    mutex_acquisitions_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.acquisitions",
+                tracker_element_factory<tracker_element_uint64>(),
+                "times the mutex was acquired");
+    mutex_contended_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.contended",
+                tracker_element_factory<tracker_element_uint64>(),
+                "acquisitions which had to wait for another thread");
+    mutex_wait_total_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.wait_total_us",
+                tracker_element_factory<tracker_element_uint64>(),
+                "total time spent waiting, in microseconds");
+    mutex_wait_max_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.wait_max_us",
+                tracker_element_factory<tracker_element_uint64>(),
+                "longest single wait, in microseconds");
+    mutex_hold_total_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.hold_total_us",
+                tracker_element_factory<tracker_element_uint64>(),
+                "total time held, in microseconds");
+    mutex_hold_max_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.hold_max_us",
+                tracker_element_factory<tracker_element_uint64>(),
+                "longest single hold, in microseconds");
+    mutex_wait_histogram_id =
+        Globalreg::globalreg->entrytracker->register_field("kismet.system.mutex.wait_histogram",
+                tracker_element_factory<tracker_element_vector>(),
+                "acquisitions by wait time, power-of-two microsecond buckets starting at <1us");
+
+    mutex_profile_endp =
+        std::make_shared<kis_net_httpd_simple_tracked_endpoint>("/system/mutex_profile",
+                [this]() -> std::shared_ptr<tracker_element> {
+                    return mutex_profile_endp_handler();
+                });
+
+    auto mutex_summary_s =
+        Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("mutex_profile_summary_rate", 60);
+
+    if (mutex_summary_s > 0) {
+        mutex_profile_timer =
+            timetracker->register_timer(SERVER_TIMESLICES_SEC * mutex_summary_s, nullptr, 1,
+                    [this](int) -> int {
+                        log_mutex_profile();
+                        return 1;
+                    });
+    } else {
+        mutex_profile_timer = -1;
+    }
+#endif
+
     // Set the startup time
     status->set_timestamp_start_sec(time(0));
 
@@ -196,11 +270,56 @@ Systemmonitor::~Systemmonitor() {
     if (timetracker != nullptr) {
         timetracker->remove_timer(timer_id);
         timetracker->remove_timer(kismetdb_log_timer);
+#ifdef PROFILE_MUTEX
+        timetracker->remove_timer(mutex_profile_timer);
+#endif
     }
 
     eventbus->remove_listener(logopen_evt_id);
 }
 
+#ifdef PROFILE_MUTEX
+std::shared_ptr<tracker_element> Systemmonitor::mutex_profile_endp_handler() {
+    auto ret = std::make_shared<tracker_element_vector>();
+
+    for (auto p : kis_mutex_profiler::profiles()) {
+        auto m = std::make_shared<tracker_element_map>(mutex_profile_id);
+
+        m->insert(std::make_shared<tracker_element_string>(mutex_name_id, p->name));
+        m->insert(std::make_shared<tracker_element_uint64>(mutex_acquisitions_id, p->acquisitions.load()));
+        m->insert(std::make_shared<tracker_element_uint64>(mutex_contended_id, p->contended.load()));
+        m->insert(std::make_shared<tracker_element_uint64>(mutex_wait_total_id, p->wait_total_us.load()));
+        m->insert(std::make_shared<tracker_element_uint64>(mutex_wait_max_id, p->wait_max_us.load()));
+        m->insert(std::make_shared<tracker_element_uint64>(mutex_hold_total_id, p->hold_total_us.load()));
+        m->insert(std::make_shared<tracker_element_uint64>(mutex_hold_max_id, p->hold_max_us.load()));
+
+        // Bucket counts are reported as integers rather than doubles
+        auto hist = std::make_shared<tracker_element_vector>(mutex_wait_histogram_id);
+        for (unsigned int b = 0; b < kis_mutex_profile::wait_buckets; b++)
+            hist->push_back(std::make_shared<tracker_element_uint64>(0, p->wait_histogram[b].load()));
+        m->insert(hist);
+
+        ret->push_back(m);
+    }
+
+    return ret;
+}
+
+void Systemmonitor::log_mutex_profile() {
+    auto profiles = kis_mutex_profiler::profiles();
+    unsigned int n = 0;
+
+    for (auto p : profiles) {
+        if (p->contended.load() == 0 || n++ >= 5)
+            break;
+
+        _MSG_INFO("Mutex profile: {} acquired {} times, {} contended, waited {}ms total "
+                "({}us max), held {}us max", p->name, p->acquisitions.load(), p->contended.load(),
+                p->wait_total_us.load() / 1000, p->wait_max_us.load(), p->hold_max_us.load());
+    }
+}
+#endif
+
 void tracked_system_status::register_fields() {
     register_field("kismet.system.battery.percentage", "remaining battery percentage", &battery_perc);
     register_field("kismet.system.battery.charging", "battery charging state", &battery_charging);
@@ -227,6 +346,9 @@ void tracked_system_status::register_fields() {
 
     register_field("kismet.system.sensors.fan", "fan sensors", &sensors_fans);
     register_field("kismet.system.sensors.temp", "temperature sensors", &sensors_temp);
+
+    register_field("kismet.system.packet_pools", "packet and packet component recycling pools", 
+            &packet_pools);
 }
 
 int Systemmonitor::timetracker_event(int eventid) {
@@ -238,6 +360,21 @@ int Systemmonitor::timetracker_event(int eventid) {
     status->set_devices(num_devices);
     status->get_devices_rrd()->add_sample(num_devices, time(0));
 
+    // Packet pool usage
+    status->get_packet_pools()->clear();
+
+    if (Globalreg::globalreg->packetchain != nullptr) {
+        for (auto p : Globalreg::globalreg->packetchain->get_packet_pools()) {
+            auto pool = std::make_shared<tracker_element_map>();
+
+            pool->insert(std::make_shared<tracker_element_uint64>(pool_hits_id, p->get_hits()));
+            pool->insert(std::make_shared<tracker_element_uint64>(pool_misses_id, p->get_misses()));
+            pool->insert(std::make_shared<tracker_element_uint64>(pool_free_id, p->get_size()));
+
+            status->get_packet_pools()->insert(p->get_name(), pool);
+        }
+    }
+
 #ifdef SYS_LINUX
     // Grab the memory from /proc
     std::string procline;
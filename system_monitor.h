@@ -97,6 +97,8 @@ public:
     __ProxyTrackable(sensors_fans, tracker_element_string_map, sensors_fans);
     __ProxyTrackable(sensors_temp, tracker_element_string_map, sensors_temp);
 
+    __ProxyTrackable(packet_pools, tracker_element_string_map, packet_pools);
+
     virtual void pre_serialize() override;
 
 protected:
@@ -129,6 +131,8 @@ protected:
 
     std::shared_ptr<tracker_element_string_map> sensors_fans;
     std::shared_ptr<tracker_element_string_map> sensors_temp;
+
+    std::shared_ptr<tracker_element_string_map> packet_pools;
 };
 
 class Systemmonitor : public lifetime_global, public time_tracker_event {
@@ -168,6 +172,20 @@ protected:
     long mem_per_page;
 
     int kismetdb_log_timer;
+
+    int pool_hits_id, pool_misses_id, pool_free_id;
+
+#ifdef PROFILE_MUTEX
+    std::shared_ptr<tracker_element> mutex_profile_endp_handler();
+    void log_mutex_profile();
+
+    std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> mutex_profile_endp;
+    int mutex_profile_timer;
+
+    int mutex_profile_id, mutex_name_id, mutex_acquisitions_id, mutex_contended_id,
+        mutex_wait_total_id, mutex_wait_max_id, mutex_hold_total_id, mutex_hold_max_id,
+        mutex_wait_histogram_id;
+#endif
 };
 
 #endif
@@ -37,9 +37,13 @@ tcp_client_v2::tcp_client_v2(global_registry *in_globalreg,
     tcp_mutex {in_rbhandler->get_mutex()} ,
     pending_connect {false}, 
     connected {false}, 
-    cli_fd {-1} { }
+    cli_fd {-1},
+    write_notify {[this](size_t amt) { if (amt > 0) pollable_wake(); }, nullptr} {
+        handler->set_write_buffer_interface(&write_notify);
+    }
 
 tcp_client_v2::~tcp_client_v2() {
+    handler->remove_write_buffer_interface();
     disconnect();
 }
 
@@ -121,36 +125,26 @@ int tcp_client_v2::connect(std::string in_host, unsigned int in_port) {
     return 0;
 }
 
-int tcp_client_v2::pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset) {
+int tcp_client_v2::pollable_interest(std::vector<kis_pollable_fd>& out_fds) {
     local_locker l(tcp_mutex);
 
-    // All we fill in is the descriptor for writing if we're still trying to
+    // All we monitor is the descriptor for writing if we're still trying to
     // connect
     if (pending_connect) {
-        FD_SET(cli_fd, out_wset);
-        if (in_max_fd < cli_fd)
-            return cli_fd;
-        return in_max_fd;
+        out_fds.push_back(kis_pollable_fd(cli_fd, false, true));
+        return 0;
     }
 
     if (!connected)
-        return in_max_fd;
-
-    // If we have data waiting to be written, fill it in
-    if (handler->get_write_buffer_used()) {
-        FD_SET(cli_fd, out_wset);
-    }
-
-    // We always want to read data
-    FD_SET(cli_fd, out_rset);
+        return 0;
 
-    if (in_max_fd < cli_fd)
-        return cli_fd;
+    // We always want to read data, and write if we have data waiting
+    out_fds.push_back(kis_pollable_fd(cli_fd, true, handler->get_write_buffer_used() > 0));
 
-    return in_max_fd;
+    return 0;
 }
 
-int tcp_client_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
+int tcp_client_v2::pollable_event(int in_fd, bool in_readable, bool in_writable) {
     local_locker l(tcp_mutex);
     
     std::string msg;
@@ -161,7 +155,7 @@ int tcp_client_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
 
     if (pending_connect) {
         // See if connect has completed
-        if (FD_ISSET(cli_fd, &in_wset)) {
+        if (in_fd == cli_fd && in_writable) {
             int r, e;
             socklen_t l;
 
@@ -198,7 +192,7 @@ int tcp_client_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
     if (!connected)
         return 0;
 
-    if (FD_ISSET(cli_fd, &in_rset)) {
+    if (in_fd == cli_fd && in_readable) {
         // If we have pending data and the buffer is full, call the pending function immediately
         if (handler->get_read_buffer_available() == 0)
             handler->trigger_read_callback(0);
@@ -260,7 +254,7 @@ int tcp_client_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
         }
     }
 
-    if (connected && FD_ISSET(cli_fd, &in_wset) && handler->get_write_buffer_used()) {
+    if (connected && in_fd == cli_fd && in_writable && handler->get_write_buffer_used()) {
         // Peek the entire data 
         len = handler->zero_copy_peek_write_buffer_data((void **) &buf, 
                 handler->get_write_buffer_used());
@@ -134,48 +134,44 @@ int tcp_server_v2::configure_server(short int in_port, unsigned int in_maxcli,
     return 1;
 }
 
-int tcp_server_v2::pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset) {
+int tcp_server_v2::pollable_interest(std::vector<kis_pollable_fd>& out_fds) {
     local_locker l(&tcp_mutex);
 
-    int maxfd = in_max_fd;
-
     if (!valid)
         return -1;
 
-    if (server_fd >= 0) {
-        FD_SET(server_fd, out_rset);
-        if (maxfd < server_fd)
-            maxfd = server_fd;
-    }
+    if (server_fd >= 0)
+        out_fds.push_back(kis_pollable_fd(server_fd, true, false));
 
-    return maxfd;
+    return 0;
 }
 
 
-int tcp_server_v2::pollable_poll(fd_set& in_rset, fd_set& in_wset) {
+int tcp_server_v2::pollable_event(int in_fd, bool in_readable, bool in_writable) {
     local_locker l(&tcp_mutex);
 
     if (!valid)
         return -1;
 
     int accept_fd = 0;
-    if (server_fd >= 0 && FD_ISSET(server_fd, &in_rset)) {
-        if ((accept_fd = accept_connection()) <= 0)
-            return 0;
+    if (server_fd >= 0 && in_fd == server_fd && in_readable) {
+        // Accept everything pending; the listen socket is non-blocking and we may only
+        // be told about new connections once
+        while ((accept_fd = accept_connection()) > 0) {
+            if (!allow_connection(accept_fd)) {
+                close(accept_fd);
+                continue;
+            }
 
-        if (!allow_connection(accept_fd)) {
-            close(accept_fd);
-            return 0;
-        }
+            if (new_connection_cb == nullptr) {
+                close(accept_fd);
+                _MSG_ERROR("TCP server on port {} cannot accept new connections as "
+                        "no new connection callback has been registered.", port);
+                return 0;
+            }
 
-        if (new_connection_cb == nullptr) {
-            close(accept_fd);
-            _MSG_ERROR("TCP server on port {} cannot accept new connections as "
-                    "no new connection callback has been registered.", port);
-            return 0;
+            new_connection_cb(accept_fd);
         }
-
-        new_connection_cb(accept_fd);
     }
 
     return 0;
@@ -68,8 +68,8 @@ public:
     virtual void shutdown();
 
     // kis_pollable
-    virtual int pollable_merge_set(int in_max_fd, fd_set *out_rset, fd_set *out_wset);
-    virtual int pollable_poll(fd_set& in_rset, fd_set& in_wset);
+    virtual int pollable_interest(std::vector<kis_pollable_fd>& out_fds);
+    virtual int pollable_event(int in_fd, bool in_readable, bool in_writable);
 protected:
     kis_recursive_timed_mutex tcp_mutex;
 
@@ -0,0 +1,101 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __TEST_HARNESS_H__
+#define __TEST_HARNESS_H__
+
+#include "config.h"
+
+#include <string>
+
+#include <stdio.h>
+
+#include "macaddr.h"
+
+/* Shared helpers for the standalone test harnesses
+ *
+ * Failures are counted and the first 20 are printed; a harness returns nonzero
+ * from main when test_failures() is not 0.
+ *
+ * Harnesses which link trackedelement.cc.o without the rest of the server define
+ * TEST_HARNESS_TRACKER_STUBS before including this header, in the one file of the
+ * harness, for stand-ins of the global registry and the entrytracker lookups.  No
+ * field is ever resolved through them; fields are built with local names or ids.
+ *
+ */
+
+inline unsigned int& test_failures() {
+    static unsigned int failures = 0;
+    return failures;
+}
+
+inline void fail(const std::string& what) {
+    if (++test_failures() <= 20)
+        fprintf(stderr, "FAIL %s\n", what.c_str());
+}
+
+inline void expect(const std::string& what, bool ok) {
+    if (!ok)
+        fail(what);
+}
+
+inline void expect(const std::string& what, const std::string& expected, const std::string& got) {
+    if (expected == got)
+        return;
+
+    if (++test_failures() <= 20)
+        fprintf(stderr, "FAIL %s:\n  expected %s\n  got      %s\n", what.c_str(),
+                expected.c_str(), got.c_str());
+}
+
+// mac_addr has no integer constructor which uses the value
+inline mac_addr test_mac(uint64_t v) {
+    uint8_t b[6];
+
+    for (unsigned int i = 0; i < 6; i++)
+        b[i] = (v >> (8 * (5 - i))) & 0xFF;
+
+    return mac_addr(b, 6);
+}
+
+#ifdef TEST_HARNESS_TRACKER_STUBS
+#include "entrytracker.h"
+#include "globalregistry.h"
+
+global_registry *Globalreg::globalreg = nullptr;
+
+int entry_tracker::get_field_id(const std::string& in_name) {
+    return -1;
+}
+
+std::string entry_tracker::get_field_name(int in_id) {
+    return "";
+}
+
+std::string entry_tracker::get_field_description(int in_id) {
+    return "";
+}
+
+std::shared_ptr<tracker_element> entry_tracker::register_and_get_field(const std::string& in_name,
+        std::unique_ptr<tracker_element> in_builder, const std::string& in_desc) {
+    return nullptr;
+}
+#endif
+
+#endif
+
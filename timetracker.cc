@@ -23,19 +23,34 @@
 
 #include <sys/time.h>
 
+#include "configfile.h"
+#include "messagebus.h"
 #include "timetracker.h"
 
 time_tracker::time_tracker() {
     time_mutex.set_name("time_tracker");
-    removed_id_mutex.set_name("time_tracker_removed_id");
 
     next_timer_id = 0;
 
-    timer_sort_required = true;
-
     Globalreg::globalreg->start_time = time(0);
 	gettimeofday(&(Globalreg::globalreg->timestamp), NULL);
 
+    timer_wheel.resize(timer_wheel_slots);
+    wheel_slice = timeval_to_slice(Globalreg::globalreg->timestamp, false);
+
+    timer_slow_us = 0;
+
+    if (Globalreg::globalreg->kismet_config != NULL) {
+        auto pool_threads =
+            Globalreg::globalreg->kismet_config->fetch_opt_uint("timer_worker_threads", 0);
+
+        timer_slow_us = 1000 *
+            Globalreg::globalreg->kismet_config->fetch_opt_ulong("timer_worker_slow_ms", 50);
+
+        if (pool_threads > 0)
+            timer_pool.reset(new kis_work_pool("timer worker", pool_threads));
+    }
+
     shutdown = false;
 
     /*
@@ -64,6 +79,9 @@ time_tracker::~time_tracker() {
 
     // time_dispatch_t.join();
 
+    // Let any slow timers running on the pool finish before we free them
+    timer_pool.reset();
+
     Globalreg::globalreg->RemoveGlobal("TIMETRACKER");
     Globalreg::globalreg->timetracker = NULL;
 
@@ -73,44 +91,41 @@ time_tracker::~time_tracker() {
         delete x->second;
 }
 
-void time_tracker::Tick() {
-    local_demand_locker lock(&time_mutex);
+uint64_t time_tracker::timeval_to_slice(const struct timeval& tv, bool round_up) {
+    const uint64_t slice_us = 1000000L / SERVER_TIMESLICES_SEC;
+    uint64_t us = ((uint64_t) tv.tv_sec * 1000000L) + tv.tv_usec;
 
-    // Handle scheduled events
-    struct timeval cur_tm;
-    gettimeofday(&cur_tm, NULL);
-    Globalreg::globalreg->timestamp.tv_sec = cur_tm.tv_sec;
-    Globalreg::globalreg->timestamp.tv_usec = cur_tm.tv_usec;
+    if (round_up)
+        return (us + slice_us - 1) / slice_us;
+
+    return us / slice_us;
+}
 
-    // Sort and duplicate the vector to a safe list; we have to re-sort 
-    // timers from recurring events
-    lock.lock();
+void time_tracker::schedule_timer(timer_event *evt) {
+    // A timer can't fire in a slice we've already processed; anything already in the
+    // past fires on the next tick
+    evt->trigger_slice = std::max(timeval_to_slice(evt->trigger_tm, true), wheel_slice);
 
-    if (timer_sort_required)
-        stable_sort(sorted_timers.begin(), sorted_timers.end(), SortTimerEventsTrigger());
+    auto& slot = timer_wheel[evt->trigger_slice % timer_wheel_slots];
+    evt->wheel_pos = slot.insert(slot.end(), evt);
+    evt->scheduled = true;
+}
 
-    timer_sort_required = false;
+void time_tracker::unschedule_timer(timer_event *evt) {
+    if (!evt->scheduled)
+        return;
 
-    auto action_timers = std::vector<timer_event *>(sorted_timers.begin(), sorted_timers.end());
-    lock.unlock();
-    // Sort the timers
+    timer_wheel[evt->trigger_slice % timer_wheel_slots].erase(evt->wheel_pos);
+    evt->scheduled = false;
+}
 
-    for (auto evt : action_timers) {
-        // If we're pending cancellation, throw us out
-        if (evt->timer_cancelled) {
-            local_locker rl(&removed_id_mutex);
-            removed_timer_ids.push_back(evt->timer_id);
-            continue;
-        }
+void time_tracker::run_timer(timer_event *evt) {
+    int ret = 0;
 
-        // We're into the future, bail
-        if ((cur_tm.tv_sec < evt->trigger_tm.tv_sec) ||
-            ((cur_tm.tv_sec == evt->trigger_tm.tv_sec) && (cur_tm.tv_usec < evt->trigger_tm.tv_usec))) {
-            break;
-		}
+    if (!evt->timer_cancelled) {
+        auto start = std::chrono::steady_clock::now();
 
         // Call the function with the given parameters
-        int ret = 0;
         if (evt->callback != NULL) {
             ret = (*evt->callback)(evt, evt->callback_parm, Globalreg::globalreg);
         } else if (evt->event != NULL) {
@@ -119,143 +134,99 @@ void time_tracker::Tick() {
             ret = evt->event_func(evt->timer_id);
         }
 
-        if (ret > 0 && evt->timeslices != -1 && evt->recurring) {
-            evt->schedule_tm.tv_sec = cur_tm.tv_sec;
-            evt->schedule_tm.tv_usec = cur_tm.tv_usec;
-            evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (evt->timeslices / SERVER_TIMESLICES_SEC);
-            evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-				((evt->timeslices % SERVER_TIMESLICES_SEC) * (1000000L / SERVER_TIMESLICES_SEC));
+        if (timer_pool != nullptr && !evt->run_async && 
+                (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count() > timer_slow_us)
+            evt->run_async = true;
+    }
 
-            if (evt->trigger_tm.tv_usec >= 999999L) {
-                evt->trigger_tm.tv_sec++;
-                evt->trigger_tm.tv_usec %= 1000000L;
-            }
+    local_locker l(&time_mutex);
 
-            timer_sort_required = true;
-        } else {
-            local_locker rl(&removed_id_mutex);
-            removed_timer_ids.push_back(evt->timer_id);
-            continue;
-        }
-    }
+    if (!evt->timer_cancelled && ret > 0 && evt->timeslices != -1 && evt->recurring) {
+        gettimeofday(&(evt->schedule_tm), NULL);
 
-    {
-        // Actually remove the timers under dual lock
-        local_locker l(&time_mutex);
-        local_locker rl(&removed_id_mutex);
-        for (auto x : removed_timer_ids) {
-            auto itr = timer_map.find(x);
-
-            if (itr != timer_map.end()) {
-                for (auto sorted_itr = sorted_timers.begin(); sorted_itr != sorted_timers.end(); ++sorted_itr) {
-                    if ((*sorted_itr)->timer_id == x) {
-                        sorted_timers.erase(sorted_itr);
-                        break;
-                    }
-                }
+        evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (evt->timeslices / SERVER_TIMESLICES_SEC);
+        evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
+            ((evt->timeslices % SERVER_TIMESLICES_SEC) * (1000000L / SERVER_TIMESLICES_SEC));
 
-                delete itr->second;
-                timer_map.erase(itr);
-            }
+        if (evt->trigger_tm.tv_usec >= 999999L) {
+            evt->trigger_tm.tv_sec++;
+            evt->trigger_tm.tv_usec %= 1000000L;
         }
 
-        removed_timer_ids.clear();
+        schedule_timer(evt);
+    } else {
+        timer_map.erase(evt->timer_id);
+        delete evt;
     }
 }
 
-void time_tracker::time_dispatcher() {
-    while (!shutdown && !Globalreg::globalreg->spindown && !Globalreg::globalreg->fatal_condition) {
-        local_demand_locker lock(&time_mutex);
+void time_tracker::Tick() {
+    // Handle scheduled events
+    struct timeval cur_tm;
+    gettimeofday(&cur_tm, NULL);
+    Globalreg::globalreg->timestamp.tv_sec = cur_tm.tv_sec;
+    Globalreg::globalreg->timestamp.tv_usec = cur_tm.tv_usec;
 
-        // Calculate the next tick
-        auto start = std::chrono::system_clock::now();
-        auto end = start + std::chrono::milliseconds(1000 / SERVER_TIMESLICES_SEC);
+    auto cur_slice = timeval_to_slice(cur_tm, false);
 
-        // Handle scheduled events
-        struct timeval cur_tm;
-        gettimeofday(&cur_tm, NULL);
-        Globalreg::globalreg->timestamp.tv_sec = cur_tm.tv_sec;
-        Globalreg::globalreg->timestamp.tv_usec = cur_tm.tv_usec;
+    std::vector<timer_event *> action_timers;
 
-        // Sort and duplicate the vector to a safe list; we have to re-sort 
-        // timers from recurring events
-        lock.lock();
+    {
+        local_locker lock(&time_mutex);
 
-        if (timer_sort_required)
-            stable_sort(sorted_timers.begin(), sorted_timers.end(), SortTimerEventsTrigger());
+        // If the clock went backwards, pick up from the new time; pending timers wait
+        // for their original trigger time as they always have
+        if (cur_slice + 1 < wheel_slice)
+            wheel_slice = cur_slice + 1;
 
-        timer_sort_required = false;
+        if (cur_slice >= wheel_slice) {
+            // Visit each slot which has come due since the last tick, but never more
+            // than one full turn of the wheel
+            uint64_t n_slots = std::min<uint64_t>(cur_slice - wheel_slice + 1, timer_wheel_slots);
 
-        auto action_timers = std::vector<timer_event *>(sorted_timers.begin(), sorted_timers.end());
-        lock.unlock();
-        // Sort the timers
+            for (uint64_t s = 0; s < n_slots; s++) {
+                auto& slot = timer_wheel[(wheel_slice + s) % timer_wheel_slots];
 
-        for (auto evt : action_timers) {
-            // If we're pending cancellation, throw us out
-            if (evt->timer_cancelled) {
-                local_locker rl(&removed_id_mutex);
-                removed_timer_ids.push_back(evt->timer_id);
-                continue;
-            }
+                for (auto i = slot.begin(); i != slot.end(); ) {
+                    auto evt = *i;
 
-            // We're into the future, bail
-            if ((cur_tm.tv_sec < evt->trigger_tm.tv_sec) ||
-                    ((cur_tm.tv_sec == evt->trigger_tm.tv_sec) && (cur_tm.tv_usec < evt->trigger_tm.tv_usec))) {
-                break;
-            }
+                    // Timers on a later turn of the wheel stay put
+                    if (evt->trigger_slice > cur_slice) {
+                        ++i;
+                        continue;
+                    }
 
-            // Call the function with the given parameters
-            int ret = 0;
-            if (evt->callback != NULL) {
-                ret = (*evt->callback)(evt, evt->callback_parm, Globalreg::globalreg);
-            } else if (evt->event != NULL) {
-                ret = evt->event->timetracker_event(evt->timer_id);
-            } else if (evt->event_func != NULL) {
-                ret = evt->event_func(evt->timer_id);
+                    i = slot.erase(i);
+                    evt->scheduled = false;
+                    action_timers.push_back(evt);
+                }
             }
 
-            if (ret > 0 && evt->timeslices != -1 && evt->recurring) {
-                evt->schedule_tm.tv_sec = cur_tm.tv_sec;
-                evt->schedule_tm.tv_usec = cur_tm.tv_usec;
-                evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (evt->timeslices / SERVER_TIMESLICES_SEC);
-                evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-                    ((evt->timeslices % SERVER_TIMESLICES_SEC) * (1000000L / SERVER_TIMESLICES_SEC));
+            wheel_slice = cur_slice + 1;
+        }
+    }
 
-                if (evt->trigger_tm.tv_usec >= 999999L) {
-                    evt->trigger_tm.tv_sec++;
-                    evt->trigger_tm.tv_usec %= 1000000L;
-                }
+    // Fire in trigger order
+    std::stable_sort(action_timers.begin(), action_timers.end(), SortTimerEventsTrigger());
 
-                timer_sort_required = true;
-            } else {
-                local_locker rl(&removed_id_mutex);
-                removed_timer_ids.push_back(evt->timer_id);
-                continue;
-            }
+    for (auto evt : action_timers) {
+        if (evt->run_async && !evt->timer_cancelled && timer_pool != nullptr) {
+            timer_pool->submit([this, evt]() { run_timer(evt); });
+            continue;
         }
 
-        {
-            // Actually remove the timers under dual lock
-            local_locker l(&time_mutex);
-            local_locker rl(&removed_id_mutex);
-            for (auto x : removed_timer_ids) {
-                auto itr = timer_map.find(x);
-
-                if (itr != timer_map.end()) {
-                    for (auto sorted_itr = sorted_timers.begin(); sorted_itr != sorted_timers.end(); ++sorted_itr) {
-                        if ((*sorted_itr)->timer_id == x) {
-                            sorted_timers.erase(sorted_itr);
-                            break;
-                        }
-                    }
+        run_timer(evt);
+    }
+}
 
-                    delete itr->second;
-                    timer_map.erase(itr);
-                }
-            }
+void time_tracker::time_dispatcher() {
+    while (!shutdown && !Globalreg::globalreg->spindown && !Globalreg::globalreg->fatal_condition) {
+        // Calculate the next tick
+        auto start = std::chrono::system_clock::now();
+        auto end = start + std::chrono::milliseconds(1000 / SERVER_TIMESLICES_SEC);
 
-            removed_timer_ids.clear();
-        }
+        Tick();
 
         /*
         if (std::chrono::system_clock::now() >= end) {
@@ -264,50 +235,12 @@ void time_tracker::time_dispatcher() {
         }
         */
 
-
         std::this_thread::sleep_until(end);
     }
 }
 
-int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
-                               int in_recurring, 
-                               int (*in_callback)(TIMEEVENT_PARMS),
-                               void *in_parm) {
-    local_locker l(&time_mutex);
-
-    timer_event *evt = new timer_event;
-
-    evt->timer_id = next_timer_id++;
-    gettimeofday(&(evt->schedule_tm), NULL);
-
-    if (in_trigger != NULL) {
-        evt->trigger_tm.tv_sec = in_trigger->tv_sec;
-        evt->trigger_tm.tv_usec = in_trigger->tv_usec;
-        evt->timeslices = -1;
-    } else {
-        evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (in_timeslices / 10);
-        evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + (in_timeslices % 10);
-        evt->timeslices = in_timeslices;
-    }
-
-    evt->recurring = in_recurring;
-    evt->callback = in_callback;
-    evt->callback_parm = in_parm;
-    evt->event = NULL;
-
-    timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
-
-    // Resort the list
-    timer_sort_required = true;
-
-    return evt->timer_id;
-}
-
-int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
-        int in_recurring, time_tracker_event *in_event) {
-    local_locker l(&time_mutex);
-
+time_tracker::timer_event *time_tracker::new_timer_event(int in_timeslices, 
+        struct timeval *in_trigger, int in_recurring) {
     timer_event *evt = new timer_event;
 
     evt->timer_cancelled = false;
@@ -323,93 +256,92 @@ int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
         evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + 
             (in_timeslices / SERVER_TIMESLICES_SEC);
         evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-            ((in_timeslices % SERVER_TIMESLICES_SEC) *
+            ((in_timeslices % SERVER_TIMESLICES_SEC) * 
              (1000000L / SERVER_TIMESLICES_SEC));
+        evt->timeslices = in_timeslices;
 
         if (evt->trigger_tm.tv_usec >= 999999L) {
             evt->trigger_tm.tv_sec++;
             evt->trigger_tm.tv_usec %= 1000000L;
         }
-            
-        evt->timeslices = in_timeslices;
     }
 
     evt->recurring = in_recurring;
     evt->callback = NULL;
     evt->callback_parm = NULL;
-    evt->event = in_event;
+    evt->event = NULL;
 
-    timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
+    evt->trigger_slice = 0;
+    evt->scheduled = false;
+    evt->run_async = false;
+
+    return evt;
+}
+
+int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
+                               int in_recurring, 
+                               int (*in_callback)(TIMEEVENT_PARMS),
+                               void *in_parm) {
+    local_locker l(&time_mutex);
 
-    // Resort the list
-    timer_sort_required = true;
+    timer_event *evt = new_timer_event(in_timeslices, in_trigger, in_recurring);
+
+    evt->callback = in_callback;
+    evt->callback_parm = in_parm;
+
+    timer_map[evt->timer_id] = evt;
+    schedule_timer(evt);
 
     return evt->timer_id;
 }
 
 int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
-        int in_recurring, std::function<int (int)> in_event) {
+        int in_recurring, time_tracker_event *in_event) {
     local_locker l(&time_mutex);
 
-    timer_event *evt = new timer_event;
+    timer_event *evt = new_timer_event(in_timeslices, in_trigger, in_recurring);
 
-    evt->timer_cancelled = false;
-    evt->timer_id = next_timer_id++;
+    evt->event = in_event;
 
-    gettimeofday(&(evt->schedule_tm), NULL);
+    timer_map[evt->timer_id] = evt;
+    schedule_timer(evt);
 
-    if (in_trigger != NULL) {
-        evt->trigger_tm.tv_sec = in_trigger->tv_sec;
-        evt->trigger_tm.tv_usec = in_trigger->tv_usec;
-        evt->timeslices = -1;
-    } else {
-        evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + 
-            (in_timeslices / SERVER_TIMESLICES_SEC);
-        evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + 
-            ((in_timeslices % SERVER_TIMESLICES_SEC) * 
-             (1000000L / SERVER_TIMESLICES_SEC));
-        evt->timeslices = in_timeslices;
+    return evt->timer_id;
+}
 
-        if (evt->trigger_tm.tv_usec >= 999999L) {
-            evt->trigger_tm.tv_sec++;
-            evt->trigger_tm.tv_usec %= 1000000L;
-        }
-    }
+int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
+        int in_recurring, std::function<int (int)> in_event) {
+    local_locker l(&time_mutex);
+
+    timer_event *evt = new_timer_event(in_timeslices, in_trigger, in_recurring);
 
-    evt->recurring = in_recurring;
-    evt->callback = NULL;
-    evt->callback_parm = NULL;
-    evt->event = NULL;
-    
     evt->event_func = in_event;
 
     timer_map[evt->timer_id] = evt;
-    sorted_timers.push_back(evt);
-
-    // Resort the list
-    timer_sort_required = true;
+    schedule_timer(evt);
 
     return evt->timer_id;
 }
 
 int time_tracker::remove_timer(int in_timerid) {
-    // Removing a timer sets the atomic cancelled and puts us on the abort list;
-    // we'll get cleaned out of the main list the next iteration through the main code.
-    
+    // A timer waiting in the wheel is removed immediately; a timer which is currently
+    // running is flagged as cancelled and released when it completes
     local_locker lock(&time_mutex);
 
     auto itr = timer_map.find(in_timerid);
 
-    if (itr != timer_map.end()) {
-        itr->second->timer_cancelled = true;
-
-        local_locker rl(&removed_id_mutex);
-        removed_timer_ids.push_back(in_timerid);
-    } else {
+    if (itr == timer_map.end())
         return 0;
+
+    auto evt = itr->second;
+
+    evt->timer_cancelled = true;
+
+    if (evt->scheduled) {
+        unschedule_timer(evt);
+        timer_map.erase(itr);
+        delete evt;
     }
 
     return 1;
 }
-
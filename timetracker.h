@@ -25,6 +25,7 @@
 #include <time.h>
 #include <list>
 #include <map>
+#include <memory>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -33,6 +34,7 @@
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
+#include "kis_work_pool.h"
 
 // For ubertooth and a few older plugins that compile against both svn and old
 #define KIS_NEW_TIMER_PARM	1
@@ -69,6 +71,15 @@ public:
         // C function, if we weren't
         int (*callback)(timer_event *, void *, global_registry *);
         void *callback_parm;
+
+        // Absolute timeslice the timer fires in, and its position in the timer wheel
+        // while it is waiting to fire
+        uint64_t trigger_slice;
+        bool scheduled;
+        std::list<timer_event *>::iterator wheel_pos;
+
+        // Callback has been slow in the past and is run on the timer worker pool
+        bool run_async;
     };
 
     // Sort alerts by alert trigger time
@@ -126,17 +137,38 @@ protected:
 
     void time_dispatcher(void);
 
-    // Do we have to re-sort the list of timers?
-    std::atomic<bool> timer_sort_required;
-
     // Next timer ID to be assigned
     std::atomic<int> next_timer_id;
 
     std::map<int, timer_event *> timer_map;
-    std::vector<timer_event *> sorted_timers;
 
-    kis_recursive_timed_mutex removed_id_mutex;
-    std::vector<int> removed_timer_ids;
+    // Pending timers are kept in a hashed timer wheel; each slot covers one 
+    // timeslice and holds every timer which fires in a slice landing on that slot,
+    // on this or a later turn of the wheel.  Scheduling and cancelling a timer are
+    // constant time, and a tick only looks at the slots which have come due.
+    const static unsigned int timer_wheel_slots = 1024;
+    std::vector<std::list<timer_event *>> timer_wheel;
+
+    // Next timeslice to be processed
+    uint64_t wheel_slice;
+
+    static uint64_t timeval_to_slice(const struct timeval& tv, bool round_up);
+
+    // Common setup of a new timer event; time_mutex must be held
+    timer_event *new_timer_event(int in_timeslices, struct timeval *in_trigger, 
+            int in_recurring);
+
+    // Add or remove a timer from the wheel; time_mutex must be held
+    void schedule_timer(timer_event *evt);
+    void unschedule_timer(timer_event *evt);
+
+    // Run a due timer and reschedule or release it
+    void run_timer(timer_event *evt);
+
+    // Timer callbacks which take longer than timer_slow_us are moved to the timer 
+    // worker pool, if one is configured, so they don't delay the other timers
+    std::unique_ptr<kis_work_pool> timer_pool;
+    unsigned long timer_slow_us;
 
     std::thread time_dispatch_t;
     std::atomic<bool> shutdown;
@@ -0,0 +1,335 @@
+/* memory benchmark for tracked component fields
+ *
+ * Builds the scalar fields of an access point record (kis_tracked_device_base,
+ * kis_tracked_signal_data, dot11_tracked_device, and one dot11_advertised_ssid) for
+ * a large number of devices, and reports the heap used per device for:
+ *
+ *   previous   the field layout before the field arena: a std::string local name in
+ *              every element, the coercion range stored in every numeric element, and
+ *              one allocation plus one shared_ptr control block per field
+ *   per-field  the current field layout, still allocated one field at a time; this is
+ *              how dynamic fields, containers, and nested components are built
+ *   arena      the current field layout packed into one tracker_element_arena per
+ *              component, as tracker_component::reserve_fields does
+ *
+ * Each field is held in an id-keyed map per component, as the component map holds
+ * them.  Containers, nested components, and dynamic fields are built the same way in
+ * every case, so they're left out.
+ *
+ * # configure and build kismet
+ * ./configure
+ * make
+ *
+ * # build benchmark
+ * g++ -O2 -o tracked_field_bench tracked_field_bench.cc trackedelement.cc.o \
+ *     util.cc.o macaddr.cc.o uuid.cc.o
+ *
+ * ./tracked_field_bench [devices]
+ *
+ */
+
+#include "config.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "entrytracker.h"
+#include "globalregistry.h"
+#include "trackedelement.h"
+
+// Field names and paths are never looked up here, so the entrytracker isn't linked;
+// these satisfy the references from trackedelement.cc
+global_registry *Globalreg::globalreg = nullptr;
+
+int entry_tracker::get_field_id(const std::string& in_name) {
+    return -1;
+}
+
+std::string entry_tracker::get_field_name(int in_id) {
+    return "";
+}
+
+std::shared_ptr<tracker_element> entry_tracker::register_and_get_field(const std::string& in_name,
+        std::unique_ptr<tracker_element> in_builder, const std::string& in_desc) {
+    return nullptr;
+}
+
+// Element layouts before the field arena
+class legacy_element {
+public:
+    legacy_element(int in_id) :
+        type {0},
+        id {in_id} { }
+    virtual ~legacy_element() { }
+
+    int type;
+    int id;
+    std::string local_name;
+};
+
+template<typename P>
+class legacy_scalar : public legacy_element {
+public:
+    legacy_scalar(int in_id) :
+        legacy_element(in_id),
+        value() { }
+
+    P value;
+};
+
+template<typename N>
+class legacy_numeric : public legacy_element {
+public:
+    legacy_numeric(int in_id) :
+        legacy_element(in_id),
+        value_min {0},
+        value_max {0},
+        value {0} { }
+
+    double value_min, value_max;
+    N value;
+};
+
+template<typename T> struct legacy_of { };
+template<> struct legacy_of<tracker_element_string> { using type = legacy_scalar<std::string>; };
+template<> struct legacy_of<tracker_element_mac_addr> { using type = legacy_scalar<mac_addr>; };
+template<> struct legacy_of<tracker_element_uuid> { using type = legacy_scalar<uuid>; };
+template<> struct legacy_of<tracker_element_device_key> { using type = legacy_scalar<device_key>; };
+template<> struct legacy_of<tracker_element_uint8> { using type = legacy_numeric<uint8_t>; };
+template<> struct legacy_of<tracker_element_uint16> { using type = legacy_numeric<uint16_t>; };
+template<> struct legacy_of<tracker_element_int32> { using type = legacy_numeric<int32_t>; };
+template<> struct legacy_of<tracker_element_uint32> { using type = legacy_numeric<uint32_t>; };
+template<> struct legacy_of<tracker_element_uint64> { using type = legacy_numeric<uint64_t>; };
+template<> struct legacy_of<tracker_element_double> { using type = legacy_numeric<double>; };
+
+// Scalar fields reserved by each component of an access point record
+template<typename B>
+void build_device(B& b) {
+    // kis_tracked_device_base
+    b.begin();
+    b.template add<tracker_element_device_key>(1);
+    b.template add<tracker_element_mac_addr>(1);
+    b.template add<tracker_element_string>(7);
+    b.template add<tracker_element_int32>(1);
+    b.template add<tracker_element_uint64>(15);
+    b.template add<tracker_element_double>(1);
+    b.template add<tracker_element_uint32>(1);
+    b.template add<tracker_element_uuid>(1);
+    b.end();
+
+    // kis_tracked_signal_data
+    b.begin();
+    b.template add<tracker_element_string>(1);
+    b.template add<tracker_element_int32>(6);
+    b.template add<tracker_element_double>(1);
+    b.template add<tracker_element_uint64>(2);
+    b.end();
+
+    // dot11_tracked_device
+    b.begin();
+    b.template add<tracker_element_uint64>(15);
+    b.template add<tracker_element_uint8>(5);
+    b.template add<tracker_element_uint32>(3);
+    b.end();
+
+    // dot11_advertised_ssid
+    b.begin();
+    b.template add<tracker_element_string>(3);
+    b.template add<tracker_element_uint32>(4);
+    b.template add<tracker_element_uint8>(9);
+    b.template add<tracker_element_uint64>(5);
+    b.template add<tracker_element_double>(2);
+    b.template add<tracker_element_uint16>(2);
+    b.end();
+}
+
+// Previous layout, one allocation per field
+class legacy_builder {
+public:
+    void begin() {
+        components.push_back(std::unordered_map<int, std::shared_ptr<legacy_element>>());
+        next_id = 0;
+    }
+
+    template<typename T>
+    void add(unsigned int in_count) {
+        using ltype = typename legacy_of<T>::type;
+
+        for (unsigned int i = 0; i < in_count; i++) {
+            // Converted from a unique_ptr, as clone_type() was, so with its own control block
+            auto f = std::shared_ptr<legacy_element>(std::unique_ptr<ltype>(new ltype(next_id)));
+            components.back()[next_id++] = f;
+        }
+    }
+
+    void end() { }
+
+    std::vector<std::unordered_map<int, std::shared_ptr<legacy_element>>> components;
+    int next_id;
+};
+
+// Current layout, one allocation per field
+class field_builder {
+public:
+    void begin() {
+        components.push_back(std::unordered_map<int, shared_tracker_element>());
+        next_id = 0;
+    }
+
+    template<typename T>
+    void add(unsigned int in_count) {
+        for (unsigned int i = 0; i < in_count; i++) {
+            auto f = shared_tracker_element(T().clone_type(next_id));
+            components.back()[next_id++] = f;
+        }
+    }
+
+    void end() { }
+
+    std::vector<std::unordered_map<int, shared_tracker_element>> components;
+    int next_id;
+};
+
+// Current layout in a field arena per component
+class arena_builder {
+public:
+    struct pending {
+        tracker_element_arena::builder_t builder;
+        size_t size;
+        size_t align;
+    };
+
+    void begin() {
+        components.push_back(std::unordered_map<int, shared_tracker_element>());
+        fields.clear();
+    }
+
+    template<typename T>
+    void add(unsigned int in_count) {
+        for (unsigned int i = 0; i < in_count; i++)
+            fields.push_back(pending{tracker_element_arena::builder_for<T>(), sizeof(T), alignof(T)});
+    }
+
+    void end() {
+        size_t sz = 0;
+
+        for (auto& f : fields)
+            sz = tracker_element_arena::reserve(sz, f.size, f.align);
+
+        auto arena = std::make_shared<tracker_element_arena>(sz, fields.size());
+
+        int id = 0;
+        for (auto& f : fields) {
+            components.back()[id] = arena->emplace(f.builder, f.size, f.align, id);
+            id++;
+        }
+    }
+
+    std::vector<std::unordered_map<int, shared_tracker_element>> components;
+    std::vector<pending> fields;
+};
+
+static size_t heap_used() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return mallinfo().uordblks;
+#endif
+}
+
+template<typename B>
+void bench(const char *in_name, size_t in_devices) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::unique_ptr<B>> devices;
+    devices.reserve(in_devices);
+
+    auto vec_heap = heap_used();
+
+    for (size_t i = 0; i < in_devices; i++) {
+        auto d = std::unique_ptr<B>(new B());
+        build_device(*d);
+        devices.push_back(std::move(d));
+    }
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    auto used = heap_used() - vec_heap;
+
+    printf("%-12s %8lu devices %10.1f bytes/device %8.1f MB %10.1f ns/device\n", in_name,
+            in_devices, (double) used / in_devices, (double) used / (1024 * 1024),
+            (us * 1000.0f) / in_devices);
+}
+
+int main(int argc, char *argv[]) {
+    size_t n_devices = 100000;
+
+    if (argc > 1)
+        n_devices = strtoul(argv[1], NULL, 10);
+
+    if (n_devices == 0) {
+        fprintf(stderr, "usage: %s [devices]\n", argv[0]);
+        exit(1);
+    }
+
+    // Fields in the arena behave like any other field
+    arena_builder check;
+    build_device(check);
+
+    for (auto& c : check.components) {
+        for (auto& f : c) {
+            if (f.second->get_id() != f.first) {
+                fprintf(stderr, "arena field %d has id %d\n", f.first, f.second->get_id());
+                exit(1);
+            }
+
+            if (f.second->get_type() == tracker_type::tracker_uint64) {
+                auto u = std::static_pointer_cast<tracker_element_uint64>(f.second);
+                u->set(f.first);
+                (*u) += 1;
+
+                if (u->get() != (uint64_t) f.first + 1) {
+                    fprintf(stderr, "arena field %d holds %lu\n", f.first, u->get());
+                    exit(1);
+                }
+            } else if (f.second->get_type() == tracker_type::tracker_string) {
+                auto s = std::static_pointer_cast<tracker_element_string>(f.second);
+                s->set(std::string(64, 'x'));
+            }
+        }
+    }
+
+    // A field keeps its arena alive after the rest of the component is gone
+    auto held = check.components[0][2];
+    check.components.clear();
+    std::static_pointer_cast<tracker_element_string>(held)->set("still valid");
+    held.reset();
+
+    printf("element sizes: uint8 %lu, uint64 %lu, double %lu, string %lu, mac_addr %lu\n",
+            sizeof(tracker_element_uint8), sizeof(tracker_element_uint64),
+            sizeof(tracker_element_double), sizeof(tracker_element_string),
+            sizeof(tracker_element_mac_addr));
+    printf("previous sizes: uint8 %lu, uint64 %lu, double %lu, string %lu, mac_addr %lu\n",
+            sizeof(legacy_numeric<uint8_t>), sizeof(legacy_numeric<uint64_t>),
+            sizeof(legacy_numeric<double>), sizeof(legacy_scalar<std::string>),
+            sizeof(legacy_scalar<mac_addr>));
+
+    // Fault in the heap first so the first case isn't charged for it
+    {
+        std::vector<legacy_builder> warm(n_devices);
+        for (auto& d : warm)
+            build_device(d);
+    }
+
+    bench<legacy_builder>("previous", n_devices);
+    bench<field_builder>("per-field", n_devices);
+    bench<arena_builder>("arena", n_devices);
+
+    return 0;
+}
+
@@ -44,6 +44,23 @@ int tracker_component::register_field(const std::string& in_name,
 }
 
 void tracker_component::reserve_fields(std::shared_ptr<tracker_element_map> e) {
+    // Size the arena for the scalar fields we have to build
+    size_t arena_sz = 0;
+    size_t arena_count = 0;
+
+    for (auto& rf : registered_fields) {
+        if (rf->assign != nullptr && !rf->dynamic && rf->arena_builder != nullptr &&
+                build_in_arena(e, rf->id)) {
+            arena_sz = tracker_element_arena::reserve(arena_sz, rf->arena_size, rf->arena_align);
+            arena_count++;
+        }
+    }
+
+    std::shared_ptr<tracker_element_arena> arena;
+
+    if (arena_count > 0)
+        arena = std::make_shared<tracker_element_arena>(arena_sz, arena_count);
+
     for (unsigned int i = 0; i < registered_fields.size(); i++) {
         auto& rf = registered_fields[i];
 
@@ -53,12 +70,36 @@ void tracker_component::reserve_fields(std::shared_ptr<tracker_element_map> e) {
                 // proxydynamictrackable can fill it in;
                 *(rf->assign) = nullptr;
                 insert(rf->id, std::shared_ptr<tracker_element>());
+            } else if (arena != nullptr && rf->arena_builder != nullptr && 
+                    build_in_arena(e, rf->id)) {
+                // Build scalars in the arena; the arena lives as long as any of its fields
+                auto r = arena->emplace(rf->arena_builder, rf->arena_size, rf->arena_align, 
+                        rf->id);
+                insert(r);
+                *(rf->assign) = r;
             } else {
                 // otherwise generate a variable for the destination
                 *(rf->assign) = import_or_new(e, rf->id);
             }
         }
     }
+
+    // Registrations are only needed to build the fields; drop them instead of 
+    // carrying them for the life of every component
+    registered_fields.clear();
+    registered_fields.shrink_to_fit();
+}
+
+bool tracker_component::build_in_arena(std::shared_ptr<tracker_element_map> e, int i) {
+    if (e != nullptr && e->get_type() == tracker_type::tracker_map && e->get_sub(i) != nullptr)
+        return false;
+
+    auto existing = find(i);
+
+    if (existing != end() && existing->second != nullptr)
+        return false;
+
+    return true;
 }
 
 shared_tracker_element tracker_component::import_or_new(std::shared_ptr<tracker_element_map> e, int i) {
@@ -75,6 +75,23 @@ class tracker_component : public tracker_element_map {
         SetTrackerValue<ptype>(cvar, static_cast<ptype>(in)); \
     }
 
+// Standard proxy, but set_<name> calls <fn>() when the new value differs from the
+// current one, instead of on every set; used to track changes to the content of a
+// component without comparing it later
+#define __ProxyOnChange(name, ptype, itype, rtype, cvar, fn) \
+    virtual shared_tracker_element get_tracker_##name() const { \
+        return (std::shared_ptr<tracker_element>) cvar; \
+    } \
+    virtual rtype get_##name() const { \
+        return (rtype) get_tracker_value<ptype>(cvar); \
+    } \
+    virtual void set_##name(const itype& in) { \
+        if (cvar->get() != static_cast<ptype>(in)) { \
+            cvar->set(static_cast<ptype>(in)); \
+            fn(); \
+        } \
+    }
+
 // Ugly macro for standard proxy access but with an additional mutex; this should
 // be a kis_recursive_timed_mutex and is used with local_locker(...)
 #define __ProxyM(name, ptype, itype, rtype, cvar, mvar) \
@@ -450,6 +467,25 @@ class tracker_component : public tracker_element_map {
         return std::static_pointer_cast<tracker_element>(cvar); \
     } 
 
+// Proxy sub-trackable which calls <fn>() when set_<name> replaces the trackable
+#define __ProxyTrackableOnChange(name, ttype, cvar, fn) \
+    virtual std::shared_ptr<ttype> get_##name() { \
+        return cvar; \
+    } \
+    virtual void set_##name(std::shared_ptr<ttype> in) { \
+        if (cvar == in) \
+            return; \
+        if (cvar != NULL) \
+            erase(cvar); \
+        cvar = in; \
+        if (in != NULL) \
+            insert(cvar); \
+        fn(); \
+    }  \
+    virtual shared_tracker_element get_tracker_##name() { \
+        return std::static_pointer_cast<tracker_element>(cvar); \
+    } 
+
 // Proxy sub-trackable (name, trackable type, class variable), with mutex
 #define __ProxyTrackableM(name, ttype, cvar, mutex) \
     virtual std::shared_ptr<ttype> get_##name() { \
@@ -619,6 +655,24 @@ class tracker_component : public tracker_element_map {
         return (dtype) (get_tracker_value<dtype>(cvar) & bs); \
     }
 
+// Proxy bitset functions which call <fn>() when the bitset changes
+#define __ProxyBitsetOnChange(name, dtype, cvar, fn) \
+    virtual void bitset_##name(dtype bs) { \
+        if ((get_tracker_value<dtype>(cvar) & bs) != bs) { \
+            (*cvar) |= bs; \
+            fn(); \
+        } \
+    } \
+    virtual void bitclear_##name(dtype bs) { \
+        if (get_tracker_value<dtype>(cvar) & bs) { \
+            (*cvar) &= ~(bs); \
+            fn(); \
+        } \
+    } \
+    virtual dtype bitcheck_##name(dtype bs) { \
+        return (dtype) (get_tracker_value<dtype>(cvar) & bs); \
+    }
+
 // Proxy bitset functions (name, trackable type, data type, class var), with mutex
 #define __ProxyBitsetM(name, dtype, cvar, mutex) \
     virtual void bitset_##name(dtype bs) { \
@@ -700,13 +754,24 @@ protected:
 
     // Register a field, automatically deriving its type from the provided destination
     // field.  The destination field must be specified.
+    //
+    // Scalar fields are built in the field arena of the component.
     template<typename T>
     int register_field(const std::string& in_name, const std::string& in_desc, 
             std::shared_ptr<T> *in_dest) {
         using build_type = typename std::remove_reference<decltype(**in_dest)>::type;
 
-        return register_field(in_name, tracker_element_factory<build_type>(), in_desc, 
+        auto id = register_field(in_name, tracker_element_factory<build_type>(), in_desc, 
                 reinterpret_cast<shared_tracker_element *>(in_dest));
+
+        if (in_dest != nullptr) {
+            auto& rf = registered_fields.back();
+            rf->arena_builder = tracker_element_arena::builder_for<build_type>();
+            rf->arena_size = sizeof(build_type);
+            rf->arena_align = alignof(build_type);
+        }
+
+        return id;
     }
 
     // Register a field, automatically deriving its type from the provided destination
@@ -749,11 +814,17 @@ protected:
     // Add imported or new field to our map for use tracking.
     virtual shared_tracker_element import_or_new(std::shared_ptr<tracker_element_map> e, int i);
 
+    // Does a field need to be built in the arena, or is it imported or already present
+    bool build_in_arena(std::shared_ptr<tracker_element_map> e, int i);
+
     class registered_field {
         public:
             registered_field(int id, shared_tracker_element *assign) { 
                 this->id = id; 
                 this->assign = assign;
+                this->arena_builder = nullptr;
+                this->arena_size = 0;
+                this->arena_align = 0;
 
                 if (assign == nullptr)
                     this->dynamic = true;
@@ -769,11 +840,19 @@ protected:
                 this->id = id;
                 this->assign = assign;
                 this->dynamic = dynamic;
+                this->arena_builder = nullptr;
+                this->arena_size = 0;
+                this->arena_align = 0;
             }
 
             int id;
             bool dynamic;
             shared_tracker_element *assign;
+
+            // In-place builder for packable fields
+            tracker_element_arena::builder_t arena_builder;
+            size_t arena_size;
+            size_t arena_align;
     };
 
     std::vector<std::unique_ptr<registered_field>> registered_fields;
@@ -393,6 +393,34 @@ tracker_type tracker_element::typestring_to_type(const std::string& s) {
     throw std::runtime_error("Unable to interpret tracker type " + s);
 }
 
+tracker_element_arena::tracker_element_arena(size_t in_size, size_t in_count) :
+    block {new char[in_size]},
+    block_sz {in_size},
+    block_used {0} {
+    elements.reserve(in_count);
+}
+
+tracker_element_arena::~tracker_element_arena() {
+    for (auto e : elements)
+        e->~tracker_element();
+}
+
+shared_tracker_element tracker_element_arena::emplace(builder_t in_builder, size_t in_size, 
+        size_t in_align, int in_id) {
+    auto end = reserve(block_used, in_size, in_align);
+
+    if (end > block_sz)
+        throw std::runtime_error(fmt::format("tracked field arena overflow placing {} bytes "
+                    "at {} of {}", in_size, block_used, block_sz));
+
+    auto e = (*in_builder)(block.get() + (end - in_size), in_id);
+    elements.push_back(e);
+    block_used = end;
+
+    // Share the control block of the arena
+    return shared_tracker_element(shared_from_this(), e);
+}
+
 template<> std::string get_tracker_value(const shared_tracker_element& e) {
 #if TE_TYPE_SAFETY == 1
     e->enforce_type(tracker_type::tracker_string);
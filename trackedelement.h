@@ -25,6 +25,7 @@
 #include <stdint.h>
 
 #include <functional>
+#include <limits>
 
 #include <string>
 #include <stdexcept>
@@ -236,11 +237,23 @@ public:
     }
 
     void set_local_name(const std::string& in_name) {
-        local_name = in_name;
+        if (in_name.length() == 0) {
+            local_name.reset();
+            return;
+        }
+
+        local_name.reset(new std::string(in_name));
     }
 
     std::string get_local_name() {
-        return local_name;
+        if (local_name == nullptr)
+            return "";
+
+        return *local_name;
+    }
+
+    bool has_local_name() const {
+        return local_name != nullptr;
     }
 
     void set_dynamic_entity(const std::string& in_name) {
@@ -293,8 +306,9 @@ protected:
     tracker_type type;
     int tracked_id;
 
-    // Overridden name for this instance only
-    std::string local_name;
+    // Overridden name for this instance only; rarely used, so only allocated when set
+    // instead of costing a full string in every element
+    std::unique_ptr<std::string> local_name;
 };
 
 // Generator function for making various elements
@@ -322,7 +336,7 @@ public:
     tracker_element_alias(const std::string& al, std::shared_ptr<tracker_element> e) :
         tracker_element{tracker_type::tracker_alias},
         alias_element{e} {
-            local_name = al;
+            set_local_name(al);
         }
 
     static tracker_type static_type() {
@@ -687,7 +701,7 @@ public:
     }
 
     virtual void coercive_set(double in_num) override {
-        if (in_num < value_min || in_num > value_max)
+        if (in_num < value_min() || in_num > value_max())
             throw std::runtime_error(fmt::format("cannot coerce to {}, number out of range",
                         this->get_type_as_string()));
 
@@ -847,30 +861,29 @@ public:
     }
 
 protected:
-    // Min/max ranges for conversion
-    double value_min, value_max;
+    // Min/max ranges for conversion; these are fixed per type, so they are provided by
+    // the subclasses instead of being stored in every element
+    virtual double value_min() const {
+        return std::numeric_limits<N>::lowest();
+    }
+
+    virtual double value_max() const {
+        return std::numeric_limits<N>::max();
+    }
+
     N value;
 };
 
 class tracker_element_uint8 : public tracker_element_core_numeric<uint8_t> {
 public:
     tracker_element_uint8() :
-        tracker_element_core_numeric<uint8_t>(tracker_type::tracker_uint8) {
-            value_min = 0;
-            value_max = INT8_MAX;
-        }
+        tracker_element_core_numeric<uint8_t>(tracker_type::tracker_uint8) { }
 
     tracker_element_uint8(int id) :
-        tracker_element_core_numeric<uint8_t>(tracker_type::tracker_uint8, id) {
-            value_min = 0;
-            value_max = INT8_MAX;
-        }
+        tracker_element_core_numeric<uint8_t>(tracker_type::tracker_uint8, id) { }
 
     tracker_element_uint8(int id, const uint8_t& v) :
-        tracker_element_core_numeric<uint8_t>(tracker_type::tracker_uint8, id, v) {
-            value_min = 0;
-            value_max = INT8_MAX;
-        }
+        tracker_element_core_numeric<uint8_t>(tracker_type::tracker_uint8, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_uint8;
@@ -887,27 +900,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return 0;
+    }
+
+    virtual double value_max() const override {
+        return INT8_MAX;
+    }
 };
 
 class tracker_element_int8 : public tracker_element_core_numeric<int8_t> {
 public:
     tracker_element_int8() :
-        tracker_element_core_numeric<int8_t>(tracker_type::tracker_int8) {
-            value_min = INT8_MIN;
-            value_max = INT8_MAX;
-        }
+        tracker_element_core_numeric<int8_t>(tracker_type::tracker_int8) { }
 
     tracker_element_int8(int id) :
-        tracker_element_core_numeric<int8_t>(tracker_type::tracker_int8, id) {
-            value_min = INT8_MIN;
-            value_max = INT8_MAX;
-        }
+        tracker_element_core_numeric<int8_t>(tracker_type::tracker_int8, id) { }
 
     tracker_element_int8(int id, const int8_t& v) :
-        tracker_element_core_numeric<int8_t>(tracker_type::tracker_int8, id, v) {
-            value_min = INT8_MIN;
-            value_max = INT8_MAX;
-        }
+        tracker_element_core_numeric<int8_t>(tracker_type::tracker_int8, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_int8;
@@ -924,27 +937,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return INT8_MIN;
+    }
+
+    virtual double value_max() const override {
+        return INT8_MAX;
+    }
 };
 
 class tracker_element_uint16 : public tracker_element_core_numeric<uint16_t> {
 public:
     tracker_element_uint16() :
-        tracker_element_core_numeric<uint16_t>(tracker_type::tracker_uint16) {
-            value_min = 0;
-            value_max = UINT16_MAX;
-        }
+        tracker_element_core_numeric<uint16_t>(tracker_type::tracker_uint16) { }
 
     tracker_element_uint16(int id) :
-        tracker_element_core_numeric<uint16_t>(tracker_type::tracker_uint16, id) {
-            value_min = 0;
-            value_max = UINT16_MAX;
-        }
+        tracker_element_core_numeric<uint16_t>(tracker_type::tracker_uint16, id) { }
 
     tracker_element_uint16(int id, const uint16_t& v) :
-        tracker_element_core_numeric<uint16_t>(tracker_type::tracker_uint16, id, v) {
-            value_min = 0;
-            value_max = UINT16_MAX;
-        }
+        tracker_element_core_numeric<uint16_t>(tracker_type::tracker_uint16, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_uint16;
@@ -961,27 +974,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return 0;
+    }
+
+    virtual double value_max() const override {
+        return UINT16_MAX;
+    }
 };
 
 class tracker_element_int16 : public tracker_element_core_numeric<int16_t> {
 public:
     tracker_element_int16() :
-        tracker_element_core_numeric<int16_t>(tracker_type::tracker_int16) {
-            value_min = INT16_MIN;
-            value_max = INT16_MAX;
-        }
+        tracker_element_core_numeric<int16_t>(tracker_type::tracker_int16) { }
 
     tracker_element_int16(int id) :
-        tracker_element_core_numeric<int16_t>(tracker_type::tracker_int16, id) {
-            value_min = INT16_MIN;
-            value_max = INT16_MAX;
-        }
+        tracker_element_core_numeric<int16_t>(tracker_type::tracker_int16, id) { }
 
     tracker_element_int16(int id, const int16_t& v) :
-        tracker_element_core_numeric<int16_t>(tracker_type::tracker_int16, id, v) {
-            value_min = INT16_MIN;
-            value_max = INT16_MAX;
-        }
+        tracker_element_core_numeric<int16_t>(tracker_type::tracker_int16, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_int16;
@@ -998,27 +1011,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return INT16_MIN;
+    }
+
+    virtual double value_max() const override {
+        return INT16_MAX;
+    }
 };
 
 class tracker_element_uint32 : public tracker_element_core_numeric<uint32_t> {
 public:
     tracker_element_uint32() :
-        tracker_element_core_numeric<uint32_t>(tracker_type::tracker_uint32) {
-            value_min = 0;
-            value_max = UINT32_MAX;
-        }
+        tracker_element_core_numeric<uint32_t>(tracker_type::tracker_uint32) { }
 
     tracker_element_uint32(int id) :
-        tracker_element_core_numeric<uint32_t>(tracker_type::tracker_uint32, id) {
-            value_min = 0;
-            value_max = UINT32_MAX;
-        }
+        tracker_element_core_numeric<uint32_t>(tracker_type::tracker_uint32, id) { }
 
     tracker_element_uint32(int id, const uint32_t& v) :
-        tracker_element_core_numeric<uint32_t>(tracker_type::tracker_uint32, id, v) {
-            value_min = 0;
-            value_max = UINT32_MAX;
-        }
+        tracker_element_core_numeric<uint32_t>(tracker_type::tracker_uint32, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_uint32;
@@ -1035,27 +1048,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return 0;
+    }
+
+    virtual double value_max() const override {
+        return UINT32_MAX;
+    }
 };
 
 class tracker_element_int32 : public tracker_element_core_numeric<int32_t> {
 public:
     tracker_element_int32() :
-        tracker_element_core_numeric<int32_t>(tracker_type::tracker_int32) {
-            value_min = INT32_MIN;
-            value_max = INT32_MAX;
-        }
+        tracker_element_core_numeric<int32_t>(tracker_type::tracker_int32) { }
 
     tracker_element_int32(int id) :
-        tracker_element_core_numeric<int32_t>(tracker_type::tracker_int32, id) {
-            value_min = INT32_MIN;
-            value_max = INT32_MAX;
-        }
+        tracker_element_core_numeric<int32_t>(tracker_type::tracker_int32, id) { }
 
     tracker_element_int32(int id, const int32_t& v) :
-        tracker_element_core_numeric<int32_t>(tracker_type::tracker_int32, id, v) {
-            value_min = INT32_MIN;
-            value_max = INT32_MAX;
-        }
+        tracker_element_core_numeric<int32_t>(tracker_type::tracker_int32, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_int32;
@@ -1072,27 +1085,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return INT32_MIN;
+    }
+
+    virtual double value_max() const override {
+        return INT32_MAX;
+    }
 };
 
 class tracker_element_uint64 : public tracker_element_core_numeric<uint64_t> {
 public:
     tracker_element_uint64() :
-        tracker_element_core_numeric<uint64_t>(tracker_type::tracker_uint64) {
-            value_min = 0;
-            value_max = UINT64_MAX;
-        }
+        tracker_element_core_numeric<uint64_t>(tracker_type::tracker_uint64) { }
 
     tracker_element_uint64(int id) :
-        tracker_element_core_numeric<uint64_t>(tracker_type::tracker_uint64, id) {
-            value_min = 0;
-            value_max = UINT64_MAX;
-        }
+        tracker_element_core_numeric<uint64_t>(tracker_type::tracker_uint64, id) { }
 
     tracker_element_uint64(int id, const uint64_t& v) :
-        tracker_element_core_numeric<uint64_t>(tracker_type::tracker_uint64, id, v) {
-            value_min = 0;
-            value_max = UINT64_MAX;
-        }
+        tracker_element_core_numeric<uint64_t>(tracker_type::tracker_uint64, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_uint64;
@@ -1109,27 +1122,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return 0;
+    }
+
+    virtual double value_max() const override {
+        return UINT64_MAX;
+    }
 };
 
 class tracker_element_int64 : public tracker_element_core_numeric<int64_t> {
 public:
     tracker_element_int64() :
-        tracker_element_core_numeric<int64_t>(tracker_type::tracker_int64) {
-            value_min = INT64_MIN;
-            value_max = INT64_MAX;
-        }
+        tracker_element_core_numeric<int64_t>(tracker_type::tracker_int64) { }
 
     tracker_element_int64(int id) :
-        tracker_element_core_numeric<int64_t>(tracker_type::tracker_int64, id) {
-            value_min = INT64_MIN;
-            value_max = INT64_MAX;
-        }
+        tracker_element_core_numeric<int64_t>(tracker_type::tracker_int64, id) { }
 
     tracker_element_int64(int id, const int64_t& v) :
-        tracker_element_core_numeric<int64_t>(tracker_type::tracker_int64, id, v) {
-            value_min = INT64_MIN;
-            value_max = INT64_MAX;
-        }
+        tracker_element_core_numeric<int64_t>(tracker_type::tracker_int64, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_int64;
@@ -1146,27 +1159,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return INT64_MIN;
+    }
+
+    virtual double value_max() const override {
+        return INT64_MAX;
+    }
 };
 
 class tracker_element_float : public tracker_element_core_numeric<float> {
 public:
     tracker_element_float() :
-        tracker_element_core_numeric<float>(tracker_type::tracker_float) {
-            value_min = std::numeric_limits<float>::min();
-            value_max = std::numeric_limits<float>::max();
-        }
+        tracker_element_core_numeric<float>(tracker_type::tracker_float) { }
 
     tracker_element_float(int id) :
-        tracker_element_core_numeric<float>(tracker_type::tracker_float, id) {
-            value_min = std::numeric_limits<float>::min();
-            value_max = std::numeric_limits<float>::max();
-        }
+        tracker_element_core_numeric<float>(tracker_type::tracker_float, id) { }
 
     tracker_element_float(int id, const float& v) :
-        tracker_element_core_numeric<float>(tracker_type::tracker_float, id, v) {
-            value_min = std::numeric_limits<float>::min();
-            value_max = std::numeric_limits<float>::max();
-        }
+        tracker_element_core_numeric<float>(tracker_type::tracker_float, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_float;
@@ -1183,27 +1196,27 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return std::numeric_limits<float>::min();
+    }
+
+    virtual double value_max() const override {
+        return std::numeric_limits<float>::max();
+    }
 };
 
 class tracker_element_double : public tracker_element_core_numeric<double> {
 public:
     tracker_element_double() :
-        tracker_element_core_numeric<double>(tracker_type::tracker_double) {
-            value_min = std::numeric_limits<double>::min();
-            value_max = std::numeric_limits<double>::max();
-        }
+        tracker_element_core_numeric<double>(tracker_type::tracker_double) { }
 
     tracker_element_double(int id) :
-        tracker_element_core_numeric<double>(tracker_type::tracker_double, id) {
-            value_min = std::numeric_limits<double>::min();
-            value_max = std::numeric_limits<double>::max();
-        }
+        tracker_element_core_numeric<double>(tracker_type::tracker_double, id) { }
 
     tracker_element_double(int id, const double& v) :
-        tracker_element_core_numeric<double>(tracker_type::tracker_double, id, v) {
-            value_min = std::numeric_limits<double>::min();
-            value_max = std::numeric_limits<double>::max();
-        }
+        tracker_element_core_numeric<double>(tracker_type::tracker_double, id, v) { }
 
     static tracker_type static_type() {
         return tracker_type::tracker_double;
@@ -1220,6 +1233,15 @@ public:
         auto dup = std::unique_ptr<this_t>(new this_t(in_id));
         return std::move(dup);
     }
+
+protected:
+    virtual double value_min() const override {
+        return std::numeric_limits<double>::min();
+    }
+
+    virtual double value_max() const override {
+        return std::numeric_limits<double>::max();
+    }
 };
 
 
@@ -1877,6 +1899,78 @@ public:
     }
 };
 
+// Packed storage for the scalar fields of a tracker_component.
+//
+// Built the normal way, every field of a component is its own heap allocation with
+// its own shared_ptr control block, which is most of the memory used by a device.
+// Scalar fields built for a new component are instead constructed back to back in 
+// a single block, and handed out as shared_ptrs which alias the arena, so they all
+// share the one control block.  The arena, and every field in it, is released when
+// the last reference to any of its fields goes away.
+//
+// The fields are still complete tracker_elements, so serialization, path queries,
+// and the proxy macros work on them unchanged.  Containers and nested components 
+// are allocated on their own as before.
+class tracker_element_arena : public std::enable_shared_from_this<tracker_element_arena> {
+protected:
+    template<typename N>
+    static std::true_type packable_test(const tracker_element_core_numeric<N> *);
+    template<typename P>
+    static std::true_type packable_test(const tracker_element_core_scalar<P> *);
+    static std::false_type packable_test(...);
+
+public:
+    // Construct a field of a packable type in place
+    using builder_t = tracker_element *(*)(void *, int);
+
+    tracker_element_arena(size_t in_size, size_t in_count);
+    ~tracker_element_arena();
+
+    tracker_element_arena(const tracker_element_arena&) = delete;
+    tracker_element_arena& operator=(const tracker_element_arena&) = delete;
+
+    // Only the scalar types are packed; their storage is fixed (or only a string)
+    template<typename T>
+    struct packable : decltype(packable_test(static_cast<T *>(nullptr))) { };
+
+    // Builder for a type, or null if the type is not packable
+    template<typename T>
+    static builder_t builder_for() {
+        return builder_for<T>(packable<T>());
+    }
+
+    // Space used by a field, starting at in_offset
+    static size_t reserve(size_t in_offset, size_t in_size, size_t in_align) {
+        return ((in_offset + in_align - 1) & ~(in_align - 1)) + in_size;
+    }
+
+    // Build a field in the arena; the arena must be owned by a shared_ptr
+    shared_tracker_element emplace(builder_t in_builder, size_t in_size, size_t in_align,
+            int in_id);
+
+protected:
+    template<typename T>
+    static tracker_element *build(void *in_mem, int in_id) {
+        return new (in_mem) T(in_id);
+    }
+
+    template<typename T>
+    static builder_t builder_for(std::true_type) {
+        return &build<T>;
+    }
+
+    template<typename T>
+    static builder_t builder_for(std::false_type) {
+        return nullptr;
+    }
+
+    std::unique_ptr<char[]> block;
+    size_t block_sz;
+    size_t block_used;
+
+    std::vector<tracker_element *> elements;
+};
+
 // Templated generic access functions
 
 template<typename T> T get_tracker_value(const shared_tracker_element&);
@@ -143,12 +143,15 @@ kis_tracked_location::kis_tracked_location(int in_id, std::shared_ptr<tracker_el
     reserve_fields(e);
 }
 
-void kis_tracked_location::add_loc(double in_lat, double in_lon, double in_alt, 
+bool kis_tracked_location::add_loc(double in_lat, double in_lon, double in_alt, 
         unsigned int fix, double in_speed, double in_heading) {
+    bool expanded = false;
+
     set_valid(1);
 
     if (fix > get_fix()) {
         set_fix(fix);
+        expanded = true;
     }
 
     if (min_loc == nullptr) {
@@ -181,27 +184,33 @@ void kis_tracked_location::add_loc(double in_lat, double in_lon, double in_alt,
 
     if (in_lat < min_loc->get_lat() || min_loc->get_lat() == 0) {
         min_loc->set_lat(in_lat);
+        expanded = true;
     }
 
     if (in_lat > max_loc->get_lat() || max_loc->get_lat() == 0) {
         max_loc->set_lat(in_lat);
+        expanded = true;
     }
 
     if (in_lon < min_loc->get_lon() || min_loc->get_lon() == 0) {
         min_loc->set_lon(in_lon);
+        expanded = true;
     }
 
     if (in_lon > max_loc->get_lon() || max_loc->get_lon() == 0) {
         max_loc->set_lon(in_lon);
+        expanded = true;
     }
 
     if (fix > 2) {
         if (in_alt < min_loc->get_alt() || min_loc->get_alt() == 0) {
             min_loc->set_alt(in_alt);
+            expanded = true;
         }
 
         if (in_alt > max_loc->get_alt() || max_loc->get_alt() == 0) {
             max_loc->set_alt(in_alt);
+            expanded = true;
         }
     }
 
@@ -244,6 +253,8 @@ void kis_tracked_location::add_loc(double in_lat, double in_lon, double in_alt,
         num_avg->set((int64_t) 1);
         num_alt_avg->set((int64_t) 1);
     }
+
+    return expanded;
 }
 
 void kis_tracked_location::register_fields() {
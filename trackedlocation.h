@@ -132,7 +132,9 @@ public:
         return std::move(dup);
     }
 
-    void add_loc(double in_lat, double in_lon, double in_alt, unsigned int fix,
+    // Add a location sample; returns true if the sample changed the fix or extended the 
+    // bounding box of the location, instead of only moving the last and average locations
+    bool add_loc(double in_lat, double in_lon, double in_alt, unsigned int fix,
             double in_speed, double in_heading);
 
     __Proxy(valid, uint8_t, bool, bool, loc_valid);
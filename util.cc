@@ -298,6 +298,53 @@ std::string str_join(const std::vector<std::string>& in_content, const std::stri
     return ostr.str();
 }
 
+bool http_accepts_encoding(const std::string& in_accept, const std::string& in_encoding) {
+    auto encoding = str_lower(in_encoding);
+
+    // Highest weight given to the coding itself and to the wildcard, or -1 if not listed
+    double coding_q = -1;
+    double wildcard_q = -1;
+
+    for (const auto& t : str_tokenize(in_accept, ",")) {
+        auto params = str_tokenize(t, ";");
+
+        if (params.size() == 0)
+            continue;
+
+        auto coding = str_lower(str_strip(params[0]));
+
+        // Codings without a weight are fully acceptable
+        double q = 1;
+
+        for (unsigned int p = 1; p < params.size(); p++) {
+            auto eq = params[p].find('=');
+
+            if (eq == std::string::npos)
+                continue;
+
+            if (str_lower(str_strip(params[p].substr(0, eq))) != "q")
+                continue;
+
+            auto v = str_strip(params[p].substr(eq + 1));
+            char *end;
+            double qv = strtod(v.c_str(), &end);
+
+            if (end != v.c_str())
+                q = qv;
+        }
+
+        if (coding == encoding)
+            coding_q = std::max(coding_q, q);
+        else if (coding == "*")
+            wildcard_q = std::max(wildcard_q, q);
+    }
+
+    if (coding_q >= 0)
+        return coding_q > 0;
+
+    return wildcard_q > 0;
+}
+
 // Collapse into basic tokenizer rewrite
 std::vector<std::string> quote_str_tokenize(const std::string& in_str, const std::string& in_split) {
     std::vector<std::string> ret;
@@ -166,6 +166,10 @@ std::vector<std::string> str_tokenize(const std::string& in_str, const std::stri
 std::string str_join(const std::vector<std::string>& in_content, const std::string& in_delim, 
         bool in_first = false);
 
+// Does an HTTP Accept-Encoding header value allow a content coding; an entry for the coding
+// itself takes precedence over the '*' wildcard, and a weight of q=0 refuses it
+bool http_accepts_encoding(const std::string& in_accept, const std::string& in_encoding);
+
 // 'smart' tokenizeing with start/end positions
 struct smart_word_token {
     std::string word;